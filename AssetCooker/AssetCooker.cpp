@@ -0,0 +1,536 @@
+﻿#include "AssetCooker.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include "BlockCompression.h"
+#include "DependencyGraph.h"
+#include "FileUtil.h"
+#include "Hash.h"
+#include "ImageLoader.h"
+#include "MeshFile.h"
+#include "MipGenerator.h"
+#include "TextureFile.h"
+#include "ThreadPool.h"
+
+#if ASSETCOOKER_FBX
+#include <future>
+#include "BatchImporter.h"
+#endif
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <objbase.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    // クッカー自体の出力が変わる修正をしたら上げる（全出力が作り直しになる）
+    constexpr uint32_t kCookerVersion = 1;
+    const char* const kGraphFileName = ".cookdeps";
+
+    // 依存関係を調べる対象の1ファイル
+    struct SourceFile
+    {
+        fs::path relative;      // 入力ディレクトリからの相対パス
+        std::string output;     // 出力ディレクトリからの相対パス（グラフのキー）
+        std::string reason;     // 作り直す理由（最新なら空）
+    };
+
+    double ElapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::string LowerExtension(const fs::path& path)
+    {
+        std::string extension = path.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+        return extension;
+    }
+
+    bool IsImage(const std::string& extension)
+    {
+#ifdef _WIN32
+        // WIC が展開できる主な形式
+        return extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".bmp" || extension == ".tif";
+#else
+        return extension == ".png";
+#endif
+    }
+
+    // 法線マップなど値そのものが意味を持つ画像か（ファイル名の末尾で判断する: foo_n.png / foo_nrm.png / foo_normal.png）
+    // こうした画像はミップを sRGB として線形空間で混ぜない
+    bool IsLinearImage(const fs::path& relative)
+    {
+        std::string stem = relative.stem().string();
+        std::transform(stem.begin(), stem.end(), stem.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+        for (const char* suffix : { "_n", "_nrm", "_normal" })
+        {
+            const size_t length = std::char_traits<char>::length(suffix);
+            if (stem.size() >= length && stem.compare(stem.size() - length, length, suffix) == 0) return true;
+        }
+        return false;
+    }
+
+    // 入力と同じ相対パスで拡張子だけを替えた出力先（フォルダは作っておく）
+    fs::path OutputPath(const std::string& outputDirectory, const fs::path& relative, const char* extension)
+    {
+        fs::path output = fs::path(outputDirectory) / relative;
+        output.replace_extension(extension);
+        std::error_code ec;
+        fs::create_directories(output.parent_path(), ec);
+        return output;
+    }
+
+    std::string OutputKey(const fs::path& relative, const char* extension)
+    {
+        fs::path output = relative;
+        output.replace_extension(extension);
+        return output.generic_u8string();
+    }
+
+    // グラフに記録する入力のパス（入力ディレクトリからの相対。別ドライブなどで相対にできなければ絶対パス）
+    std::string InputKey(const std::string& inputDirectory, const fs::path& file)
+    {
+        std::error_code ec;
+        const fs::path absolute = fs::absolute(file, ec).lexically_normal();
+        const fs::path relative = absolute.lexically_relative(fs::absolute(inputDirectory, ec).lexically_normal());
+        return (relative.empty() ? absolute : relative).generic_u8string();
+    }
+
+    // 出力を左右するインポート設定とバージョン
+    uint64_t MeshSettingsHash(const AssetCooker::CookOptions& options)
+    {
+#if ASSETCOOKER_FBX
+        Hasher hasher(ModelImporter::HashOptions(options.import));
+#else
+        Hasher hasher;  // FBX なしのビルドではメッシュは常に失敗として記録されるので設定は比べない
+#endif
+        hasher.AddValue(options.compressMeshes);
+        return hasher.Get();
+    }
+
+    uint64_t MeshVersionHash()
+    {
+        Hasher hasher;
+        hasher.AddValue(kCookerVersion);
+        hasher.AddValue(ModelImporter::kVersion);
+        hasher.AddValue(TextureAtlas::kVersion);
+        hasher.AddValue(MeshFile::kVersion);
+        return hasher.Get();
+    }
+
+    uint64_t ImageSettingsHash(const AssetCooker::CookOptions& options)
+    {
+        Hasher hasher;
+        hasher.AddValue(options.generateMips);
+        hasher.AddValue(options.mipFilter);
+        hasher.AddValue(options.textureFormat.has_value());
+        hasher.AddValue(options.textureFormat.value_or(PixelFormat::RGBA8));
+        hasher.AddValue(options.blockQuality);
+        hasher.AddValue(options.minPsnr);
+        return hasher.Get();
+    }
+
+    uint64_t ImageVersionHash()
+    {
+        Hasher hasher;
+        hasher.AddValue(kCookerVersion);
+        hasher.AddValue(kImageDecoderVersion);
+        hasher.AddValue(TextureFile::kVersion);
+        hasher.AddValue(MipGenerator::kVersion);
+        hasher.AddValue(BlockCompression::kVersion);
+        return hasher.Get();
+    }
+
+    // クックした結果をグラフに記録する（失敗したものも記録し、次回に作り直す）
+    void RecordOutput(DependencyGraph& graph, const AssetCooker::CookOptions& options, const AssetCooker::CookedAsset& asset,
+        const std::string& output, uint64_t settingsHash, uint64_t versionHash, const std::vector<std::string>& dependencies)
+    {
+        DependencyGraph::Output record;
+        record.path = output;
+        record.settingsHash = settingsHash;
+        record.versionHash = versionHash;
+        record.succeeded = asset.succeeded;
+        record.inputs.push_back({ asset.source, graph.HashInput(options.inputDirectory, asset.source) });
+        for (const std::string& file : dependencies)
+        {
+            const std::string input = InputKey(options.inputDirectory, fs::u8path(file));
+            record.inputs.push_back({ input, graph.HashInput(options.inputDirectory, input) });
+        }
+        graph.Set(record);
+    }
+
+    // 画像1枚: 読み込み -> RGBA8 に展開 -> ミップ生成 -> BC 圧縮 -> TextureFile で書き出し
+    AssetCooker::CookedAsset CookImage(const AssetCooker::CookOptions& options, const fs::path& relative, ThreadPool* pool,
+        AssetCooker::CookSummary& summary, std::mutex& mutex)
+    {
+        auto start = std::chrono::steady_clock::now();
+        AssetCooker::CookedAsset asset;
+        asset.kind = AssetCooker::AssetKind::Image;
+        asset.source = relative.generic_u8string();
+
+        std::vector<unsigned char> source;
+        if (!ReadFileBytes(fs::path(options.inputDirectory) / relative, source))
+        {
+            asset.error = "cannot read file";
+            return asset;
+        }
+        asset.sourceBytes = source.size();
+
+#ifdef _WIN32
+        // WIC は呼び出しスレッドで COM が初期化されている必要がある
+        const HRESULT com = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+#endif
+        auto stageStart = std::chrono::steady_clock::now();
+        ImageData image;
+        const bool decoded = DecodeImageRGBA8(source.data(), source.size(), image, asset.error);
+        const double decodeMs = ElapsedMs(stageStart);
+#ifdef _WIN32
+        if (SUCCEEDED(com)) CoUninitialize();
+#endif
+        if (!decoded) return asset;
+
+        // 画像ごとに並列に処理しているが、大きな画像が最後に残ったときも他のスレッドが手伝えるよう、
+        // 1枚の中も同じプールで行の帯 / ブロックの行に分ける（ParallelFor は入れ子にしても待ち合いにならない）
+        stageStart = std::chrono::steady_clock::now();
+        MipGenerator::Options mipOptions;
+        mipOptions.filter = options.mipFilter;
+        mipOptions.srgb = !IsLinearImage(relative);
+        std::vector<ImageData> levels;
+        if (options.generateMips) MipGenerator::GenerateMips(image, mipOptions, levels, pool);
+        else levels.push_back(std::move(image));
+        const double mipMs = ElapsedMs(stageStart);
+
+        // D3D11 は先頭の段の幅/高さが4の倍数でない BC テクスチャを作れないので、指定があってもそのときは RGBA8 のまま
+        stageStart = std::chrono::steady_clock::now();
+        const uint32_t width = levels[0].width, height = levels[0].height;
+        PixelFormat format = options.textureFormat ? *options.textureFormat : BlockCompression::ChooseFormat(width, height, !mipOptions.srgb);
+        if (!BlockCompression::CanCompress(width, height)) format = PixelFormat::RGBA8;
+        if (format != PixelFormat::RGBA8)
+        {
+            const ImageData original = levels[0];
+            ImageData compressed, decoded;
+            for (ImageData& level : levels)
+            {
+                BlockCompression::CompressImage(level, format, options.blockQuality, compressed, pool);
+                std::swap(level, compressed);
+            }
+            BlockCompression::DecompressImage(levels[0], decoded);
+            asset.psnr = BlockCompression::ComputePsnr(original, decoded, format);
+        }
+        const double compressMs = ElapsedMs(stageStart);
+        asset.format = format;
+        if (format != PixelFormat::RGBA8 && asset.psnr < options.minPsnr)
+        {
+            char message[96];
+            std::snprintf(message, sizeof(message), "%s PSNR %.2f dB is below %.2f dB", GetPixelFormatName(format), asset.psnr,
+                options.minPsnr);
+            asset.error = message;
+            return asset;
+        }
+
+        stageStart = std::chrono::steady_clock::now();
+        std::vector<uint8_t> bytes;
+        if (!TextureFile::Serialize(levels, uint32_t(levels.size()), mipOptions.srgb ? uint32_t(TextureFile::kFlagSrgb) : 0u, bytes, asset.error))
+        {
+            return asset;
+        }
+        const fs::path output = OutputPath(options.outputDirectory, relative, ".texture");
+        if (!WriteFileAtomic(output, bytes.data(), bytes.size()))
+        {
+            asset.error = "cannot write " + output.string();
+            return asset;
+        }
+        const double writeMs = ElapsedMs(stageStart);
+
+        asset.output = output.string();
+        asset.cookedBytes = bytes.size();
+        asset.width = levels[0].width;
+        asset.height = levels[0].height;
+        asset.mipCount = uint32_t(levels.size());
+        asset.srgb = mipOptions.srgb;
+        asset.succeeded = true;
+        asset.milliseconds = ElapsedMs(start);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        summary.AddStageTime("image decode", decodeMs);
+        summary.AddStageTime("image mips", mipMs);
+        summary.AddStageTime("image compress", compressMs);
+        summary.AddStageTime("image write", writeMs);
+        return asset;
+    }
+}
+
+namespace AssetCooker
+{
+    void CookSummary::AddStageTime(const char* stage, double milliseconds)
+    {
+        for (ImportStageTiming& timing : stages)
+        {
+            if (timing.stage == stage)
+            {
+                timing.milliseconds += milliseconds;
+                return;
+            }
+        }
+        stages.push_back({ stage, milliseconds });
+    }
+
+    size_t CookSummary::FailureCount() const
+    {
+        return size_t(std::count_if(assets.begin(), assets.end(), [](const CookedAsset& asset) { return !asset.succeeded; }));
+    }
+
+    bool SupportsFbx()
+    {
+        return ASSETCOOKER_FBX != 0;
+    }
+
+    CookSummary CookDirectory(const CookOptions& options)
+    {
+        auto start = std::chrono::steady_clock::now();
+        CookSummary summary;
+        const size_t jobs = options.jobs > 0 ? options.jobs : std::max<size_t>(1, std::thread::hardware_concurrency());
+        summary.threadCount = jobs;
+
+        // 入力フォルダ以下の対象ファイルを集める（結果の並びが実行ごとに変わらないようパス順）
+        std::vector<SourceFile> meshes, images;
+        std::error_code ec;
+        for (fs::recursive_directory_iterator it(options.inputDirectory, ec), end; !ec && it != end; it.increment(ec))
+        {
+            if (!it->is_regular_file(ec)) continue;
+            const std::string extension = LowerExtension(it->path());
+            const fs::path relative = it->path().lexically_relative(options.inputDirectory);
+            if (extension == ".fbx") meshes.push_back({ relative, OutputKey(relative, ".mesh"), std::string() });
+            else if (IsImage(extension)) images.push_back({ relative, OutputKey(relative, ".texture"), std::string() });
+        }
+        auto byPath = [](const SourceFile& a, const SourceFile& b) { return a.relative < b.relative; };
+        std::sort(meshes.begin(), meshes.end(), byPath);
+        std::sort(images.begin(), images.end(), byPath);
+        summary.AddStageTime("scan", ElapsedMs(start));
+
+        // 前回の記録と比べ、作り直すものだけを残す（最新かどうかはサイズと更新日時が変わったファイルだけを読んで判断する）
+        auto stageStart = std::chrono::steady_clock::now();
+        const fs::path graphPath = fs::path(options.outputDirectory) / kGraphFileName;
+        DependencyGraph graph;
+        graph.Load(graphPath.string());
+        const uint64_t meshSettings = MeshSettingsHash(options);
+        const uint64_t meshVersion = MeshVersionHash();
+        const uint64_t imageSettings = ImageSettingsHash(options);
+        const uint64_t imageVersion = ImageVersionHash();
+
+        std::unordered_set<std::string> liveOutputs;
+        auto selectDirty = [&](std::vector<SourceFile>& files, uint64_t settingsHash, uint64_t versionHash)
+        {
+            std::vector<SourceFile> dirty;
+            for (SourceFile& file : files)
+            {
+                liveOutputs.insert(file.output);
+                const std::string outputFile = (fs::path(options.outputDirectory) / fs::u8path(file.output)).string();
+                file.reason = options.force ? std::string("forced")
+                    : graph.WhyDirty(file.output, outputFile, options.inputDirectory, settingsHash, versionHash);
+                if (file.reason.empty()) summary.upToDate++;
+                else dirty.push_back(std::move(file));
+            }
+            files.swap(dirty);
+        };
+        selectDirty(meshes, meshSettings, meshVersion);
+        selectDirty(images, imageSettings, imageVersion);
+
+        // 元ファイルが消えた出力は削除する（記録にある、このクッカーが書いたものだけ）
+        for (const std::string& output : graph.GetOutputs())
+        {
+            if (liveOutputs.count(output) != 0) continue;
+            std::error_code removeError;
+            fs::remove(fs::path(options.outputDirectory) / fs::u8path(output), removeError);
+            graph.Remove(output);
+            summary.removed++;
+        }
+        summary.AddStageTime("dependency check", ElapsedMs(stageStart));
+
+#if ASSETCOOKER_FBX
+        // FBX はワーカーごとの FbxManager で変換を始めておき、その間に画像を処理する
+        std::unique_ptr<BatchImporter> importer;
+        std::vector<std::future<BatchImportResult>> pending;
+        if (!meshes.empty())
+        {
+            importer = std::make_unique<BatchImporter>(std::min(jobs, meshes.size()));
+            for (const SourceFile& mesh : meshes)
+            {
+                pending.push_back(importer->Submit((fs::path(options.inputDirectory) / mesh.relative).string(), options.import));
+            }
+        }
+#endif
+
+        std::mutex mutex;
+        std::vector<CookedAsset> imageAssets(images.size());
+        std::unique_ptr<ThreadPool> imagePool;
+        if (jobs > 1 && !images.empty()) imagePool = std::make_unique<ThreadPool>(jobs - 1);
+        auto cookImages = [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                imageAssets[i] = CookImage(options, images[i].relative, imagePool.get(), summary, mutex);
+                imageAssets[i].reason = images[i].reason;
+            }
+        };
+        if (imagePool) imagePool->ParallelFor(images.size(), 1, cookImages);
+        else cookImages(0, images.size());
+
+        // メッシュは終わった順ではなくパス順に受け取り、書き出しはこのスレッドで行う（その間も他のワーカーは変換を続ける）
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            CookedAsset asset;
+            asset.kind = AssetKind::Mesh;
+            asset.source = meshes[i].relative.generic_u8string();
+            asset.reason = meshes[i].reason;
+            std::error_code sizeError;
+            asset.sourceBytes = fs::file_size(fs::path(options.inputDirectory) / meshes[i].relative, sizeError);
+            std::vector<std::string> dependencies;
+#if ASSETCOOKER_FBX
+            BatchImportResult result = pending[i].get();
+            asset.milliseconds = result.milliseconds;
+            for (const ImportStageTiming& stage : result.report.stages) summary.AddStageTime(stage.stage.c_str(), stage.milliseconds);
+            dependencies = result.report.textureFiles;
+            if (!result.succeeded)
+            {
+                asset.error = result.error;
+                RecordOutput(graph, options, asset, meshes[i].output, meshSettings, meshVersion, dependencies);
+                summary.assets.push_back(asset);
+                continue;
+            }
+
+            stageStart = std::chrono::steady_clock::now();
+            std::vector<uint8_t> bytes;
+            if (!MeshFile::Serialize(result.model, bytes, asset.error, options.compressMeshes))
+            {
+                RecordOutput(graph, options, asset, meshes[i].output, meshSettings, meshVersion, dependencies);
+                summary.assets.push_back(asset);
+                continue;
+            }
+            summary.AddStageTime("serialize", ElapsedMs(stageStart));
+            asset.milliseconds += ElapsedMs(stageStart);
+
+            stageStart = std::chrono::steady_clock::now();
+            const fs::path output = OutputPath(options.outputDirectory, meshes[i].relative, ".mesh");
+            if (!WriteFileAtomic(output, bytes.data(), bytes.size()))
+            {
+                asset.error = "cannot write " + output.string();
+                RecordOutput(graph, options, asset, meshes[i].output, meshSettings, meshVersion, dependencies);
+                summary.assets.push_back(asset);
+                continue;
+            }
+            summary.AddStageTime("write", ElapsedMs(stageStart));
+            asset.milliseconds += ElapsedMs(stageStart);
+
+            asset.output = output.string();
+            asset.cookedBytes = bytes.size();
+            asset.vertexCount = result.model.geometry.vertices.size();
+            for (const SubMesh& submesh : result.model.geometry.submeshes) asset.triangleCount += submesh.indexCount / 3;
+            asset.clipCount = result.model.animations.size();
+            for (const MeshImportStats& mesh : result.report.meshes)
+            {
+                asset.invalidAttributeCorners += mesh.invalidAttributeCorners;
+                asset.unsupportedAttributeLayers += mesh.unsupportedAttributeLayers;
+            }
+            asset.succeeded = true;
+#else
+            asset.error = "cooker was built without the FBX SDK";
+#endif
+            RecordOutput(graph, options, asset, meshes[i].output, meshSettings, meshVersion, dependencies);
+            summary.assets.push_back(asset);
+        }
+        summary.assets.insert(summary.assets.end(), imageAssets.begin(), imageAssets.end());
+
+        // 記録を更新して書き出す（画像の元ファイルはクック中に読んだばかりなのでハッシュはほぼディスクキャッシュから読む）
+        stageStart = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < images.size(); i++)
+        {
+            RecordOutput(graph, options, imageAssets[i], images[i].output, imageSettings, imageVersion, {});
+        }
+        graph.PruneFileStamps();
+        std::error_code directoryError;
+        fs::create_directories(options.outputDirectory, directoryError);
+        if (!graph.Save(graphPath.string()))
+        {
+            std::fprintf(stderr, "warning: cannot write %s, the next run will rebuild everything\n", graphPath.string().c_str());
+        }
+        summary.AddStageTime("dependency save", ElapsedMs(stageStart));
+
+        summary.wallMilliseconds = ElapsedMs(start);
+        return summary;
+    }
+
+    void PrintSummary(const CookSummary& summary, std::FILE* out, bool explain)
+    {
+        for (const CookedAsset& asset : summary.assets)
+        {
+            const char* kind = asset.kind == AssetKind::Mesh ? "mesh " : "image";
+            if (!asset.succeeded)
+            {
+                std::fprintf(out, "%s FAILED %s: %s\n", kind, asset.source.c_str(), asset.error.c_str());
+                if (explain) std::fprintf(out, "      because %s\n", asset.reason.c_str());
+                continue;
+            }
+            std::fprintf(out, "%s %-48s %9.2f ms %10.1f KB -> %10.1f KB", kind, asset.source.c_str(), asset.milliseconds,
+                asset.sourceBytes / 1024.0, asset.cookedBytes / 1024.0);
+            if (asset.kind == AssetKind::Mesh)
+            {
+                std::fprintf(out, "  (%zu vertices, %zu tris, %zu clips)", asset.vertexCount, asset.triangleCount, asset.clipCount);
+            }
+            else
+            {
+                std::fprintf(out, "  (%ux%u, %u mips, %s, %s", asset.width, asset.height, asset.mipCount, asset.srgb ? "sRGB" : "linear",
+                    GetPixelFormatName(asset.format));
+                if (asset.format != PixelFormat::RGBA8) std::fprintf(out, " %.2f dB", asset.psnr);
+                std::fprintf(out, ")");
+            }
+            std::fprintf(out, "\n");
+            if (asset.invalidAttributeCorners > 0 || asset.unsupportedAttributeLayers > 0)
+            {
+                std::fprintf(out, "      warning: %zu normal/UV references out of range, %zu layers with an unsupported mapping"
+                    " (both replaced with defaults)\n", asset.invalidAttributeCorners, asset.unsupportedAttributeLayers);
+            }
+            if (explain) std::fprintf(out, "      because %s\n", asset.reason.c_str());
+        }
+
+        // 段階ごとの時間（各スレッドで掛かった時間の合計なので経過時間より長くなる）
+        std::fprintf(out, "\nstage                   total ms\n");
+        for (const ImportStageTiming& stage : summary.stages)
+        {
+            std::fprintf(out, "  %-18s %10.2f\n", stage.stage.c_str(), stage.milliseconds);
+        }
+
+        // 種類ごとのサイズ
+        std::fprintf(out, "\n");
+        for (AssetKind kind : { AssetKind::Mesh, AssetKind::Image })
+        {
+            size_t count = 0, failed = 0;
+            uint64_t sourceBytes = 0, cookedBytes = 0;
+            for (const CookedAsset& asset : summary.assets)
+            {
+                if (asset.kind != kind) continue;
+                if (!asset.succeeded)
+                {
+                    failed++;
+                    continue;
+                }
+                count++;
+                sourceBytes += asset.sourceBytes;
+                cookedBytes += asset.cookedBytes;
+            }
+            std::fprintf(out, "%-6s %5zu cooked, %3zu failed, %12.1f KB source -> %12.1f KB cooked\n",
+                kind == AssetKind::Mesh ? "meshes" : "images", count, failed, sourceBytes / 1024.0, cookedBytes / 1024.0);
+        }
+        std::fprintf(out, "%zu up to date, %zu removed\n", summary.upToDate, summary.removed);
+        std::fprintf(out, "wall %.2f ms, %zu threads\n", summary.wallMilliseconds, summary.threadCount);
+    }
+}
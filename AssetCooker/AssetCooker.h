@@ -0,0 +1,83 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <vector>
+#include "BlockCompression.h"
+#include "MipGenerator.h"
+#include "ModelImporter.h"
+
+// ウィンドウも D3D デバイスも作らずに、フォルダ以下の FBX / 画像をクック済みファイルにする
+// FBX -> .mesh（MeshFile）、画像 -> ミップ付きで BC 圧縮した .texture（TextureFile）。出力は入力と同じ相対パスに置く
+// 出力フォルダの .cookdeps に前回の入力と設定を記録し、変わったものだけを作り直す（DependencyGraph）
+namespace AssetCooker
+{
+    struct CookOptions
+    {
+        std::string inputDirectory;
+        std::string outputDirectory;
+        size_t jobs = 0;                    // 並列数（0 なら論理コア数）
+        MeshImportOptions import;
+        bool compressMeshes = true;         // 頂点/インデックスを MeshCodec で圧縮するか
+        bool generateMips = true;           // 画像のミップチェーンを作るか（false なら元の大きさの1段だけ）
+        MipGenerator::Filter mipFilter = MipGenerator::Filter::Kaiser;
+        std::optional<PixelFormat> textureFormat;   // 空なら画像ごとに選ぶ（BlockCompression::ChooseFormat）
+        BlockCompression::Quality blockQuality = BlockCompression::Quality::Normal;
+        double minPsnr = 0.0;               // 圧縮後の PSNR [dB] がこれを下回る画像は失敗にする（0 なら調べない）
+        bool force = false;                 // 依存関係を見ずにすべて作り直すか
+    };
+
+    enum class AssetKind
+    {
+        Mesh,
+        Image,
+    };
+
+    // 1ファイル分の結果
+    struct CookedAsset
+    {
+        AssetKind kind = AssetKind::Mesh;
+        std::string source;                 // 入力ディレクトリからの相対パス
+        std::string output;
+        bool succeeded = false;
+        std::string error;
+        std::string reason;                 // 作り直した理由（DependencyGraph::WhyDirty）
+        uint64_t sourceBytes = 0;
+        uint64_t cookedBytes = 0;
+        double milliseconds = 0.0;          // 読み込みから書き出しまで（キュー待ちを含まない）
+        size_t vertexCount = 0;             // メッシュのみ
+        size_t triangleCount = 0;
+        size_t clipCount = 0;
+        size_t invalidAttributeCorners = 0;     // 法線/UV の参照が範囲外で既定値にしたコーナー（MeshImportStats の合計）
+        size_t unsupportedAttributeLayers = 0;  // マッピングが未対応で読まなかった法線/UV のレイヤー
+        uint32_t width = 0;                 // 画像のみ
+        uint32_t height = 0;
+        uint32_t mipCount = 0;
+        bool srgb = true;
+        PixelFormat format = PixelFormat::RGBA8;
+        double psnr = 0.0;                  // 先頭の段を圧縮して戻したときの PSNR [dB]（RGBA8 なら 0）
+    };
+
+    struct CookSummary
+    {
+        std::vector<CookedAsset> assets;    // 作り直したものだけ
+        size_t upToDate = 0;                // 入力も設定も変わっていないので飛ばした数
+        size_t removed = 0;                 // 元ファイルが消えたので出力を削除した数
+        std::vector<ImportStageTiming> stages;  // 全ファイル分を合算（並列に走った時間の合計）
+        double wallMilliseconds = 0.0;
+        size_t threadCount = 0;
+
+        void AddStageTime(const char* stage, double milliseconds);
+        size_t FailureCount() const;
+    };
+
+    // FBX の読み込みが使えるビルドか（FBX SDK なしでビルドしたクッカーは画像だけを扱う）
+    bool SupportsFbx();
+
+    CookSummary CookDirectory(const CookOptions& options);
+
+    // ファイルごとの行と、段階ごとの時間・種類ごとのサイズの集計を書く（explain なら作り直した理由も）
+    void PrintSummary(const CookSummary& summary, std::FILE* out, bool explain = false);
+}
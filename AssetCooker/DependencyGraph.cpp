@@ -0,0 +1,269 @@
+﻿#include "DependencyGraph.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include "FileUtil.h"
+#include "Hash.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t outputCount;
+        uint32_t stampCount;
+        uint64_t payloadSize;
+        uint64_t payloadChecksum;   // Hash64（ヘッダーの後ろ全体）
+    };
+
+    class Writer
+    {
+    public:
+        template <class T>
+        void Value(const T& value)
+        {
+            const size_t offset = mBytes.size();
+            mBytes.resize(offset + sizeof(T));
+            std::memcpy(mBytes.data() + offset, &value, sizeof(T));
+        }
+
+        void String(const std::string& text)
+        {
+            Value(uint32_t(text.size()));
+            mBytes.insert(mBytes.end(), text.begin(), text.end());
+        }
+
+        std::vector<uint8_t>& Bytes() { return mBytes; }
+
+    private:
+        std::vector<uint8_t> mBytes;
+    };
+
+    // 範囲外を読もうとしたら以降はすべて失敗する
+    class Reader
+    {
+    public:
+        Reader(const uint8_t* data, size_t size) : mData(data), mSize(size) {}
+
+        template <class T>
+        bool Value(T& value)
+        {
+            if (mSize - mOffset < sizeof(T)) return Fail();
+            std::memcpy(&value, mData + mOffset, sizeof(T));
+            mOffset += sizeof(T);
+            return true;
+        }
+
+        bool String(std::string& text)
+        {
+            uint32_t length = 0;
+            if (!Value(length) || mSize - mOffset < length) return Fail();
+            text.assign(reinterpret_cast<const char*>(mData + mOffset), length);
+            mOffset += length;
+            return true;
+        }
+
+        bool AtEnd() const { return mOffset == mSize; }
+
+    private:
+        bool Fail()
+        {
+            mOffset = mSize;
+            return false;
+        }
+
+        const uint8_t* mData;
+        size_t mSize;
+        size_t mOffset = 0;
+    };
+}
+
+bool DependencyGraph::Load(const std::string& path)
+{
+    mOutputs.clear();
+    mStamps.clear();
+
+    std::vector<unsigned char> bytes;
+    if (!ReadFileBytes(path, bytes) || bytes.size() < sizeof(Header)) return false;
+
+    Header header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (header.magic != kMagic || header.version != kVersion || header.payloadSize != bytes.size() - sizeof(Header) ||
+        Hash64(bytes.data() + sizeof(Header), size_t(header.payloadSize)) != header.payloadChecksum)
+    {
+        return false;
+    }
+
+    Reader reader(bytes.data() + sizeof(Header), size_t(header.payloadSize));
+    bool ok = true;
+    for (uint32_t i = 0; i < header.outputCount && ok; i++)
+    {
+        Output output;
+        uint8_t succeeded = 0;
+        uint32_t inputCount = 0;
+        ok = reader.String(output.path) && reader.Value(output.settingsHash) && reader.Value(output.versionHash) &&
+            reader.Value(succeeded) && reader.Value(inputCount);
+        output.succeeded = succeeded != 0;
+        for (uint32_t j = 0; j < inputCount && ok; j++)
+        {
+            Input input;
+            ok = reader.String(input.path) && reader.Value(input.hash);
+            output.inputs.push_back(input);
+        }
+        if (ok) mOutputs[output.path] = std::move(output);
+    }
+    for (uint32_t i = 0; i < header.stampCount && ok; i++)
+    {
+        std::string file;
+        FileStamp stamp;
+        ok = reader.String(file) && reader.Value(stamp.size) && reader.Value(stamp.modified) && reader.Value(stamp.hash);
+        if (ok) mStamps[file] = stamp;
+    }
+    if (!ok || !reader.AtEnd())
+    {
+        mOutputs.clear();
+        mStamps.clear();
+        return false;
+    }
+    return true;
+}
+
+bool DependencyGraph::Save(const std::string& path) const
+{
+    // 実行ごとに同じ内容なら同じバイト列になるよう、パス順に書く
+    std::vector<const Output*> outputs;
+    for (const auto& entry : mOutputs) outputs.push_back(&entry.second);
+    std::sort(outputs.begin(), outputs.end(), [](const Output* a, const Output* b) { return a->path < b->path; });
+    std::vector<std::pair<std::string, FileStamp>> stamps(mStamps.begin(), mStamps.end());
+    std::sort(stamps.begin(), stamps.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    Writer writer;
+    writer.Value(Header{});
+    for (const Output* output : outputs)
+    {
+        writer.String(output->path);
+        writer.Value(output->settingsHash);
+        writer.Value(output->versionHash);
+        writer.Value(uint8_t(output->succeeded ? 1 : 0));
+        writer.Value(uint32_t(output->inputs.size()));
+        for (const Input& input : output->inputs)
+        {
+            writer.String(input.path);
+            writer.Value(input.hash);
+        }
+    }
+    for (const auto& stamp : stamps)
+    {
+        writer.String(stamp.first);
+        writer.Value(stamp.second.size);
+        writer.Value(stamp.second.modified);
+        writer.Value(stamp.second.hash);
+    }
+
+    std::vector<uint8_t>& bytes = writer.Bytes();
+    Header header{};
+    header.magic = kMagic;
+    header.version = kVersion;
+    header.outputCount = uint32_t(outputs.size());
+    header.stampCount = uint32_t(stamps.size());
+    header.payloadSize = bytes.size() - sizeof(Header);
+    header.payloadChecksum = Hash64(bytes.data() + sizeof(Header), size_t(header.payloadSize));
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    return WriteFileAtomic(path, bytes.data(), bytes.size());
+}
+
+uint64_t DependencyGraph::HashFile(const std::string& path)
+{
+    mFilesStatted++;
+    FileStamp& stamp = mStamps[path];
+    stamp.used = true;
+
+    std::error_code ec;
+    const uintmax_t size = fs::file_size(path, ec);
+    const int64_t modified = ec ? 0 : int64_t(fs::last_write_time(path, ec).time_since_epoch().count());
+    if (ec)
+    {
+        stamp = FileStamp();
+        stamp.used = true;
+        return kMissing;
+    }
+    if (stamp.hash != kMissing && stamp.size == size && stamp.modified == modified) return stamp.hash;
+
+    // 内容が変わった可能性があるので読み直す（0 は「存在しない」に使うので避ける）
+    std::vector<unsigned char> bytes;
+    if (!ReadFileBytes(path, bytes)) return kMissing;
+    mFilesHashed++;
+    stamp.size = size;
+    stamp.modified = modified;
+    stamp.hash = std::max<uint64_t>(Hash64(bytes.data(), bytes.size()), 1);
+    return stamp.hash;
+}
+
+uint64_t DependencyGraph::HashInput(const std::string& inputRoot, const std::string& input)
+{
+    return HashFile((fs::path(inputRoot) / fs::u8path(input)).lexically_normal().string());
+}
+
+std::string DependencyGraph::WhyDirty(const std::string& output, const std::string& outputFile, const std::string& inputRoot,
+    uint64_t settingsHash, uint64_t versionHash)
+{
+    auto found = mOutputs.find(output);
+    if (found == mOutputs.end()) return "new output";
+    const Output& record = found->second;
+    if (!record.succeeded) return "previous cook failed";
+    if (record.versionHash != versionHash) return "cooker version changed";
+    if (record.settingsHash != settingsHash) return "settings changed";
+
+    std::error_code ec;
+    if (!fs::is_regular_file(outputFile, ec)) return "output missing";
+
+    // 1つ目の変化で止める（残りの入力はハッシュしない）
+    for (size_t i = 0; i < record.inputs.size(); i++)
+    {
+        const Input& input = record.inputs[i];
+        const uint64_t hash = HashInput(inputRoot, input.path);
+        if (hash != input.hash)
+        {
+            const char* what = hash == kMissing ? "removed" : input.hash == kMissing ? "added" : "changed";
+            return std::string(i == 0 ? "source " : "dependency ") + what + ": " + input.path;
+        }
+    }
+    return std::string();
+}
+
+const DependencyGraph::Output* DependencyGraph::Find(const std::string& output) const
+{
+    auto found = mOutputs.find(output);
+    return found != mOutputs.end() ? &found->second : nullptr;
+}
+
+void DependencyGraph::Set(const Output& output)
+{
+    mOutputs[output.path] = output;
+}
+
+void DependencyGraph::Remove(const std::string& output)
+{
+    mOutputs.erase(output);
+}
+
+std::vector<std::string> DependencyGraph::GetOutputs() const
+{
+    std::vector<std::string> outputs;
+    outputs.reserve(mOutputs.size());
+    for (const auto& entry : mOutputs) outputs.push_back(entry.first);
+    std::sort(outputs.begin(), outputs.end());
+    return outputs;
+}
+
+void DependencyGraph::PruneFileStamps()
+{
+    for (auto it = mStamps.begin(); it != mStamps.end();)
+    {
+        if (it->second.used) ++it;
+        else it = mStamps.erase(it);
+    }
+}
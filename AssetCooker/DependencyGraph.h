@@ -0,0 +1,72 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// クック結果ごとの入力ファイルと、その内容のハッシュを覚えておく依存関係グラフ
+// 次のクックでは入力の内容・設定・クッカーのバージョンのどれかが変わった出力だけを作り直す
+// ファイルの内容のハッシュは（サイズ, 更新日時）が変わっていなければ覚えた値を使い、ファイルを読まない
+class DependencyGraph
+{
+public:
+    static constexpr uint32_t kMagic = 0x50454443;     // "CDEP"
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint64_t kMissing = 0;            // 入力が存在しないときのハッシュ
+
+    struct Input
+    {
+        std::string path;       // 入力ディレクトリからの相対パス（外のファイルは ../ で始まる）
+        uint64_t hash = kMissing;
+    };
+
+    // 出力1つ分（先頭の入力が元ファイル、続きが参照しているファイル）
+    struct Output
+    {
+        std::string path;       // 出力ディレクトリからの相対パス
+        uint64_t settingsHash = 0;
+        uint64_t versionHash = 0;
+        bool succeeded = false;
+        std::vector<Input> inputs;
+    };
+
+    // 失敗（ファイルがない・壊れている・形式が違う）なら空のグラフになり、全出力が作り直しになる
+    bool Load(const std::string& path);
+    bool Save(const std::string& path) const;
+
+    // ファイルの内容のハッシュ（存在しなければ kMissing）。サイズと更新日時が前回と同じなら読まない
+    uint64_t HashFile(const std::string& path);
+
+    // 記録された入力（inputRoot からの相対パス）のハッシュ
+    uint64_t HashInput(const std::string& inputRoot, const std::string& input);
+
+    // 出力を作り直す理由（最新なら空）。outputFile は出力の実際のパス
+    std::string WhyDirty(const std::string& output, const std::string& outputFile, const std::string& inputRoot,
+        uint64_t settingsHash, uint64_t versionHash);
+
+    const Output* Find(const std::string& output) const;
+    void Set(const Output& output);
+    void Remove(const std::string& output);
+    std::vector<std::string> GetOutputs() const;
+
+    // 今回 HashFile で触らなかったファイルの記録を捨てる（消えたファイルで表が膨らまないように）
+    void PruneFileStamps();
+
+    size_t FilesHashed() const { return mFilesHashed; }
+    size_t FilesStatted() const { return mFilesStatted; }
+
+private:
+    struct FileStamp
+    {
+        uint64_t size = 0;
+        int64_t modified = 0;   // file_time_type の内部値
+        uint64_t hash = kMissing;
+        bool used = false;
+    };
+
+    std::unordered_map<std::string, Output> mOutputs;
+    std::unordered_map<std::string, FileStamp> mStamps;
+    size_t mFilesHashed = 0;
+    size_t mFilesStatted = 0;
+};
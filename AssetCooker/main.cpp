@@ -0,0 +1,651 @@
+﻿#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+#include "AssetCooker.h"
+#include "BlockCompression.h"
+#include "Bounds.h"
+#include "ClusterCulling.h"
+#include "MeshCodec.h"
+#include "MeshFile.h"
+#include "MeshOptimizer.h"
+#include "Skinning.h"
+#include "TextureAtlas.h"
+#include "TextureFile.h"
+#include "ThreadPool.h"
+#if ASSETCOOKER_FBX
+#include "ModelImporter.h"
+#endif
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <objbase.h>
+#endif
+
+namespace
+{
+    void PrintUsage()
+    {
+        std::fprintf(stderr,
+            "usage: AssetCooker <input-dir> <output-dir> [options]\n"
+            "  --jobs N              number of threads (default: all cores)\n"
+            "  --packed              quantize vertices to the 16-bit packed format\n"
+            "  --no-compress         store vertex/index streams uncompressed\n"
+            "  --no-animations       skip FBX takes\n"
+            "  --no-atlas            keep small FBX textures as separate images instead of packing them into atlases\n"
+            "  --sample-rate R       animation sample rate in frames per second\n"
+            "  --mip-filter F        image mip filter: box, kaiser (default) or lanczos\n"
+            "  --no-mips             store images without a mip chain\n"
+            "  --texture-format F    auto (default: BC5 for normal maps, BC7 otherwise), rgba8, bc1, bc3, bc5 or bc7\n"
+            "  --bc-quality Q        block compression quality: fast, normal (default) or high\n"
+            "  --min-psnr DB         fail images whose compressed top level is below DB decibels\n"
+            "  --force               rebuild everything, ignoring the dependency graph\n"
+            "  --explain             print why each asset was rebuilt\n"
+            "       AssetCooker --mip-benchmark\n"
+            "                        measure mip generation throughput on all cores and exit\n"
+            "       AssetCooker --bc-benchmark [fast|normal|high]\n"
+            "                        measure block compression throughput and PSNR on all cores and exit\n"
+            "       AssetCooker --load-benchmark <image> <cooked.texture>\n"
+            "                        compare cold/warm load time of the source image and its cooked texture and exit\n"
+            "       AssetCooker --load-benchmark <model.fbx> <cooked.mesh>\n"
+            "                        compare cold/warm time of importing the FBX and opening its cooked mesh and exit\n"
+            "       AssetCooker --skinning-benchmark\n"
+            "                        measure CPU skinning throughput and SIMD error on all cores and exit\n"
+            "       AssetCooker --atlas-benchmark\n"
+            "                        measure texture atlas packing efficiency and time and exit\n"
+            "       AssetCooker --codec-benchmark [cooked.mesh]\n"
+            "                        measure vertex/index stream compression ratio and decode speed on built-in meshes\n"
+            "                        (or on the streams of cooked.mesh) and exit\n"
+            "       AssetCooker --cull-benchmark [cooked.mesh]\n"
+            "                        print the share of clusters and triangles rejected by the frustum and cone tests\n"
+            "                        over a sweep of view directions around built-in meshes\n"
+            "                        (or around each submesh of cooked.mesh) and exit\n"
+            "       AssetCooker --weld-benchmark\n"
+            "                        measure vertex welding throughput on a multi-million-corner grid and exit\n"
+            "       AssetCooker --optimize-benchmark [model.fbx]\n"
+            "                        print ACMR/ATVR and vertex fetch overfetch before and after the reordering passes\n"
+            "                        on built-in meshes\n"
+            "                        (or on every mesh of model.fbx) and exit\n"
+            "       AssetCooker --import-benchmark <model.fbx>\n"
+            "                        compare per-corner and columnar FBX vertex extraction time and exit\n");
+    }
+
+    // ミップ生成の処理速度をフィルタごとに測って表示する
+    int RunMipBenchmark()
+    {
+        ThreadPool pool;
+        const MipGenerator::BenchmarkResult bench = MipGenerator::RunBenchmark(pool);
+        std::printf("mip generation, %ux%u source, %s kernel, %zu threads (megapixels of source per second)\n",
+            bench.width, bench.height, bench.kernel, bench.threadCount);
+        std::printf("filter      scalar       SIMD   parallel\n");
+        for (MipGenerator::Filter filter : { MipGenerator::Filter::Box, MipGenerator::Filter::Kaiser, MipGenerator::Filter::Lanczos })
+        {
+            const size_t f = size_t(filter);
+            std::printf("%-8s %9.1f %10.1f %10.1f\n", MipGenerator::GetFilterName(filter), bench.referenceMegapixelsPerSecond[f],
+                bench.simdMegapixelsPerSecond[f], bench.parallelMegapixelsPerSecond[f]);
+        }
+        std::printf("SIMD vs scalar: %d levels max difference\n", bench.maxDifference);
+        return bench.maxDifference <= 1 ? 0 : 1;
+    }
+
+    // BC 圧縮の処理速度と PSNR を形式ごとに測って表示する
+    int RunBlockCompressionBenchmark(BlockCompression::Quality quality)
+    {
+        ThreadPool pool;
+        const BlockCompression::BenchmarkResult bench = BlockCompression::RunBenchmark(pool, quality);
+        std::printf("block compression, %ux%u source, %s quality, %s kernel, %zu threads (megapixels per second)\n",
+            bench.width, bench.height, BlockCompression::GetQualityName(bench.quality), bench.kernel, bench.threadCount);
+        std::printf("format      scalar       SIMD   parallel    PSNR dB\n");
+        const PixelFormat formats[4] = { PixelFormat::BC1, PixelFormat::BC3, PixelFormat::BC5, PixelFormat::BC7 };
+        for (size_t f = 0; f < 4; f++)
+        {
+            std::printf("%-8s %9.1f %10.1f %10.1f %10.2f\n", GetPixelFormatName(formats[f]), bench.referenceMegapixelsPerSecond[f],
+                bench.simdMegapixelsPerSecond[f], bench.parallelMegapixelsPerSecond[f], bench.psnr[f]);
+        }
+        std::printf("SIMD vs scalar: %s\n", bench.matchesReference ? "identical" : "MISMATCH");
+        return bench.matchesReference ? 0 : 1;
+    }
+
+    // CPU スキニングの処理速度を版ごとに測り、SIMD 版とスカラー版の差を表示する
+    int RunSkinningBenchmark()
+    {
+        ThreadPool pool;
+        const Skinning::BenchmarkResult bench = Skinning::RunBenchmark(pool);
+        std::printf("CPU skinning, %zu vertices, %u joints, %s kernel, %zu threads (best of 20, Mvertices/s)\n",
+            bench.vertexCount, bench.jointCount, bench.kernel, bench.threadCount);
+        std::printf("    scalar       SIMD   parallel/thread\n");
+        std::printf("%10.1f %10.1f %17.1f\n", bench.referenceVerticesPerSecond * 1.0e-6, bench.simdVerticesPerSecond * 1.0e-6,
+            bench.parallelVerticesPerSecondPerCore * 1.0e-6);
+        const bool matches = bench.maxPositionError <= 1.0e-5f && bench.maxNormalError <= 1.0e-5f;
+        std::printf("SIMD vs scalar: %g position, %g normal/tangent max difference (%s)\n", bench.maxPositionError,
+            bench.maxNormalError, matches ? "within 1e-5" : "MISMATCH");
+        return matches ? 0 : 1;
+    }
+
+    // アトラスの詰め方ごとの効率と時間を測って表示する
+    int RunAtlasBenchmark()
+    {
+        const TextureAtlas::Options options;
+        const TextureAtlas::BenchmarkResult bench = TextureAtlas::RunBenchmark(options);
+        std::printf("atlas packing, %zu images up to %u texels, %ux%u pages, %u texel gutter, %u mips (best of 5)\n",
+            bench.rectCount, options.maxExtent, bench.pageSize, bench.pageSize, options.gutter, options.mipCount);
+        std::printf("packer    pages   cells %%  images %%         ms\n");
+        for (TextureAtlas::Packer packer : { TextureAtlas::Packer::Skyline, TextureAtlas::Packer::MaxRects })
+        {
+            const size_t p = size_t(packer);
+            std::printf("%-8s %6zu %9.1f %9.1f %10.3f\n", TextureAtlas::GetPackerName(packer), bench.pageCount[p],
+                100.0 * bench.occupancy[p], 100.0 * bench.imageOccupancy[p], bench.packMs[p]);
+        }
+        return 0;
+    }
+
+    // 角ごとにばらした格子を溶接する処理速度を測って表示する
+    int RunWeldBenchmark()
+    {
+        const MeshOptimizer::WeldBenchmarkResult bench = MeshOptimizer::RunWeldBenchmark();
+        const size_t expected = size_t(bench.gridSize + 1) * (bench.gridSize + 1);
+        std::printf("vertex welding, %ux%u grid, 1 thread (best of 5)\n", bench.gridSize, bench.gridSize);
+        std::printf("   corners   vertices         ms   Mvertices/s\n");
+        std::printf("%10zu %10zu %10.3f %13.1f\n", bench.cornerCount, bench.vertexCount, bench.milliseconds,
+            bench.verticesPerSecond * 1.0e-6);
+        std::printf("welded vertices: %s\n", bench.vertexCount == expected ? "one per grid point" : "MISMATCH");
+        return bench.vertexCount == expected ? 0 : 1;
+    }
+
+    void PrintOptimizeHeader(const char* source)
+    {
+        std::printf("mesh reordering, %s (ACMR/ATVR: 16-entry FIFO, fetch: %u-byte vertices, 64-byte lines)\n", source,
+            VertexFormatStride(MeshImportOptions().vertexFormat));
+        std::printf("mesh                      tris   vertices     ACMR before -> after      ATVR before -> after"
+            "    line misses before -> after    overfetch before -> after\n");
+    }
+
+    void PrintOptimizeRow(const char* name, size_t triangleCount, size_t vertexCount, float acmrBefore, float acmrAfter,
+        float atvrBefore, float atvrAfter, size_t missesBefore, size_t missesAfter, float overfetchBefore, float overfetchAfter)
+    {
+        std::printf("%-20s %9zu %10zu %15.3f %8.3f %16.3f %8.3f %22zu %8zu %20.3f %8.3f\n", name, triangleCount, vertexCount,
+            acmrBefore, acmrAfter, atvrBefore, atvrAfter, missesBefore, missesAfter, overfetchBefore, overfetchAfter);
+    }
+
+    // 組み込みの見本メッシュで最適化パスの前後の指標を表示する
+    int RunOptimizeBenchmark()
+    {
+        const std::vector<MeshOptimizer::OptimizeBenchmarkMesh> meshes = MeshOptimizer::RunOptimizeBenchmark();
+        PrintOptimizeHeader("built-in meshes");
+        bool improved = true;
+        for (const MeshOptimizer::OptimizeBenchmarkMesh& mesh : meshes)
+        {
+            PrintOptimizeRow(mesh.name, mesh.triangleCount, mesh.vertexCount, mesh.cacheBefore.acmr, mesh.cacheAfter.acmr,
+                mesh.cacheBefore.atvr, mesh.cacheAfter.atvr, mesh.fetchBefore.cacheLineMisses, mesh.fetchAfter.cacheLineMisses,
+                mesh.fetchBefore.overfetch, mesh.fetchAfter.overfetch);
+            improved = improved && mesh.cacheAfter.acmr <= mesh.cacheBefore.acmr &&
+                mesh.fetchAfter.cacheLineMisses <= mesh.fetchBefore.cacheLineMisses &&
+                mesh.fetchAfter.overfetch <= mesh.fetchBefore.overfetch;
+        }
+        std::printf("ACMR, line misses and overfetch after the passes: %s\n", improved ? "never worse" : "WORSE");
+        return improved ? 0 : 1;
+    }
+
+#if ASSETCOOKER_FBX
+    // FBX の全メッシュをインポートして、インポートが記録した最適化パスの前後の指標を表示する
+    int RunOptimizeBenchmark(const char* path)
+    {
+        ModelImporter importer;
+        ModelData model;
+        ImportReport report;
+        if (!importer.Import(path, MeshImportOptions(), model, report))
+        {
+            std::fprintf(stderr, "optimize benchmark failed: %s\n", importer.GetErrorString().c_str());
+            return 1;
+        }
+        PrintOptimizeHeader(path);
+        bool improved = true;
+        for (const MeshImportStats& mesh : report.meshes)
+        {
+            PrintOptimizeRow(mesh.name.c_str(), mesh.triangleCount, mesh.vertexCount, mesh.acmrBefore, mesh.acmrAfter,
+                mesh.atvrBefore, mesh.atvrAfter, mesh.fetchMissesBefore, mesh.fetchMissesAfter, mesh.overfetchBefore,
+                mesh.overfetchAfter);
+            improved = improved && mesh.acmrAfter <= mesh.acmrBefore && mesh.fetchMissesAfter <= mesh.fetchMissesBefore &&
+                mesh.overfetchAfter <= mesh.overfetchBefore;
+        }
+        std::printf("ACMR, line misses and overfetch after the passes: %s\n", improved ? "never worse" : "WORSE");
+        return improved ? 0 : 1;
+    }
+
+    // FBX の頂点属性を1コーナーずつ読む方法と、列で一括に読んで組み立てる方法の時間を比べる
+    int RunImportBenchmark(const char* path)
+    {
+        ThreadPool pool;
+        ModelImporter importer(&pool);
+        FbxMeshExtractor::BenchmarkResult bench;
+        double importMs = 0.0, triangulateMs = 0.0;
+        if (!importer.BenchmarkExtraction(path, 5, bench, importMs, triangulateMs))
+        {
+            std::fprintf(stderr, "import benchmark failed: %s\n", importer.GetErrorString().c_str());
+            return 1;
+        }
+        std::printf("FBX vertex extraction, %zu meshes, %zu corners, %zu threads (best of 5, milliseconds)\n",
+            bench.meshCount, bench.cornerCount, bench.threadCount);
+        std::printf("import       %10.3f   (once)\n", importMs);
+        std::printf("triangulate  %10.3f   (once)\n", triangulateMs);
+        std::printf("per-corner   %10.3f\n", bench.perCornerMs);
+        std::printf("extract      %10.3f\n", bench.extractMs);
+        std::printf("assemble     %10.3f\n", bench.assembleMs);
+        const double columnarMs = bench.extractMs + bench.assembleMs;
+        std::printf("speedup      %10.1fx\n", columnarMs > 0.0 ? bench.perCornerMs / columnarMs : 0.0);
+        std::printf("columnar vs per-corner vertices: %s\n", bench.matches ? "identical" : "MISMATCH");
+        return bench.matches ? 0 : 1;
+    }
+#endif
+
+    // 元画像の展開と、クック済みテクスチャのマップにかかる時間を比べる
+    int RunLoadBenchmark(const char* imagePath, const char* texturePath)
+    {
+#ifdef _WIN32
+        // WIC は呼び出しスレッドで COM が初期化されている必要がある
+        CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+#endif
+        TextureFile::LoadBenchmarkResult bench;
+        std::string error;
+        if (!TextureFile::RunLoadBenchmark(imagePath, texturePath, bench, error))
+        {
+            std::fprintf(stderr, "load benchmark failed: %s\n", error.c_str());
+            return 1;
+        }
+        std::printf("texture load, %ux%u, %u mips, %s (best of 5, milliseconds)\n", bench.width, bench.height, bench.mipCount,
+            GetPixelFormatName(bench.format));
+        std::printf("source          KB       cold       warm\n");
+        if (bench.coldMeasured)
+        {
+            std::printf("image    %10.1f %10.3f %10.3f   (read + decode top level only)\n", bench.imageBytes / 1024.0,
+                bench.imageColdMs, bench.imageWarmMs);
+            std::printf("texture  %10.1f %10.3f %10.3f   (map + validate + touch every page)\n", bench.textureBytes / 1024.0,
+                bench.textureColdMs, bench.textureWarmMs);
+        }
+        else
+        {
+            std::printf("image    %10.1f %10s %10.3f   (read + decode top level only)\n", bench.imageBytes / 1024.0, "n/a",
+                bench.imageWarmMs);
+            std::printf("texture  %10.1f %10s %10.3f   (map + validate + touch every page)\n", bench.textureBytes / 1024.0, "n/a",
+                bench.textureWarmMs);
+            std::printf("cold runs need a POSIX page cache drop and were skipped\n");
+        }
+        return 0;
+    }
+
+    // FBX のインポートと、クック済みメッシュのマップにかかる時間を比べる
+    int RunMeshLoadBenchmark(const char* modelPath, const char* meshPath)
+    {
+        std::function<bool(std::string&)> importModel;
+#if ASSETCOOKER_FBX
+        ThreadPool pool;
+        ModelImporter importer(&pool);
+        importModel = [&](std::string& error)
+        {
+            ModelData model;
+            ImportReport report;
+            if (importer.Import(modelPath, MeshImportOptions(), model, report)) return true;
+            error = std::string(modelPath) + ": " + importer.GetErrorString();
+            return false;
+        };
+#endif
+        MeshFile::LoadBenchmarkResult bench;
+        std::string error;
+        if (!MeshFile::RunLoadBenchmark(modelPath, meshPath, importModel, bench, error))
+        {
+            std::fprintf(stderr, "load benchmark failed: %s\n", error.c_str());
+            return 1;
+        }
+        std::printf("mesh load, %u vertices, %u tris, %s streams (best of 5, milliseconds)\n", bench.vertexCount,
+            bench.triangleCount, bench.compressed ? "compressed" : "uncompressed");
+        std::printf("source          KB       cold       warm\n");
+        auto row = [&](const char* name, uint64_t bytes, bool measured, double coldMs, double warmMs, const char* note)
+        {
+            char cold[16] = "n/a", warm[16] = "n/a";
+            if (measured && bench.coldMeasured) std::snprintf(cold, sizeof(cold), "%.3f", coldMs);
+            if (measured) std::snprintf(warm, sizeof(warm), "%.3f", warmMs);
+            std::printf("%-6s %11.1f %10s %10s   (%s)\n", name, bytes / 1024.0, cold, warm, note);
+        };
+        row("fbx", bench.sourceBytes, bench.sourceMeasured, bench.sourceColdMs, bench.sourceWarmMs,
+            "import + optimize + build meshlets and LODs");
+        row("mesh", bench.meshBytes, true, bench.meshColdMs, bench.meshWarmMs,
+            bench.compressed ? "map + verify checksums + decode streams" : "map + verify checksums");
+        if (!bench.sourceMeasured) std::printf("FBX import needs the FBX SDK and was skipped\n");
+        if (!bench.coldMeasured) std::printf("cold runs need a POSIX page cache drop and were skipped\n");
+        return 0;
+    }
+
+    // クック済みメッシュの頂点/インデックス列を圧縮・展開して、圧縮率と展開速度を表示する
+    int RunCodecBenchmark(const char* meshPath)
+    {
+        MeshFileView file;
+        if (!file.Open(meshPath))
+        {
+            std::fprintf(stderr, "codec benchmark failed: %s: %s\n", meshPath, file.GetErrorString().c_str());
+            return 1;
+        }
+        const MeshFile::Header& header = file.GetHeader();
+        std::vector<uint8_t> vertices(size_t(header.vertexCount) * header.vertexStride);
+        std::vector<uint32_t> indices(header.indexCount);
+        if (!file.DecodeVertices(vertices.data()) || !file.DecodeIndices(indices.data()))
+        {
+            std::fprintf(stderr, "codec benchmark failed: %s: stream decode failed\n", meshPath);
+            return 1;
+        }
+
+        const MeshCodec::BenchmarkResult bench = MeshCodec::RunBenchmark(vertices.data(), header.vertexCount,
+            header.vertexStride, indices.data(), header.indexCount);
+        std::printf("mesh stream codec, %u vertices x %u bytes, %u indices, 1 thread (best of 5)\n", header.vertexCount,
+            header.vertexStride, header.indexCount);
+        std::printf("stream        raw KB  encoded KB    ratio  encode MB/s  decode MB/s\n");
+        auto row = [](const char* name, const MeshCodec::StreamBenchmark& stream)
+        {
+            std::printf("%-8s %11.1f %11.1f %8.3f %12.1f %12.1f\n", name, stream.rawBytes / 1024.0, stream.encodedBytes / 1024.0,
+                stream.rawBytes > 0 ? double(stream.encodedBytes) / double(stream.rawBytes) : 0.0,
+                stream.encodeMegabytesPerSecond, stream.decodeMegabytesPerSecond);
+        };
+        row("vertices", bench.vertices);
+        row("indices", bench.indices);
+        const bool matches = bench.vertices.matches && bench.indices.matches;
+        std::printf("round trip: %s\n", matches ? "identical" : "MISMATCH");
+        return matches ? 0 : 1;
+    }
+
+    // 組み込みの見本メッシュの集まりで圧縮率と展開速度を測り、全体の値を展開 1 GB/s の目標と比べる
+    int RunCodecBenchmark()
+    {
+        const std::vector<MeshCodec::CorpusBenchmarkMesh> corpus = MeshCodec::RunCorpusBenchmark();
+        std::printf("mesh stream codec, built-in corpus (%zu UV spheres and grids after the cache and fetch passes, float32 and"
+            " packed16), 1 thread (best of 5)\n", corpus.size() / 2);
+        std::printf("mesh               format        tris  vertex ratio  index ratio  vertex MB/s  index MB/s\n");
+
+        // 全体の展開速度は、各メッシュの展開時間の和で全体のバイト数を割ったもの
+        struct Total
+        {
+            double raw = 0.0, encoded = 0.0, decodeSeconds = 0.0;
+            void Add(const MeshCodec::StreamBenchmark& stream)
+            {
+                raw += double(stream.rawBytes);
+                encoded += double(stream.encodedBytes);
+                if (stream.decodeMegabytesPerSecond > 0.0) decodeSeconds += double(stream.rawBytes) * 1.0e-6 / stream.decodeMegabytesPerSecond;
+            }
+        };
+        Total vertices, indices, all;
+        bool matches = true;
+        for (const MeshCodec::CorpusBenchmarkMesh& mesh : corpus)
+        {
+            const MeshCodec::BenchmarkResult& bench = mesh.result;
+            auto ratio = [](const MeshCodec::StreamBenchmark& stream)
+            {
+                return stream.rawBytes > 0 ? double(stream.encodedBytes) / double(stream.rawBytes) : 0.0;
+            };
+            std::printf("%-18s %-8s %10zu %13.3f %12.3f %12.1f %11.1f\n", mesh.name.c_str(),
+                mesh.format == VertexFormat::Packed16 ? "packed16" : "float32", mesh.triangleCount, ratio(bench.vertices),
+                ratio(bench.indices), bench.vertices.decodeMegabytesPerSecond, bench.indices.decodeMegabytesPerSecond);
+            vertices.Add(bench.vertices);
+            indices.Add(bench.indices);
+            all.Add(bench.vertices);
+            all.Add(bench.indices);
+            matches = matches && bench.vertices.matches && bench.indices.matches;
+        }
+
+        const double target = 1.0;
+        std::printf("total      raw MB  encoded MB    ratio  decode GB/s per core\n");
+        auto total = [&](const char* name, const Total& t)
+        {
+            const double gigabytesPerSecond = t.decodeSeconds > 0.0 ? t.raw * 1.0e-9 / t.decodeSeconds : 0.0;
+            std::printf("%-8s %10.1f %11.1f %8.3f %12.2f (%s %.0f GB/s)\n", name, t.raw * 1.0e-6, t.encoded * 1.0e-6,
+                t.raw > 0.0 ? t.encoded / t.raw : 0.0, gigabytesPerSecond, gigabytesPerSecond >= target ? "meets" : "BELOW", target);
+        };
+        total("vertices", vertices);
+        total("indices", indices);
+        total("all", all);
+        std::printf("round trip: %s\n", matches ? "identical" : "MISMATCH");
+        return matches ? 0 : 1;
+    }
+
+    // 視点の距離1つ分の判定結果を、クラスタ数と三角形数に対する割合で1行に表示する
+    void PrintCullRow(const char* mesh, float distance, const ClusterCulling::CullStats& stats)
+    {
+        auto percent = [](size_t part, size_t total) { return total > 0 ? 100.0 * double(part) / double(total) : 0.0; };
+        const size_t clustersDrawn = stats.clusters - stats.frustumCulled - stats.backfaceCulled;
+        if (mesh[0] != '\0') std::printf("%-6s ", mesh);
+        std::printf("%4.1fx radius %17.1f %8.1f %8.1f %20.1f %8.1f %8.1f\n", distance,
+            percent(stats.frustumCulled, stats.clusters), percent(stats.backfaceCulled, stats.clusters),
+            percent(clustersDrawn, stats.clusters), percent(stats.trianglesFrustumCulled, stats.triangles),
+            percent(stats.trianglesBackfaceCulled, stats.triangles), percent(stats.trianglesDrawn, stats.triangles));
+    }
+
+    // クック済みメッシュのまわりを回る視点でクラスタを判定し、視錐台と法線コーンで落とした割合を表示する
+    int RunCullBenchmark(const char* meshPath)
+    {
+        MeshFileView file;
+        if (!file.Open(meshPath))
+        {
+            std::fprintf(stderr, "cull benchmark failed: %s: %s\n", meshPath, file.GetErrorString().c_str());
+            return 1;
+        }
+        const MeshFile::Header& header = file.GetHeader();
+        if (header.meshletCount == 0)
+        {
+            std::fprintf(stderr, "cull benchmark failed: %s has no meshlets\n", meshPath);
+            return 1;
+        }
+
+        // サブメッシュごとに自身の境界球のまわりから LOD0 のクラスタを判定する（メッシュ空間）
+        const uint32_t directionCount = 64;
+        const float distances[2] = { 3.0f, 1.5f };
+        std::printf("cluster culling, %u meshlets, %u directions per submesh, 60 degree view (%% of all)\n",
+            header.meshletCount, directionCount);
+        std::printf("distance     clusters: frustum     cone    drawn   triangles: frustum     cone    drawn\n");
+        for (float distance : distances)
+        {
+            ClusterCulling::CullStats stats;
+            for (uint32_t s = 0; s < header.submeshCount; s++)
+            {
+                const SubMesh& submesh = file.GetSubMeshes()[s];
+                const MeshLod& lod = file.GetLods()[submesh.lodOffset];
+                stats.Add(ClusterCulling::SweepViewDirections(file.GetMeshlets() + lod.meshletOffset, lod.meshletCount,
+                    submesh.boundsCenter, submesh.boundsRadius, distance, directionCount));
+            }
+            PrintCullRow("", distance, stats);
+        }
+        return 0;
+    }
+
+    // 組み込みの UV 球と格子をインポートと同じ順に最適化してクラスタに区切り、同じ判定の割合を表示する
+    int RunCullBenchmark()
+    {
+        struct Sample
+        {
+            const char* name;
+            MeshData mesh;
+        };
+        Sample samples[2] = { { "sphere", MeshOptimizer::MakeBenchmarkSphere(256, 384) }, { "grid", MeshOptimizer::MakeBenchmarkGrid(256) } };
+        size_t meshletCount = 0;
+        for (Sample& sample : samples)
+        {
+            MeshOptimizer::WeldVertices(sample.mesh);
+            MeshOptimizer::OptimizeVertexCache(sample.mesh.indices, sample.mesh.vertices.size());
+            MeshOptimizer::OptimizeVertexFetch(sample.mesh, VertexFormatStride(MeshImportOptions().vertexFormat));
+            MeshOptimizer::BuildMeshlets(sample.mesh, 64, 124);
+            meshletCount += sample.mesh.meshlets.size();
+        }
+
+        const uint32_t directionCount = 64;
+        const float distances[2] = { 3.0f, 1.5f };
+        std::printf("cluster culling, built-in meshes, %zu meshlets, %u directions per mesh, 60 degree view (%% of all)\n",
+            meshletCount, directionCount);
+        std::printf("mesh   distance     clusters: frustum     cone    drawn   triangles: frustum     cone    drawn\n");
+        for (const Sample& sample : samples)
+        {
+            const Bounds::Sphere sphere = Bounds::ComputeSphere(&sample.mesh.vertices[0].pos, sample.mesh.vertices.size(),
+                sizeof(MeshVertex));
+            for (float distance : distances)
+            {
+                PrintCullRow(sample.name, distance, ClusterCulling::SweepViewDirections(sample.mesh.meshlets.data(),
+                    sample.mesh.meshlets.size(), sphere.center, sphere.radius, distance, directionCount));
+            }
+        }
+        return 0;
+    }
+
+    bool EndsWith(const char* text, const char* suffix)
+    {
+        const size_t length = std::strlen(text), suffixLength = std::strlen(suffix);
+        return length >= suffixLength && std::strcmp(text + length - suffixLength, suffix) == 0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc == 2 && std::strcmp(argv[1], "--mip-benchmark") == 0) return RunMipBenchmark();
+    if (argc == 2 && std::strcmp(argv[1], "--skinning-benchmark") == 0) return RunSkinningBenchmark();
+    if (argc == 2 && std::strcmp(argv[1], "--atlas-benchmark") == 0) return RunAtlasBenchmark();
+    if (argc == 2 && std::strcmp(argv[1], "--weld-benchmark") == 0) return RunWeldBenchmark();
+    if (argc == 2 && std::strcmp(argv[1], "--codec-benchmark") == 0) return RunCodecBenchmark();
+    if (argc == 3 && std::strcmp(argv[1], "--codec-benchmark") == 0) return RunCodecBenchmark(argv[2]);
+    if (argc == 2 && std::strcmp(argv[1], "--cull-benchmark") == 0) return RunCullBenchmark();
+    if (argc == 3 && std::strcmp(argv[1], "--cull-benchmark") == 0) return RunCullBenchmark(argv[2]);
+    if (argc == 4 && std::strcmp(argv[1], "--load-benchmark") == 0)
+    {
+        return EndsWith(argv[3], ".mesh") ? RunMeshLoadBenchmark(argv[2], argv[3]) : RunLoadBenchmark(argv[2], argv[3]);
+    }
+    if (argc == 2 && std::strcmp(argv[1], "--optimize-benchmark") == 0) return RunOptimizeBenchmark();
+    if (argc == 3 && std::strcmp(argv[1], "--optimize-benchmark") == 0)
+    {
+#if ASSETCOOKER_FBX
+        return RunOptimizeBenchmark(argv[2]);
+#else
+        std::fprintf(stderr, "--optimize-benchmark <model.fbx> needs the FBX SDK (set FBXSDK_ROOT)\n");
+        return 1;
+#endif
+    }
+    if (argc == 3 && std::strcmp(argv[1], "--import-benchmark") == 0)
+    {
+#if ASSETCOOKER_FBX
+        return RunImportBenchmark(argv[2]);
+#else
+        std::fprintf(stderr, "--import-benchmark needs the FBX SDK (set FBXSDK_ROOT)\n");
+        return 1;
+#endif
+    }
+    if ((argc == 2 || argc == 3) && std::strcmp(argv[1], "--bc-benchmark") == 0)
+    {
+        BlockCompression::Quality quality = BlockCompression::Quality::Normal;
+        if (argc == 3 && !BlockCompression::ParseQuality(argv[2], quality))
+        {
+            std::fprintf(stderr, "unknown block compression quality: %s\n", argv[2]);
+            PrintUsage();
+            return 2;
+        }
+        return RunBlockCompressionBenchmark(quality);
+    }
+    if (argc < 3)
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    AssetCooker::CookOptions options;
+    bool explain = false;
+    options.inputDirectory = argv[1];
+    options.outputDirectory = argv[2];
+    for (int i = 3; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        if (std::strcmp(arg, "--jobs") == 0 && i + 1 < argc)
+        {
+            options.jobs = size_t(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(arg, "--packed") == 0)
+        {
+            options.import.vertexFormat = VertexFormat::Packed16;
+        }
+        else if (std::strcmp(arg, "--no-compress") == 0)
+        {
+            options.compressMeshes = false;
+        }
+        else if (std::strcmp(arg, "--no-animations") == 0)
+        {
+            options.import.importAnimations = false;
+        }
+        else if (std::strcmp(arg, "--no-atlas") == 0)
+        {
+            options.import.buildAtlases = false;
+        }
+        else if (std::strcmp(arg, "--sample-rate") == 0 && i + 1 < argc)
+        {
+            options.import.animationSampleRate = float(std::atof(argv[++i]));
+        }
+        else if (std::strcmp(arg, "--mip-filter") == 0 && i + 1 < argc)
+        {
+            if (!MipGenerator::ParseFilter(argv[++i], options.mipFilter))
+            {
+                std::fprintf(stderr, "unknown mip filter: %s\n", argv[i]);
+                PrintUsage();
+                return 2;
+            }
+        }
+        else if (std::strcmp(arg, "--no-mips") == 0)
+        {
+            options.generateMips = false;
+        }
+        else if (std::strcmp(arg, "--texture-format") == 0 && i + 1 < argc)
+        {
+            PixelFormat format = PixelFormat::RGBA8;
+            if (std::strcmp(argv[++i], "auto") == 0)
+            {
+                options.textureFormat.reset();
+            }
+            else if (BlockCompression::ParseFormat(argv[i], format))
+            {
+                options.textureFormat = format;
+            }
+            else
+            {
+                std::fprintf(stderr, "unknown texture format: %s\n", argv[i]);
+                PrintUsage();
+                return 2;
+            }
+        }
+        else if (std::strcmp(arg, "--bc-quality") == 0 && i + 1 < argc)
+        {
+            if (!BlockCompression::ParseQuality(argv[++i], options.blockQuality))
+            {
+                std::fprintf(stderr, "unknown block compression quality: %s\n", argv[i]);
+                PrintUsage();
+                return 2;
+            }
+        }
+        else if (std::strcmp(arg, "--min-psnr") == 0 && i + 1 < argc)
+        {
+            options.minPsnr = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--force") == 0)
+        {
+            options.force = true;
+        }
+        else if (std::strcmp(arg, "--explain") == 0)
+        {
+            explain = true;
+        }
+        else
+        {
+            std::fprintf(stderr, "unknown option: %s\n", arg);
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    if (!AssetCooker::SupportsFbx())
+    {
+        std::fprintf(stderr, "warning: built without the FBX SDK, .fbx files will be reported as failures\n");
+    }
+
+    const AssetCooker::CookSummary summary = AssetCooker::CookDirectory(options);
+    AssetCooker::PrintSummary(summary, stdout, explain);
+    return summary.FailureCount() == 0 ? 0 : 1;
+}
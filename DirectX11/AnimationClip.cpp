@@ -0,0 +1,188 @@
+﻿#include "AnimationClip.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define ANIMATION_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    // チャンネルごとの要素数と、ポーズの中の最初のストリーム
+    constexpr uint32_t kChannelComponents[kChannelCount] = { 3, 4, 3 };
+    constexpr uint32_t kChannelStream[kChannelCount] = { kPoseTx, kPoseRx, kPoseSx };
+
+    float ReadFloat(const uint8_t* data)
+    {
+        float value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    // index 番目の量子化値を float にする（bits == 32 は float そのもの）
+    float ReadComponent(const uint8_t* keys, size_t index, uint32_t bits)
+    {
+        if (bits == 32) return ReadFloat(keys + index * sizeof(float));
+
+        // 16 ビット以下なら開始位置のずれ（< 8）を足しても 3 バイトに収まる
+        const size_t bit = index * bits;
+        const uint8_t* p = keys + (bit >> 3);
+        const uint32_t word = uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16);
+        return float((word >> (bit & 7)) & ((1u << bits) - 1));
+    }
+}
+
+namespace AnimationSampling
+{
+    uint32_t ChannelComponents(uint32_t channel)
+    {
+        return kChannelComponents[channel];
+    }
+
+    size_t TrackDataSize(const AnimationTrack& track, uint32_t components)
+    {
+        if (track.bits == 0) return components * sizeof(float);
+        return 2 * components * sizeof(float) + (size_t(track.keyCount) * components * track.bits + 7) / 8;
+    }
+}
+
+void AnimationPose::Resize(uint32_t count)
+{
+    nodeCount = count;
+    stride = (count + 3) & ~3u;
+    const size_t size = size_t(kPoseStreamCount) * stride;
+    streams.assign(size, 0.0f);
+    key0.assign(size, 0.0f);
+    key1.assign(size, 0.0f);
+    rangeMin.assign(size, 0.0f);
+    rangeScale.assign(size, 0.0f);
+    alpha.assign(size_t(kChannelCount) * stride, 0.0f);
+}
+
+namespace AnimationSampling
+{
+    void SamplePose(const AnimationClip& clip, float time, AnimationPose& pose)
+    {
+        if (pose.nodeCount != clip.nodeCount) pose.Resize(clip.nodeCount);
+        const uint32_t stride = pose.stride;
+        const float lastFrame = float(clip.frameCount > 0 ? clip.frameCount - 1 : 0);
+        const float frame = std::min(std::max(time * clip.sampleRate, 0.0f), lastFrame);
+        const uint16_t wholeFrame = uint16_t(frame);
+
+        // トラックごと: frame を挟む2つのキーを二分探索し、量子化値と範囲を SoA に並べる
+        for (uint32_t node = 0; node < clip.nodeCount; node++)
+        {
+            for (uint32_t channel = 0; channel < kChannelCount; channel++)
+            {
+                const AnimationTrack& track = clip.tracks[size_t(node) * kChannelCount + channel];
+                const uint32_t components = kChannelComponents[channel];
+                const uint8_t* data = clip.keyData.data() + track.dataOffset;
+                const size_t base = size_t(kChannelStream[channel]) * stride + node;
+
+                if (track.bits == 0)
+                {
+                    for (uint32_t c = 0; c < components; c++)
+                    {
+                        pose.rangeMin[base + c * stride] = ReadFloat(data + c * sizeof(float));
+                        pose.rangeScale[base + c * stride] = 0.0f;
+                    }
+                    pose.alpha[size_t(channel) * stride + node] = 0.0f;
+                    continue;
+                }
+
+                // 全フレームにキーがあるトラックは探さずにフレーム番号で引く
+                size_t k0, k1;
+                float alpha;
+                if (track.keyCount == clip.frameCount)
+                {
+                    k0 = wholeFrame;
+                    k1 = std::min<size_t>(k0 + 1, track.keyCount - 1);
+                    alpha = frame - float(wholeFrame);
+                }
+                else
+                {
+                    const uint16_t* frames = clip.keyFrames.data() + track.keyOffset;
+                    const size_t next = std::upper_bound(frames, frames + track.keyCount, wholeFrame) - frames;
+                    k0 = next > 0 ? next - 1 : 0;
+                    k1 = std::min<size_t>(next, track.keyCount - 1);
+                    const float span = float(frames[k1]) - float(frames[k0]);
+                    alpha = span > 0.0f ? (frame - float(frames[k0])) / span : 0.0f;
+                }
+                pose.alpha[size_t(channel) * stride + node] = alpha;
+
+                const uint8_t* keys = data + 2 * components * sizeof(float);
+                for (uint32_t c = 0; c < components; c++)
+                {
+                    const size_t i = base + c * stride;
+                    pose.rangeMin[i] = ReadFloat(data + c * sizeof(float));
+                    pose.rangeScale[i] = ReadFloat(data + (components + c) * sizeof(float));
+                    pose.key0[i] = ReadComponent(keys, k0 * components + c, track.bits);
+                    pose.key1[i] = ReadComponent(keys, k1 * components + c, track.bits);
+                }
+            }
+        }
+
+        // 4ノードずつ: value = min + scale * lerp(key0, key1, alpha)
+        for (uint32_t s = 0; s < kPoseStreamCount; s++)
+        {
+            const uint32_t channel = s < kPoseRx ? kChannelTranslation : s < kPoseSx ? kChannelRotation : kChannelScale;
+            const size_t offset = size_t(s) * stride;
+            const float* a = pose.alpha.data() + size_t(channel) * stride;
+            const float* k0 = pose.key0.data() + offset;
+            const float* k1 = pose.key1.data() + offset;
+            const float* lo = pose.rangeMin.data() + offset;
+            const float* scale = pose.rangeScale.data() + offset;
+            float* out = pose.streams.data() + offset;
+#if ANIMATION_SSE
+            for (uint32_t i = 0; i < stride; i += 4)
+            {
+                const __m128 q0 = _mm_loadu_ps(k0 + i);
+                const __m128 q = _mm_add_ps(q0, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(k1 + i), q0), _mm_loadu_ps(a + i)));
+                _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(lo + i), _mm_mul_ps(_mm_loadu_ps(scale + i), q)));
+            }
+#else
+            for (uint32_t i = 0; i < stride; i++)
+            {
+                out[i] = lo[i] + scale[i] * (k0[i] + (k1[i] - k0[i]) * a[i]);
+            }
+#endif
+        }
+
+        // 回転を正規化する（nlerp）。長さ 0 は単位クォータニオンにする
+        float* rx = pose.Stream(kPoseRx);
+        float* ry = pose.Stream(kPoseRy);
+        float* rz = pose.Stream(kPoseRz);
+        float* rw = pose.Stream(kPoseRw);
+#if ANIMATION_SSE
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        for (uint32_t i = 0; i < stride; i += 4)
+        {
+            const __m128 x = _mm_loadu_ps(rx + i), y = _mm_loadu_ps(ry + i), z = _mm_loadu_ps(rz + i), w = _mm_loadu_ps(rw + i);
+            const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)),
+                _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w))));
+            const __m128 valid = _mm_cmpgt_ps(length, zero);
+            const __m128 inverse = _mm_and_ps(_mm_div_ps(one, length), valid);
+            _mm_storeu_ps(rx + i, _mm_mul_ps(x, inverse));
+            _mm_storeu_ps(ry + i, _mm_mul_ps(y, inverse));
+            _mm_storeu_ps(rz + i, _mm_mul_ps(z, inverse));
+            _mm_storeu_ps(rw + i, _mm_or_ps(_mm_mul_ps(w, inverse), _mm_andnot_ps(valid, one)));
+        }
+#else
+        for (uint32_t i = 0; i < stride; i++)
+        {
+            const float length = std::sqrt((rx[i] * rx[i] + ry[i] * ry[i]) + (rz[i] * rz[i] + rw[i] * rw[i]));
+            if (length > 0.0f)
+            {
+                rx[i] /= length; ry[i] /= length; rz[i] /= length; rw[i] /= length;
+            }
+            else
+            {
+                rx[i] = ry[i] = rz[i] = 0.0f; rw[i] = 1.0f;
+            }
+        }
+#endif
+    }
+}
@@ -0,0 +1,92 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MeshData.h"
+
+// 圧縮済みアニメーションクリップと、1時刻分のポーズの展開（D3D非依存）
+// トラックはノードごとに T / R / S の3本。キーは一定間隔のフレーム番号に置き、間は線形補間（回転は nlerp）する
+
+enum AnimationChannel : uint32_t
+{
+    kChannelTranslation,
+    kChannelRotation,
+    kChannelScale,
+    kChannelCount
+};
+
+// 1トラック（要素数は T / S が 3、R が 4）
+// keyData の dataOffset から、bits が 0 なら定数の値（float x 要素数）、
+// それ以外は量子化の範囲（min[要素数], scale[要素数] の float）に続けて keyCount 個の量子化値
+// 量子化値はキーごとに要素を bits ビットずつ下位から詰める。bits が 32 なら量子化せず float のまま
+// keyCount が frameCount と等しいトラックは全フレームにキーがあり、keyFrames を持たない
+struct AnimationTrack
+{
+    uint32_t keyOffset = 0;     // keyFrames の中の位置
+    uint32_t dataOffset = 0;    // keyData の中のバイト位置
+    uint16_t keyCount = 0;      // 定数なら 1
+    uint8_t bits = 0;           // 1要素のビット数（0 = 定数 / 1..16 / 32 = float）
+    uint8_t reserved = 0;
+};
+static_assert(sizeof(AnimationTrack) == 12, "AnimationTrack layout changed");
+
+namespace AnimationSampling
+{
+    constexpr size_t kKeyDataPadding = 4;
+
+    // トラックの要素数と、keyData 上のバイト数（範囲の float を含み、パディングは含まない）
+    uint32_t ChannelComponents(uint32_t channel);
+    size_t TrackDataSize(const AnimationTrack& track, uint32_t components);
+}
+
+struct AnimationClip
+{
+    std::string name;
+    float sampleRate = 30.0f;           // 1秒あたりのフレーム数
+    uint32_t frameCount = 0;            // フレーム 0 .. frameCount - 1
+    uint32_t nodeCount = 0;             // ModelData::nodes と同じ並び
+    std::vector<AnimationTrack> tracks; // node * kChannelCount + channel
+    std::vector<uint16_t> keyFrames;    // トラックごとに昇順
+    std::vector<uint8_t> keyData;       // 末尾に kKeyDataPadding バイトの 0 を置く（展開時に数バイトまとめて読むため）
+    float errorBudget = 0.0f;           // 圧縮時に許した関節（と周りの皮膚）の位置の誤差（モデル空間の距離）
+    float measuredError = 0.0f;         // 圧縮後に全フレームを展開して測った誤差
+
+    float Duration() const { return frameCount > 1 ? float(frameCount - 1) / sampleRate : 0.0f; }
+    size_t CompressedBytes() const
+    {
+        return tracks.size() * sizeof(AnimationTrack) + keyFrames.size() * sizeof(uint16_t) + keyData.size();
+    }
+};
+
+// ポーズの SoA の並び（各ストリームは AnimationPose::stride 個の float）
+enum AnimationPoseStream : uint32_t
+{
+    kPoseTx, kPoseTy, kPoseTz,
+    kPoseRx, kPoseRy, kPoseRz, kPoseRw,
+    kPoseSx, kPoseSy, kPoseSz,
+    kPoseStreamCount
+};
+
+// 1時刻分のローカル TRS（SoA）。ノード数を 4 の倍数に切り上げて SIMD で4ノードずつ処理する
+struct AnimationPose
+{
+    uint32_t nodeCount = 0;
+    uint32_t stride = 0;
+    std::vector<float> streams;         // kPoseStreamCount * stride
+
+    // 展開の作業領域（SamplePose の中でだけ使う）
+    std::vector<float> key0, key1, rangeMin, rangeScale;    // streams と同じ並び
+    std::vector<float> alpha;           // kChannelCount * stride
+
+    void Resize(uint32_t count);
+    float* Stream(AnimationPoseStream s) { return streams.data() + size_t(s) * stride; }
+    const float* Stream(AnimationPoseStream s) const { return streams.data() + size_t(s) * stride; }
+};
+
+namespace AnimationSampling
+{
+    // clip を time 秒（0 .. Duration に丸める）で展開し、全ノードのローカル TRS を pose に書く
+    // トラックごとにキーを探して量子化値を SoA に並べ、逆量子化・補間・回転の正規化は SIMD で4ノードずつ行う
+    void SamplePose(const AnimationClip& clip, float time, AnimationPose& pose);
+}
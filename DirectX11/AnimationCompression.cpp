@@ -0,0 +1,449 @@
+﻿#include "AnimationCompression.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "ThreadPool.h"
+
+namespace
+{
+    constexpr uint32_t kComponents[kChannelCount] = { 3, 4, 3 };
+    constexpr uint32_t kMaxAttempts = 4;
+    constexpr size_t kParallelChunk = 8;   // ノード数
+
+    // 拡大縮小を含む回転 r と平行移動 t（列ベクトル: p' = r * p + t）
+    struct Transform
+    {
+        double r[3][3];
+        double t[3];
+    };
+
+    Transform FromTrs(const float* t, const float* q, const float* s)
+    {
+        double x = q[0], y = q[1], z = q[2], w = q[3];
+        const double length = std::sqrt(x * x + y * y + z * z + w * w);
+        if (length > 0.0) { x /= length; y /= length; z /= length; w /= length; }
+        else { x = y = z = 0.0; w = 1.0; }
+
+        const double rotation[3][3] =
+        {
+            { 1.0 - 2.0 * (y * y + z * z), 2.0 * (x * y - w * z),       2.0 * (x * z + w * y) },
+            { 2.0 * (x * y + w * z),       1.0 - 2.0 * (x * x + z * z), 2.0 * (y * z - w * x) },
+            { 2.0 * (x * z - w * y),       2.0 * (y * z + w * x),       1.0 - 2.0 * (x * x + y * y) },
+        };
+        Transform result;
+        for (int i = 0; i < 3; i++)
+        {
+            for (int j = 0; j < 3; j++) result.r[i][j] = rotation[i][j] * s[j];
+            result.t[i] = t[i];
+        }
+        return result;
+    }
+
+    Transform Combine(const Transform& parent, const Transform& local)
+    {
+        Transform result;
+        for (int i = 0; i < 3; i++)
+        {
+            for (int j = 0; j < 3; j++)
+            {
+                result.r[i][j] = parent.r[i][0] * local.r[0][j] + parent.r[i][1] * local.r[1][j] + parent.r[i][2] * local.r[2][j];
+            }
+            result.t[i] = parent.r[i][0] * local.t[0] + parent.r[i][1] * local.t[1] + parent.r[i][2] * local.t[2] + parent.t[i];
+        }
+        return result;
+    }
+
+    // 1フレーム分のローカル TRS（ノードごとに t[3], q[4], s[3]）からモデル空間の行列を求める
+    void SolveHierarchy(const float* trs, const std::vector<int32_t>& parents, Transform* world)
+    {
+        for (size_t n = 0; n < parents.size(); n++)
+        {
+            const float* local = trs + n * 10;
+            const Transform transform = FromTrs(local, local + 3, local + 7);
+            world[n] = parents[n] >= 0 ? Combine(world[parents[n]], transform) : transform;
+        }
+    }
+
+    // 関節の原点と、各軸方向に shell 離れた点のずれの最大
+    double PoseError(const Transform& a, const Transform& b, double shell)
+    {
+        double worst = 0.0;
+        for (int k = -1; k < 3; k++)
+        {
+            double distance2 = 0.0;
+            for (int i = 0; i < 3; i++)
+            {
+                double d = a.t[i] - b.t[i];
+                if (k >= 0) d += (a.r[i][k] - b.r[i][k]) * shell;
+                distance2 += d * d;
+            }
+            worst = std::max(worst, distance2);
+        }
+        return std::sqrt(worst);
+    }
+
+    // 2つの値の差（T / S は距離、R は回転角[rad]。b は正規化前のクォータニオンでもよい）
+    double ValueError(const float* a, const float* b, bool rotation)
+    {
+        if (!rotation)
+        {
+            const double dx = double(a[0]) - b[0], dy = double(a[1]) - b[1], dz = double(a[2]) - b[2];
+            return std::sqrt(dx * dx + dy * dy + dz * dz);
+        }
+        // conj(a) * b の角度。acos より小さな角度でも精度が落ちない atan2 で求める
+        const double ax = a[0], ay = a[1], az = a[2], aw = a[3];
+        const double bx = b[0], by = b[1], bz = b[2], bw = b[3];
+        const double w = aw * bw + ax * bx + ay * by + az * bz;
+        const double x = aw * bx - bw * ax - (ay * bz - az * by);
+        const double y = aw * by - bw * ay - (az * bx - ax * bz);
+        const double z = aw * bz - bw * az - (ax * by - ay * bx);
+        return 2.0 * std::atan2(std::sqrt(x * x + y * y + z * z), std::fabs(w));
+    }
+
+    // 1トラックの圧縮結果（オフセットは組み立て時に足す）
+    struct TrackResult
+    {
+        AnimationTrack track;
+        std::vector<uint16_t> frames;
+        std::vector<uint8_t> data;
+    };
+
+    void AppendFloats(std::vector<uint8_t>& data, const float* values, size_t count)
+    {
+        const size_t offset = data.size();
+        data.resize(offset + count * sizeof(float));
+        std::memcpy(data.data() + offset, values, count * sizeof(float));
+    }
+
+    // samples は frameCount * components（フレーム順）
+    TrackResult CompressTrack(const float* samples, uint32_t frameCount, uint32_t components, bool rotation, double tolerance)
+    {
+        TrackResult result;
+        float lo[4], hi[4];
+        for (uint32_t c = 0; c < components; c++)
+        {
+            lo[c] = hi[c] = samples[c];
+            for (uint32_t f = 1; f < frameCount; f++)
+            {
+                lo[c] = std::min(lo[c], samples[f * components + c]);
+                hi[c] = std::max(hi[c], samples[f * components + c]);
+            }
+        }
+
+        // 範囲の中央の1値で全フレームが許容値に収まれば定数トラック
+        float middle[4];
+        for (uint32_t c = 0; c < components; c++) middle[c] = lo[c] + (hi[c] - lo[c]) * 0.5f;
+        bool constant = true;
+        for (uint32_t f = 0; f < frameCount && constant; f++)
+        {
+            constant = ValueError(samples + f * components, middle, rotation) <= tolerance;
+        }
+        if (constant)
+        {
+            if (rotation)
+            {
+                const float length = std::sqrt(middle[0] * middle[0] + middle[1] * middle[1] + middle[2] * middle[2] + middle[3] * middle[3]);
+                for (uint32_t c = 0; c < 4; c++) middle[c] = length > 0.0f ? middle[c] / length : (c == 3 ? 1.0f : 0.0f);
+            }
+            result.track.keyCount = 1;
+            result.track.bits = 0;
+            result.frames.push_back(0);
+            AppendFloats(result.data, middle, components);
+            return result;
+        }
+
+        // 量子化の誤差（1要素あたり半ステップ）が許容値の半分に収まる最小のビット数を選ぶ。残りの半分をキーの間引きに使う
+        // 回転は要素の誤差 |dq| に対して角度がおよそ 2|dq| ずれる。16 ビットでも足りなければ float のまま持つ
+        uint32_t bits = 32;
+        for (uint32_t candidate = 1; candidate <= 16; candidate++)
+        {
+            const double levels = double((1u << candidate) - 1);
+            double step2 = 0.0;
+            for (uint32_t c = 0; c < components; c++)
+            {
+                const double step = (double(hi[c]) - lo[c]) / levels;
+                step2 += step * step;
+            }
+            const double error = 0.5 * std::sqrt(step2) * (rotation ? 2.0 : 1.0);
+            if (error <= tolerance * 0.5)
+            {
+                bits = candidate;
+                break;
+            }
+        }
+
+        // 量子化値と、展開時と同じ式で復元した値
+        float rangeMin[4], rangeScale[4];
+        std::vector<float> quantized(size_t(frameCount) * components);
+        for (uint32_t c = 0; c < components; c++)
+        {
+            const double levels = bits == 32 ? 0.0 : double((1u << bits) - 1);
+            rangeMin[c] = bits == 32 ? 0.0f : lo[c];
+            rangeScale[c] = bits == 32 ? 1.0f : float((double(hi[c]) - lo[c]) / levels);
+            for (uint32_t f = 0; f < frameCount; f++)
+            {
+                const float value = samples[f * components + c];
+                float q = value;
+                if (bits != 32)
+                {
+                    q = rangeScale[c] > 0.0f ? std::round((value - rangeMin[c]) / rangeScale[c]) : 0.0f;
+                    q = float(std::min(std::max(double(q), 0.0), levels));
+                }
+                quantized[f * components + c] = q;
+            }
+        }
+        auto reconstruct = [&](uint32_t f0, uint32_t f1, uint32_t f, float* out)
+        {
+            const float alpha = f1 > f0 ? (float(f) - float(f0)) / (float(f1) - float(f0)) : 0.0f;
+            for (uint32_t c = 0; c < components; c++)
+            {
+                const float q0 = quantized[f0 * components + c];
+                const float q1 = quantized[f1 * components + c];
+                out[c] = rangeMin[c] + rangeScale[c] * (q0 + (q1 - q0) * alpha);
+            }
+        };
+
+        // キーの間引き: 前のキーから、間のフレームがすべて補間で許容値に収まる限り次のキーを遠くに置く
+        std::vector<uint32_t> keys(1, 0);
+        float value[4];
+        const uint32_t last = frameCount - 1;
+        for (uint32_t start = 0; start < last;)
+        {
+            uint32_t best = start + 1;
+            for (uint32_t end = start + 2; end <= last; end++)
+            {
+                bool fits = true;
+                for (uint32_t f = start + 1; f < end && fits; f++)
+                {
+                    reconstruct(start, end, f, value);
+                    fits = ValueError(samples + f * components, value, rotation) <= tolerance;
+                }
+                if (!fits) break;
+                best = end;
+            }
+            keys.push_back(best);
+            start = best;
+        }
+
+        // フレーム番号（2 バイト/キー）の分で間引きが得にならなければ全フレームを持つ
+        const size_t keyBits = size_t(components) * bits;
+        if (keys.size() * (keyBits + 16) >= size_t(frameCount) * keyBits)
+        {
+            keys.resize(frameCount);
+            for (uint32_t f = 0; f < frameCount; f++) keys[f] = f;
+        }
+        else
+        {
+            for (uint32_t key : keys) result.frames.push_back(uint16_t(key));
+        }
+
+        result.track.keyCount = uint16_t(keys.size());
+        result.track.bits = uint8_t(bits);
+        AppendFloats(result.data, rangeMin, components);
+        AppendFloats(result.data, rangeScale, components);
+        if (bits == 32)
+        {
+            for (uint32_t key : keys) AppendFloats(result.data, &quantized[key * components], components);
+            return result;
+        }
+
+        // 要素ごとに bits ビットずつ下位から詰める
+        const size_t keyStart = result.data.size();
+        result.data.resize(keyStart + (keys.size() * keyBits + 7) / 8, 0);
+        size_t bit = 0;
+        for (uint32_t key : keys)
+        {
+            for (uint32_t c = 0; c < components; c++, bit += bits)
+            {
+                const uint32_t q = uint32_t(quantized[key * components + c]);
+                for (uint32_t b = 0; b < bits; b++)
+                {
+                    if (q & (1u << b)) result.data[keyStart + ((bit + b) >> 3)] |= uint8_t(1u << ((bit + b) & 7));
+                }
+            }
+        }
+        return result;
+    }
+}
+
+namespace AnimationCompression
+{
+    CompressStats Compress(const RawClip& raw, const std::vector<int32_t>& parents, const CompressOptions& options,
+        AnimationClip& clip, ThreadPool* pool)
+    {
+        CompressStats stats;
+        stats.rawBytes = raw.RawBytes();
+
+        clip = AnimationClip();
+        clip.name = raw.name;
+        clip.sampleRate = raw.sampleRate;
+        clip.frameCount = std::min<uint32_t>(raw.frameCount, 0xffff);
+        clip.nodeCount = raw.nodeCount;
+        const uint32_t frameCount = clip.frameCount;
+        const uint32_t nodeCount = raw.nodeCount;
+        if (frameCount == 0 || nodeCount == 0 || parents.size() != nodeCount) return stats;
+
+        // フレームごとのローカル TRS（ノードごとに t, q, s の 10 float）。回転は前のフレームと同じ半球に揃える
+        std::vector<float> local(size_t(frameCount) * nodeCount * 10);
+        for (uint32_t f = 0; f < frameCount; f++)
+        {
+            for (uint32_t n = 0; n < nodeCount; n++)
+            {
+                const size_t i = size_t(f) * nodeCount + n;
+                float* out = &local[i * 10];
+                const Float3& t = raw.translations[i];
+                Float4 q = raw.rotations[i];
+                const Float3& s = raw.scales[i];
+                if (f > 0)
+                {
+                    const float* previous = &local[(i - nodeCount) * 10 + 3];
+                    if (previous[0] * q.x + previous[1] * q.y + previous[2] * q.z + previous[3] * q.w < 0.0f)
+                    {
+                        q = { -q.x, -q.y, -q.z, -q.w };
+                    }
+                }
+                const float values[10] = { t.x, t.y, t.z, q.x, q.y, q.z, q.w, s.x, s.y, s.z };
+                std::copy(values, values + 10, out);
+            }
+        }
+
+        // 元のアニメーションのモデル空間の行列と、骨格の大きさ（ルートの移動を含めないよう、フレームごとの AABB の半対角の最大）
+        std::vector<Transform> reference(size_t(frameCount) * nodeCount);
+        double extent = 0.0;
+        for (uint32_t f = 0; f < frameCount; f++)
+        {
+            Transform* world = &reference[size_t(f) * nodeCount];
+            SolveHierarchy(&local[size_t(f) * nodeCount * 10], parents, world);
+            double lo[3] = { world[0].t[0], world[0].t[1], world[0].t[2] };
+            double hi[3] = { lo[0], lo[1], lo[2] };
+            for (uint32_t n = 1; n < nodeCount; n++)
+            {
+                for (int i = 0; i < 3; i++)
+                {
+                    lo[i] = std::min(lo[i], world[n].t[i]);
+                    hi[i] = std::max(hi[i], world[n].t[i]);
+                }
+            }
+            const double dx = hi[0] - lo[0], dy = hi[1] - lo[1], dz = hi[2] - lo[2];
+            extent = std::max(extent, 0.5 * std::sqrt(dx * dx + dy * dy + dz * dz));
+        }
+        const double size = extent > 0.0 ? extent : 1.0;
+        const double budget = options.errorRatio * size;
+        const double shell = options.shellRatio * size;
+
+        // 関節の回転/拡大縮小の誤差は、子孫の関節と皮膚の点を関節からの距離（reach）に比例して動かす
+        std::vector<double> reach(nodeCount, 0.0);
+        for (uint32_t f = 0; f < frameCount; f++)
+        {
+            const Transform* world = &reference[size_t(f) * nodeCount];
+            for (uint32_t d = 0; d < nodeCount; d++)
+            {
+                for (int32_t a = parents[d]; a >= 0; a = parents[a])
+                {
+                    const double dx = world[d].t[0] - world[a].t[0], dy = world[d].t[1] - world[a].t[1], dz = world[d].t[2] - world[a].t[2];
+                    reach[a] = std::max(reach[a], std::sqrt(dx * dx + dy * dy + dz * dz));
+                }
+            }
+        }
+
+        // 根から葉への経路上の誤差は足し合わさるので、経路の長さ（深さ + 下の高さ - 1）で予算を割る
+        // どの経路でも関節ごとの予算の合計が全体の予算を超えない。T / R / S の3本でさらに等分する
+        // 実際には誤差が同時に最大になることは少ないので、初回は二乗和で足し合わさるとみなして sqrt(本数) 倍だけ緩め、
+        // 測った誤差が予算を超えたら半分ずつ締める（最後の試行は必ず最悪の場合でも収まる配分にする）
+        std::vector<uint32_t> depth(nodeCount, 1), height(nodeCount, 1);
+        for (uint32_t n = 0; n < nodeCount; n++)
+        {
+            if (parents[n] >= 0) depth[n] = depth[parents[n]] + 1;
+        }
+        for (uint32_t n = nodeCount; n-- > 0;)
+        {
+            if (parents[n] >= 0) height[parents[n]] = std::max(height[parents[n]], height[n] + 1);
+        }
+
+        for (stats.attempts = 1; ; stats.attempts++)
+        {
+            const double relax = stats.attempts < kMaxAttempts ? 1.0 / double(1u << (stats.attempts - 1)) : 0.0;
+            std::vector<TrackResult> results(size_t(nodeCount) * kChannelCount);
+            auto compressTracks = [&](size_t begin, size_t end)
+            {
+                std::vector<float> trackSamples;
+                for (size_t n = begin; n < end; n++)
+                {
+                    const double terms = double(depth[n] + height[n] - 1) * kChannelCount;
+                    const double jointBudget = budget / terms * std::max(1.0, std::sqrt(terms) * relax);
+                    const double radius = reach[n] + shell;
+                    const double tolerance[kChannelCount] = { jointBudget, jointBudget / radius, jointBudget / radius };
+                    uint32_t first = 0;
+                    for (uint32_t channel = 0; channel < kChannelCount; channel++)
+                    {
+                        const uint32_t components = kComponents[channel];
+                        trackSamples.resize(size_t(frameCount) * components);
+                        for (uint32_t f = 0; f < frameCount; f++)
+                        {
+                            const float* values = &local[(size_t(f) * nodeCount + n) * 10 + first];
+                            std::copy(values, values + components, &trackSamples[size_t(f) * components]);
+                        }
+                        results[n * kChannelCount + channel] = CompressTrack(trackSamples.data(), frameCount, components,
+                            channel == kChannelRotation, tolerance[channel]);
+                        first += components;
+                    }
+                }
+            };
+            if (pool) pool->ParallelFor(nodeCount, kParallelChunk, compressTracks);
+            else compressTracks(size_t(0), nodeCount);
+
+            // トラックを1つのクリップに詰める
+            clip.tracks.clear();
+            clip.keyFrames.clear();
+            clip.keyData.clear();
+            stats.constantTracks = stats.keyCount = stats.sampleCount = 0;
+            for (TrackResult& result : results)
+            {
+                AnimationTrack track = result.track;
+                track.keyOffset = uint32_t(clip.keyFrames.size());
+                track.dataOffset = uint32_t(clip.keyData.size());
+                clip.tracks.push_back(track);
+                clip.keyFrames.insert(clip.keyFrames.end(), result.frames.begin(), result.frames.end());
+                clip.keyData.insert(clip.keyData.end(), result.data.begin(), result.data.end());
+                if (track.bits == 0)
+                {
+                    stats.constantTracks++;
+                }
+                else
+                {
+                    stats.keyCount += track.keyCount;
+                    stats.sampleCount += frameCount;
+                }
+            }
+            clip.keyData.resize(clip.keyData.size() + AnimationSampling::kKeyDataPadding, 0);
+
+            // 全フレームを実行時と同じ処理で展開し、モデル空間で誤差を測る
+            AnimationPose pose;
+            std::vector<float> trs(size_t(nodeCount) * 10);
+            std::vector<Transform> world(nodeCount);
+            double measured = 0.0;
+            for (uint32_t f = 0; f < frameCount; f++)
+            {
+                AnimationSampling::SamplePose(clip, float(f) / clip.sampleRate, pose);
+                for (uint32_t n = 0; n < nodeCount; n++)
+                {
+                    for (uint32_t s = 0; s < kPoseStreamCount; s++)
+                    {
+                        trs[n * 10 + s] = pose.Stream(AnimationPoseStream(s))[n];
+                    }
+                }
+                SolveHierarchy(trs.data(), parents, world.data());
+                for (uint32_t n = 0; n < nodeCount; n++)
+                {
+                    measured = std::max(measured, PoseError(world[n], reference[size_t(f) * nodeCount + n], shell));
+                }
+            }
+            clip.errorBudget = float(budget);
+            clip.measuredError = float(measured);
+            if (measured <= budget || stats.attempts == kMaxAttempts) break;
+        }
+
+        stats.compressedBytes = clip.CompressedBytes();
+        return stats;
+    }
+}
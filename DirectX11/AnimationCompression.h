@@ -0,0 +1,55 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "AnimationClip.h"
+
+class ThreadPool;
+
+// 一定間隔でサンプリングしたアニメーションを圧縮する（CPUのみ・D3D非依存）
+// 定数トラックの検出 -> 誤差に合わせた量子化幅の選択 -> 線形補間で復元できるキーの間引き、の順に行う
+namespace AnimationCompression
+{
+    // 圧縮前のクリップ（全フレーム・全ノードのローカル TRS、frame * nodeCount + node の順）
+    struct RawClip
+    {
+        std::string name;
+        float sampleRate = 30.0f;
+        uint32_t frameCount = 0;
+        uint32_t nodeCount = 0;
+        std::vector<Float3> translations;
+        std::vector<Float4> rotations;      // (x, y, z, w)
+        std::vector<Float3> scales;
+
+        // 生の float キーのバイト数（圧縮率の基準）
+        size_t RawBytes() const
+        {
+            return translations.size() * sizeof(Float3) + rotations.size() * sizeof(Float4) + scales.size() * sizeof(Float3);
+        }
+    };
+
+    struct CompressOptions
+    {
+        // 許容する位置の誤差（骨格の大きさに対する比）
+        // 関節の位置と、関節から shellRatio 離れた仮想的な皮膚の点をモデル空間で測る
+        float errorRatio = 1.0e-3f;
+        float shellRatio = 0.02f;
+    };
+
+    struct CompressStats
+    {
+        size_t rawBytes = 0;
+        size_t compressedBytes = 0;
+        size_t constantTracks = 0;
+        size_t keyCount = 0;            // 定数でないトラックに残したキーの合計
+        size_t sampleCount = 0;         // 定数でないトラックの元のサンプル数の合計
+        uint32_t attempts = 0;          // 誤差が予算を超えて許容値を締め直した回数 + 1
+    };
+
+    // parents はノードの親番号（親が子より前、ルートは -1）。誤差の予算を階層に沿って関節ごとに配る
+    // 圧縮後に全フレームを展開して実際の誤差を測り、予算を超えたら許容値を締めてやり直す
+    // pool があればノードごとのトラックの圧縮を並列に行う
+    CompressStats Compress(const RawClip& raw, const std::vector<int32_t>& parents, const CompressOptions& options,
+        AnimationClip& clip, ThreadPool* pool = nullptr);
+}
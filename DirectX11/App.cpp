@@ -1,9 +1,22 @@
 ﻿#include "App.h"
 #include <d3dcompiler.h>
-#include <fbxsdk.h>      // FBX SDKメインヘッダー
 #include <vector>
 #include <string>
 #include <iostream>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <unordered_map>
+#include "BlockCompression.h"
+#include "ClusterCulling.h"
+#include "FileUtil.h"
+#include "Hash.h"
+#include "ImageLoader.h"
+#include "MeshFile.h"
+#include "MipGenerator.h"
+#include "TextureFile.h"
 bool D3DApp::Initialize(HWND hWnd, UINT width, UINT height)
 {
     mWidth = width;
@@ -29,10 +42,71 @@ bool D3DApp::Initialize(HWND hWnd, UINT width, UINT height)
 
     CreateRenderTargetAndDepth(width, height);
     //CreateTriangle();
-    LoadFBXModel("Assets/model.fbx");
+    // キャッシュにない FBX はワーカーで変換させ、その間にテクスチャを読む
+    BeginLoadModel("Assets/model.fbx");
     LoadTexture(L"Assets/MainTexture.png");
+    FinishLoadModel();
+
+    DerivedDataCacheStats cacheStats = mCache.GetStats();
+    char log[160];
+    sprintf_s(log, "Derived data cache: %llu hits, %llu misses, %llu writes, %llu evictions (%llu KB read, %llu KB written)\n",
+        cacheStats.hits, cacheStats.misses, cacheStats.writes, cacheStats.evictions,
+        cacheStats.bytesRead >> 10, cacheStats.bytesWritten >> 10);
+    OutputDebugStringA(log);
     CreateShadersAndInputLayout();
 
+    if (!mImportBenchmarkDirectory.empty())
+    {
+        // ワーカー数ごとのインポートの所要時間（ワーカーの FbxManager の生成は含まない）
+        const std::vector<std::string> paths = BatchImporter::FindFbxFiles(mImportBenchmarkDirectory);
+        for (const BatchImporter::ScalingSample& sample : BatchImporter::BenchmarkScaling(paths, mImportOptions))
+        {
+            sprintf_s(log, "Import benchmark: %zu files, %zu workers, %.1f ms, %.2f files/s, speedup %.2fx, %zu failed\n",
+                paths.size(), sample.workerCount, sample.milliseconds, sample.assetsPerSecond, sample.speedup, sample.failures);
+            OutputDebugStringA(log);
+        }
+    }
+
+    if (mSkinningBenchmark)
+    {
+        const Skinning::BenchmarkResult bench = Skinning::RunBenchmark(mThreadPool);
+        sprintf_s(log, "Skinning benchmark (%s, %zu vertices, %u joints): scalar %.1f M/s, SIMD %.1f M/s, %zu threads %.1f M/s per core\n",
+            bench.kernel, bench.vertexCount, bench.jointCount, bench.referenceVerticesPerSecond * 1.0e-6,
+            bench.simdVerticesPerSecond * 1.0e-6, bench.threadCount, bench.parallelVerticesPerSecondPerCore * 1.0e-6);
+        OutputDebugStringA(log);
+        sprintf_s(log, "  SIMD vs scalar: position %.3g, normal/tangent %.3g\n", bench.maxPositionError, bench.maxNormalError);
+        OutputDebugStringA(log);
+    }
+    if (mMipBenchmark)
+    {
+        const MipGenerator::BenchmarkResult bench = MipGenerator::RunBenchmark(mThreadPool);
+        for (MipGenerator::Filter filter : { MipGenerator::Filter::Box, MipGenerator::Filter::Kaiser, MipGenerator::Filter::Lanczos })
+        {
+            const size_t f = size_t(filter);
+            sprintf_s(log, "Mip benchmark (%s, %ux%u, %s): scalar %.1f MP/s, SIMD %.1f MP/s, %zu threads %.1f MP/s\n",
+                bench.kernel, bench.width, bench.height, MipGenerator::GetFilterName(filter), bench.referenceMegapixelsPerSecond[f],
+                bench.simdMegapixelsPerSecond[f], bench.threadCount, bench.parallelMegapixelsPerSecond[f]);
+            OutputDebugStringA(log);
+        }
+        sprintf_s(log, "  SIMD vs scalar: %d levels max difference\n", bench.maxDifference);
+        OutputDebugStringA(log);
+    }
+    if (mBlockCompressionBenchmark)
+    {
+        const BlockCompression::BenchmarkResult bench = BlockCompression::RunBenchmark(mThreadPool, mBlockQuality);
+        const PixelFormat formats[4] = { PixelFormat::BC1, PixelFormat::BC3, PixelFormat::BC5, PixelFormat::BC7 };
+        for (size_t f = 0; f < 4; f++)
+        {
+            sprintf_s(log, "BC benchmark (%s, %ux%u, %s %s): scalar %.1f MP/s, SIMD %.1f MP/s, %zu threads %.1f MP/s, %.2f dB\n",
+                bench.kernel, bench.width, bench.height, GetPixelFormatName(formats[f]), BlockCompression::GetQualityName(bench.quality),
+                bench.referenceMegapixelsPerSecond[f], bench.simdMegapixelsPerSecond[f], bench.threadCount,
+                bench.parallelMegapixelsPerSecond[f], bench.psnr[f]);
+            OutputDebugStringA(log);
+        }
+        sprintf_s(log, "  SIMD vs scalar: %s\n", bench.matchesReference ? "identical" : "MISMATCH");
+        OutputDebugStringA(log);
+    }
+
     // 定数バッファ作成
     D3D11_BUFFER_DESC cbd{};
     cbd.ByteWidth = sizeof(ConstantBufferData);
@@ -51,106 +125,186 @@ bool D3DApp::Initialize(HWND hWnd, UINT width, UINT height)
     return true;
 }
 
-bool D3DApp::LoadFBXModel(const std::string& path)
+void D3DApp::BeginLoadModel(const std::string& path)
 {
-    // FBXマネージャ生成
-    FbxManager* manager = FbxManager::Create();
-    FbxIOSettings* ios = FbxIOSettings::Create(manager, IOSROOT);
-    manager->SetIOSettings(ios);
-
-    // インポーター生成
-    FbxImporter* importer = FbxImporter::Create(manager, "");
-    if (!importer->Initialize(path.c_str(), -1, manager->GetIOSettings()))
-    {
-        MessageBoxA(nullptr, importer->GetStatus().GetErrorString(), "FBX Import Error", MB_OK);
-        importer->Destroy();
-        manager->Destroy();
-        return false;
+    // 元ファイルの内容・インポーター・オプション・クック形式のどれかが変わればキーが変わる
+    std::vector<unsigned char> source;
+    if (!ReadFileBytes(path, source))
+    {
+        MessageBoxA(nullptr, ("Cannot read " + path).c_str(), "FBX Import Error", MB_OK);
+        return;
+    }
+    Hasher hasher(ModelImporter::ComputeCacheKey(source.data(), source.size(), mImportOptions));
+    hasher.AddValue(MeshFile::kVersion);
+    const uint64_t key = hasher.Get();
+    source = std::vector<unsigned char>();
+
+    // キャッシュにあればFBX SDKを通さずにクック済みメッシュを使う（参照するテクスチャが変わっていれば読み直す）
+    std::string cachedPath;
+    if (mCache.Find("mesh", key, cachedPath) && TextureDependenciesCurrent(key) && LoadCookedModel(cachedPath))
+    {
+        return;
     }
 
-    // シーン生成・読み込み
-    FbxScene* scene = FbxScene::Create(manager, "scene");
-    importer->Import(scene);
-    importer->Destroy();
+    // FbxManager はワーカーごとに作って使い回すので、インポーターは最初に必要になったときに作る
+    if (!mImporter) mImporter = std::make_unique<BatchImporter>();
+    mPendingModel = mImporter->Submit(path, mImportOptions);
+    mPendingModelKey = key;
+}
 
-    // 三角形化
-    FbxGeometryConverter converter(manager);
-    converter.Triangulate(scene, true);
+bool D3DApp::FinishLoadModel()
+{
+    if (!mPendingModel.valid()) return !mSubMeshes.empty();
 
-    // 最初のメッシュを探す
-    FbxNode* root = scene->GetRootNode();
-    if (!root)
+    BatchImportResult result = mPendingModel.get();
+    if (!result.succeeded)
     {
-        manager->Destroy();
+        MessageBoxA(nullptr, result.error.c_str(), "FBX Import Error", MB_OK);
         return false;
     }
+    if (!LoadFBXModel(result.model, result.report)) return false;
+
+    std::string error;
+    std::vector<uint8_t> bytes;
+    if (!MeshFile::Serialize(result.model, bytes, error, mCompressCookedMeshes) ||
+        !mCache.Put("mesh", mPendingModelKey, bytes.data(), bytes.size()))
+    {
+        OutputDebugStringA(("Cooked mesh write failed: " + error + "\n").c_str());
+    }
 
-    FbxMesh* mesh = nullptr;
-    for (int i = 0; i < root->GetChildCount(); i++) {
-        FbxNode* node = root->GetChild(i);
-        if (node->GetMesh()) {
-            mesh = node->GetMesh();
-            break;
+    // メッシュに焼き込んだ外部テクスチャ（アトラスのページの元）: 状態のハッシュ + パスを1行ずつ
+    const std::vector<std::string>& files = result.report.textureFiles;
+    const uint64_t filesHash = ModelImporter::HashTextureFiles(files);
+    std::string deps(reinterpret_cast<const char*>(&filesHash), sizeof(filesHash));
+    for (const std::string& file : files) deps += file + "\n";
+    mCache.Put("meshdeps", mPendingModelKey, deps.data(), deps.size());
+    return true;
+}
+
+bool D3DApp::TextureDependenciesCurrent(uint64_t key)
+{
+    // 記録がない（古いキャッシュ）か、どれかのテクスチャが変わっていればキャッシュを使わない
+    std::string path;
+    std::vector<unsigned char> deps;
+    if (!mCache.Find("meshdeps", key, path) || !ReadFileBytes(path, deps) || deps.size() < sizeof(uint64_t)) return false;
+    uint64_t recorded;
+    std::memcpy(&recorded, deps.data(), sizeof(recorded));
+    std::vector<std::string> files;
+    std::string line;
+    for (size_t i = sizeof(uint64_t); i < deps.size(); i++)
+    {
+        if (deps[i] != '\n')
+        {
+            line += char(deps[i]);
+            continue;
         }
+        files.push_back(line);
+        line.clear();
     }
-    if (!mesh)
+    if (ModelImporter::HashTextureFiles(files) == recorded) return true;
+    OutputDebugStringA("Cooked mesh is stale: a referenced texture changed\n");
+    return false;
+}
+
+bool D3DApp::LoadCookedModel(const std::string& path)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    MeshFileView file;
+    if (!file.Open(path))
     {
-        manager->Destroy();
+        OutputDebugStringA(("Cooked mesh rejected: " + file.GetErrorString() + "\n").c_str());
         return false;
     }
+    const MeshFile::Header& header = file.GetHeader();
 
-    // 頂点データ格納
-    std::vector<Vertex> vertices;
-    std::vector<uint32_t> indices;
-
-    int polyCount = mesh->GetPolygonCount();
-    for (int p = 0; p < polyCount; p++)
+    // 非圧縮ならマップしたメモリをそのまま初期データとして渡す（中間コピーなし）
+    const void* vertexData = file.GetVertexData();
+    const void* indexData = file.GetIndices();
+    std::vector<uint8_t> decodedVertices;
+    std::vector<uint32_t> decodedIndices;
+    double decodeMs = 0.0;
+    if (file.IsCompressed())
     {
-        // 常に三角形
-        for (int v = 0; v < 3; v++)
+        auto decodeStart = std::chrono::steady_clock::now();
+        decodedVertices.resize(size_t(header.vertexCount) * header.vertexStride);
+        decodedIndices.resize(header.indexCount);
+        if (!file.DecodeVertices(decodedVertices.data()) || !file.DecodeIndices(decodedIndices.data()))
         {
-            Vertex vert{};
+            OutputDebugStringA("Cooked mesh rejected: stream decode failed\n");
+            return false;
+        }
+        decodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - decodeStart).count();
+        vertexData = decodedVertices.data();
+        indexData = decodedIndices.data();
+    }
 
-            int ctrlIdx = mesh->GetPolygonVertex(p, v);
+    D3D11_BUFFER_DESC vbd{};
+    vbd.ByteWidth = header.vertexCount * header.vertexStride;
+    vbd.Usage = D3D11_USAGE_DEFAULT;
+    vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    D3D11_SUBRESOURCE_DATA vinit{ vertexData };
+    if (FAILED(mDevice->CreateBuffer(&vbd, &vinit, mVB.ReleaseAndGetAddressOf()))) return false;
 
-            // 位置
-            FbxVector4 pos = mesh->GetControlPointAt(ctrlIdx);
-            vert.pos = { (float)pos[0], (float)pos[1], (float)pos[2] };
+    D3D11_BUFFER_DESC ibd{};
+    ibd.ByteWidth = header.indexCount * header.indexSize;
+    ibd.Usage = D3D11_USAGE_DEFAULT;
+    ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+    D3D11_SUBRESOURCE_DATA iinit{ indexData };
+    if (FAILED(mDevice->CreateBuffer(&ibd, &iinit, mIB.ReleaseAndGetAddressOf()))) return false;
 
-            // 法線
-            FbxVector4 normal;
-            mesh->GetPolygonVertexNormal(p, v, normal);
-            vert.normal = { (float)normal[0], (float)normal[1], (float)normal[2] };
+    mSubMeshes.assign(file.GetSubMeshes(), file.GetSubMeshes() + header.submeshCount);
+    mNodes.assign(file.GetNodes(), file.GetNodes() + header.nodeCount);
+    mMeshlets.assign(file.GetMeshlets(), file.GetMeshlets() + header.meshletCount);
+    mLods.assign(file.GetLods(), file.GetLods() + header.lodCount);
+    mVertexFormat = VertexFormat(header.vertexFormat);
+    mJoints.assign(file.GetJoints(), file.GetJoints() + header.jointCount);
+    mSkinVertices.assign(file.GetSkinVertices(), file.GetSkinVertices() + header.skinVertexCount);
+    mSkinWeights.assign(file.GetSkinWeights(), file.GetSkinWeights() + header.skinVertexCount);
+    mAnimations.resize(header.animationCount);
+    for (uint32_t i = 0; i < header.animationCount; i++) file.GetAnimation(i, mAnimations[i]);
+    mMaterials.assign(file.GetMaterials(), file.GetMaterials() + header.materialCount);
+    std::vector<ModelTexture> textures(header.textureCount);
+    for (uint32_t i = 0; i < header.textureCount; i++) file.GetTexture(i, textures[i]);
+    LoadMaterialTextures(textures);
+    UpdateNodeTransforms();
+    BuildDrawOrder();
+    if (!CreateSkinningBuffer()) return false;
 
-            // UV
-            FbxStringList uvNames;
-            mesh->GetUVSetNames(uvNames);
-            if (uvNames.GetCount() > 0)
-            {
-                const char* uvName = uvNames[0];
-                FbxVector2 uv;
-                bool unmapped;
-                if (mesh->GetPolygonVertexUV(p, v, uvName, uv, unmapped))
-                {
-                    vert.uv = { (float)uv[0], 1.0f - (float)uv[1] };
-                }
-            }
-            vertices.push_back(vert);
-            indices.push_back(static_cast<uint32_t>(vertices.size() - 1));
-        }
+    char log[160];
+    sprintf_s(log, "Cooked mesh load: %.2f ms (%u vertices, %u indices)\n",
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(),
+        header.vertexCount, header.indexCount);
+    OutputDebugStringA(log);
+    if (file.IsCompressed())
+    {
+        // 展開後 / ファイル上のサイズと展開速度
+        const double rawBytes = double(decodedVertices.size()) + double(decodedIndices.size()) * sizeof(uint32_t);
+        const double storedBytes = double(header.sections[MeshFile::kSectionVertices].size + header.sections[MeshFile::kSectionIndices].size);
+        sprintf_s(log, "  stream decode: %.2f ms, ratio %.2f, %.2f GB/s\n",
+            decodeMs, rawBytes / storedBytes, decodeMs > 0.0 ? rawBytes / (decodeMs * 1.0e6) : 0.0);
+        OutputDebugStringA(log);
     }
+    return true;
+}
+
+bool D3DApp::LoadFBXModel(const ModelData& model, ImportReport& report)
+{
+    // インポート済みのシーン（全メッシュを1組の頂点/インデックス配列にまとめたもの）を GPU に上げる
+    auto uploadStart = std::chrono::steady_clock::now();
+
+    const std::vector<uint32_t>& indices = model.geometry.indices;
 
     // --- DirectX バッファ作成 ---
     D3D11_BUFFER_DESC vbd{};
-    vbd.ByteWidth = UINT(sizeof(Vertex) * vertices.size());
+    vbd.ByteWidth = UINT(model.gpuVertices.size());
     vbd.Usage = D3D11_USAGE_DEFAULT;
     vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-    D3D11_SUBRESOURCE_DATA vinit{ vertices.data() };
+    D3D11_SUBRESOURCE_DATA vinit{ model.gpuVertices.data() };
     HRESULT hr = mDevice->CreateBuffer(&vbd, &vinit, mVB.GetAddressOf());
     if (FAILED(hr))
     {
         MessageBoxW(nullptr, L"頂点バッファ作成失敗", L"Error", MB_OK);
-        manager->Destroy();
         return false;
     }
 
@@ -163,30 +317,252 @@ bool D3DApp::LoadFBXModel(const std::string& path)
     if (FAILED(hr))
     {
         MessageBoxW(nullptr, L"インデックスバッファ作成失敗", L"Error", MB_OK);
-        manager->Destroy();
         return false;
     }
 
-    mIndexCount = static_cast<UINT>(indices.size());
+    mSubMeshes = model.geometry.submeshes;
+    mNodes = model.nodes;
+    mMeshlets = model.geometry.meshlets;
+    mLods = model.geometry.lods;
+    mVertexFormat = model.vertexFormat;
+    mJoints = model.joints;
+    mSkinVertices = model.skinVertices;
+    mSkinWeights = model.skinWeights;
+    mAnimations = model.animations;
+    mMaterials = model.materials;
+    LoadMaterialTextures(model.textures);
+    UpdateNodeTransforms();
+    BuildDrawOrder();
+    if (!CreateSkinningBuffer())
+    {
+        MessageBoxW(nullptr, L"スキニング用頂点バッファ作成失敗", L"Error", MB_OK);
+        return false;
+    }
+    report.AddStageTime("upload",
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - uploadStart).count());
 
-    // --- 後処理 ---
-    manager->Destroy();
+    LogImportReport(report);
     return true;
 }
 
-void D3DApp::LoadTexture(const std::wstring& path)
+void D3DApp::UpdateNodeTransforms()
 {
-    HRESULT hr = DirectX::CreateWICTextureFromFile(
-        mDevice.Get(),
-        mContext.Get(),
-        path.c_str(),
-        nullptr,
-        mTextureSRV.GetAddressOf()
-    );
+    // 親が子より前に並んでいるので、前から順に親の行列を掛けていけばよい
+    mNodeWorld.resize(mNodes.size());
+    mNodeMeshes.resize(mNodes.size());
+    for (size_t i = 0; i < mNodes.size(); i++)
+    {
+        const SceneNode& node = mNodes[i];
+        mNodeMeshes[i] = node.mesh;
+        XMMATRIX local = XMMatrixScaling(node.scale.x, node.scale.y, node.scale.z)
+            * XMMatrixRotationQuaternion(XMVectorSet(node.rotation.x, node.rotation.y, node.rotation.z, node.rotation.w))
+            * XMMatrixTranslation(node.translation.x, node.translation.y, node.translation.z);
+        if (node.parent >= 0)
+        {
+            local = local * XMLoadFloat4x4(&mNodeWorld[node.parent]);
+        }
+        XMStoreFloat4x4(&mNodeWorld[i], local);
+    }
+}
 
-    if (FAILED(hr)) {
-        MessageBoxW(nullptr, L"テクスチャ読み込み失敗", L"Error", MB_OK);
-        return;
+void D3DApp::UpdateAnimation(float time)
+{
+    if (!mPlayAnimation || mAnimationClip >= mAnimations.size()) return;
+    const AnimationClip& clip = mAnimations[mAnimationClip];
+    if (clip.nodeCount != mNodes.size()) return;
+    auto start = std::chrono::steady_clock::now();
+
+    // クリップの長さでループさせ、展開したローカル TRS をノードに書いてから行列を求め直す
+    const float duration = clip.Duration();
+    AnimationSampling::SamplePose(clip, duration > 0.0f ? std::fmod(time, duration) : 0.0f, mPose);
+    const float* tx = mPose.Stream(kPoseTx); const float* ty = mPose.Stream(kPoseTy); const float* tz = mPose.Stream(kPoseTz);
+    const float* rx = mPose.Stream(kPoseRx); const float* ry = mPose.Stream(kPoseRy);
+    const float* rz = mPose.Stream(kPoseRz); const float* rw = mPose.Stream(kPoseRw);
+    const float* sx = mPose.Stream(kPoseSx); const float* sy = mPose.Stream(kPoseSy); const float* sz = mPose.Stream(kPoseSz);
+    for (size_t i = 0; i < mNodes.size(); i++)
+    {
+        SceneNode& node = mNodes[i];
+        node.translation = { tx[i], ty[i], tz[i] };
+        node.rotation = { rx[i], ry[i], rz[i], rw[i] };
+        node.scale = { sx[i], sy[i], sz[i] };
+    }
+    UpdateNodeTransforms();
+
+    mAnimationMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool D3DApp::CreateSkinningBuffer()
+{
+    mSkinVB.Reset();
+    mSkinPalette.resize(mJoints.size());
+    if (mSkinVertices.empty()) return true;
+
+    // 毎フレーム CPU から全体を書き直すので動的バッファにする
+    D3D11_BUFFER_DESC vbd{};
+    vbd.ByteWidth = UINT(mSkinVertices.size() * sizeof(SkinnedVertex));
+    vbd.Usage = D3D11_USAGE_DYNAMIC;
+    vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    vbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    return SUCCEEDED(mDevice->CreateBuffer(&vbd, nullptr, mSkinVB.GetAddressOf()));
+}
+
+void D3DApp::UpdateSkinning()
+{
+    if (!mSkinVB) return;
+    auto start = std::chrono::steady_clock::now();
+
+    // パレット = 逆バインド行列 * 関節ノードのモデル空間での行列
+    for (size_t i = 0; i < mJoints.size(); i++)
+    {
+        const SkinJoint& joint = mJoints[i];
+        const XMFLOAT4X4 inverseBind(&joint.inverseBind[0][0]);
+        const XMMATRIX jointWorld = joint.node >= 0 ? XMLoadFloat4x4(&mNodeWorld[joint.node]) : XMMatrixIdentity();
+        XMStoreFloat4x4A(reinterpret_cast<XMFLOAT4X4A*>(&mSkinPalette[i]), XMLoadFloat4x4(&inverseBind) * jointWorld);
+    }
+
+    // 変形した頂点はマップしたメモリへ直接書く
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    if (FAILED(mContext->Map(mSkinVB.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped))) return;
+    SkinnedVertex* out = static_cast<SkinnedVertex*>(mapped.pData);
+    for (const SubMesh& submesh : mSubMeshes)
+    {
+        if (submesh.jointCount == 0) continue;
+        const uint32_t offset = submesh.skinVertexOffset;
+        Skinning::SkinVerticesParallel(mThreadPool, &mSkinVertices[offset], &mSkinWeights[offset], submesh.vertexCount,
+            &mSkinPalette[submesh.jointOffset], out + offset);
+    }
+    mContext->Unmap(mSkinVB.Get(), 0);
+
+    mSkinningMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void D3DApp::LogImportReport(const ImportReport& report)
+{
+    char log[256];
+    for (const MeshImportStats& mesh : report.meshes)
+    {
+        sprintf_s(log, "FBX mesh '%s': %zu tris, weld %zu -> %zu vertices\n",
+            mesh.name.c_str(), mesh.triangleCount, mesh.cornerCount, mesh.vertexCount);
+        OutputDebugStringA(log);
+        sprintf_s(log, "  vertex cache: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+            mesh.acmrBefore, mesh.acmrAfter, mesh.atvrBefore, mesh.atvrAfter);
+        OutputDebugStringA(log);
+        if (mImportOptions.optimizeOverdraw)
+        {
+            sprintf_s(log, "  overdraw: %.3f -> %.3f\n", mesh.overdrawBefore, mesh.overdrawAfter);
+            OutputDebugStringA(log);
+        }
+        sprintf_s(log, "  tangents: %zu vertices split by UV mirroring, %zu without UV tangent\n",
+            mesh.tangentSplitVertices, mesh.tangentFallbackVertices);
+        OutputDebugStringA(log);
+        if (mesh.invalidAttributeCorners > 0 || mesh.unsupportedAttributeLayers > 0)
+        {
+            sprintf_s(log, "  attributes: %zu normal/UV references out of range, %zu layers with an unsupported mapping\n",
+                mesh.invalidAttributeCorners, mesh.unsupportedAttributeLayers);
+            OutputDebugStringA(log);
+        }
+        if (mesh.skinJoints > 0)
+        {
+            sprintf_s(log, "  skin: %zu joints, up to 4 weights per vertex\n", mesh.skinJoints);
+            OutputDebugStringA(log);
+        }
+        sprintf_s(log, "  vertex fetch: %zu -> %zu cache line misses, overfetch %.3f -> %.3f\n",
+            mesh.fetchMissesBefore, mesh.fetchMissesAfter, mesh.overfetchBefore, mesh.overfetchAfter);
+        OutputDebugStringA(log);
+        if (mImportOptions.buildMeshlets)
+        {
+            sprintf_s(log, "  meshlets: %zu\n", mesh.meshletCount);
+            OutputDebugStringA(log);
+        }
+        for (size_t i = 1; i < mesh.lods.size(); i++)
+        {
+            sprintf_s(log, "  lod%zu: %zu tris (%.1f%%), error %.6f\n", i, mesh.lods[i].triangleCount,
+                100.0 * mesh.lods[i].triangleCount / std::max<size_t>(mesh.triangleCount, 1), mesh.lods[i].error);
+            OutputDebugStringA(log);
+        }
+    }
+
+    const MaterialImportStats& m = report.materials;
+    sprintf_s(log, "FBX materials: %zu -> %zu unique, %zu texture references -> %zu textures (%zu embedded)\n",
+        m.sourceMaterials, mMaterials.size(), m.textureReferences, mMaterialTextures.size(), m.embeddedTextures);
+    OutputDebugStringA(log);
+    const TextureAtlas::BuildStats& atlas = m.atlas.build;
+    if (atlas.pageCount > 0)
+    {
+        sprintf_s(log, "FBX atlas: %zu / %zu small textures -> %zu pages, %.1f%% of page texels used, pack %.3f ms, build %.2f ms\n",
+            atlas.imageCount, m.atlas.candidates, atlas.pageCount, 100.0 * atlas.imageTexels / std::max<uint64_t>(atlas.pageTexels, 1),
+            atlas.packMs, atlas.buildMs);
+        OutputDebugStringA(log);
+    }
+
+    // テイクごとの圧縮率と、全フレームで測った誤差（予算はモデル空間の距離）
+    for (const AnimationImportStats& animation : report.animations)
+    {
+        const AnimationCompression::CompressStats& c = animation.compression;
+        sprintf_s(log, "FBX take '%s': %u frames, %zu -> %zu bytes (%.1fx), %zu constant tracks, %zu / %zu keys kept\n",
+            animation.name.c_str(), animation.frameCount, c.rawBytes, c.compressedBytes,
+            double(c.rawBytes) / std::max<size_t>(c.compressedBytes, 1), c.constantTracks, c.keyCount, c.sampleCount);
+        OutputDebugStringA(log);
+        sprintf_s(log, "  error %.6f (budget %.6f, %u attempts)\n", animation.measuredError, animation.errorBudget, c.attempts);
+        OutputDebugStringA(log);
+    }
+
+    // GPU の頂点形式に変換したときの誤差（測定値 / 形式から決まる上限）
+    const VertexPacking::PackingStats& packing = report.packing;
+    sprintf_s(log, "GPU vertices: position %.6f (<= %.6f), normal %.4f deg, tangent %.4f deg (<= %.4f), uv %.6f (<= %.6f)\n",
+        packing.measured.position, packing.bound.position,
+        packing.measured.normalDegrees, packing.measured.tangentDegrees, packing.bound.normalDegrees,
+        packing.measured.uv, packing.bound.uv);
+    OutputDebugStringA(log);
+    if (packing.measured.position > packing.bound.position ||
+        packing.measured.normalDegrees > packing.bound.normalDegrees ||
+        packing.measured.tangentDegrees > packing.bound.tangentDegrees ||
+        packing.measured.uv > packing.bound.uv)
+    {
+        OutputDebugStringA("GPU vertices exceed the error bound\n");
+    }
+
+    // 段階ごとの処理時間
+    double total = 0.0;
+    for (const ImportStageTiming& stage : report.stages)
+    {
+        sprintf_s(log, "FBX stage %-12s %8.2f ms\n", stage.stage.c_str(), stage.milliseconds);
+        OutputDebugStringA(log);
+        total += stage.milliseconds;
+    }
+    sprintf_s(log, "FBX load total   %8.2f ms\n", total);
+    OutputDebugStringA(log);
+}
+
+void D3DApp::LoadTexture(const std::wstring& path)
+{
+    // AssetCooker の出力（同じ名前の .texture）が隣にあれば、元の画像を読まずにマップしてそのまま転送する
+    // 元の画像を変えたら AssetCooker で作り直す（変わったものだけ作り直される）
+    auto start = std::chrono::steady_clock::now();
+    std::filesystem::path cookedPath(path);
+    cookedPath.replace_extension(L".texture");
+    TextureFileView cooked;
+    if (cooked.Open(cookedPath.string()) && CreateTexture(cooked.GetData(), mTextureSRV))
+    {
+        const TextureFile::Header& header = cooked.GetHeader();
+        char log[160];
+        sprintf_s(log, "Cooked texture load: %.2f ms (%ux%u, %u mips, %s)\n",
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(),
+            header.width, header.height, header.mipCount, GetPixelFormatName(header.format));
+        OutputDebugStringA(log);
+    }
+    else
+    {
+        std::vector<unsigned char> source;
+        if (!ReadFileBytes(path, source)) {
+            MessageBoxW(nullptr, L"テクスチャ読み込み失敗", L"Error", MB_OK);
+            return;
+        }
+        std::string error;
+        if (!CreateTextureFromFile(source.data(), source.size(), true, mTextureSRV, error)) {
+            MessageBoxA(nullptr, error.c_str(), "Texture Load Error", MB_OK);
+            return;
+        }
     }
 
     // サンプラー（補間設定）
@@ -202,6 +578,310 @@ void D3DApp::LoadTexture(const std::wstring& path)
     mDevice->CreateSamplerState(&samp, mSamplerState.GetAddressOf());
 }
 
+bool D3DApp::CreateTextureFromFile(const void* data, size_t size, bool srgb, ComPtr<ID3D11ShaderResourceView>& srv, std::string& error)
+{
+    StreamedTexture texture;
+    if (!CookTexture(data, size, srgb, texture, error)) return false;
+    if (!CreateTexture(texture.data, srv))
+    {
+        error = "texture creation failed";
+        return false;
+    }
+    return true;
+}
+
+bool D3DApp::CookTexture(const void* data, size_t size, bool srgb, StreamedTexture& texture, std::string& error)
+{
+    MipGenerator::Options mipOptions;
+    mipOptions.filter = mMipFilter;
+    mipOptions.srgb = srgb;
+
+    Hasher hasher(Hash64(data, size));
+    hasher.AddValue(kImageDecoderVersion);
+    hasher.AddValue(TextureFile::kVersion);
+    hasher.AddValue(MipGenerator::kVersion);
+    hasher.AddValue(MipGenerator::HashOptions(mipOptions));
+    hasher.AddValue(BlockCompression::kVersion);
+    hasher.AddValue(mCompressTextures);
+    hasher.AddValue(mBlockQuality);
+    const uint64_t key = hasher.Get();
+
+    // キャッシュにあればクック済みテクスチャ（展開・圧縮済みの全段）をマップするだけ
+    std::string cachedPath;
+    if (mCache.Find("texture", key, cachedPath) && texture.file.Open(cachedPath))
+    {
+        texture.data = texture.file.GetData();
+        return true;
+    }
+
+    // 展開してミップを作り、各段を BC に圧縮して、キャッシュに置いてからマップし直す
+    // アトラスのページのようにクック済みテクスチャが渡されたら、ミップは作らずに入っている段をそのまま使う
+    ImageData image;
+    std::vector<ImageData> levels;
+    const uint8_t* bytesIn = static_cast<const uint8_t*>(data);
+    std::string fileError;
+    if (TextureFile::Validate(bytesIn, size, fileError))
+    {
+        const TextureFile::Header& header = *reinterpret_cast<const TextureFile::Header*>(bytesIn);
+        const TextureFile::Subresource* subresources = reinterpret_cast<const TextureFile::Subresource*>(&header + 1);
+        if (header.format != PixelFormat::RGBA8 || header.arraySize != 1)
+        {
+            texture.bytes.assign(bytesIn, bytesIn + size);
+            texture.data = texture.bytes.data();
+            return true;
+        }
+        levels.resize(header.mipCount);
+        for (uint32_t mip = 0; mip < header.mipCount; mip++)
+        {
+            ImageData& level = levels[mip];
+            level.width = MipExtent(header.width, mip);
+            level.height = MipExtent(header.height, mip);
+            const uint8_t* pixels = bytesIn + subresources[mip].offset;
+            level.pixels.assign(pixels, pixels + subresources[mip].slicePitch);
+        }
+        image = levels[0];
+    }
+    else
+    {
+        if (!DecodeImageRGBA8(data, size, image, error)) return false;
+        MipGenerator::GenerateMips(image, mipOptions, levels, &mThreadPool);
+    }
+
+    const PixelFormat format = mCompressTextures ? BlockCompression::ChooseFormat(image.width, image.height, !srgb) : PixelFormat::RGBA8;
+    if (format != PixelFormat::RGBA8)
+    {
+        auto start = std::chrono::steady_clock::now();
+        ImageData compressed, decoded;
+        for (size_t level = 0; level < levels.size(); level++)
+        {
+            BlockCompression::CompressImage(levels[level], format, mBlockQuality, compressed, &mThreadPool);
+            if (level == 0) BlockCompression::DecompressImage(compressed, decoded);
+            std::swap(levels[level], compressed);
+        }
+        char log[160];
+        sprintf_s(log, "Texture %ux%u -> %s (%s): %.2f dB, %.2f ms\n", image.width, image.height, GetPixelFormatName(format),
+            BlockCompression::GetQualityName(mBlockQuality), BlockCompression::ComputePsnr(image, decoded, format),
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        OutputDebugStringA(log);
+    }
+
+    std::vector<uint8_t> bytes;
+    if (!TextureFile::Serialize(levels, uint32_t(levels.size()), srgb ? uint32_t(TextureFile::kFlagSrgb) : 0u, bytes, error)) return false;
+    mCache.Put("texture", key, bytes.data(), bytes.size());
+    if (mCache.Find("texture", key, cachedPath) && texture.file.Open(cachedPath))
+    {
+        texture.data = texture.file.GetData();
+        return true;
+    }
+    texture.bytes = std::move(bytes);
+    texture.data = texture.bytes.data();
+    return true;
+}
+
+void D3DApp::LoadMaterialTextures(const std::vector<ModelTexture>& textures)
+{
+    // 同じ内容の画像は（パスが違っても）1枚のテクスチャを共有する
+    // 法線マップとして参照される画像は値そのものが向きなので、ミップを sRGB として混ぜない
+    auto start = std::chrono::steady_clock::now();
+    std::vector<bool> srgb(textures.size(), true);
+    for (const Material& material : mMaterials)
+    {
+        const int32_t normal = material.textures[kTextureNormal];
+        if (normal >= 0 && size_t(normal) < textures.size()) srgb[normal] = false;
+    }
+    // ストリーミングするときはミップの末尾だけでテクスチャを作り、細かい段は描画で必要になってから読む
+    mTextureStreamer.Clear();
+    mTextureStreamer.SetSettings(mStreamingSettings);
+    mTextures.clear();
+    mMaterialTextures.assign(textures.size(), -1);
+    std::unordered_map<uint64_t, int32_t> unique;
+    size_t embedded = 0, missing = 0;
+    uint64_t fullBytes = 0;
+    for (size_t i = 0; i < textures.size(); i++)
+    {
+        const ModelTexture& texture = textures[i];
+        std::vector<unsigned char> fileBytes;
+        const void* data = texture.embedded.data();
+        size_t size = texture.embedded.size();
+        if (texture.embedded.empty())
+        {
+            if (!ReadFileBytes(std::filesystem::u8path(texture.path), fileBytes))
+            {
+                OutputDebugStringA(("Texture not found: " + texture.path + "\n").c_str());
+                missing++;
+                continue;
+            }
+            data = fileBytes.data();
+            size = fileBytes.size();
+        }
+        else
+        {
+            embedded++;
+        }
+
+        Hasher content(Hash64(data, size));
+        content.AddValue(bool(srgb[i]));
+        auto found = unique.find(content.Get());
+        if (found != unique.end())
+        {
+            mMaterialTextures[i] = found->second;
+            continue;
+        }
+        std::string error;
+        auto streamed = std::make_unique<StreamedTexture>();
+        if (!CookTexture(data, size, srgb[i], *streamed, error))
+        {
+            OutputDebugStringA(("Texture load failed: " + texture.path + ": " + error + "\n").c_str());
+            missing++;
+            continue;
+        }
+        const TextureFile::Header& header = *reinterpret_cast<const TextureFile::Header*>(streamed->data);
+        fullBytes += header.fileSize;
+        uint32_t firstMip = 0;
+        if (mTextureStreaming)
+        {
+            // Streamer の番号は mTextures の添字と同じ
+            const uint32_t id = mTextureStreamer.Register(header.width, header.height, header.mipCount, header.format, header.arraySize);
+            firstMip = mTextureStreamer.GetTailMip(id);
+        }
+        if (!CreateTexture(streamed->data, streamed->srv, firstMip))
+        {
+            OutputDebugStringA(("Texture creation failed: " + texture.path + "\n").c_str());
+            if (mTextureStreaming)
+            {
+                // 番号をずらさないよう、作れなかったテクスチャも Streamer と同じ位置に残す
+                streamed->data = nullptr;
+                mTextures.push_back(std::move(streamed));
+            }
+            missing++;
+            continue;
+        }
+        if (!mTextureStreaming)
+        {
+            // 全段を作ったので、マップやクックしたバイト列はもう要らない
+            streamed->file.Close();
+            streamed->bytes = std::vector<uint8_t>();
+            streamed->data = nullptr;
+        }
+        mMaterialTextures[i] = int32_t(mTextures.size());
+        unique[content.Get()] = mMaterialTextures[i];
+        mTextures.push_back(std::move(streamed));
+    }
+
+    char log[256];
+    sprintf_s(log, "Materials: %zu materials, %zu textures -> %zu images (%zu embedded, %zu missing), %.2f ms\n",
+        mMaterials.size(), textures.size(), unique.size(), embedded, missing,
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    OutputDebugStringA(log);
+    if (mTextureStreaming)
+    {
+        sprintf_s(log, "Texture streaming: mip tails %.2f MB resident of %.2f MB cooked, budget %.2f MB\n",
+            mTextureStreamer.GetStats().tailBytes / (1024.0 * 1024.0), fullBytes / (1024.0 * 1024.0),
+            mStreamingSettings.budgetBytes / (1024.0 * 1024.0));
+        OutputDebugStringA(log);
+    }
+}
+
+void D3DApp::UpdateTextureStreaming()
+{
+    if (!mTextureStreaming) return;
+
+    // フレーム中に集めた要求から常駐する段を決め直し、変わったテクスチャをその段から作り直す
+    // 作り直しでは古いテクスチャを捨てるので、細かい段を追い出せば実際にメモリが空く
+    auto start = std::chrono::steady_clock::now();
+    mTextureStreamer.Update(mStreamingChanges);
+    for (const TextureStreaming::Streamer::Change& change : mStreamingChanges)
+    {
+        // 作り直せなければ前のテクスチャが残るので、Streamer の常駐する段と常駐量も変更前に戻す
+        StreamedTexture& texture = *mTextures[change.texture];
+        ComPtr<ID3D11ShaderResourceView> srv;
+        if (texture.data && CreateTexture(texture.data, srv, change.firstMip))
+        {
+            texture.srv = srv;
+            continue;
+        }
+        mTextureStreamer.Revert(change);
+        char log[128];
+        sprintf_s(log, "Texture streaming: failed to recreate texture %u from mip %u, kept mip %u\n",
+            change.texture, change.firstMip, change.previousMip);
+        OutputDebugStringA(log);
+    }
+    mStreamingMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void D3DApp::BuildDrawOrder()
+{
+    // テクスチャとマテリアルの切り替えが減るよう、メッシュを持つノードを結ぶテクスチャ（アトラスのページ）の順、
+    // その中をマテリアル順に並べる（同じマテリアルの中は階層順のまま）
+    auto textureKey = [&](uint32_t material)
+    {
+        if (material >= mMaterials.size()) return uint64_t(0);
+        auto slot = [&](MaterialTextureSlot s)
+        {
+            const int32_t t = mMaterials[material].textures[s];
+            return uint32_t(t >= 0 && size_t(t) < mMaterialTextures.size() ? mMaterialTextures[t] + 1 : 0);
+        };
+        return uint64_t(slot(kTextureDiffuse)) << 32 | slot(kTextureNormal);
+    };
+    mDrawOrder.clear();
+    for (uint32_t i = 0; i < uint32_t(mNodes.size()); i++)
+    {
+        if (mNodes[i].mesh >= 0) mDrawOrder.push_back(i);
+    }
+    std::stable_sort(mDrawOrder.begin(), mDrawOrder.end(), [&](uint32_t a, uint32_t b)
+    {
+        const uint32_t ma = mSubMeshes[mNodes[a].mesh].material, mb = mSubMeshes[mNodes[b].mesh].material;
+        const uint64_t ka = textureKey(ma), kb = textureKey(mb);
+        if (ka != kb) return ka < kb;
+        return ma < mb;
+    });
+}
+
+bool D3DApp::CreateTexture(const uint8_t* file, ComPtr<ID3D11ShaderResourceView>& srv, uint32_t firstMip)
+{
+    // file は検証済みのクック済みテクスチャ全体（TextureFile）。ミップは CPU で作って（圧縮して）あるので、
+    // 表のオフセットと行ピッチで各サブリソースを指して初期データにし、コピーせずに変更不可のテクスチャを作る
+    // firstMip > 0 なら、その段を先頭にした小さいテクスチャを作る（ストリーミングで常駐する段だけ）
+    const TextureFile::Header& header = *reinterpret_cast<const TextureFile::Header*>(file);
+    const TextureFile::Subresource* subresources = reinterpret_cast<const TextureFile::Subresource*>(&header + 1);
+    firstMip = std::min(firstMip, header.mipCount - 1);
+
+    // sRGB の画像もこれまで通り UNORM として読む（ライティングはガンマ空間のまま）
+    DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    switch (header.format)
+    {
+    case PixelFormat::RGBA8: format = DXGI_FORMAT_R8G8B8A8_UNORM; break;
+    case PixelFormat::BC1: format = DXGI_FORMAT_BC1_UNORM; break;
+    case PixelFormat::BC3: format = DXGI_FORMAT_BC3_UNORM; break;
+    case PixelFormat::BC5: format = DXGI_FORMAT_BC5_UNORM; break;
+    case PixelFormat::BC7: format = DXGI_FORMAT_BC7_UNORM; break;
+    }
+    D3D11_TEXTURE2D_DESC td{};
+    td.Width = MipExtent(header.width, firstMip);
+    td.Height = MipExtent(header.height, firstMip);
+    td.MipLevels = header.mipCount - firstMip;
+    td.ArraySize = header.arraySize;
+    td.Format = format;
+    td.SampleDesc.Count = 1;
+    td.Usage = D3D11_USAGE_IMMUTABLE;
+    td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+    std::vector<D3D11_SUBRESOURCE_DATA> initial;
+    initial.reserve(size_t(td.MipLevels) * header.arraySize);
+    for (uint32_t slice = 0; slice < header.arraySize; slice++)
+    {
+        for (uint32_t mip = firstMip; mip < header.mipCount; mip++)
+        {
+            const TextureFile::Subresource& subresource = subresources[mip + slice * header.mipCount];
+            initial.push_back({ file + subresource.offset, subresource.rowPitch, subresource.slicePitch });
+        }
+    }
+
+    ComPtr<ID3D11Texture2D> texture;
+    if (FAILED(mDevice->CreateTexture2D(&td, initial.data(), texture.GetAddressOf()))) return false;
+    return SUCCEEDED(mDevice->CreateShaderResourceView(texture.Get(), nullptr, srv.ReleaseAndGetAddressOf()));
+}
+
 
 void D3DApp::CreateRenderTargetAndDepth(UINT width, UINT height)
 {
@@ -233,20 +913,22 @@ void D3DApp::CreateRenderTargetAndDepth(UINT width, UINT height)
 
 void D3DApp::CreateTriangle()
 {
-    Vertex vertices[] = {
-        {{ 0.0f,  0.5f, 0.f}, {0.f, 0.f, -1.f}, {1.f, 0.f}}, // 赤
-        {{ 0.5f, -0.5f, 0.f}, {0.f, 0.f, -1.f}, {0.f, 1.f}}, // 緑
-        {{-0.5f, -0.5f, 0.f}, {0.f, 0.f, -1.f}, {0.f, 0.f}}, // 青
+    const std::vector<Vertex> vertices = {
+        {{ 0.0f,  0.5f, 0.f}, {0.f, 0.f, -1.f}, {1.f, 0.f}, {1.f, 0.f, 0.f, 1.f}}, // 赤
+        {{ 0.5f, -0.5f, 0.f}, {0.f, 0.f, -1.f}, {0.f, 1.f}, {1.f, 0.f, 0.f, 1.f}}, // 緑
+        {{-0.5f, -0.5f, 0.f}, {0.f, 0.f, -1.f}, {0.f, 0.f}, {1.f, 0.f, 0.f, 1.f}}, // 青
     };
+    std::vector<uint8_t> gpuVertices;
+    VertexPacking::PackVertices(vertices, VertexFormat::Float32, VertexQuantization(), gpuVertices);
     uint16_t indices[] = {
         0, 1, 2, // 奥
     };
 
     D3D11_BUFFER_DESC vbd{};
-    vbd.ByteWidth = sizeof(vertices);
+    vbd.ByteWidth = UINT(gpuVertices.size());
     vbd.Usage = D3D11_USAGE_DEFAULT;
     vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-    D3D11_SUBRESOURCE_DATA vinit{ vertices };
+    D3D11_SUBRESOURCE_DATA vinit{ gpuVertices.data() };
     mDevice->CreateBuffer(&vbd, &vinit, mVB.GetAddressOf());
 
     D3D11_BUFFER_DESC ibd{};
@@ -265,8 +947,12 @@ void D3DApp::CreateShadersAndInputLayout()
     flags |= D3DCOMPILE_DEBUG;
 #endif
 
+    // 頂点形式に合わせて VSMain の入力と復元処理を切り替える
+    const D3D_SHADER_MACRO packedDefines[] = { { "PACKED_VERTEX", "1" }, { nullptr, nullptr } };
+    const bool packed = mVertexFormat == VertexFormat::Packed16;
+
     HRESULT hr = D3DCompileFromFile(
-        L"shaders.hlsl", nullptr, nullptr, "VSMain", "vs_5_0",
+        L"shaders.hlsl", packed ? packedDefines : nullptr, nullptr, "VSMain", "vs_5_0",
         flags, 0, vsBlob.GetAddressOf(), error.GetAddressOf());
     if (FAILED(hr)) {
         if (error) MessageBoxA(nullptr, (char*)error->GetBufferPointer(), "VS Compile Error", MB_OK);
@@ -287,20 +973,62 @@ void D3DApp::CreateShadersAndInputLayout()
     mDevice->CreateVertexShader(vsBlob->GetBufferPointer(), vsBlob->GetBufferSize(), nullptr, mVS.GetAddressOf());
     mDevice->CreatePixelShader(psBlob->GetBufferPointer(), psBlob->GetBufferSize(), nullptr, mPS.GetAddressOf());
 
+    // Float32Vertex: 位置 float3 / QTangent SNORM16x4 / UV float2
     D3D11_INPUT_ELEMENT_DESC layout[] = {
         {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,
          D3D11_INPUT_PER_VERTEX_DATA, 0},
-        {"NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,
+        {"QTANGENT", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0,
         D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
         {"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0,
          D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
     };
-    mDevice->CreateInputLayout(layout, _countof(layout),
+    // PackedVertex: 位置 UNORM16x4 / QTangent SNORM16x4 / UV half2
+    D3D11_INPUT_ELEMENT_DESC packedLayout[] = {
+        {"POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0,
+         D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"QTANGENT", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0,
+        D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0,
+         D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+    };
+    mDevice->CreateInputLayout(packed ? packedLayout : layout, packed ? _countof(packedLayout) : _countof(layout),
         vsBlob->GetBufferPointer(), vsBlob->GetBufferSize(),
         mInputLayout.GetAddressOf());
+
+    // スキン付きサブメッシュ用: 変形後の位置/法線/接線はスロット1（SkinnedVertex）、UV はスロット0 の元の頂点から読む
+    if (mSkinVertices.empty()) return;
+
+    const D3D_SHADER_MACRO skinnedDefines[] = { { "SKINNED_VERTEX", "1" }, { nullptr, nullptr } };
+    ComPtr<ID3DBlob> skinnedBlob;
+    error.Reset();
+    hr = D3DCompileFromFile(
+        L"shaders.hlsl", skinnedDefines, nullptr, "VSMain", "vs_5_0",
+        flags, 0, skinnedBlob.GetAddressOf(), error.GetAddressOf());
+    if (FAILED(hr)) {
+        if (error) MessageBoxA(nullptr, (char*)error->GetBufferPointer(), "VS Compile Error", MB_OK);
+        return;
+    }
+    mDevice->CreateVertexShader(skinnedBlob->GetBufferPointer(), skinnedBlob->GetBufferSize(), nullptr, mSkinnedVS.GetAddressOf());
+
+    D3D11_INPUT_ELEMENT_DESC skinnedLayout[] = {
+        {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 1, offsetof(SkinnedVertex, pos),
+         D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 1, offsetof(SkinnedVertex, normal),
+         D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"TANGENT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, offsetof(SkinnedVertex, tangent),
+         D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"TEXCOORD", 0, packed ? DXGI_FORMAT_R16G16_FLOAT : DXGI_FORMAT_R32G32_FLOAT, 0,
+         UINT(packed ? offsetof(PackedVertex, uv) : offsetof(Float32Vertex, uv)), D3D11_INPUT_PER_VERTEX_DATA, 0},
+    };
+    mDevice->CreateInputLayout(skinnedLayout, _countof(skinnedLayout),
+        skinnedBlob->GetBufferPointer(), skinnedBlob->GetBufferSize(),
+        mSkinnedInputLayout.GetAddressOf());
 }
 void D3DApp::Render(float time)
 {
+    UpdateAnimation(time);
+    UpdateSkinning();
+
     ConstantBufferData cb{};
 
     XMVECTOR eye = XMVectorSet(0.0f, 0.7f, -3.0f, 0.0f);
@@ -326,7 +1054,7 @@ void D3DApp::Render(float time)
     mContext->ClearDepthStencilView(mDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
 
     // パイプライン設定
-    UINT stride = sizeof(Vertex), offset = 0;
+    UINT stride = VertexFormatStride(mVertexFormat), offset = 0;
     mContext->IASetVertexBuffers(0, 1, mVB.GetAddressOf(), &stride, &offset);
     mContext->IASetIndexBuffer(mIB.Get(), DXGI_FORMAT_R32_UINT, 0);
     mContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
@@ -335,31 +1063,279 @@ void D3DApp::Render(float time)
     mContext->PSSetShader(mPS.Get(), nullptr, 0);
     mContext->VSSetConstantBuffers(0, 1, mConstantBuffer.GetAddressOf());
     mContext->PSSetConstantBuffers(0, 1, mConstantBuffer.GetAddressOf());
-    mContext->PSSetShaderResources(0, 1, mTextureSRV.GetAddressOf());
     mContext->PSSetSamplers(0, 1, mSamplerState.GetAddressOf());
 
-    // マテリアル
-    cb.materialColor = XMFLOAT4(1, 1, 1, 1); // アルベド乗算（白＝無加工）
-    cb.specPower = 64.0f;                // 鏡面の鋭さ
-    cb.useTexture = 1u;                   // テクスチャを使う
+    // マテリアル（値は定数バッファに入れ、ワールド行列と一緒に描画ごとに送る。テクスチャは変わったときだけ結ぶ）
+    // マテリアルのないモデルは既定値（白、鏡面の鋭さ 64）と mTextureSRV で描く
+    // アトラスのページを共有するマテリアルどうしはテクスチャを結び直さない（UV の変換は定数バッファで渡す）
+    uint32_t boundMaterial = UINT32_MAX;
+    ID3D11ShaderResourceView* boundViews[2] = { nullptr, nullptr };
+    bool viewsBound = false;
+    auto bindMaterial = [&](uint32_t index)
+    {
+        if (index == boundMaterial) return;
+        boundMaterial = index;
+        mMaterialBinds++;
+
+        const bool hasMaterial = index < mMaterials.size();
+        const Material material = hasMaterial ? mMaterials[index] : Material();
+        auto texture = [&](MaterialTextureSlot slot) -> ID3D11ShaderResourceView*
+        {
+            const int32_t t = material.textures[slot];
+            const int32_t index = t >= 0 && size_t(t) < mMaterialTextures.size() ? mMaterialTextures[t] : -1;
+            return index >= 0 ? mTextures[index]->srv.Get() : nullptr;
+        };
+        ID3D11ShaderResourceView* views[] = { hasMaterial ? texture(kTextureDiffuse) : mTextureSRV.Get(), texture(kTextureNormal) };
+        if (!viewsBound || views[0] != boundViews[0] || views[1] != boundViews[1])
+        {
+            mContext->PSSetShaderResources(0, 2, views);
+            viewsBound = true;
+            boundViews[0] = views[0];
+            boundViews[1] = views[1];
+            mTextureBinds++;
+        }
+
+        cb.materialColor = XMFLOAT4(material.diffuse.x, material.diffuse.y, material.diffuse.z, material.diffuse.w);
+        cb.specPower = material.specularPower;
+        cb.specularColor = XMFLOAT3(material.specular.x, material.specular.y, material.specular.z);
+        cb.emissiveColor = XMFLOAT3(material.emissive.x, material.emissive.y, material.emissive.z);
+        cb.useTexture = views[0] ? 1u : 0u;
+        cb.useNormalMap = views[1] ? 1u : 0u;
+        const Float4& diffuseUv = material.uvScaleOffset[kTextureDiffuse];
+        const Float4& normalUv = material.uvScaleOffset[kTextureNormal];
+        cb.diffuseUvScaleOffset = XMFLOAT4(diffuseUv.x, diffuseUv.y, diffuseUv.z, diffuseUv.w);
+        cb.normalUvScaleOffset = XMFLOAT4(normalUv.x, normalUv.y, normalUv.z, normalUv.w);
+    };
+
+    // LOD の誤差（モデル空間の距離）を画面上のピクセル数に換算する係数（距離 1 のときの 1 単位の長さ）
+    XMFLOAT4X4 projValues;
+    XMStoreFloat4x4(&projValues, proj);
+    const float pixelsPerUnit = projValues._22 * 0.5f * float(mHeight);
+
+    // ストリーミングするテクスチャに、描くサブメッシュで必要な段を伝える（結ぶ拡散色と法線マップのみ）
+    // テクセル密度は UV 密度 * テクスチャの長い辺で、距離と同じくモデル空間で測る（アトラスならページの中の範囲の辺）
+    auto requestTextures = [&](const SubMesh& submesh, float distance)
+    {
+        if (!mTextureStreaming || submesh.material >= mMaterials.size()) return;
+        const Material& material = mMaterials[submesh.material];
+        for (MaterialTextureSlot slot : { kTextureDiffuse, kTextureNormal })
+        {
+            const int32_t t = material.textures[slot];
+            const int32_t index = t >= 0 && size_t(t) < mMaterialTextures.size() ? mMaterialTextures[t] : -1;
+            if (index < 0) continue;
+            const TextureFile::Header& header = *reinterpret_cast<const TextureFile::Header*>(mTextures[index]->data);
+            const Float4& uv = material.uvScaleOffset[slot];
+            const float texelsPerUnit = submesh.uvDensity * std::max(header.width * uv.x, header.height * uv.y);
+            mTextureStreamer.Request(uint32_t(index), TextureStreaming::RequiredMip(texelsPerUnit, distance, pixelsPerUnit));
+        }
+    };
+
+    // シーンの全ノードを1つのモデルとして描く
+    const XMVECTOR eyeWorld = XMLoadFloat3(&cb.camPos);
+    const XMMATRIX viewProj = view * proj;
+    ClusterCulling::CullStats frameStats;
+
+    // スキン付きサブメッシュは2本のストリームをサブメッシュの位置にずらして結び、BaseVertexLocation は 0 で描く
+    bool skinnedBound = false;
+    auto bindStreams = [&](const SubMesh* skinned)
+    {
+        if (skinned)
+        {
+            ID3D11Buffer* buffers[] = { mVB.Get(), mSkinVB.Get() };
+            const UINT strides[] = { stride, UINT(sizeof(SkinnedVertex)) };
+            const UINT offsets[] = { skinned->vertexOffset * stride, skinned->skinVertexOffset * UINT(sizeof(SkinnedVertex)) };
+            mContext->IASetVertexBuffers(0, 2, buffers, strides, offsets);
+            mContext->IASetInputLayout(mSkinnedInputLayout.Get());
+            mContext->VSSetShader(mSkinnedVS.Get(), nullptr, 0);
+        }
+        else
+        {
+            mContext->IASetVertexBuffers(0, 1, mVB.GetAddressOf(), &stride, &offset);
+            mContext->IASetInputLayout(mInputLayout.Get());
+            mContext->VSSetShader(mVS.Get(), nullptr, 0);
+        }
+        skinnedBound = skinned != nullptr;
+    };
+
+    // サブメッシュの境界はワールド空間で判定する
+    XMFLOAT4X4 viewProjValues;
+    XMStoreFloat4x4(&viewProjValues, viewProj);
+    const ClusterCulling::Frustum worldFrustum = ClusterCulling::ExtractFrustum(viewProjValues.m);
+
+    auto drawModel = [&](const XMMATRIX& modelWorld)
+    {
+        // 全ノードのワールド行列を求め、サブメッシュの境界をまとめてワールド空間に移す
+        mInstanceWorld.resize(mNodes.size());
+        mWorldBounds.resize(mNodes.size());
+        for (size_t i = 0; i < mNodes.size(); i++)
+        {
+            XMStoreFloat4x4(&mInstanceWorld[i], XMLoadFloat4x4(&mNodeWorld[i]) * modelWorld);
+        }
+        Bounds::TransformBounds(mSubMeshes.data(), mNodeMeshes.data(), reinterpret_cast<const float (*)[4][4]>(mInstanceWorld.data()),
+            mNodes.size(), mWorldBounds.data());
+
+        for (uint32_t i : mDrawOrder)
+        {
+            const SceneNode& node = mNodes[i];
+
+            // スキニング済みの頂点はモデル空間にあるので、ノードの行列は掛けない
+            // 境界もバインドポーズのものなのでスキン付きはカリングしない
+            const SubMesh& submesh = mSubMeshes[node.mesh];
+            const bool skinned = submesh.jointCount > 0 && mSkinVB && mSkinnedVS;
+            if (mSubMeshCulling && !skinned)
+            {
+                frameStats.submeshes++;
+                if (!Bounds::IsVisible(worldFrustum, mWorldBounds[i]))
+                {
+                    frameStats.submeshesCulled++;
+                    continue;
+                }
+            }
+            if (skinned || skinnedBound) bindStreams(skinned ? &submesh : nullptr);
+            bindMaterial(submesh.material);
+            const XMMATRIX world = XMLoadFloat4x4(&mInstanceWorld[i]);
+            cb.world = XMMatrixTranspose(skinned ? modelWorld : world);
+            // 量子化頂点の位置の復元（サブメッシュごとの AABB）
+            const VertexQuantization& q = submesh.quantization;
+            cb.posOffset = XMFLOAT3(q.positionOffset.x, q.positionOffset.y, q.positionOffset.z);
+            cb.posScale = XMFLOAT3(q.positionScale.x, q.positionScale.y, q.positionScale.z);
+            mContext->UpdateSubresource(mConstantBuffer.Get(), 0, nullptr, &cb, 0, 0);
+
+            XMFLOAT3 eyeLocal;
+            XMStoreFloat3(&eyeLocal, XMVector3TransformCoord(eyeWorld, XMMatrixInverse(nullptr, world)));
+
+            // 誤差が許容ピクセル数に収まる最も粗い LOD を選ぶ
+            // 誤差と距離の比はモデルの拡大率で変わらないので、どちらもモデル空間で測る（球の中なら LOD0）
+            // スキン付きはバインドポーズの境界球で近似する
+            const float dx = eyeLocal.x - submesh.boundsCenter.x;
+            const float dy = eyeLocal.y - submesh.boundsCenter.y;
+            const float dz = eyeLocal.z - submesh.boundsCenter.z;
+            const float distance = std::sqrt(dx * dx + dy * dy + dz * dz) - submesh.boundsRadius;
+            requestTextures(submesh, distance);
+            MeshLod lod = { submesh.indexOffset, submesh.indexCount, submesh.meshletOffset, submesh.meshletCount, 0.0f };
+            if (submesh.lodCount > 1 && mLodErrorPixels > 0.0f)
+            {
+                if (distance > 0.0f)
+                {
+                    const MeshLod* lods = &mLods[submesh.lodOffset];
+                    for (uint32_t l = 1; l < submesh.lodCount && lods[l].error * pixelsPerUnit <= mLodErrorPixels * distance; l++)
+                    {
+                        lod = lods[l];
+                    }
+                }
+            }
+            mLodTriangles += lod.indexCount / 3;
+            mFullTriangles += submesh.indexCount / 3;
+
+            // スキン付きはクラスタの境界がバインドポーズのものなのでカリングしない
+            if (skinned)
+            {
+                mContext->DrawIndexed(lod.indexCount, lod.indexOffset, 0);
+                continue;
+            }
+            if (!mClusterCulling || lod.meshletCount == 0)
+            {
+                mContext->DrawIndexed(lod.indexCount, lod.indexOffset, INT(submesh.vertexOffset));
+                continue;
+            }
+
+            // モデル空間で視錐台と法線コーンを判定し、残ったクラスタの範囲だけ描く
+            XMFLOAT4X4 worldViewProj;
+            XMStoreFloat4x4(&worldViewProj, world * viewProj);
+
+            mDrawRanges.clear();
+            ClusterCulling::CullMeshlets(&mMeshlets[lod.meshletOffset], lod.meshletCount,
+                ClusterCulling::ExtractFrustum(worldViewProj.m), Float3{ eyeLocal.x, eyeLocal.y, eyeLocal.z },
+                mDrawRanges, frameStats);
+            for (const ClusterCulling::DrawRange& range : mDrawRanges)
+            {
+                mContext->DrawIndexed(range.indexCount, range.indexOffset, INT(submesh.vertexOffset));
+            }
+        }
+    };
 
     // --- モデル1 ---
     XMMATRIX world1 = XMMatrixScaling(0.5f, 0.5f, 0.5f)
         * XMMatrixTranslation(-1.0f, 0.0f, 0.0f)
         * XMMatrixRotationY(time);
-    cb.world = XMMatrixTranspose(world1);
-    mContext->UpdateSubresource(mConstantBuffer.Get(), 0, nullptr, &cb, 0, 0);
-    mContext->DrawIndexed(mIndexCount, 0, 0);
+    drawModel(world1);
 
     // --- モデル2 ---
     XMMATRIX world2 = XMMatrixScaling(0.5f, 0.5f, 0.5f)
         * XMMatrixTranslation(1.0f, 0.0f, 0.0f)
         * XMMatrixRotationY(-time * 0.5f);
-    cb.world = XMMatrixTranspose(world2);
-    mContext->UpdateSubresource(mConstantBuffer.Get(), 0, nullptr, &cb, 0, 0);
-    mContext->DrawIndexed(mIndexCount, 0, 0);
+    drawModel(world2);
+
+    UpdateTextureStreaming();
 
     mSwapChain->Present(1, 0);
+
+    // クラスタカリングと LOD 選択の結果を一定フレームごとにまとめて出す
+    mCullStats.Add(frameStats);
+    if (++mCullStatsFrames == 300)
+    {
+        const ClusterCulling::CullStats& s = mCullStats;
+        if (s.submeshes > 0)
+        {
+            char log[128];
+            sprintf_s(log, "Submesh culling: %.1f%% of %.1f submeshes/frame outside the frustum\n",
+                100.0 * s.submeshesCulled / s.submeshes, double(s.submeshes) / mCullStatsFrames);
+            OutputDebugStringA(log);
+        }
+        if (s.clusters > 0)
+        {
+            char log[192];
+            sprintf_s(log, "Cluster culling: %.1f%% frustum, %.1f%% backface, %.1f%% triangles drawn, %.1f draws/frame\n",
+                100.0 * s.frustumCulled / s.clusters, 100.0 * s.backfaceCulled / s.clusters,
+                100.0 * s.trianglesDrawn / std::max<size_t>(s.triangles, 1), double(s.drawCalls) / mCullStatsFrames);
+            OutputDebugStringA(log);
+        }
+        if (mFullTriangles > 0)
+        {
+            char log[128];
+            sprintf_s(log, "LOD: %.1f%% of full-detail triangles submitted\n", 100.0 * mLodTriangles / mFullTriangles);
+            OutputDebugStringA(log);
+        }
+        if (mPlayAnimation && mAnimationClip < mAnimations.size())
+        {
+            char log[160];
+            sprintf_s(log, "Animation: '%s', %u nodes, %.3f ms/frame\n", mAnimations[mAnimationClip].name.c_str(),
+                mAnimations[mAnimationClip].nodeCount, mAnimationMs / mCullStatsFrames);
+            OutputDebugStringA(log);
+        }
+        if (!mSkinVertices.empty())
+        {
+            char log[128];
+            sprintf_s(log, "Skinning: %zu vertices, %.3f ms/frame (%s, %zu threads)\n", mSkinVertices.size(),
+                mSkinningMs / mCullStatsFrames, Skinning::GetKernelName(), mThreadPool.GetThreadCount());
+            OutputDebugStringA(log);
+        }
+        if (mMaterialBinds > 0)
+        {
+            char log[128];
+            sprintf_s(log, "Materials: %.1f binds/frame, %.1f texture binds/frame\n", double(mMaterialBinds) / mCullStatsFrames,
+                double(mTextureBinds) / mCullStatsFrames);
+            OutputDebugStringA(log);
+        }
+        if (mTextureStreaming && mTextureStreamer.GetTextureCount() > 0)
+        {
+            const TextureStreaming::Streamer::Stats& t = mTextureStreamer.GetStats();
+            const double mb = 1024.0 * 1024.0;
+            char log[256];
+            sprintf_s(log, "Texture streaming: %zu textures, %.2f / %.2f MB resident (%.2f MB requested, %.2f MB tails), "
+                "%zu loads, %zu evictions, %zu deferred, %zu reverted, %.3f ms/frame\n",
+                t.textureCount, t.residentBytes / mb, mStreamingSettings.budgetBytes / mb, t.requestedBytes / mb, t.tailBytes / mb,
+                t.loads, t.evictions, t.deferredLoads, t.reverts, mStreamingMs / mCullStatsFrames);
+            OutputDebugStringA(log);
+        }
+        mCullStats = ClusterCulling::CullStats();
+        mCullStatsFrames = 0;
+        mLodTriangles = mFullTriangles = 0;
+        mSkinningMs = 0.0;
+        mAnimationMs = 0.0;
+        mMaterialBinds = mTextureBinds = 0;
+        mStreamingMs = 0.0;
+    }
 }
 
 void D3DApp::OnResize(UINT width, UINT height)
@@ -392,6 +1368,10 @@ void D3DApp::Cleanup()
     mVS.Reset();
     mPS.Reset();
     mInputLayout.Reset();
+    mSkinnedVS.Reset();
+    mSkinnedInputLayout.Reset();
+    mSkinVB.Reset();
+    mImporter.reset();
 
     mRTV.Reset();
     mDSV.Reset();
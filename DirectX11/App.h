@@ -2,18 +2,31 @@
 #include <Windows.h>
 #include <d3d11.h>
 #include <DirectXMath.h>
-#include <DirectXTK/WICTextureLoader.h>
 #include <wrl.h>
 #include <cstdint>
+#include <future>
+#include <memory>
 #include <string>
 #include <vector>
+#include "AnimationClip.h"
+#include "BatchImporter.h"
+#include "BlockCompression.h"
+#include "Bounds.h"
 #include "Camera.h"
+#include "ClusterCulling.h"
+#include "DerivedDataCache.h"
+#include "ImageLoader.h"
+#include "MipGenerator.h"
+#include "ModelImporter.h"
+#include "Skinning.h"
+#include "TextureFile.h"
+#include "TextureStreaming.h"
+#include "ThreadPool.h"
 
 #pragma comment(lib, "d3d11.lib")       // D3D11 ̖{
 #pragma comment(lib, "dxgi.lib")        // Xbv`F[Ȃ
 #pragma comment(lib, "d3dcompiler.lib") // VF[_[RpCp
 #pragma comment(lib, "libfbxsdk.lib")	// FBX SDK
-#pragma comment(lib, "DirectXTK.lib")
 
 using Microsoft::WRL::ComPtr;
 using namespace DirectX;
@@ -31,11 +44,43 @@ private:
 	void CreateRenderTargetAndDepth(UINT width, UINT height);
 	void CreateTriangle();
 	void CreateShadersAndInputLayout();
-	bool LoadFBXModel(const std::string& path);
+	void BeginLoadModel(const std::string& path);
+	bool FinishLoadModel();
+	bool TextureDependenciesCurrent(uint64_t key);
+	bool LoadFBXModel(const ModelData& model, ImportReport& report);
+	bool LoadCookedModel(const std::string& path);
+	void UpdateNodeTransforms();
+	void UpdateAnimation(float time);
+	bool CreateSkinningBuffer();
+	void UpdateSkinning();
+	void LogImportReport(const ImportReport& report);
 	void LoadTexture(const std::wstring& path);
+	struct StreamedTexture;
+	bool CookTexture(const void* data, size_t size, bool srgb, StreamedTexture& texture, std::string& error);
+	bool CreateTextureFromFile(const void* data, size_t size, bool srgb, ComPtr<ID3D11ShaderResourceView>& srv, std::string& error);
+	bool CreateTexture(const uint8_t* file, ComPtr<ID3D11ShaderResourceView>& srv, uint32_t firstMip = 0);
+	void LoadMaterialTextures(const std::vector<ModelTexture>& textures);
+	void UpdateTextureStreaming();
+	void BuildDrawOrder();
 
 public:
 	Camera mCamera;
+	MeshImportOptions mImportOptions;
+	bool mCompressCookedMeshes = false;	// LbVɒuNbNς݃bV̒_/CfbNXk邩i񈳏kȂ}bv͈͂̂܂ GPU ɓnj
+	bool mSubMeshCulling = true;		// `OɃTubV̋EŎJO邩
+	bool mClusterCulling = true;		// `OɃNX^PʂŎ/JO邩
+	float mLodErrorPixels = 1.0f;		// LOD ̌`̌덷ʏŉsNZ܂ŋi0 Ȃ LOD0j
+	bool mSkinningBenchmark = false;	// N CPU XLjȌx𑪂ăfobOo͂ɏo
+	MipGenerator::Filter mMipFilter = MipGenerator::Filter::Kaiser;	// eNX`̃~bvƂ̏ktB^
+	bool mMipBenchmark = false;			// NɃ~bv̏x𑪂ăfobOo͂ɏo
+	bool mCompressTextures = true;		// eNX` BC `Ɉk GPU ɒui@}bv BC5AȊO BC7j
+	BlockCompression::Quality mBlockQuality = BlockCompression::Quality::Normal;	// BC k̕iixƂ̂ˍj
+	bool mBlockCompressionBenchmark = false;	// N BC k̏x PSNR 𑪂ăfobOo͂ɏo
+	bool mTextureStreaming = true;		// }eÃeNX`~bv̖ōAɉčׂiǂݍނ
+	TextureStreaming::Streamer::Settings mStreamingSettings;	// 풓ʂ̗\ZȂǁifǂݍޑOɐݒ肷j
+	std::string mImportBenchmarkDirectory;	// łȂ΋Nɂ̃tH_ȉ FBX [J[ςăC|[gAvԂo
+	bool mPlayAnimation = true;			// ǂݍ񂾃eCNĐ邩ifalse ȂoCh|[Ŷ܂܁j
+	uint32_t mAnimationClip = 0;		// ĐeCN̔ԍ
 
 private:
 	UINT mWidth = 1280;
@@ -54,16 +99,13 @@ private:
 	ComPtr<ID3D11VertexShader> mVS;
 	ComPtr<ID3D11PixelShader> mPS;
 	ComPtr<ID3D11InputLayout> mInputLayout;
+	ComPtr<ID3D11VertexShader> mSkinnedVS;			// XLtTubVpiʒu/@/ڐXbg1ǂށj
+	ComPtr<ID3D11InputLayout> mSkinnedInputLayout;
 
-	ComPtr<ID3D11ShaderResourceView> mTextureSRV;
+	ComPtr<ID3D11ShaderResourceView> mTextureSRV;	// }eAȂfɎgeNX`
 	ComPtr<ID3D11SamplerState> mSamplerState;
 
-	struct Vertex 
-	{ 
-		XMFLOAT3 pos; 
-		XMFLOAT3 normal;
-		XMFLOAT2 uv;
-	};
+	using Vertex = MeshVertex;
 
 	struct ConstantBufferData
 	{
@@ -82,8 +124,80 @@ private:
 		XMFLOAT4 materialColor;
 
 		UINT              useTexture;
-		XMFLOAT3 _pad; // 16byte AC킹
+		UINT              useNormalMap;
+		XMFLOAT2 _pad; // 16byte AC킹
+
+		// ʎq_̈ʒu̕ipos = posOffset + unorm * posScalej
+		XMFLOAT3 posOffset;
+		float             _pad1;
+		XMFLOAT3 posScale;
+		float             _pad2;
+
+		// }eA̋ʔːFƎȔF
+		XMFLOAT3 specularColor;
+		float             _pad3;
+		XMFLOAT3 emissiveColor;
+		float             _pad4;
+
+		// gUFeNX`Ɩ@}bv UV ̕ϊiuv * xy + zwBAgX̃y[W͈̒̔́j
+		XMFLOAT4 diffuseUvScaleOffset;
+		XMFLOAT4 normalUvScaleOffset;
 	};
 
-	UINT mIndexCount = 0;		// FBXǂݍ݌̃CfbNX
+	// FBXǂݍ݌̃V[im[h̓TubVԍŎQƁj
+	std::vector<SubMesh> mSubMeshes;
+	std::vector<SceneNode> mNodes;
+	std::vector<XMFLOAT4X4> mNodeWorld;	// m[h̃fԂł̍siǂݍݎɌvZj
+	std::vector<int32_t> mNodeMeshes;	// m[h̃TubVԍiE܂Ƃ߂ĕϊƂ̓́j
+	std::vector<XMFLOAT4X4> mInstanceWorld;	// `撆̃f̊em[h̃[hsit[g񂷁j
+	std::vector<Bounds::WorldBounds> mWorldBounds;	// em[h̃TubṼ[hԂ̋E
+	std::vector<Meshlet> mMeshlets;		// TubV͈͂ŎQƂNX^
+	std::vector<MeshLod> mLods;			// TubV͈͂ŎQƂ LODi擪 LOD0j
+	std::vector<Material> mMaterials;	// SubMesh::material ŎQƂiȂl mTextureSRV ŕ`j
+	// NbNς݃eNX`1Bt@C}bv܂܎A풓iς邽тɂ蒼
+	struct StreamedTexture
+	{
+		TextureFileView file;			// hf[^LbṼt@C
+		std::vector<uint8_t> bytes;		// LbVɒuȂƂ̓Ɏ
+		const uint8_t* data = nullptr;	// file  bytes ̐擪iTextureFile Śj
+		ComPtr<ID3D11ShaderResourceView> srv;
+	};
+	std::vector<std::unique_ptr<StreamedTexture>> mTextures;	// ëႤ摜ƁiXg[~O Streamer ̔ԍƓсj
+	std::vector<int32_t> mMaterialTextures;	// ModelData::textures Ɠт mTextures ̔ԍiǂ߂Ȃ̂ -1j
+	TextureStreaming::Streamer mTextureStreamer;
+	std::vector<TextureStreaming::Streamer::Change> mStreamingChanges;	// t[g
+	double mStreamingMs = 0.0;			// eNX`蒼ԁiv̊Ԃ̍vj
+	std::vector<uint32_t> mDrawOrder;	// bVm[h}eAɕׂ
+	size_t mMaterialBinds = 0;			// }eA؂ւ񐔁iv̊Ԃ̍vj
+	size_t mTextureBinds = 0;			// ̂eNX`ђ񐔁iAgXL}eAǂ͌ђȂj
+	std::vector<ClusterCulling::DrawRange> mDrawRanges;	// JOʁit[g񂷁j
+	ClusterCulling::CullStats mCullStats;
+	UINT mCullStatsFrames = 0;
+	size_t mLodTriangles = 0;			// I LOD ̎Op` /  LOD0 Ȃ`Op`iv̊Ԃ̍vj
+	size_t mFullTriangles = 0;
+
+	// ǂݍ񂾒_obt@̌`i̓CAEgƃVF[_[̕킹j
+	VertexFormat mVertexFormat = VertexFormat::Float32;
+
+	// CPU XLjOit[ό`_𓮓Iobt@ mSkinVB ɏA2{ڂ̒_Xg[Ƃĕ`j
+	ThreadPool mThreadPool;
+	std::vector<SkinJoint> mJoints;
+	std::vector<SkinnedVertex> mSkinVertices;	// oCh|[YiSubMesh::skinVertexOffset  vertexCount j
+	std::vector<SkinWeights> mSkinWeights;
+	std::vector<Skinning::SkinMatrix> mSkinPalette;	// mJoints Ɠсit[蒼j
+	ComPtr<ID3D11Buffer> mSkinVB;
+	double mSkinningMs = 0.0;			// v̊Ԃ̍v
+
+	// kς݃Aj[Vit[1̃|[YWJ mNodes  TRS ɏj
+	std::vector<AnimationClip> mAnimations;
+	AnimationPose mPose;
+	double mAnimationMs = 0.0;			// v̊Ԃ̍v
+
+	// FBX ̃C|[giLbVɂȂƂB[J[Ƃ FbxManager j
+	std::unique_ptr<BatchImporter> mImporter;
+	std::future<BatchImportResult> mPendingModel;
+	uint64_t mPendingModelKey = 0;
+
+	// C|[gς݃bV / WJς݃eNX`̃LbVit@CςȂ΍ĕϊȂj
+	DerivedDataCache mCache{ "DerivedDataCache", 512ull << 20 };
 };
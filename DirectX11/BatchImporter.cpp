@@ -0,0 +1,144 @@
+﻿#include "BatchImporter.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include "ThreadPool.h"
+
+BatchImporter::BatchImporter(size_t workerCount)
+{
+    if (workerCount == 0)
+    {
+        workerCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+    // ワーカーが全員メッシュ内の並列処理に入っても、呼び出し側のワーカーが加わるので合計はワーカー数の2倍未満に収まる
+    // 1ファイルだけ読むときは空いているプールのスレッドが手伝う
+    if (workerCount > 1) mPool = std::make_unique<ThreadPool>(workerCount - 1);
+    mWorkers.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; i++)
+    {
+        mWorkers.emplace_back([this, i]() { WorkerLoop(i); });
+    }
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mReady.wait(lock, [this]() { return mReadyCount == mWorkers.size(); });
+}
+
+BatchImporter::~BatchImporter()
+{
+    // 積まれた分は処理してから止める（受け取る側の future を壊さないため）
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mWake.notify_all();
+    for (std::thread& worker : mWorkers) worker.join();
+}
+
+std::future<BatchImportResult> BatchImporter::Submit(const std::string& path, const MeshImportOptions& options)
+{
+    Job job;
+    job.path = path;
+    job.options = options;
+    std::future<BatchImportResult> result = job.promise.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mJobs.push_back(std::move(job));
+    }
+    mWake.notify_one();
+    return result;
+}
+
+std::vector<std::future<BatchImportResult>> BatchImporter::SubmitAll(const std::vector<std::string>& paths,
+    const MeshImportOptions& options)
+{
+    std::vector<std::future<BatchImportResult>> results;
+    results.reserve(paths.size());
+    for (const std::string& path : paths)
+    {
+        results.push_back(Submit(path, options));
+    }
+    return results;
+}
+
+void BatchImporter::WorkerLoop(size_t worker)
+{
+    // FbxManager はこのスレッドで作り、このスレッドだけが使う
+    ModelImporter importer(mPool.get());
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mReadyCount++;
+    }
+    mReady.notify_one();
+
+    for (;;)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWake.wait(lock, [this]() { return mStopping || !mJobs.empty(); });
+            if (mJobs.empty()) return;
+            job = std::move(mJobs.front());
+            mJobs.pop_front();
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        BatchImportResult result;
+        result.path = job.path;
+        result.worker = worker;
+        result.succeeded = importer.Import(job.path, job.options, result.model, result.report);
+        if (!result.succeeded) result.error = importer.GetErrorString();
+        result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        job.promise.set_value(std::move(result));
+    }
+}
+
+std::vector<BatchImporter::ScalingSample> BatchImporter::BenchmarkScaling(const std::vector<std::string>& paths,
+    const MeshImportOptions& options, size_t maxWorkers)
+{
+    std::vector<ScalingSample> samples;
+    if (paths.empty()) return samples;
+    if (maxWorkers == 0) maxWorkers = std::max<size_t>(1, std::thread::hardware_concurrency());
+
+    std::vector<size_t> counts;
+    for (size_t count = 1; count < maxWorkers; count *= 2) counts.push_back(count);
+    counts.push_back(maxWorkers);
+
+    for (size_t count : counts)
+    {
+        // ワーカーの起動（FbxManager の生成）は計測に含めない
+        BatchImporter importer(count);
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::future<BatchImportResult>> results = importer.SubmitAll(paths, options);
+        size_t failures = 0;
+        for (std::future<BatchImportResult>& result : results)
+        {
+            if (!result.get().succeeded) failures++;
+        }
+
+        ScalingSample sample;
+        sample.workerCount = count;
+        sample.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        sample.assetsPerSecond = sample.milliseconds > 0.0 ? paths.size() * 1000.0 / sample.milliseconds : 0.0;
+        sample.speedup = samples.empty() ? 1.0 : samples[0].milliseconds / std::max(sample.milliseconds, 1.0e-9);
+        sample.failures = failures;
+        samples.push_back(sample);
+    }
+    return samples;
+}
+
+std::vector<std::string> BatchImporter::FindFbxFiles(const std::string& directory)
+{
+    namespace fs = std::filesystem;
+    std::vector<std::string> paths;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec))
+    {
+        if (!it->is_regular_file(ec)) continue;
+        std::string extension = it->path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+        if (extension == ".fbx") paths.push_back(it->path().string());
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
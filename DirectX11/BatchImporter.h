@@ -0,0 +1,77 @@
+﻿#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ModelImporter.h"
+
+// 1ファイル分のインポート結果
+struct BatchImportResult
+{
+    std::string path;
+    bool succeeded = false;
+    std::string error;              // 失敗時の理由
+    ModelData model;
+    ImportReport report;
+    double milliseconds = 0.0;      // ワーカーが処理に掛けた時間（待ち時間を含まない）
+    size_t worker = 0;              // 処理したワーカーの番号
+};
+
+// 複数の FBX を並列にインポートする（D3D非依存）
+// ワーカーごとに ModelImporter（= FbxManager と FbxIOSettings）を1つ作って使い回し、
+// ファイルごとにマネージャーを作り直す費用を払わない。結果は future で受け取る
+// メッシュ内の並列処理は全ワーカーで共有する1つの ThreadPool に載せ、スレッド数がワーカー数に掛け算で増えないようにする
+class BatchImporter
+{
+public:
+    // workerCount が 0 なら論理コア数。全ワーカーの FbxManager ができるまで待って戻る
+    explicit BatchImporter(size_t workerCount = 0);
+    ~BatchImporter();
+    BatchImporter(const BatchImporter&) = delete;
+    BatchImporter& operator=(const BatchImporter&) = delete;
+
+    size_t GetWorkerCount() const { return mWorkers.size(); }
+
+    // キューに積んですぐ戻る。空いたワーカーが積まれた順に処理する
+    std::future<BatchImportResult> Submit(const std::string& path, const MeshImportOptions& options);
+    std::vector<std::future<BatchImportResult>> SubmitAll(const std::vector<std::string>& paths, const MeshImportOptions& options);
+
+    // ワーカー数を 1, 2, 4, ... maxWorkers と変えて paths を全部インポートし、かかった時間を測る
+    struct ScalingSample
+    {
+        size_t workerCount;
+        double milliseconds;        // 全ファイルが終わるまでの経過時間
+        double assetsPerSecond;
+        double speedup;             // 1 ワーカーに対する比
+        size_t failures;
+    };
+    static std::vector<ScalingSample> BenchmarkScaling(const std::vector<std::string>& paths, const MeshImportOptions& options,
+        size_t maxWorkers = 0);
+
+    // directory 以下の .fbx を再帰的に集める（並びはパス順）
+    static std::vector<std::string> FindFbxFiles(const std::string& directory);
+
+private:
+    struct Job
+    {
+        std::string path;
+        MeshImportOptions options;
+        std::promise<BatchImportResult> promise;
+    };
+
+    void WorkerLoop(size_t worker);
+
+    std::unique_ptr<ThreadPool> mPool;     // ワーカーが2つ以上のときだけ作る（ワーカー数 - 1 のスレッド）
+    std::vector<std::thread> mWorkers;
+    std::deque<Job> mJobs;
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::condition_variable mReady;
+    size_t mReadyCount = 0;
+    bool mStopping = false;
+};
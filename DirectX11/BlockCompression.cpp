@@ -0,0 +1,967 @@
+﻿#include "BlockCompression.h"
+#include <algorithm>
+#include <cctype>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+#include "ThreadPool.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define BC_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    // 1スレッドに渡す最小のブロック数（これより少ない画像はブロックの行に分けない）
+    constexpr size_t kParallelBlocks = 256;
+
+    using Quality = BlockCompression::Quality;
+
+    // 4x4 画素をチャンネルごとに並べたもの（SIMD で4画素ずつ読む）
+    struct alignas(16) Block
+    {
+        float c[4][16];     // [RGBA][画素（行優先）]
+    };
+
+    // 端点から補間した値の候補（どれも 0〜255 の整数）
+    struct alignas(16) Palette
+    {
+        float c[4][16];
+        uint32_t count = 0;
+    };
+
+    // 各画素に最も近い候補の番号を indices に書き、誤差（チャンネルの重み付きの二乗和）の合計を返す
+    // 値はすべて整数なので、SIMD 版とスカラー版は同じ誤差・同じ添字になる（同じ距離なら番号の小さい方）
+    using FindIndicesFunction = float (*)(const Block&, const Palette&, const float (&)[4], uint8_t*);
+
+    float FindIndicesScalar(const Block& block, const Palette& palette, const float (&weights)[4], uint8_t* indices)
+    {
+        float errors[16];
+        for (int i = 0; i < 16; i++)
+        {
+            float best = FLT_MAX;
+            uint8_t bestIndex = 0;
+            for (uint32_t p = 0; p < palette.count; p++)
+            {
+                float d = 0.0f;
+                for (int c = 0; c < 4; c++)
+                {
+                    const float diff = block.c[c][i] - palette.c[c][p];
+                    d += diff * diff * weights[c];
+                }
+                if (d < best)
+                {
+                    best = d;
+                    bestIndex = uint8_t(p);
+                }
+            }
+            errors[i] = best;
+            indices[i] = bestIndex;
+        }
+        float total = 0.0f;
+        for (float error : errors) total += error;
+        return total;
+    }
+
+#if BC_SSE
+    // 4画素を1レジスタに並べ、候補ごとに距離を比べて小さい方の番号を残す
+    float FindIndicesSse(const Block& block, const Palette& palette, const float (&weights)[4], uint8_t* indices)
+    {
+        const __m128 w[4] = { _mm_set1_ps(weights[0]), _mm_set1_ps(weights[1]), _mm_set1_ps(weights[2]), _mm_set1_ps(weights[3]) };
+        alignas(16) float errors[16];
+        alignas(16) int32_t best[16];
+        for (int i = 0; i < 16; i += 4)
+        {
+            const __m128 v[4] = { _mm_load_ps(&block.c[0][i]), _mm_load_ps(&block.c[1][i]),
+                _mm_load_ps(&block.c[2][i]), _mm_load_ps(&block.c[3][i]) };
+            __m128 bestError = _mm_set1_ps(FLT_MAX);
+            __m128i bestIndex = _mm_setzero_si128();
+            for (uint32_t p = 0; p < palette.count; p++)
+            {
+                __m128 d = _mm_setzero_ps();
+                for (int c = 0; c < 4; c++)
+                {
+                    const __m128 diff = _mm_sub_ps(v[c], _mm_set1_ps(palette.c[c][p]));
+                    d = _mm_add_ps(d, _mm_mul_ps(_mm_mul_ps(diff, diff), w[c]));
+                }
+                const __m128i less = _mm_castps_si128(_mm_cmplt_ps(d, bestError));
+                bestError = _mm_min_ps(d, bestError);
+                bestIndex = _mm_or_si128(_mm_and_si128(less, _mm_set1_epi32(int32_t(p))), _mm_andnot_si128(less, bestIndex));
+            }
+            _mm_store_ps(errors + i, bestError);
+            _mm_store_si128(reinterpret_cast<__m128i*>(best + i), bestIndex);
+        }
+        for (int i = 0; i < 16; i++) indices[i] = uint8_t(best[i]);
+        float total = 0.0f;
+        for (float error : errors) total += error;
+        return total;
+    }
+#endif
+
+    // 画像の外は端の画素を繰り返す
+    void LoadBlock(const ImageData& image, uint32_t bx, uint32_t by, Block& block)
+    {
+        for (uint32_t y = 0; y < 4; y++)
+        {
+            const uint32_t sy = std::min(by * 4 + y, image.height - 1);
+            for (uint32_t x = 0; x < 4; x++)
+            {
+                const uint32_t sx = std::min(bx * 4 + x, image.width - 1);
+                const uint8_t* p = &image.pixels[(size_t(sy) * image.width + sx) * 4];
+                for (int c = 0; c < 4; c++) block.c[c][y * 4 + x] = p[c];
+            }
+        }
+    }
+
+    float Clamp255(float v)
+    {
+        return std::min(std::max(v, 0.0f), 255.0f);
+    }
+
+    // 先頭 channels 個のチャンネルで主成分の軸を求め、軸に沿った両端を端点にする
+    // inset は両端を範囲の何割だけ内側に寄せるか（端の外れ値に引っ張られにくくする）
+    void PrincipalEndpoints(const Block& block, int channels, float inset, float (&e0)[4], float (&e1)[4])
+    {
+        float mean[4] = {};
+        for (int c = 0; c < channels; c++)
+        {
+            for (int i = 0; i < 16; i++) mean[c] += block.c[c][i];
+            mean[c] /= 16.0f;
+        }
+        float covariance[4][4] = {};
+        for (int i = 0; i < 16; i++)
+        {
+            for (int a = 0; a < channels; a++)
+            {
+                for (int b = 0; b < channels; b++)
+                {
+                    covariance[a][b] += (block.c[a][i] - mean[a]) * (block.c[b][i] - mean[b]);
+                }
+            }
+        }
+
+        // べき乗法（分散の最も大きいチャンネルの行から始める）
+        int largest = 0;
+        for (int c = 1; c < channels; c++)
+        {
+            if (covariance[c][c] > covariance[largest][largest]) largest = c;
+        }
+        float axis[4] = {};
+        for (int c = 0; c < channels; c++) axis[c] = covariance[largest][c];
+        for (int iteration = 0; iteration < 8; iteration++)
+        {
+            float next[4] = {};
+            float scale = 0.0f;
+            for (int a = 0; a < channels; a++)
+            {
+                for (int b = 0; b < channels; b++) next[a] += covariance[a][b] * axis[b];
+                scale = std::max(scale, std::fabs(next[a]));
+            }
+            if (scale < 1.0e-8f) break;
+            for (int c = 0; c < channels; c++) axis[c] = next[c] / scale;
+        }
+        float length = 0.0f;
+        for (int c = 0; c < channels; c++) length += axis[c] * axis[c];
+
+        float minT = 0.0f, maxT = 0.0f;
+        if (length > 1.0e-12f)
+        {
+            minT = FLT_MAX;
+            maxT = -FLT_MAX;
+            for (int i = 0; i < 16; i++)
+            {
+                float t = 0.0f;
+                for (int c = 0; c < channels; c++) t += (block.c[c][i] - mean[c]) * axis[c];
+                t /= length;
+                minT = std::min(minT, t);
+                maxT = std::max(maxT, t);
+            }
+            const float shrink = (maxT - minT) * inset;
+            minT += shrink;
+            maxT -= shrink;
+        }
+        for (int c = 0; c < 4; c++)
+        {
+            e0[c] = c < channels ? Clamp255(mean[c] + minT * axis[c]) : 0.0f;
+            e1[c] = c < channels ? Clamp255(mean[c] + maxT * axis[c]) : 0.0f;
+        }
+    }
+
+    // 添字ごとの重み（端点1の割合）を固定して、誤差が最小になる2つの端点をチャンネルごとに解く（解けなければ false）
+    bool SolveEndpoints(const Block& block, const uint8_t* indices, const float* indexWeights, int channels,
+        float (&e0)[4], float (&e1)[4])
+    {
+        float a = 0.0f, b = 0.0f, c = 0.0f;
+        float x0[4] = {}, x1[4] = {};
+        for (int i = 0; i < 16; i++)
+        {
+            const float w = indexWeights[indices[i]];
+            const float iw = 1.0f - w;
+            a += iw * iw;
+            b += iw * w;
+            c += w * w;
+            for (int ch = 0; ch < channels; ch++)
+            {
+                x0[ch] += iw * block.c[ch][i];
+                x1[ch] += w * block.c[ch][i];
+            }
+        }
+        const float det = a * c - b * b;
+        if (std::fabs(det) < 1.0e-6f) return false;
+        for (int ch = 0; ch < 4; ch++)
+        {
+            e0[ch] = ch < channels ? Clamp255((c * x0[ch] - b * x1[ch]) / det) : 0.0f;
+            e1[ch] = ch < channels ? Clamp255((a * x1[ch] - b * x0[ch]) / det) : 0.0f;
+        }
+        return true;
+    }
+
+    // --- BC1（色） ---
+
+    uint16_t Pack565(const float (&c)[4])
+    {
+        const int r = std::min(31, int(c[0] * (31.0f / 255.0f) + 0.5f));
+        const int g = std::min(63, int(c[1] * (63.0f / 255.0f) + 0.5f));
+        const int b = std::min(31, int(c[2] * (31.0f / 255.0f) + 0.5f));
+        return uint16_t((r << 11) | (g << 5) | b);
+    }
+
+    void Unpack565(uint16_t v, int (&c)[3])
+    {
+        const int r = v >> 11, g = (v >> 5) & 63, b = v & 31;
+        c[0] = (r << 3) | (r >> 2);
+        c[1] = (g << 2) | (g >> 4);
+        c[2] = (b << 3) | (b >> 2);
+    }
+
+    // fourColor なら 1/3, 2/3 の補間、そうでなければ中間と透明な黒（c0 <= c1 の BC1）
+    void ColorPalette(uint16_t c0, uint16_t c1, bool fourColor, Palette& palette)
+    {
+        int a[3], b[3];
+        Unpack565(c0, a);
+        Unpack565(c1, b);
+        for (int c = 0; c < 3; c++)
+        {
+            palette.c[c][0] = float(a[c]);
+            palette.c[c][1] = float(b[c]);
+            palette.c[c][2] = float(fourColor ? (2 * a[c] + b[c] + 1) / 3 : (a[c] + b[c]) / 2);
+            palette.c[c][3] = float(fourColor ? (a[c] + 2 * b[c] + 1) / 3 : 0);
+        }
+        for (int i = 0; i < 4; i++) palette.c[3][i] = fourColor || i < 3 ? 255.0f : 0.0f;
+        palette.count = 4;
+    }
+
+    // c0 > c1 で4色モードになる。逆なら入れ替えて添字 0<->1, 2<->3 を付け替える（BC3 の色は常に4色として読まれる）
+    void WriteColorBlock(uint16_t c0, uint16_t c1, uint8_t (&indices)[16], uint8_t* out)
+    {
+        if (c0 < c1)
+        {
+            std::swap(c0, c1);
+            for (uint8_t& index : indices) index ^= 1;
+        }
+        else if (c0 == c1)
+        {
+            std::fill(std::begin(indices), std::end(indices), uint8_t(0));
+        }
+        uint32_t bits = 0;
+        for (int i = 0; i < 16; i++) bits |= uint32_t(indices[i]) << (i * 2);
+        out[0] = uint8_t(c0);
+        out[1] = uint8_t(c0 >> 8);
+        out[2] = uint8_t(c1);
+        out[3] = uint8_t(c1 >> 8);
+        for (int i = 0; i < 4; i++) out[4 + i] = uint8_t(bits >> (i * 8));
+    }
+
+    void EncodeColorBlock(const Block& block, Quality quality, FindIndicesFunction find, uint8_t* out)
+    {
+        static const float kWeights[4] = { 1.0f, 1.0f, 1.0f, 0.0f };
+        static const float kIndexWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+        float e0[4], e1[4];
+        PrincipalEndpoints(block, 3, quality == Quality::Fast ? 1.0f / 16.0f : 0.0f, e0, e1);
+        uint16_t c0 = Pack565(e0), c1 = Pack565(e1);
+        Palette palette;
+        ColorPalette(c0, c1, true, palette);
+        uint8_t indices[16];
+        float error = find(block, palette, kWeights, indices);
+
+        auto tryEndpoints = [&](uint16_t a, uint16_t b)
+        {
+            Palette candidate;
+            ColorPalette(a, b, true, candidate);
+            uint8_t candidateIndices[16];
+            const float candidateError = find(block, candidate, kWeights, candidateIndices);
+            if (candidateError >= error) return false;
+            error = candidateError;
+            c0 = a;
+            c1 = b;
+            std::copy(candidateIndices, candidateIndices + 16, indices);
+            return true;
+        };
+
+        const int iterations = quality == Quality::Fast ? 0 : quality == Quality::Normal ? 2 : 4;
+        for (int iteration = 0; iteration < iterations && error > 0.0f; iteration++)
+        {
+            float n0[4], n1[4];
+            if (!SolveEndpoints(block, indices, kIndexWeights, 3, n0, n1)) break;
+            if (!tryEndpoints(Pack565(n0), Pack565(n1))) break;
+        }
+
+        if (quality == Quality::High)
+        {
+            // 5:6:5 の各成分を1段ずつずらす
+            static const struct { int shift, mask; } kFields[3] = { { 11, 31 }, { 5, 63 }, { 0, 31 } };
+            for (int pass = 0; pass < 2 && error > 0.0f; pass++)
+            {
+                bool improved = false;
+                for (int endpoint = 0; endpoint < 2; endpoint++)
+                {
+                    for (const auto& field : kFields)
+                    {
+                        for (int delta : { -1, 1 })
+                        {
+                            const uint16_t v = endpoint == 0 ? c0 : c1;
+                            const int f = ((v >> field.shift) & field.mask) + delta;
+                            if (f < 0 || f > field.mask) continue;
+                            const uint16_t moved = uint16_t((v & ~(field.mask << field.shift)) | (f << field.shift));
+                            improved |= endpoint == 0 ? tryEndpoints(moved, c1) : tryEndpoints(c0, moved);
+                        }
+                    }
+                }
+                if (!improved) break;
+            }
+        }
+        WriteColorBlock(c0, c1, indices, out);
+    }
+
+    // --- BC4（1チャンネル。BC3 のアルファと BC5 の R/G） ---
+
+    // a0 > a1 なら 6段の補間、そうでなければ 4段の補間 + 0 + 255
+    void SingleChannelPalette(int a0, int a1, Palette& palette)
+    {
+        float* v = palette.c[0];
+        v[0] = float(a0);
+        v[1] = float(a1);
+        if (a0 > a1)
+        {
+            for (int i = 2; i < 8; i++) v[i] = float(((8 - i) * a0 + (i - 1) * a1 + 3) / 7);
+        }
+        else
+        {
+            for (int i = 2; i < 6; i++) v[i] = float(((6 - i) * a0 + (i - 1) * a1 + 2) / 5);
+            v[6] = 0.0f;
+            v[7] = 255.0f;
+        }
+        for (int c = 1; c < 4; c++) std::fill(palette.c[c], palette.c[c] + 8, 0.0f);
+        palette.count = 8;
+    }
+
+    // block.c[0] を圧縮する
+    void EncodeSingleChannelBlock(const Block& block, Quality quality, FindIndicesFunction find, uint8_t* out)
+    {
+        static const float kWeights[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+        static const float kIndexWeights[8] = { 0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+
+        int lo = 255, hi = 0;
+        int innerLo = 255, innerHi = 0;   // 0 と 255 を除いた範囲（0 / 255 を持つ 4段補間のモード用）
+        for (int i = 0; i < 16; i++)
+        {
+            const int v = int(block.c[0][i]);
+            lo = std::min(lo, v);
+            hi = std::max(hi, v);
+            if (v != 0 && v != 255)
+            {
+                innerLo = std::min(innerLo, v);
+                innerHi = std::max(innerHi, v);
+            }
+        }
+
+        int a0 = hi, a1 = lo;
+        uint8_t indices[16] = {};
+        float error = 0.0f;
+        if (a0 != a1)
+        {
+            Palette palette;
+            SingleChannelPalette(a0, a1, palette);
+            error = find(block, palette, kWeights, indices);
+        }
+
+        auto tryEndpoints = [&](int b0, int b1)
+        {
+            Palette candidate;
+            SingleChannelPalette(b0, b1, candidate);
+            uint8_t candidateIndices[16];
+            const float candidateError = find(block, candidate, kWeights, candidateIndices);
+            if (candidateError >= error) return false;
+            error = candidateError;
+            a0 = b0;
+            a1 = b1;
+            std::copy(candidateIndices, candidateIndices + 16, indices);
+            return true;
+        };
+
+        if (quality != Quality::Fast && error > 0.0f)
+        {
+            const int iterations = quality == Quality::Normal ? 2 : 4;
+            for (int iteration = 0; iteration < iterations && error > 0.0f && a0 > a1; iteration++)
+            {
+                float n0[4], n1[4];
+                if (!SolveEndpoints(block, indices, kIndexWeights, 1, n0, n1)) break;
+                int b0 = int(n0[0] + 0.5f), b1 = int(n1[0] + 0.5f);
+                if (b0 < b1) std::swap(b0, b1);
+                if (b0 == b1 || !tryEndpoints(b0, b1)) break;
+            }
+
+            // 0 や 255 を含むブロックは、残りの範囲を 4段で補間するモードの方が合うことがある
+            if ((lo == 0 || hi == 255) && innerLo <= innerHi) tryEndpoints(innerLo, innerHi);
+        }
+
+        if (quality == Quality::High && error > 0.0f)
+        {
+            const int base0 = a0, base1 = a1;
+            for (int d0 = -2; d0 <= 2; d0++)
+            {
+                for (int d1 = -2; d1 <= 2; d1++)
+                {
+                    const int b0 = base0 + d0, b1 = base1 + d1;
+                    if ((d0 == 0 && d1 == 0) || b0 < 0 || b0 > 255 || b1 < 0 || b1 > 255) continue;
+                    if ((base0 > base1) != (b0 > b1)) continue;     // モードは変えない
+                    tryEndpoints(b0, b1);
+                }
+            }
+        }
+
+        uint64_t bits = 0;
+        for (int i = 0; i < 16; i++) bits |= uint64_t(indices[i]) << (i * 3);
+        out[0] = uint8_t(a0);
+        out[1] = uint8_t(a1);
+        for (int i = 0; i < 6; i++) out[2 + i] = uint8_t(bits >> (i * 8));
+    }
+
+    // --- BC7 モード 6（1区画、RGBA 各 7bit + 端点ごとの p ビット、4bit 添字） ---
+
+    const int kBc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    struct Bc7Endpoints
+    {
+        int q[2][4];    // 7bit
+        int p[2];       // p ビット（復元値 = q << 1 | p）
+    };
+
+    void Bc7Palette(const Bc7Endpoints& e, Palette& palette)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            const int a = (e.q[0][c] << 1) | e.p[0];
+            const int b = (e.q[1][c] << 1) | e.p[1];
+            for (int i = 0; i < 16; i++) palette.c[c][i] = float(((64 - kBc7Weights[i]) * a + kBc7Weights[i] * b + 32) >> 6);
+        }
+        palette.count = 16;
+    }
+
+    void QuantizeBc7(const float (&v)[4], int p, int (&q)[4])
+    {
+        for (int c = 0; c < 4; c++) q[c] = std::min(127, std::max(0, int((v[c] - p) * 0.5f + 0.5f)));
+    }
+
+    // 端点ごとに p ビットを選んで量子化する
+    // exhaustive なら4通りの組み合わせを全画素の誤差で比べ、そうでなければ端点の量子化誤差だけで決める
+    float QuantizeBc7Endpoints(const Block& block, const float (&e0)[4], const float (&e1)[4], bool exhaustive,
+        FindIndicesFunction find, Bc7Endpoints& best, uint8_t (&indices)[16])
+    {
+        static const float kWeights[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        float bestError = FLT_MAX;
+        for (int p0 = 0; p0 < 2; p0++)
+        {
+            for (int p1 = 0; p1 < 2; p1++)
+            {
+                Bc7Endpoints e;
+                e.p[0] = p0;
+                e.p[1] = p1;
+                QuantizeBc7(e0, p0, e.q[0]);
+                QuantizeBc7(e1, p1, e.q[1]);
+                if (!exhaustive)
+                {
+                    // 端点ごとに量子化誤差の小さい p を使う組み合わせだけを評価する
+                    auto endpointError = [](const float (&v)[4], const int (&q)[4], int p)
+                    {
+                        float sum = 0.0f;
+                        for (int c = 0; c < 4; c++)
+                        {
+                            const float d = v[c] - float((q[c] << 1) | p);
+                            sum += d * d;
+                        }
+                        return sum;
+                    };
+                    int other[4];
+                    QuantizeBc7(e0, 1 - p0, other);
+                    if (endpointError(e0, other, 1 - p0) < endpointError(e0, e.q[0], p0)) continue;
+                    QuantizeBc7(e1, 1 - p1, other);
+                    if (endpointError(e1, other, 1 - p1) < endpointError(e1, e.q[1], p1)) continue;
+                }
+                Palette palette;
+                Bc7Palette(e, palette);
+                uint8_t candidateIndices[16];
+                const float error = find(block, palette, kWeights, candidateIndices);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    best = e;
+                    std::copy(candidateIndices, candidateIndices + 16, indices);
+                }
+            }
+        }
+        return bestError;
+    }
+
+    // 128bit のブロックに下位ビットから詰める
+    struct BitWriter
+    {
+        uint8_t* out;
+        uint32_t position = 0;
+
+        void Write(uint32_t value, uint32_t bits)
+        {
+            for (uint32_t b = 0; b < bits; b++, position++)
+            {
+                if ((value >> b) & 1) out[position >> 3] |= uint8_t(1 << (position & 7));
+            }
+        }
+    };
+
+    struct BitReader
+    {
+        const uint8_t* in;
+        uint32_t position = 0;
+
+        uint32_t Read(uint32_t bits)
+        {
+            uint32_t value = 0;
+            for (uint32_t b = 0; b < bits; b++, position++)
+            {
+                value |= uint32_t((in[position >> 3] >> (position & 7)) & 1) << b;
+            }
+            return value;
+        }
+    };
+
+    void EncodeBc7Block(const Block& block, Quality quality, FindIndicesFunction find, uint8_t* out)
+    {
+        static const float kWeights[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        float kIndexWeights[16];
+        for (int i = 0; i < 16; i++) kIndexWeights[i] = kBc7Weights[i] / 64.0f;
+
+        float e0[4], e1[4];
+        PrincipalEndpoints(block, 4, quality == Quality::Fast ? 1.0f / 32.0f : 0.0f, e0, e1);
+        const bool exhaustive = quality != Quality::Fast;
+        Bc7Endpoints endpoints;
+        uint8_t indices[16];
+        float error = QuantizeBc7Endpoints(block, e0, e1, exhaustive, find, endpoints, indices);
+
+        const int iterations = quality == Quality::Fast ? 0 : quality == Quality::Normal ? 2 : 4;
+        for (int iteration = 0; iteration < iterations && error > 0.0f; iteration++)
+        {
+            float n0[4], n1[4];
+            if (!SolveEndpoints(block, indices, kIndexWeights, 4, n0, n1)) break;
+            Bc7Endpoints candidate;
+            uint8_t candidateIndices[16];
+            const float candidateError = QuantizeBc7Endpoints(block, n0, n1, exhaustive, find, candidate, candidateIndices);
+            if (candidateError >= error) break;
+            error = candidateError;
+            endpoints = candidate;
+            std::copy(candidateIndices, candidateIndices + 16, indices);
+        }
+
+        if (quality == Quality::High)
+        {
+            // 7bit の各成分を1段ずつずらす
+            for (int pass = 0; pass < 2 && error > 0.0f; pass++)
+            {
+                bool improved = false;
+                for (int endpoint = 0; endpoint < 2; endpoint++)
+                {
+                    for (int c = 0; c < 4; c++)
+                    {
+                        for (int delta : { -1, 1 })
+                        {
+                            Bc7Endpoints candidate = endpoints;
+                            candidate.q[endpoint][c] += delta;
+                            if (candidate.q[endpoint][c] < 0 || candidate.q[endpoint][c] > 127) continue;
+                            Palette palette;
+                            Bc7Palette(candidate, palette);
+                            uint8_t candidateIndices[16];
+                            const float candidateError = find(block, palette, kWeights, candidateIndices);
+                            if (candidateError >= error) continue;
+                            error = candidateError;
+                            endpoints = candidate;
+                            std::copy(candidateIndices, candidateIndices + 16, indices);
+                            improved = true;
+                        }
+                    }
+                }
+                if (!improved) break;
+            }
+        }
+
+        // 先頭の画素の添字は最上位ビットを持たない（3bit）ので、8 以上なら端点を入れ替えて添字を反転する
+        // 重みの表は対称（w[15 - i] = 64 - w[i]）なので復元値は変わらない
+        if (indices[0] >= 8)
+        {
+            for (int c = 0; c < 4; c++) std::swap(endpoints.q[0][c], endpoints.q[1][c]);
+            std::swap(endpoints.p[0], endpoints.p[1]);
+            for (uint8_t& index : indices) index = uint8_t(15 - index);
+        }
+
+        std::memset(out, 0, 16);
+        BitWriter writer{ out };
+        writer.Write(1 << 6, 7);    // モード 6
+        for (int c = 0; c < 4; c++)
+        {
+            writer.Write(uint32_t(endpoints.q[0][c]), 7);
+            writer.Write(uint32_t(endpoints.q[1][c]), 7);
+        }
+        writer.Write(uint32_t(endpoints.p[0]), 1);
+        writer.Write(uint32_t(endpoints.p[1]), 1);
+        for (int i = 0; i < 16; i++) writer.Write(indices[i], i == 0 ? 3 : 4);
+    }
+
+    void EncodeBlock(const Block& block, PixelFormat format, Quality quality, FindIndicesFunction find, uint8_t* out)
+    {
+        Block channel = {};     // 1チャンネルのブロック（残りのチャンネルは重み 0 だが NaN を混ぜないよう 0 にしておく）
+        switch (format)
+        {
+        case PixelFormat::BC1:
+            EncodeColorBlock(block, quality, find, out);
+            break;
+        case PixelFormat::BC3:
+            std::copy(block.c[3], block.c[3] + 16, channel.c[0]);
+            EncodeSingleChannelBlock(channel, quality, find, out);
+            EncodeColorBlock(block, quality, find, out + 8);
+            break;
+        case PixelFormat::BC5:
+            std::copy(block.c[0], block.c[0] + 16, channel.c[0]);
+            EncodeSingleChannelBlock(channel, quality, find, out);
+            std::copy(block.c[1], block.c[1] + 16, channel.c[0]);
+            EncodeSingleChannelBlock(channel, quality, find, out + 8);
+            break;
+        case PixelFormat::BC7:
+            EncodeBc7Block(block, quality, find, out);
+            break;
+        case PixelFormat::RGBA8:
+            break;
+        }
+    }
+
+    // --- 復元（品質の計測用） ---
+
+    void DecodeColorBlock(const uint8_t* in, bool alwaysFourColor, uint8_t (&rgba)[16][4])
+    {
+        const uint16_t c0 = uint16_t(in[0] | (in[1] << 8));
+        const uint16_t c1 = uint16_t(in[2] | (in[3] << 8));
+        const uint32_t bits = uint32_t(in[4]) | (uint32_t(in[5]) << 8) | (uint32_t(in[6]) << 16) | (uint32_t(in[7]) << 24);
+        Palette palette;
+        ColorPalette(c0, c1, alwaysFourColor || c0 > c1, palette);
+        for (int i = 0; i < 16; i++)
+        {
+            const uint32_t index = (bits >> (i * 2)) & 3;
+            for (int c = 0; c < 4; c++) rgba[i][c] = uint8_t(palette.c[c][index]);
+        }
+    }
+
+    void DecodeSingleChannelBlock(const uint8_t* in, int channel, uint8_t (&rgba)[16][4])
+    {
+        Palette palette;
+        SingleChannelPalette(in[0], in[1], palette);
+        uint64_t bits = 0;
+        for (int i = 0; i < 6; i++) bits |= uint64_t(in[2 + i]) << (i * 8);
+        for (int i = 0; i < 16; i++) rgba[i][channel] = uint8_t(palette.c[0][(bits >> (i * 3)) & 7]);
+    }
+
+    // このエンコーダーが書くモード 6 だけを読む（他のモードは黒）
+    void DecodeBc7Block(const uint8_t* in, uint8_t (&rgba)[16][4])
+    {
+        BitReader reader{ in };
+        if (reader.Read(7) != (1u << 6))
+        {
+            std::memset(rgba, 0, sizeof(rgba));
+            return;
+        }
+        Bc7Endpoints e;
+        for (int c = 0; c < 4; c++)
+        {
+            e.q[0][c] = int(reader.Read(7));
+            e.q[1][c] = int(reader.Read(7));
+        }
+        e.p[0] = int(reader.Read(1));
+        e.p[1] = int(reader.Read(1));
+        Palette palette;
+        Bc7Palette(e, palette);
+        for (int i = 0; i < 16; i++)
+        {
+            const uint32_t index = reader.Read(i == 0 ? 3 : 4);
+            for (int c = 0; c < 4; c++) rgba[i][c] = uint8_t(palette.c[c][index]);
+        }
+    }
+
+    void Compress(const ImageData& image, PixelFormat format, Quality quality, ImageData& out, ThreadPool* pool,
+        FindIndicesFunction find)
+    {
+        if (!IsBlockCompressed(format) || image.width == 0 || image.height == 0)
+        {
+            out = image;
+            return;
+        }
+        out.width = image.width;
+        out.height = image.height;
+        out.format = format;
+        out.pixels.assign(ImageSize(format, image.width, image.height), 0);
+
+        const uint32_t blocksWide = (image.width + 3) / 4;
+        const uint32_t blocksHigh = (image.height + 3) / 4;
+        const size_t blockBytes = format == PixelFormat::BC1 ? 8 : 16;
+        auto encodeRows = [&](size_t begin, size_t end)
+        {
+            Block block;
+            for (size_t by = begin; by < end; by++)
+            {
+                for (uint32_t bx = 0; bx < blocksWide; bx++)
+                {
+                    LoadBlock(image, bx, uint32_t(by), block);
+                    EncodeBlock(block, format, quality, find, &out.pixels[(by * blocksWide + bx) * blockBytes]);
+                }
+            }
+        };
+        const size_t minRows = std::max<size_t>(1, kParallelBlocks / blocksWide);
+        if (pool) pool->ParallelFor(blocksHigh, minRows, encodeRows);
+        else encodeRows(0, blocksHigh);
+    }
+
+    FindIndicesFunction SelectKernel()
+    {
+#if BC_SSE
+        return FindIndicesSse;
+#else
+        return FindIndicesScalar;
+#endif
+    }
+
+    // なめらかなグラデーション、境界のはっきりした図形、弱い雑音を重ねた画像（アルファは縦のグラデーション）
+    ImageData MakeBenchmarkImage(uint32_t width, uint32_t height)
+    {
+        std::mt19937 rng(12345);
+        std::uniform_int_distribution<int> noise(-6, 6);
+        ImageData image;
+        image.width = width;
+        image.height = height;
+        image.pixels.resize(size_t(width) * height * 4);
+        for (uint32_t y = 0; y < height; y++)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                uint8_t* p = &image.pixels[(size_t(y) * width + x) * 4];
+                const float u = float(x) / width, v = float(y) / height;
+                const float dx = u - 0.5f, dy = v - 0.5f;
+                const bool inside = dx * dx + dy * dy < 0.09f;
+                const bool stripe = ((x / 24 + y / 24) & 1) != 0;
+                p[0] = uint8_t(std::clamp(int(255.0f * u) + noise(rng), 0, 255));
+                p[1] = uint8_t(std::clamp((inside ? 200 : 60) + noise(rng), 0, 255));
+                p[2] = uint8_t(std::clamp((stripe ? 180 : 90) + int(60.0f * v) + noise(rng), 0, 255));
+                p[3] = uint8_t(std::clamp(int(255.0f * v), 0, 255));
+            }
+        }
+        return image;
+    }
+
+    // body を iterations 回実行し、最も速かった1回の処理速度（メガピクセル/秒）を返す
+    template <class Body>
+    double MeasureThroughput(size_t pixelCount, int iterations, Body body)
+    {
+        double best = 0.0;
+        for (int i = 0; i < iterations; i++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            body();
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (seconds > 0.0) best = std::max(best, double(pixelCount) * 1.0e-6 / seconds);
+        }
+        return best;
+    }
+}
+
+namespace BlockCompression
+{
+    void CompressImage(const ImageData& image, PixelFormat format, Quality quality, ImageData& out, ThreadPool* pool)
+    {
+        Compress(image, format, quality, out, pool, SelectKernel());
+    }
+
+    void CompressImageReference(const ImageData& image, PixelFormat format, Quality quality, ImageData& out)
+    {
+        Compress(image, format, quality, out, nullptr, FindIndicesScalar);
+    }
+
+    void DecompressImage(const ImageData& compressed, ImageData& out)
+    {
+        out.width = compressed.width;
+        out.height = compressed.height;
+        out.format = PixelFormat::RGBA8;
+        if (!IsBlockCompressed(compressed.format))
+        {
+            out.pixels = compressed.pixels;
+            return;
+        }
+        out.pixels.resize(size_t(compressed.width) * compressed.height * 4);
+
+        const uint32_t blocksWide = (compressed.width + 3) / 4;
+        const uint32_t blocksHigh = (compressed.height + 3) / 4;
+        const size_t blockBytes = compressed.format == PixelFormat::BC1 ? 8 : 16;
+        for (uint32_t by = 0; by < blocksHigh; by++)
+        {
+            for (uint32_t bx = 0; bx < blocksWide; bx++)
+            {
+                const uint8_t* in = &compressed.pixels[(size_t(by) * blocksWide + bx) * blockBytes];
+                uint8_t rgba[16][4];
+                switch (compressed.format)
+                {
+                case PixelFormat::BC1:
+                    DecodeColorBlock(in, false, rgba);
+                    break;
+                case PixelFormat::BC3:
+                    DecodeColorBlock(in + 8, true, rgba);
+                    DecodeSingleChannelBlock(in, 3, rgba);
+                    break;
+                case PixelFormat::BC5:
+                    for (auto& pixel : rgba)
+                    {
+                        pixel[2] = 0;
+                        pixel[3] = 255;
+                    }
+                    DecodeSingleChannelBlock(in, 0, rgba);
+                    DecodeSingleChannelBlock(in + 8, 1, rgba);
+                    break;
+                default:
+                    DecodeBc7Block(in, rgba);
+                    break;
+                }
+                for (uint32_t y = 0; y < 4 && by * 4 + y < compressed.height; y++)
+                {
+                    for (uint32_t x = 0; x < 4 && bx * 4 + x < compressed.width; x++)
+                    {
+                        std::memcpy(&out.pixels[((size_t(by) * 4 + y) * compressed.width + bx * 4 + x) * 4], rgba[y * 4 + x], 4);
+                    }
+                }
+            }
+        }
+    }
+
+    double ComputePsnr(const ImageData& original, const ImageData& decoded, PixelFormat format)
+    {
+        const size_t channels = format == PixelFormat::BC1 ? 3 : format == PixelFormat::BC5 ? 2 : 4;
+        const size_t count = std::min(original.pixels.size(), decoded.pixels.size()) / 4;
+        double sum = 0.0;
+        for (size_t i = 0; i < count; i++)
+        {
+            for (size_t c = 0; c < channels; c++)
+            {
+                const double d = double(original.pixels[i * 4 + c]) - double(decoded.pixels[i * 4 + c]);
+                sum += d * d;
+            }
+        }
+        if (count == 0 || sum == 0.0) return 99.0;
+        return 10.0 * std::log10(255.0 * 255.0 / (sum / double(count * channels)));
+    }
+
+    bool CanCompress(uint32_t width, uint32_t height)
+    {
+        return width > 0 && height > 0 && width % 4 == 0 && height % 4 == 0;
+    }
+
+    PixelFormat ChooseFormat(uint32_t width, uint32_t height, bool normalMap)
+    {
+        if (!CanCompress(width, height)) return PixelFormat::RGBA8;
+        return normalMap ? PixelFormat::BC5 : PixelFormat::BC7;
+    }
+
+    const char* GetKernelName()
+    {
+#if BC_SSE
+        return "SSE2";
+#else
+        return "scalar";
+#endif
+    }
+
+    const char* GetQualityName(Quality quality)
+    {
+        switch (quality)
+        {
+        case Quality::Fast: return "fast";
+        case Quality::Normal: return "normal";
+        case Quality::High: return "high";
+        }
+        return "unknown";
+    }
+
+    bool ParseQuality(const char* name, Quality& quality)
+    {
+        for (Quality candidate : { Quality::Fast, Quality::Normal, Quality::High })
+        {
+            if (std::string_view(name) == GetQualityName(candidate))
+            {
+                quality = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool ParseFormat(const char* name, PixelFormat& format)
+    {
+        for (PixelFormat candidate : { PixelFormat::RGBA8, PixelFormat::BC1, PixelFormat::BC3, PixelFormat::BC5, PixelFormat::BC7 })
+        {
+            std::string lower = GetPixelFormatName(candidate);
+            std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+            if (lower == name)
+            {
+                format = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    BenchmarkResult RunBenchmark(ThreadPool& pool, Quality quality, uint32_t width, uint32_t height, int iterations)
+    {
+        BenchmarkResult result;
+        result.kernel = GetKernelName();
+        result.quality = quality;
+        result.width = width;
+        result.height = height;
+        result.threadCount = pool.GetThreadCount();
+        if (width == 0 || height == 0 || iterations <= 0) return result;
+
+        const ImageData image = MakeBenchmarkImage(width, height);
+        const size_t pixelCount = size_t(width) * height;
+        const PixelFormat formats[4] = { PixelFormat::BC1, PixelFormat::BC3, PixelFormat::BC5, PixelFormat::BC7 };
+        for (size_t f = 0; f < 4; f++)
+        {
+            ImageData reference, simd, parallel, decoded;
+            result.referenceMegapixelsPerSecond[f] = MeasureThroughput(pixelCount, iterations,
+                [&]() { CompressImageReference(image, formats[f], quality, reference); });
+            result.simdMegapixelsPerSecond[f] = MeasureThroughput(pixelCount, iterations,
+                [&]() { CompressImage(image, formats[f], quality, simd, nullptr); });
+            result.parallelMegapixelsPerSecond[f] = MeasureThroughput(pixelCount, iterations,
+                [&]() { CompressImage(image, formats[f], quality, parallel, &pool); });
+            result.matchesReference = result.matchesReference && simd.pixels == reference.pixels && parallel.pixels == reference.pixels;
+
+            DecompressImage(simd, decoded);
+            result.psnr[f] = ComputePsnr(image, decoded, formats[f]);
+        }
+        return result;
+    }
+}
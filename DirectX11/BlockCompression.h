@@ -0,0 +1,72 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "ImageData.h"
+
+class ThreadPool;
+
+// RGBA8 画像を BC1 / BC3 / BC5 / BC7 に圧縮する（D3D非依存）
+// 出力はそのまま D3D11 のテクスチャの初期データにできる（行ピッチは RowPitch）
+namespace BlockCompression
+{
+    // 圧縮結果が変わる修正をしたら上げる（派生データキャッシュ / クッカーの依存関係のキーに含まれる）
+    constexpr uint32_t kVersion = 1;
+
+    enum class Quality : uint32_t
+    {
+        Fast,       // 主成分の軸に沿った両端を少し内側に寄せて端点にする
+        Normal,     // 添字を決めてから端点を最小二乗で解き直すのを数回繰り返す
+        High,       // さらに量子化後の端点を1段ずつずらして誤差が減る方へ探す
+    };
+
+    // image（RGBA8）を format に圧縮する。幅/高さが4の倍数でない端のブロックは端の画素を繰り返して埋める
+    // BC7 はモード 6（1区画、RGBA 7bit + p ビット、4bit 添字）だけを使う
+    // pool があればブロックの行ごとに並列に処理する
+    void CompressImage(const ImageData& image, PixelFormat format, Quality quality, ImageData& out, ThreadPool* pool = nullptr);
+
+    // スカラー版・1スレッド（SIMD 版の検証用の基準。同じ端点と添字を選ぶ）
+    void CompressImageReference(const ImageData& image, PixelFormat format, Quality quality, ImageData& out);
+
+    // 圧縮済みの画像を RGBA8 に戻す（品質の計測用。BC1 / BC5 の持たないチャンネルは B = 0, A = 255）
+    void DecompressImage(const ImageData& compressed, ImageData& out);
+
+    // format が持つチャンネル（BC1: RGB、BC5: RG、それ以外: RGBA）で測った PSNR [dB]（完全に一致すれば 99）
+    double ComputePsnr(const ImageData& original, const ImageData& decoded, PixelFormat format);
+
+    // 用途から形式を選ぶ（法線マップは BC5、それ以外は BC7）
+    // D3D11 は先頭の段の幅/高さが4の倍数でない BC テクスチャを作れないので、そのときは RGBA8 のまま
+    PixelFormat ChooseFormat(uint32_t width, uint32_t height, bool normalMap);
+
+    // D3D11 がこの大きさの BC テクスチャを作れるか
+    bool CanCompress(uint32_t width, uint32_t height);
+
+    // CompressImage が使う命令セット（"SSE2" / "scalar"）
+    const char* GetKernelName();
+
+    const char* GetQualityName(Quality quality);
+
+    // "fast" / "normal" / "high"（知らない名前なら false）
+    bool ParseQuality(const char* name, Quality& quality);
+
+    // "rgba8" / "bc1" / "bc3" / "bc5" / "bc7"（知らない名前なら false）
+    bool ParseFormat(const char* name, PixelFormat& format);
+
+    struct BenchmarkResult
+    {
+        const char* kernel = "";
+        Quality quality = Quality::Normal;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        size_t threadCount = 0;
+        // 形式ごと（BC1, BC3, BC5, BC7 の順）の処理速度（メガピクセル/秒）と品質
+        double referenceMegapixelsPerSecond[4] = {};    // スカラー版、1スレッド
+        double simdMegapixelsPerSecond[4] = {};         // SIMD 版、1スレッド
+        double parallelMegapixelsPerSecond[4] = {};     // SIMD 版をスレッドプールで実行
+        double psnr[4] = {};
+        bool matchesReference = true;                   // SIMD 版 / 並列版の出力がスカラー版とバイト単位で一致したか
+    };
+
+    // 乱数で作った画像で各形式の処理速度と PSNR を測る
+    BenchmarkResult RunBenchmark(ThreadPool& pool, Quality quality = Quality::Normal, uint32_t width = 512, uint32_t height = 512,
+        int iterations = 3);
+}
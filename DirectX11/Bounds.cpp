@@ -0,0 +1,275 @@
+﻿#include "Bounds.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define BOUNDS_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const Float3& PositionAt(const Float3* positions, size_t index, size_t stride)
+    {
+        return *reinterpret_cast<const Float3*>(reinterpret_cast<const uint8_t*>(positions) + index * stride);
+    }
+
+    float Distance2(const Float3& a, const Float3& b)
+    {
+        const float dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+        return dx * dx + dy * dy + dz * dz;
+    }
+
+#if BOUNDS_SSE
+    // 12byte だけ読む（配列の末尾の要素でも範囲外を読まない）。w は 0
+    __m128 LoadFloat3(const Float3& p)
+    {
+        const __m128 xy = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(&p.x)));
+        return _mm_movelh_ps(xy, _mm_load_ss(&p.z));
+    }
+
+    Float3 StoreFloat3(__m128 v)
+    {
+        alignas(16) float values[4];
+        _mm_store_ps(values, v);
+        return { values[0], values[1], values[2] };
+    }
+#endif
+
+    // EPOS-14 の方向（軸3つと対角線4つ。正規化はしない: 両端の点を選ぶだけなので長さは関係ない）
+    const Float3 kDirections[] =
+    {
+        { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f },
+        { 1.0f, 1.0f, 1.0f }, { 1.0f, 1.0f, -1.0f }, { 1.0f, -1.0f, 1.0f }, { 1.0f, -1.0f, -1.0f },
+    };
+    constexpr size_t kDirectionCount = sizeof(kDirections) / sizeof(kDirections[0]);
+
+    // 境界球を縮めて広げ直す回数と縮める比
+    constexpr size_t kRefineIterations = 4;
+    constexpr float kRefineShrink = 0.95f;
+}
+
+namespace Bounds
+{
+    Aabb ComputeAabb(const Float3* positions, size_t count, size_t stride)
+    {
+        if (count == 0) return { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } };
+#if BOUNDS_SSE
+        // 依存の連鎖を短くするため2組の min/max に交互に集めてから合わせる
+        __m128 lo0 = LoadFloat3(PositionAt(positions, 0, stride)), hi0 = lo0, lo1 = lo0, hi1 = lo0;
+        size_t i = 1;
+        for (; i + 1 < count; i += 2)
+        {
+            const __m128 a = LoadFloat3(PositionAt(positions, i, stride));
+            const __m128 b = LoadFloat3(PositionAt(positions, i + 1, stride));
+            lo0 = _mm_min_ps(lo0, a);
+            hi0 = _mm_max_ps(hi0, a);
+            lo1 = _mm_min_ps(lo1, b);
+            hi1 = _mm_max_ps(hi1, b);
+        }
+        if (i < count)
+        {
+            const __m128 a = LoadFloat3(PositionAt(positions, i, stride));
+            lo0 = _mm_min_ps(lo0, a);
+            hi0 = _mm_max_ps(hi0, a);
+        }
+        return { StoreFloat3(_mm_min_ps(lo0, lo1)), StoreFloat3(_mm_max_ps(hi0, hi1)) };
+#else
+        Float3 lo = PositionAt(positions, 0, stride), hi = lo;
+        for (size_t i = 1; i < count; i++)
+        {
+            const Float3& p = PositionAt(positions, i, stride);
+            lo = { std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z) };
+            hi = { std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z) };
+        }
+        return { lo, hi };
+#endif
+    }
+
+    Sphere ComputeSphere(const Float3* positions, size_t count, size_t stride)
+    {
+        if (count == 0) return { { 0.0f, 0.0f, 0.0f }, 0.0f };
+
+        // 各方向で射影が最小/最大になる点
+        size_t minIndex[kDirectionCount] = {}, maxIndex[kDirectionCount] = {};
+        float minProj[kDirectionCount], maxProj[kDirectionCount];
+        for (size_t d = 0; d < kDirectionCount; d++)
+        {
+            const Float3& p = positions[0];
+            minProj[d] = maxProj[d] = p.x * kDirections[d].x + p.y * kDirections[d].y + p.z * kDirections[d].z;
+        }
+        for (size_t i = 1; i < count; i++)
+        {
+            const Float3& p = PositionAt(positions, i, stride);
+            for (size_t d = 0; d < kDirectionCount; d++)
+            {
+                const float proj = p.x * kDirections[d].x + p.y * kDirections[d].y + p.z * kDirections[d].z;
+                if (proj < minProj[d]) { minProj[d] = proj; minIndex[d] = i; }
+                if (proj > maxProj[d]) { maxProj[d] = proj; maxIndex[d] = i; }
+            }
+        }
+
+        // 最も離れた組を直径とする球から始める
+        size_t bestDirection = 0;
+        float bestDistance2 = -1.0f;
+        for (size_t d = 0; d < kDirectionCount; d++)
+        {
+            const float distance2 = Distance2(PositionAt(positions, minIndex[d], stride), PositionAt(positions, maxIndex[d], stride));
+            if (distance2 > bestDistance2)
+            {
+                bestDistance2 = distance2;
+                bestDirection = d;
+            }
+        }
+        const Float3& a = PositionAt(positions, minIndex[bestDirection], stride);
+        const Float3& b = PositionAt(positions, maxIndex[bestDirection], stride);
+        Float3 center = { (a.x + b.x) * 0.5f, (a.y + b.y) * 0.5f, (a.z + b.z) * 0.5f };
+        float radius = std::sqrt(bestDistance2) * 0.5f;
+
+        // 外に出た点を含むよう、その点の反対側の端を固定したまま球を広げる（first から始めて一周する）
+        auto grow = [&](Float3& c, float& r, size_t first)
+        {
+            for (size_t n = 0, i = first; n < count; n++, i = i + 1 == count ? 0 : i + 1)
+            {
+                const Float3& p = PositionAt(positions, i, stride);
+                const float distance2 = Distance2(p, c);
+                if (distance2 <= r * r) continue;
+                const float distance = std::sqrt(distance2);
+                const float step = (distance - r) * 0.5f;
+                const float t = step / distance;
+                c = { c.x + (p.x - c.x) * t, c.y + (p.y - c.y) * t, c.z + (p.z - c.z) * t };
+                r += step;
+            }
+        };
+        grow(center, radius, 0);
+
+        // 少し縮めて別の点から広げ直し、小さくなれば採用する（Ritter の反復改良）
+        for (size_t iteration = 1; iteration <= kRefineIterations; iteration++)
+        {
+            Float3 refinedCenter = center;
+            float refinedRadius = radius * kRefineShrink;
+            grow(refinedCenter, refinedRadius, count * iteration / (kRefineIterations + 1));
+            if (refinedRadius < radius)
+            {
+                center = refinedCenter;
+                radius = refinedRadius;
+            }
+        }
+
+        // 丸め誤差で外に残る点がないよう、最後に中心から最も遠い点までの距離にそろえる
+        // AABB の中心からの球（以前の求め方）も同じように測り、小さいほうを使う
+        const Aabb box = ComputeAabb(positions, count, stride);
+        const Float3 boxCenter = { (box.min.x + box.max.x) * 0.5f, (box.min.y + box.max.y) * 0.5f, (box.min.z + box.max.z) * 0.5f };
+        float radius2 = 0.0f, boxRadius2 = 0.0f;
+        for (size_t i = 0; i < count; i++)
+        {
+            const Float3& p = PositionAt(positions, i, stride);
+            radius2 = std::max(radius2, Distance2(p, center));
+            boxRadius2 = std::max(boxRadius2, Distance2(p, boxCenter));
+        }
+        if (boxRadius2 < radius2) return { boxCenter, std::sqrt(boxRadius2) };
+        return { center, std::sqrt(radius2) };
+    }
+
+    void ComputeSubMeshBounds(const MeshVertex* vertices, size_t count, SubMesh& submesh)
+    {
+        const Aabb box = ComputeAabb(&vertices->pos, count, sizeof(MeshVertex));
+        const Sphere sphere = ComputeSphere(&vertices->pos, count, sizeof(MeshVertex));
+        submesh.boundsMin = box.min;
+        submesh.boundsMax = box.max;
+        submesh.boundsCenter = sphere.center;
+        submesh.boundsRadius = sphere.radius;
+    }
+
+    void TransformBounds(const SubMesh* submeshes, const int32_t* meshes, const float (*matrices)[4][4], size_t count,
+        WorldBounds* out)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            if (meshes[i] < 0)
+            {
+                out[i] = { { 1.0f, 1.0f, 1.0f }, { -1.0f, -1.0f, -1.0f }, { 0.0f, 0.0f, 0.0f }, -1.0f };
+                continue;
+            }
+            const SubMesh& submesh = submeshes[meshes[i]];
+            const float (&m)[4][4] = matrices[i];
+#if BOUNDS_SSE
+            // 箱の中心を変換し、半分の大きさは行列の絶対値で変換する（Arvo の方法）
+            const __m128 r0 = _mm_loadu_ps(m[0]), r1 = _mm_loadu_ps(m[1]), r2 = _mm_loadu_ps(m[2]), r3 = _mm_loadu_ps(m[3]);
+            const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+            const __m128 a0 = _mm_and_ps(r0, signMask), a1 = _mm_and_ps(r1, signMask), a2 = _mm_and_ps(r2, signMask);
+            const __m128 lo = LoadFloat3(submesh.boundsMin), hi = LoadFloat3(submesh.boundsMax);
+            const __m128 half = _mm_set1_ps(0.5f);
+            const __m128 c = _mm_mul_ps(_mm_add_ps(lo, hi), half);
+            const __m128 e = _mm_mul_ps(_mm_sub_ps(hi, lo), half);
+            auto transform = [&](__m128 v, __m128 x, __m128 y, __m128 z)
+            {
+                return _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)), x),
+                    _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)), y)),
+                    _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2)), z));
+            };
+            const __m128 worldCenter = _mm_add_ps(transform(c, r0, r1, r2), r3);
+            const __m128 worldExtent = transform(e, a0, a1, a2);
+            const __m128 sphereCenter = _mm_add_ps(transform(LoadFloat3(submesh.boundsCenter), r0, r1, r2), r3);
+
+            // 各軸の拡大率の2乗（行の xyz の長さの2乗）の最大
+            __m128 s0 = _mm_mul_ps(r0, r0), s1 = _mm_mul_ps(r1, r1), s2 = _mm_mul_ps(r2, r2), s3 = _mm_setzero_ps();
+            _MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+            const __m128 scale2 = _mm_add_ps(_mm_add_ps(s0, s1), s2);
+            const float maxScale2 = std::max(std::max(_mm_cvtss_f32(scale2), _mm_cvtss_f32(_mm_shuffle_ps(scale2, scale2, 1))),
+                _mm_cvtss_f32(_mm_shuffle_ps(scale2, scale2, 2)));
+
+            WorldBounds& bounds = out[i];
+            bounds.min = StoreFloat3(_mm_sub_ps(worldCenter, worldExtent));
+            bounds.max = StoreFloat3(_mm_add_ps(worldCenter, worldExtent));
+            bounds.center = StoreFloat3(sphereCenter);
+            bounds.radius = submesh.boundsRadius * std::sqrt(maxScale2);
+#else
+            auto transformPoint = [&](const Float3& p)
+            {
+                return Float3
+                {
+                    p.x * m[0][0] + p.y * m[1][0] + p.z * m[2][0] + m[3][0],
+                    p.x * m[0][1] + p.y * m[1][1] + p.z * m[2][1] + m[3][1],
+                    p.x * m[0][2] + p.y * m[1][2] + p.z * m[2][2] + m[3][2],
+                };
+            };
+            const Float3& lo = submesh.boundsMin;
+            const Float3& hi = submesh.boundsMax;
+            const Float3 c = transformPoint({ (lo.x + hi.x) * 0.5f, (lo.y + hi.y) * 0.5f, (lo.z + hi.z) * 0.5f });
+            const Float3 e = { (hi.x - lo.x) * 0.5f, (hi.y - lo.y) * 0.5f, (hi.z - lo.z) * 0.5f };
+            Float3 extent;
+            float* extentOut = &extent.x;
+            float maxScale2 = 0.0f;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                extentOut[axis] = e.x * std::fabs(m[0][axis]) + e.y * std::fabs(m[1][axis]) + e.z * std::fabs(m[2][axis]);
+                maxScale2 = std::max(maxScale2, m[axis][0] * m[axis][0] + m[axis][1] * m[axis][1] + m[axis][2] * m[axis][2]);
+            }
+            WorldBounds& bounds = out[i];
+            bounds.min = { c.x - extent.x, c.y - extent.y, c.z - extent.z };
+            bounds.max = { c.x + extent.x, c.y + extent.y, c.z + extent.z };
+            bounds.center = transformPoint(submesh.boundsCenter);
+            bounds.radius = submesh.boundsRadius * std::sqrt(maxScale2);
+#endif
+        }
+    }
+
+    bool IsVisible(const ClusterCulling::Frustum& frustum, const WorldBounds& bounds)
+    {
+        if (bounds.radius < 0.0f) return false;
+        for (const Float4& plane : frustum.planes)
+        {
+            const float distance = plane.x * bounds.center.x + plane.y * bounds.center.y + plane.z * bounds.center.z + plane.w;
+            if (distance < -bounds.radius) return false;
+            if (distance >= bounds.radius) continue;
+
+            // 平面の法線の向きに最も進んだ頂点が外なら箱全体が外
+            const float x = plane.x >= 0.0f ? bounds.max.x : bounds.min.x;
+            const float y = plane.y >= 0.0f ? bounds.max.y : bounds.min.y;
+            const float z = plane.z >= 0.0f ? bounds.max.z : bounds.min.z;
+            if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0.0f) return false;
+        }
+        return true;
+    }
+}
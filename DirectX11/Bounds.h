@@ -0,0 +1,49 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "ClusterCulling.h"
+#include "MeshData.h"
+
+// メッシュの境界（AABB と境界球）の計算とワールド空間への変換（D3D非依存）
+// インポート時にサブメッシュごとに求めてクック済みデータに入れ、描画時はノードの行列でまとめて変換する
+namespace Bounds
+{
+    struct Aabb
+    {
+        Float3 min;
+        Float3 max;
+    };
+
+    struct Sphere
+    {
+        Float3 center;
+        float radius;
+    };
+
+    // positions から stride バイトおきに count 個並んだ位置（MeshVertex::pos など）の AABB（SIMD の min/max）
+    Aabb ComputeAabb(const Float3* positions, size_t count, size_t stride = sizeof(Float3));
+
+    // 7方向の両端の点から最も離れた組を初期の直径にし（EPOS-14）、外に出た点で広げる（Ritter、縮めて広げ直す改良付き）
+    // AABB の中心を使った球のほうが小さければそちらを返す
+    Sphere ComputeSphere(const Float3* positions, size_t count, size_t stride = sizeof(Float3));
+
+    // サブメッシュの boundsMin/Max と boundsCenter/Radius を頂点から求める
+    void ComputeSubMeshBounds(const MeshVertex* vertices, size_t count, SubMesh& submesh);
+
+    // ワールド空間の境界（AABB は回転後の箱を囲み直したもの、半径は行列の最大の拡大率で広げたもの）
+    struct WorldBounds
+    {
+        Float3 min;
+        Float3 max;
+        Float3 center;
+        float radius;
+    };
+
+    // 行ベクトル規約（p * M）の行列で count 個の境界をまとめて変換する
+    // meshes[i] < 0 のもの（メッシュなしのノード）は空の境界（min > max、半径 -1）にする
+    void TransformBounds(const SubMesh* submeshes, const int32_t* meshes, const float (*matrices)[4][4], size_t count,
+        WorldBounds* out);
+
+    // 球で外れを判定し、球が平面にかかるときだけ AABB の最も内側の頂点で判定する（frustum はワールド空間）
+    bool IsVisible(const ClusterCulling::Frustum& frustum, const WorldBounds& bounds);
+}
@@ -0,0 +1,180 @@
+﻿#include "ClusterCulling.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    Float4 NormalizePlane(float a, float b, float c, float d)
+    {
+        float length = std::sqrt(a * a + b * b + c * c);
+        float inv = length > 0.0f ? 1.0f / length : 0.0f;
+        return { a * inv, b * inv, c * inv, d * inv };
+    }
+
+    Float3 Normalize(const Float3& v)
+    {
+        const float length = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+        const float inv = length > 0.0f ? 1.0f / length : 0.0f;
+        return { v.x * inv, v.y * inv, v.z * inv };
+    }
+
+    Float3 Cross(const Float3& a, const Float3& b)
+    {
+        return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    }
+
+    float Dot(const Float3& a, const Float3& b)
+    {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+
+    // XMMatrixLookAtLH * XMMatrixPerspectiveFovLH と同じ行列（行ベクトル規約、アスペクト比 1）
+    void LookAtPerspective(const Float3& eye, const Float3& target, float fovY, float nearZ, float farZ, float (&m)[4][4])
+    {
+        const Float3 z = Normalize({ target.x - eye.x, target.y - eye.y, target.z - eye.z });
+        const Float3 up = std::fabs(z.y) > 0.99f ? Float3{ 0.0f, 0.0f, 1.0f } : Float3{ 0.0f, 1.0f, 0.0f };
+        const Float3 x = Normalize(Cross(up, z));
+        const Float3 y = Cross(z, x);
+        const float view[4][4] =
+        {
+            { x.x, y.x, z.x, 0.0f },
+            { x.y, y.y, z.y, 0.0f },
+            { x.z, y.z, z.z, 0.0f },
+            { -Dot(x, eye), -Dot(y, eye), -Dot(z, eye), 1.0f },
+        };
+        const float h = 1.0f / std::tan(fovY * 0.5f);
+        const float q = farZ / (farZ - nearZ);
+        const float proj[4][4] =
+        {
+            { h, 0.0f, 0.0f, 0.0f },
+            { 0.0f, h, 0.0f, 0.0f },
+            { 0.0f, 0.0f, q, 1.0f },
+            { 0.0f, 0.0f, -q * nearZ, 0.0f },
+        };
+        for (int r = 0; r < 4; r++)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                m[r][c] = view[r][0] * proj[0][c] + view[r][1] * proj[1][c] + view[r][2] * proj[2][c] + view[r][3] * proj[3][c];
+            }
+        }
+    }
+}
+
+namespace ClusterCulling
+{
+    void CullStats::Add(const CullStats& other)
+    {
+        clusters += other.clusters;
+        frustumCulled += other.frustumCulled;
+        backfaceCulled += other.backfaceCulled;
+        triangles += other.triangles;
+        trianglesDrawn += other.trianglesDrawn;
+        trianglesFrustumCulled += other.trianglesFrustumCulled;
+        trianglesBackfaceCulled += other.trianglesBackfaceCulled;
+        drawCalls += other.drawCalls;
+        submeshes += other.submeshes;
+        submeshesCulled += other.submeshesCulled;
+    }
+
+    Frustum ExtractFrustum(const float (&m)[4][4])
+    {
+        // クリップ座標 c = p * M の各成分は p と M の列の内積（Gribb-Hartmann）
+        auto column = [&](int i, float& a, float& b, float& c, float& d)
+        {
+            a = m[0][i];
+            b = m[1][i];
+            c = m[2][i];
+            d = m[3][i];
+        };
+        float x[4], y[4], z[4], w[4];
+        column(0, x[0], x[1], x[2], x[3]);
+        column(1, y[0], y[1], y[2], y[3]);
+        column(2, z[0], z[1], z[2], z[3]);
+        column(3, w[0], w[1], w[2], w[3]);
+
+        Frustum frustum;
+        frustum.planes[0] = NormalizePlane(w[0] + x[0], w[1] + x[1], w[2] + x[2], w[3] + x[3]);     // 左   -w <= x
+        frustum.planes[1] = NormalizePlane(w[0] - x[0], w[1] - x[1], w[2] - x[2], w[3] - x[3]);     // 右    x <= w
+        frustum.planes[2] = NormalizePlane(w[0] + y[0], w[1] + y[1], w[2] + y[2], w[3] + y[3]);     // 下   -w <= y
+        frustum.planes[3] = NormalizePlane(w[0] - y[0], w[1] - y[1], w[2] - y[2], w[3] - y[3]);     // 上    y <= w
+        frustum.planes[4] = NormalizePlane(z[0], z[1], z[2], z[3]);                                 // 近    0 <= z
+        frustum.planes[5] = NormalizePlane(w[0] - z[0], w[1] - z[1], w[2] - z[2], w[3] - z[3]);     // 遠    z <= w
+        return frustum;
+    }
+
+    void CullMeshlets(const Meshlet* meshlets, size_t count, const Frustum& frustum, const Float3& eye,
+        std::vector<DrawRange>& ranges, CullStats& stats)
+    {
+        const size_t firstRange = ranges.size();
+        for (size_t i = 0; i < count; i++)
+        {
+            const Meshlet& m = meshlets[i];
+            stats.clusters++;
+            stats.triangles += m.triangleCount;
+
+            bool outside = false;
+            for (const Float4& p : frustum.planes)
+            {
+                if (p.x * m.center.x + p.y * m.center.y + p.z * m.center.z + p.w < -m.radius)
+                {
+                    outside = true;
+                    break;
+                }
+            }
+            if (outside)
+            {
+                stats.frustumCulled++;
+                stats.trianglesFrustumCulled += m.triangleCount;
+                continue;
+            }
+
+            if (m.coneCutoff < 1.0f)
+            {
+                Float3 d = { m.coneApex.x - eye.x, m.coneApex.y - eye.y, m.coneApex.z - eye.z };
+                float length = std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z);
+                if (d.x * m.coneAxis.x + d.y * m.coneAxis.y + d.z * m.coneAxis.z >= m.coneCutoff * length)
+                {
+                    stats.backfaceCulled++;
+                    stats.trianglesBackfaceCulled += m.triangleCount;
+                    continue;
+                }
+            }
+
+            stats.trianglesDrawn += m.triangleCount;
+            const uint32_t indexCount = m.triangleCount * 3;
+            if (ranges.size() > firstRange && ranges.back().indexOffset + ranges.back().indexCount == m.indexOffset)
+            {
+                ranges.back().indexCount += indexCount;
+            }
+            else
+            {
+                ranges.push_back({ m.indexOffset, indexCount });
+            }
+        }
+        stats.drawCalls += ranges.size() - firstRange;
+    }
+
+    CullStats SweepViewDirections(const Meshlet* meshlets, size_t count, const Float3& center, float radius,
+        float distance, uint32_t directionCount)
+    {
+        CullStats stats;
+        std::vector<DrawRange> ranges;
+        const float pi = 3.14159265f;
+        for (uint32_t i = 0; i < directionCount; i++)
+        {
+            // フィボナッチ格子で球面上にほぼ均等に方向を並べる
+            const float y = 1.0f - 2.0f * (float(i) + 0.5f) / float(directionCount);
+            const float ring = std::sqrt(std::max(0.0f, 1.0f - y * y));
+            const float phi = float(i) * pi * (3.0f - std::sqrt(5.0f));
+            const Float3 eye = { center.x + radius * distance * ring * std::cos(phi), center.y + radius * distance * y,
+                center.z + radius * distance * ring * std::sin(phi) };
+
+            float viewProj[4][4];
+            LookAtPerspective(eye, center, pi / 3.0f, radius * 0.01f, radius * (distance + 2.0f), viewProj);
+            ranges.clear();
+            CullMeshlets(meshlets, count, ExtractFrustum(viewProj), eye, ranges, stats);
+        }
+        return stats;
+    }
+}
@@ -0,0 +1,53 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MeshData.h"
+
+// Meshlet 単位の CPU カリング（D3D非依存）
+// 描画前にクラスタを視錐台と法線コーンで判定し、残った範囲だけを DrawIndexed に渡す
+namespace ClusterCulling
+{
+    // 内側が dot(normal, p) + d >= 0 になる正規化済み平面（x, y, z = 法線, w = d）
+    struct Frustum
+    {
+        Float4 planes[6];
+    };
+
+    // 行ベクトル規約（p * M）の 4x4 行列から視錐台を取り出す（D3D の z 範囲 [0, 1]）
+    // world * view * proj を渡せば、平面はモデル空間で得られる
+    Frustum ExtractFrustum(const float (&m)[4][4]);
+
+    struct CullStats
+    {
+        size_t clusters = 0;
+        size_t frustumCulled = 0;
+        size_t backfaceCulled = 0;
+        size_t triangles = 0;
+        size_t trianglesDrawn = 0;
+        size_t trianglesFrustumCulled = 0;  // 視錐台/法線コーンで落としたクラスタの三角形の数
+        size_t trianglesBackfaceCulled = 0;
+        size_t drawCalls = 0;
+        size_t submeshes = 0;           // クラスタの前にサブメッシュの境界で判定した数
+        size_t submeshesCulled = 0;
+
+        void Add(const CullStats& other);
+    };
+
+    struct DrawRange
+    {
+        uint32_t indexOffset;
+        uint32_t indexCount;
+    };
+
+    // eye はカメラ位置（frustum と同じ空間）。残ったクラスタの範囲を ranges に追加する
+    // インデックス列で隣り合うクラスタは1つの範囲にまとめる
+    void CullMeshlets(const Meshlet* meshlets, size_t count, const Frustum& frustum, const Float3& eye,
+        std::vector<DrawRange>& ranges, CullStats& stats);
+
+    // 境界球（center, radius）のまわりの directionCount 方向、中心から radius * distance 離れた位置から
+    // 縦 60 度の視野で中心を見てクラスタを判定し、全方向の結果を合計する（カリングの効き方の計測用）
+    // distance が小さいと球の一部が視野の外に出る
+    CullStats SweepViewDirections(const Meshlet* meshlets, size_t count, const Float3& center, float radius,
+        float distance, uint32_t directionCount = 64);
+}
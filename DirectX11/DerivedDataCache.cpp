@@ -0,0 +1,124 @@
+﻿#include "DerivedDataCache.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <vector>
+#include "FileUtil.h"
+
+namespace fs = std::filesystem;
+
+DerivedDataCache::DerivedDataCache(const std::string& rootDir, uint64_t maxBytes)
+    : mRootDir(rootDir), mMaxBytes(maxBytes)
+{
+}
+
+std::string DerivedDataCache::KeyToString(uint64_t key)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string text(16, '0');
+    for (int i = 15; i >= 0; i--)
+    {
+        text[i] = digits[key & 0xf];
+        key >>= 4;
+    }
+    return text;
+}
+
+std::string DerivedDataCache::EntryPath(const char* type, uint64_t key) const
+{
+    // 1ディレクトリに集中しないよう先頭2桁でフォルダを分ける
+    std::string name = KeyToString(key);
+    return mRootDir + "/" + name.substr(0, 2) + "/" + name + "." + type;
+}
+
+bool DerivedDataCache::Find(const char* type, uint64_t key, std::string& path)
+{
+    std::string entry = EntryPath(type, key);
+
+    std::error_code ec;
+    uintmax_t size = fs::file_size(entry, ec);
+    if (ec || size == 0)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStats.misses++;
+        return false;
+    }
+
+    // LRU のためにアクセス時刻として更新日時を進める（失敗しても読み込みには影響しない）
+    fs::last_write_time(entry, fs::file_time_type::clock::now(), ec);
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStats.hits++;
+        mStats.bytesRead += size;
+    }
+    path = entry;
+    return true;
+}
+
+bool DerivedDataCache::Put(const char* type, uint64_t key, const void* data, size_t size)
+{
+    if (!WriteFileAtomic(EntryPath(type, key), data, size)) return false;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStats.writes++;
+        mStats.bytesWritten += size;
+    }
+    Trim();
+    return true;
+}
+
+void DerivedDataCache::Trim()
+{
+    struct Entry
+    {
+        fs::path path;
+        fs::file_time_type time;
+        uintmax_t size;
+    };
+    std::vector<Entry> entries;
+    uintmax_t total = 0;
+
+    std::error_code ec;
+    const auto now = fs::file_time_type::clock::now();
+    for (fs::recursive_directory_iterator it(mRootDir, ec), end; !ec && it != end; it.increment(ec))
+    {
+        if (!it->is_regular_file(ec)) continue;
+
+        Entry entry{ it->path(), it->last_write_time(ec), it->file_size(ec) };
+        if (ec) continue;
+
+        // 書き込み途中で落ちたプロセスの一時ファイルは1時間経ったら捨てる
+        if (entry.path.filename().string().find(".tmp") != std::string::npos)
+        {
+            if (now - entry.time > std::chrono::hours(1)) fs::remove(entry.path, ec);
+            continue;
+        }
+        entries.push_back(entry);
+        total += entry.size;
+    }
+    if (total <= mMaxBytes) return;
+
+    std::sort(entries.begin(), entries.end(),
+        [](const Entry& a, const Entry& b) { return a.time < b.time; });
+
+    for (const Entry& entry : entries)
+    {
+        if (total <= mMaxBytes) break;
+
+        // 他プロセスが開いているエントリは削除できないことがあるが、その場合は次へ
+        if (fs::remove(entry.path, ec))
+        {
+            total -= entry.size;
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStats.evictions++;
+        }
+    }
+}
+
+DerivedDataCacheStats DerivedDataCache::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
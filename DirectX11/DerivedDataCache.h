@@ -0,0 +1,46 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+struct DerivedDataCacheStats
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t writes = 0;
+    uint64_t evictions = 0;
+    uint64_t bytesRead = 0;
+    uint64_t bytesWritten = 0;
+};
+
+// 変換済みアセットのローカルキャッシュ
+// キーは（元ファイルの内容, 変換処理のバージョン, 変換オプション）のハッシュ。内容が同じなら再変換しない
+// エントリは1ファイルずつ置き、最終アクセス時刻（更新日時）の古い順に容量上限まで削除する
+class DerivedDataCache
+{
+public:
+    DerivedDataCache(const std::string& rootDir, uint64_t maxBytes);
+
+    // ヒットしたらエントリのパスを返し、アクセス時刻を更新する（パスはそのままメモリマップしてよい）
+    bool Find(const char* type, uint64_t key, std::string& path);
+
+    // エントリを書き込む。一時ファイルからのリネームなので、同時に書く他プロセスと壊し合わない
+    bool Put(const char* type, uint64_t key, const void* data, size_t size);
+
+    // 容量上限を超えていれば古いエントリから削除する
+    void Trim();
+
+    DerivedDataCacheStats GetStats() const;
+    const std::string& GetRootDir() const { return mRootDir; }
+
+    static std::string KeyToString(uint64_t key);
+
+private:
+    std::string EntryPath(const char* type, uint64_t key) const;
+
+    std::string mRootDir;
+    uint64_t mMaxBytes;
+    mutable std::mutex mMutex;
+    DerivedDataCacheStats mStats;
+};
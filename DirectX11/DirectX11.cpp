@@ -23,6 +23,9 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wp, LPARAM lp)
 
 int WINAPI wWinMain(HINSTANCE hInst, HINSTANCE, LPWSTR, int nCmdShow)
 {
+    // テクスチャの展開に WIC を使うので COM を初期化しておく
+    CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
     const wchar_t* clsName = L"D3D11Window";
     WNDCLASSEX wc{ sizeof(WNDCLASSEX) };
     wc.lpfnWndProc = WndProc;
@@ -68,5 +71,6 @@ int WINAPI wWinMain(HINSTANCE hInst, HINSTANCE, LPWSTR, int nCmdShow)
         }
     }
     gApp.Cleanup();
+    CoUninitialize();
     return 0;
 }
\ No newline at end of file
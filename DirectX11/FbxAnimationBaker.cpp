@@ -0,0 +1,53 @@
+﻿#include "FbxAnimationBaker.h"
+#include <fbxsdk.h>
+#include <algorithm>
+#include <cmath>
+
+namespace FbxAnimationBaker
+{
+    void BakeTakes(FbxScene* scene, const std::vector<FbxNode*>& nodes, float sampleRate,
+        std::vector<AnimationCompression::RawClip>& clips)
+    {
+        if (sampleRate <= 0.0f || nodes.empty()) return;
+
+        const int stackCount = scene->GetSrcObjectCount<FbxAnimStack>();
+        for (int i = 0; i < stackCount; i++)
+        {
+            FbxAnimStack* stack = scene->GetSrcObject<FbxAnimStack>(i);
+            const FbxTimeSpan span = stack->GetLocalTimeSpan();
+            const double start = span.GetStart().GetSecondDouble();
+            const double duration = span.GetDuration().GetSecondDouble();
+            if (!(duration > 0.0)) continue;
+
+            // 評価はシーンの現在のテイクに対して行われる
+            scene->SetCurrentAnimationStack(stack);
+
+            AnimationCompression::RawClip clip;
+            clip.name = stack->GetName();
+            clip.sampleRate = sampleRate;
+            clip.frameCount = uint32_t(std::min(std::floor(duration * sampleRate + 1.0e-6) + 1.0, 65535.0));
+            clip.nodeCount = uint32_t(nodes.size());
+            const size_t count = size_t(clip.frameCount) * clip.nodeCount;
+            clip.translations.reserve(count);
+            clip.rotations.reserve(count);
+            clip.scales.reserve(count);
+
+            for (uint32_t f = 0; f < clip.frameCount; f++)
+            {
+                FbxTime time;
+                time.SetSecondDouble(start + double(f) / sampleRate);
+                for (FbxNode* node : nodes)
+                {
+                    const FbxAMatrix& local = node->EvaluateLocalTransform(time);
+                    const FbxVector4 t = local.GetT();
+                    const FbxQuaternion q = local.GetQ();
+                    const FbxVector4 s = local.GetS();
+                    clip.translations.push_back({ (float)t[0], (float)t[1], (float)t[2] });
+                    clip.rotations.push_back({ (float)q[0], (float)q[1], (float)q[2], (float)q[3] });
+                    clip.scales.push_back({ (float)s[0], (float)s[1], (float)s[2] });
+                }
+            }
+            clips.push_back(std::move(clip));
+        }
+    }
+}
@@ -0,0 +1,15 @@
+﻿#pragma once
+#include <vector>
+#include "AnimationCompression.h"
+
+namespace fbxsdk { class FbxScene; class FbxNode; }
+
+// FBX のテイク（FbxAnimStack）をノードごとのローカル TRS として一定間隔でサンプリングする
+// カーブの種類（オイラー角・補間モード・制約など）の違いは FBX SDK の評価に任せ、結果の行列だけを使う
+namespace FbxAnimationBaker
+{
+    // nodes は ModelData::nodes と同じ並び。テイクの長さが 0 のものは飛ばす
+    // 1テイクは最大 65535 フレーム（AnimationTrack のフレーム番号が 16 ビットのため）
+    void BakeTakes(fbxsdk::FbxScene* scene, const std::vector<fbxsdk::FbxNode*>& nodes, float sampleRate,
+        std::vector<AnimationCompression::RawClip>& clips);
+}
@@ -0,0 +1,398 @@
+﻿#include "FbxMeshExtractor.h"
+#include <fbxsdk.h>
+#include <algorithm>
+#include <chrono>
+#include "ThreadPool.h"
+
+namespace
+{
+    constexpr size_t kParallelChunk = 64 * 1024;
+
+    // レイヤー要素のマッピング / 参照モードを解決し、コーナーごとの DirectArray 番号を求める
+    // 列は DirectArray の後ろに既定値を1つ足してあり（番号 directCount）、範囲外の参照（壊れたファイルの -1 など）は
+    // そこを指す。未対応のマッピング（eByEdge / eNone）なら全コーナーを既定値にして false を返す
+    // invalid には既定値にしたコーナーの数を足す。pool があれば並列に解決する
+    template <class TElement>
+    bool ResolveCornerIndices(TElement* element, const int* polygonVertices, size_t cornerCount, int directCount,
+        std::vector<int>& out, size_t& invalid, ThreadPool* pool)
+    {
+        const FbxLayerElement::EMappingMode mapping = element->GetMappingMode();
+        if (mapping != FbxLayerElement::eByControlPoint && mapping != FbxLayerElement::eByPolygonVertex &&
+            mapping != FbxLayerElement::eByPolygon && mapping != FbxLayerElement::eAllSame)
+        {
+            out.assign(cornerCount, directCount);
+            invalid += cornerCount;
+            return false;
+        }
+        out.resize(cornerCount);
+
+        const bool indexed = element->GetReferenceMode() != FbxLayerElement::eDirect;
+        const int indexCount = indexed ? element->GetIndexArray().GetCount() : 0;
+        FbxLayerElementArrayReadLock<int> indexLock(element->GetIndexArray());
+        const int* indexArray = indexed ? indexLock.GetData() : nullptr;
+
+        auto resolve = [&](size_t begin, size_t end)
+        {
+            for (size_t c = begin; c < end; c++)
+            {
+                int source = 0;
+                switch (mapping)
+                {
+                case FbxLayerElement::eByControlPoint:  source = polygonVertices[c]; break;
+                case FbxLayerElement::eByPolygonVertex: source = int(c); break;
+                case FbxLayerElement::eByPolygon:       source = int(c / 3); break;
+                case FbxLayerElement::eAllSame:         source = 0; break;
+                default:                                break;
+                }
+                if (indexArray) source = source >= 0 && source < indexCount ? indexArray[source] : -1;
+                out[c] = source >= 0 && source < directCount ? source : directCount;
+            }
+        };
+        if (pool) pool->ParallelFor(cornerCount, kParallelChunk, resolve);
+        else resolve(size_t(0), cornerCount);
+        invalid += size_t(std::count(out.begin(), out.end(), directCount));
+        return true;
+    }
+
+    // 重い順に並んだ4枠に影響を差し込む（あふれた最も軽いものは捨てる）
+    void InsertInfluence(SkinWeights& skin, uint16_t joint, float weight)
+    {
+        int slot = 4;
+        while (slot > 0 && skin.weights[slot - 1] < weight) slot--;
+        if (slot == 4) return;
+        for (int k = 3; k > slot; k--)
+        {
+            skin.joints[k] = skin.joints[k - 1];
+            skin.weights[k] = skin.weights[k - 1];
+        }
+        skin.joints[slot] = joint;
+        skin.weights[slot] = weight;
+    }
+
+    double ElapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void CollectMeshes(FbxNode* node, std::vector<FbxMesh*>& meshes)
+    {
+        if (FbxMesh* mesh = node->GetMesh())
+        {
+            if (mesh->GetPolygonVertexCount() == mesh->GetPolygonCount() * 3) meshes.push_back(mesh);
+        }
+        for (int i = 0; i < node->GetChildCount(); i++) CollectMeshes(node->GetChild(i), meshes);
+    }
+
+    bool SameAttributes(const MeshVertex& a, const MeshVertex& b)
+    {
+        return a.pos.x == b.pos.x && a.pos.y == b.pos.y && a.pos.z == b.pos.z &&
+            a.normal.x == b.normal.x && a.normal.y == b.normal.y && a.normal.z == b.normal.z &&
+            a.uv.x == b.uv.x && a.uv.y == b.uv.y;
+    }
+
+    void StoreMatrix(const FbxAMatrix& matrix, float (&out)[4][4])
+    {
+        for (int r = 0; r < 4; r++)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                out[r][c] = (float)matrix.Get(r, c);
+            }
+        }
+    }
+}
+
+namespace FbxMeshExtractor
+{
+    bool ExtractColumns(FbxMesh* mesh, FbxMeshColumns& columns, ThreadPool* pool)
+    {
+        columns.invalidCorners = 0;
+        columns.unsupportedLayers = 0;
+        const int polyCount = mesh->GetPolygonCount();
+        const size_t cornerCount = size_t(mesh->GetPolygonVertexCount());
+        if (cornerCount != size_t(polyCount) * 3) return false;
+
+        // コーナー -> コントロールポイント（範囲外を指すコーナーがあれば頂点を組み立てられない）
+        const int* polygonVertices = mesh->GetPolygonVertices();
+        const int controlPointCount = mesh->GetControlPointsCount();
+        columns.positionIndex.assign(polygonVertices, polygonVertices + cornerCount);
+        for (int index : columns.positionIndex)
+        {
+            if (index < 0 || index >= controlPointCount) return false;
+        }
+
+        // 位置
+        const FbxVector4* controlPoints = mesh->GetControlPoints();
+        columns.positions.resize(controlPointCount);
+        for (int i = 0; i < controlPointCount; i++)
+        {
+            const FbxVector4& p = controlPoints[i];
+            columns.positions[i] = { (float)p[0], (float)p[1], (float)p[2] };
+        }
+
+        // 法線
+        FbxGeometryElementNormal* normalElement = mesh->GetElementNormal(0);
+        if (normalElement)
+        {
+            FbxLayerElementArrayTemplate<FbxVector4>& direct = normalElement->GetDirectArray();
+            FbxLayerElementArrayReadLock<FbxVector4> lock(direct);
+            const FbxVector4* data = lock.GetData();
+            const int directCount = direct.GetCount();
+            columns.normals.resize(size_t(directCount) + 1);
+            for (int i = 0; i < directCount; i++)
+            {
+                columns.normals[i] = { (float)data[i][0], (float)data[i][1], (float)data[i][2] };
+            }
+            columns.normals[directCount] = Float3{ 0.0f, 0.0f, 0.0f };
+            if (!ResolveCornerIndices(normalElement, polygonVertices, cornerCount, directCount, columns.normalIndex,
+                columns.invalidCorners, pool))
+            {
+                columns.unsupportedLayers++;
+            }
+        }
+        else
+        {
+            columns.normals.assign(1, Float3{ 0.0f, 0.0f, 0.0f });
+            columns.normalIndex.assign(cornerCount, 0);
+        }
+
+        // UV（最初のUVセット）
+        FbxGeometryElementUV* uvElement = mesh->GetElementUV(0);
+        if (uvElement)
+        {
+            FbxLayerElementArrayTemplate<FbxVector2>& direct = uvElement->GetDirectArray();
+            FbxLayerElementArrayReadLock<FbxVector2> lock(direct);
+            const FbxVector2* data = lock.GetData();
+            const int directCount = direct.GetCount();
+            columns.uvs.resize(size_t(directCount) + 1);
+            for (int i = 0; i < directCount; i++)
+            {
+                columns.uvs[i] = { (float)data[i][0], 1.0f - (float)data[i][1] };
+            }
+            columns.uvs[directCount] = Float2{ 0.0f, 0.0f };
+            if (!ResolveCornerIndices(uvElement, polygonVertices, cornerCount, directCount, columns.uvIndex,
+                columns.invalidCorners, pool))
+            {
+                columns.unsupportedLayers++;
+            }
+        }
+        else
+        {
+            columns.uvs.assign(1, Float2{ 0.0f, 0.0f });
+            columns.uvIndex.assign(cornerCount, 0);
+        }
+
+        return true;
+    }
+
+    bool ExtractSkin(FbxMesh* mesh, FbxNode* meshNode, FbxMeshColumns& columns)
+    {
+        columns.skin.clear();
+        columns.joints.clear();
+
+        const size_t controlPointCount = columns.positions.size();
+        std::vector<SkinWeights> skin(controlPointCount, SkinWeights{});
+        const int skinCount = mesh->GetDeformerCount(FbxDeformer::eSkin);
+        for (int d = 0; d < skinCount; d++)
+        {
+            FbxSkin* fbxSkin = static_cast<FbxSkin*>(mesh->GetDeformer(d, FbxDeformer::eSkin));
+            for (int c = 0; c < fbxSkin->GetClusterCount(); c++)
+            {
+                FbxCluster* cluster = fbxSkin->GetCluster(c);
+                FbxNode* link = cluster->GetLink();
+                const int count = cluster->GetControlPointIndicesCount();
+                if (!link || count <= 0) continue;
+                if (columns.joints.size() >= 0xfffe) break;    // 1つはメッシュ自身の関節用に空けておく
+
+                // バインド時のメッシュのグローバル行列を関節のグローバル行列で割る
+                // （ジオメトリック変換は位置に焼き込み済みなので掛けない）
+                FbxAMatrix meshBind, linkBind;
+                cluster->GetTransformMatrix(meshBind);
+                cluster->GetTransformLinkMatrix(linkBind);
+                FbxSkinJoint joint;
+                joint.node = link;
+                StoreMatrix(linkBind.Inverse() * meshBind, joint.inverseBind);
+
+                // リンクモード（eNormalize / eTotalOne / eAdditive）によらず、最後に合計 1 へ正規化する
+                const uint16_t jointIndex = uint16_t(columns.joints.size());
+                columns.joints.push_back(joint);
+                const int* indices = cluster->GetControlPointIndices();
+                const double* weights = cluster->GetControlPointWeights();
+                for (int i = 0; i < count; i++)
+                {
+                    const float weight = (float)weights[i];
+                    if (indices[i] < 0 || size_t(indices[i]) >= controlPointCount || !(weight > 0.0f)) continue;
+                    InsertInfluence(skin[indices[i]], jointIndex, weight);
+                }
+            }
+        }
+        if (columns.joints.empty()) return false;
+
+        // どの関節も効いていないポイントはメッシュ自身のノードに付ける（スキンなしのときと同じ位置に出る）
+        uint16_t selfJoint = 0xffff;
+        for (SkinWeights& s : skin)
+        {
+            const float sum = s.weights[0] + s.weights[1] + s.weights[2] + s.weights[3];
+            if (sum > 0.0f)
+            {
+                for (float& weight : s.weights) weight /= sum;
+                continue;
+            }
+            if (selfJoint == 0xffff)
+            {
+                selfJoint = uint16_t(columns.joints.size());
+                FbxSkinJoint joint;
+                joint.node = meshNode;
+                StoreMatrix(FbxAMatrix(), joint.inverseBind);
+                columns.joints.push_back(joint);
+            }
+            s.joints[0] = selfJoint;
+            s.weights[0] = 1.0f;
+        }
+
+        columns.skin = std::move(skin);
+        return true;
+    }
+
+    void TransformColumns(FbxMeshColumns& columns, const FbxAMatrix& transform)
+    {
+        for (Float3& p : columns.positions)
+        {
+            FbxVector4 v = transform.MultT(FbxVector4(p.x, p.y, p.z, 1.0));
+            p = { (float)v[0], (float)v[1], (float)v[2] };
+        }
+
+        // 法線は線形部分の逆転置で変換する。列ベクトル a0,a1,a2 の余因子行列
+        // [a1×a2 | a2×a0 | a0×a1] は逆転置の det 倍なので、向きを det の符号で揃えて正規化すればよい
+        const FbxVector4 origin = transform.MultT(FbxVector4(0.0, 0.0, 0.0, 1.0));
+        const FbxVector4 a0 = transform.MultT(FbxVector4(1.0, 0.0, 0.0, 1.0)) - origin;
+        const FbxVector4 a1 = transform.MultT(FbxVector4(0.0, 1.0, 0.0, 1.0)) - origin;
+        const FbxVector4 a2 = transform.MultT(FbxVector4(0.0, 0.0, 1.0, 1.0)) - origin;
+        const FbxVector4 c0 = a1.CrossProduct(a2);
+        const FbxVector4 c1 = a2.CrossProduct(a0);
+        const FbxVector4 c2 = a0.CrossProduct(a1);
+        const double sign = a0.DotProduct(c0) < 0.0 ? -1.0 : 1.0;
+
+        for (Float3& n : columns.normals)
+        {
+            FbxVector4 v = (c0 * n.x + c1 * n.y + c2 * n.z) * sign;
+            v[3] = 0.0;
+            v.Normalize();
+            n = { (float)v[0], (float)v[1], (float)v[2] };
+        }
+    }
+
+    void AssembleVertices(const FbxMeshColumns& columns, MeshData& mesh, ThreadPool* pool)
+    {
+        const size_t cornerCount = columns.CornerCount();
+        mesh.vertices.resize(cornerCount);
+        mesh.indices.resize(cornerCount);
+
+        auto assemble = [&](size_t begin, size_t end)
+        {
+            const Float3* positions = columns.positions.data();
+            const Float3* normals = columns.normals.data();
+            const Float2* uvs = columns.uvs.data();
+            for (size_t c = begin; c < end; c++)
+            {
+                MeshVertex& v = mesh.vertices[c];
+                v.pos = positions[columns.positionIndex[c]];
+                v.normal = normals[columns.normalIndex[c]];
+                v.uv = uvs[columns.uvIndex[c]];
+                v.skin = columns.skin.empty() ? SkinWeights{} : columns.skin[columns.positionIndex[c]];
+                mesh.indices[c] = uint32_t(c);
+            }
+        };
+        if (pool) pool->ParallelFor(cornerCount, kParallelChunk, assemble);
+        else assemble(size_t(0), cornerCount);
+    }
+
+    void ExtractVerticesPerCorner(FbxMesh* fbxMesh, MeshData& mesh)
+    {
+        mesh.vertices.clear();
+        mesh.indices.clear();
+        const int polyCount = fbxMesh->GetPolygonCount();
+        for (int p = 0; p < polyCount; p++)
+        {
+            // 常に三角形
+            for (int v = 0; v < 3; v++)
+            {
+                MeshVertex vert{};
+
+                int ctrlIdx = fbxMesh->GetPolygonVertex(p, v);
+
+                // 位置
+                FbxVector4 pos = fbxMesh->GetControlPointAt(ctrlIdx);
+                vert.pos = { (float)pos[0], (float)pos[1], (float)pos[2] };
+
+                // 法線
+                FbxVector4 normal;
+                if (fbxMesh->GetPolygonVertexNormal(p, v, normal))
+                {
+                    vert.normal = { (float)normal[0], (float)normal[1], (float)normal[2] };
+                }
+
+                // UV
+                FbxStringList uvNames;
+                fbxMesh->GetUVSetNames(uvNames);
+                if (uvNames.GetCount() > 0)
+                {
+                    const char* uvName = uvNames[0];
+                    FbxVector2 uv;
+                    bool unmapped;
+                    if (fbxMesh->GetPolygonVertexUV(p, v, uvName, uv, unmapped))
+                    {
+                        vert.uv = { (float)uv[0], 1.0f - (float)uv[1] };
+                    }
+                }
+                mesh.vertices.push_back(vert);
+                mesh.indices.push_back(static_cast<uint32_t>(mesh.vertices.size() - 1));
+            }
+        }
+    }
+
+    BenchmarkResult RunBenchmark(FbxScene* scene, ThreadPool* pool, int iterations)
+    {
+        BenchmarkResult result;
+        result.threadCount = pool ? pool->GetThreadCount() : 1;
+        std::vector<FbxMesh*> meshes;
+        if (scene->GetRootNode()) CollectMeshes(scene->GetRootNode(), meshes);
+        result.meshCount = meshes.size();
+        for (FbxMesh* mesh : meshes) result.cornerCount += size_t(mesh->GetPolygonVertexCount());
+
+        for (int i = 0; i < iterations; i++)
+        {
+            double perCornerMs = 0.0, extractMs = 0.0, assembleMs = 0.0;
+            for (FbxMesh* fbxMesh : meshes)
+            {
+                MeshData reference, assembled;
+                auto start = std::chrono::steady_clock::now();
+                ExtractVerticesPerCorner(fbxMesh, reference);
+                perCornerMs += ElapsedMs(start);
+
+                start = std::chrono::steady_clock::now();
+                FbxMeshColumns columns;
+                ExtractColumns(fbxMesh, columns, pool);
+                extractMs += ElapsedMs(start);
+
+                start = std::chrono::steady_clock::now();
+                AssembleVertices(columns, assembled, pool);
+                assembleMs += ElapsedMs(start);
+
+                if (i == 0)
+                {
+                    bool same = reference.vertices.size() == assembled.vertices.size();
+                    for (size_t v = 0; same && v < reference.vertices.size(); v++)
+                    {
+                        same = SameAttributes(reference.vertices[v], assembled.vertices[v]);
+                    }
+                    result.matches = result.matches && same;
+                }
+            }
+            result.perCornerMs = i == 0 ? perCornerMs : std::min(result.perCornerMs, perCornerMs);
+            result.extractMs = i == 0 ? extractMs : std::min(result.extractMs, extractMs);
+            result.assembleMs = i == 0 ? assembleMs : std::min(result.assembleMs, assembleMs);
+        }
+        return result;
+    }
+}
@@ -0,0 +1,77 @@
+﻿#pragma once
+#include <cstddef>
+#include <vector>
+#include "MeshData.h"
+
+namespace fbxsdk { class FbxMesh; class FbxNode; class FbxAMatrix; class FbxScene; }
+class ThreadPool;
+
+// スキンの関節（SkinWeights::joints の番号はこの並びの位置）
+struct FbxSkinJoint
+{
+    fbxsdk::FbxNode* node;          // 関節のノード（ウェイトのないポイント用にメッシュ自身のノードのこともある）
+    float inverseBind[4][4];        // バインドポーズのメッシュ空間 -> 関節空間（行ベクトル形式）
+};
+
+// FBXメッシュの頂点属性を列（属性ごとの配列）としてまとめて読み出す
+// 1頂点ずつ GetPolygonVertexNormal などを呼ぶ代わりに、レイヤー要素の配列を一括で参照する
+struct FbxMeshColumns
+{
+    std::vector<Float3> positions;      // コントロールポイント
+    std::vector<Float3> normals;        // 法線要素の DirectArray + 既定値 (0, 0, 0)
+    std::vector<Float2> uvs;            // 最初のUVセットの DirectArray（V反転済み）+ 既定値 (0, 0)
+
+    // コーナー（三角形の頂点）ごとの各列への参照
+    std::vector<int> positionIndex;
+    std::vector<int> normalIndex;
+    std::vector<int> uvIndex;
+
+    // コントロールポイントごとのスキンウェイトと関節（スキンなしなら空）
+    std::vector<SkinWeights> skin;
+    std::vector<FbxSkinJoint> joints;
+
+    // 法線/UV を既定値にしたコーナーの数（両方の合計）と、未対応のマッピングで読まなかったレイヤーの数
+    size_t invalidCorners = 0;
+    size_t unsupportedLayers = 0;
+
+    size_t CornerCount() const { return positionIndex.size(); }
+};
+
+namespace FbxMeshExtractor
+{
+    // 三角形化済みのメッシュから列データを読み出す（三角形以外や範囲外のコントロールポイントを含む場合は false）
+    // 法線/UV の参照が DirectArray の範囲外のコーナーと、未対応のマッピングのレイヤーは既定値にする
+    // pool があれば大きなメッシュのコーナーの参照を並列に解決する
+    bool ExtractColumns(fbxsdk::FbxMesh* mesh, FbxMeshColumns& columns, ThreadPool* pool = nullptr);
+
+    // FbxSkin のクラスタからコントロールポイントごとの上位4つのウェイトを読み、合計 1 に正規化する
+    // 逆バインド行列はジオメトリック変換を焼き込んだ後の位置に掛かる（スキンがなければ false）
+    bool ExtractSkin(fbxsdk::FbxMesh* mesh, fbxsdk::FbxNode* meshNode, FbxMeshColumns& columns);
+
+    // 位置と法線の列に行列を掛ける（ノードのジオメトリック変換の焼き込み用）
+    void TransformColumns(FbxMeshColumns& columns, const fbxsdk::FbxAMatrix& transform);
+
+    // 列データから頂点を組み立てる（コーナーごとに1頂点・インデックスは連番）
+    // pool があれば大きなメッシュは並列に処理する
+    void AssembleVertices(const FbxMeshColumns& columns, MeshData& mesh, ThreadPool* pool = nullptr);
+
+    // 1コーナーずつ GetPolygonVertex / GetControlPointAt / GetPolygonVertexNormal / GetPolygonVertexUV で読む
+    // 列の一括読み出しに置き換える前の方法（RunBenchmark の比較用。スキンとジオメトリック変換は扱わない）
+    void ExtractVerticesPerCorner(fbxsdk::FbxMesh* fbxMesh, MeshData& mesh);
+
+    struct BenchmarkResult
+    {
+        size_t meshCount = 0;
+        size_t cornerCount = 0;
+        size_t threadCount = 0;
+        // 全メッシュの合計（最も速かった回）
+        double perCornerMs = 0.0;
+        double extractMs = 0.0;     // ExtractColumns
+        double assembleMs = 0.0;    // AssembleVertices
+        bool matches = true;        // 2つの方法で組み立てた頂点の位置/法線/UV が一致したか
+    };
+
+    // 三角形化済みのシーンの全メッシュで、1コーナーずつの読み出しと列の読み出し + 組み立てを比べる
+    // pool があれば列の読み出しと組み立てを並列に行う（threadCount はその並列数）
+    BenchmarkResult RunBenchmark(fbxsdk::FbxScene* scene, ThreadPool* pool, int iterations = 5);
+}
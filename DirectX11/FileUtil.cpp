@@ -0,0 +1,77 @@
+﻿#include "FileUtil.h"
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+bool WriteFileAtomic(const std::filesystem::path& path, const void* data, size_t size)
+{
+    namespace fs = std::filesystem;
+
+    // 同じ出力先に複数のスレッド/プロセスが書いても衝突しない一時ファイル名
+    static std::atomic<unsigned> counter{ 0 };
+    size_t unique = std::hash<std::thread::id>{}(std::this_thread::get_id())
+        ^ size_t(std::chrono::steady_clock::now().time_since_epoch().count())
+        ^ (size_t(counter++) << 20);
+    fs::path tempPath = path;
+    tempPath += ".tmp" + std::to_string(unique);
+
+    std::error_code ec;
+    fs::path parent = path.parent_path();
+    if (!parent.empty()) fs::create_directories(parent, ec);
+
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        out.write(static_cast<const char*>(data), std::streamsize(size));
+        if (!out)
+        {
+            out.close();
+            fs::remove(tempPath, ec);
+            return false;
+        }
+    }
+
+    fs::rename(tempPath, path, ec);
+    if (ec)
+    {
+        fs::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+bool ReadFileBytes(const std::filesystem::path& path, std::vector<unsigned char>& bytes)
+{
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) return false;
+
+    std::streamsize size = in.tellg();
+    in.seekg(0);
+    bytes.resize(size_t(size));
+    return size == 0 || bool(in.read(reinterpret_cast<char*>(bytes.data()), size));
+}
+
+bool DropFileCache(const std::filesystem::path& path)
+{
+#ifdef _WIN32
+    (void)path;
+    return false;
+#else
+    const int file = open(path.c_str(), O_RDONLY);
+    if (file < 0) return false;
+    // 書いたばかりのページは汚れていると追い出されないので、先に書き戻す
+    fdatasync(file);
+    const bool dropped = posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(file);
+    return dropped;
+#endif
+}
@@ -0,0 +1,14 @@
+﻿#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+
+// 一時ファイルへ書いてからリネームする（他プロセスが途中まで書かれたファイルを見ることはない）
+bool WriteFileAtomic(const std::filesystem::path& path, const void* data, size_t size);
+
+// ファイル全体を読み込む
+bool ReadFileBytes(const std::filesystem::path& path, std::vector<unsigned char>& bytes);
+
+// ファイルの内容を OS のページキャッシュから追い出す（次の読み込みをディスクからにする。ベンチマーク用）
+// POSIX のみ。他の環境や失敗したときは false
+bool DropFileCache(const std::filesystem::path& path);
@@ -0,0 +1,24 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// 64bit の非暗号学的ハッシュ（xxHash64 と同じアルゴリズム）
+// クックデータのチェックサムやキャッシュキーに使う
+uint64_t Hash64(const void* data, size_t size, uint64_t seed = 0);
+
+// 複数のデータを順に混ぜ込むためのハッシュ
+class Hasher
+{
+public:
+    explicit Hasher(uint64_t seed = 0) : mHash(seed) {}
+
+    void Add(const void* data, size_t size) { mHash = Hash64(data, size, mHash); }
+
+    template <class T>
+    void AddValue(const T& value) { Add(&value, sizeof(T)); }
+
+    uint64_t Get() const { return mHash; }
+
+private:
+    uint64_t mHash;
+};
@@ -0,0 +1,75 @@
+﻿#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ピクセルの並び（BC は 4x4 画素のブロック単位。D3D11 の DXGI_FORMAT_BCn_UNORM と同じ並び）
+enum class PixelFormat : uint32_t
+{
+    RGBA8,
+    BC1,        // RGB、1ブロック 8 バイト（アルファなし）
+    BC3,        // RGBA、16 バイト（BC4 のアルファ + BC1 の色）
+    BC5,        // RG、16 バイト（BC4 x 2。法線マップの xy）
+    BC7,        // RGBA、16 バイト
+};
+
+// 1段分の画像（行は詰めて並ぶ: RGBA8 は pitch = width * 4、BC はブロックの行ごと）
+// デコーダーや MipGenerator が作るのは常に RGBA8。BlockCompression が BC に変換する
+struct ImageData
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    PixelFormat format = PixelFormat::RGBA8;
+    std::vector<uint8_t> pixels;
+};
+
+inline bool IsBlockCompressed(PixelFormat format)
+{
+    return format != PixelFormat::RGBA8;
+}
+
+// 1行（BC はブロックの1行）のバイト数
+inline size_t RowPitch(PixelFormat format, uint32_t width)
+{
+    if (!IsBlockCompressed(format)) return size_t(width) * 4;
+    return size_t((width + 3) / 4) * (format == PixelFormat::BC1 ? 8 : 16);
+}
+
+// 行（BC はブロックの行）の数
+inline uint32_t RowCount(PixelFormat format, uint32_t height)
+{
+    return IsBlockCompressed(format) ? (height + 3) / 4 : height;
+}
+
+inline size_t ImageSize(PixelFormat format, uint32_t width, uint32_t height)
+{
+    return RowPitch(format, width) * RowCount(format, height);
+}
+
+inline const char* GetPixelFormatName(PixelFormat format)
+{
+    switch (format)
+    {
+    case PixelFormat::RGBA8: return "RGBA8";
+    case PixelFormat::BC1: return "BC1";
+    case PixelFormat::BC3: return "BC3";
+    case PixelFormat::BC5: return "BC5";
+    case PixelFormat::BC7: return "BC7";
+    }
+    return "unknown";
+}
+
+// 各辺を半分（切り捨て、最小 1）にしていったときの 1x1 までの段数（元の大きさの段を含む）
+inline uint32_t MipLevelCount(uint32_t width, uint32_t height)
+{
+    uint32_t count = 1;
+    for (uint32_t size = std::max(width, height); size > 1; size >>= 1) count++;
+    return count;
+}
+
+// level 段目の辺の長さ
+inline uint32_t MipExtent(uint32_t size, uint32_t level)
+{
+    return std::max<uint32_t>(1, size >> level);
+}
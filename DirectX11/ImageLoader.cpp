@@ -0,0 +1,97 @@
+﻿#include "ImageLoader.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <wincodec.h>
+#include <wrl.h>
+#pragma comment(lib, "windowscodecs.lib")
+
+using Microsoft::WRL::ComPtr;
+
+bool DecodeImageRGBA8(const void* data, size_t size, ImageData& image, std::string& error)
+{
+    // WIC を使うには呼び出しスレッドで COM が初期化されている必要がある
+    ComPtr<IWICImagingFactory> factory;
+    HRESULT hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory));
+    if (FAILED(hr))
+    {
+        error = "WIC factory unavailable";
+        return false;
+    }
+
+    ComPtr<IWICStream> stream;
+    hr = factory->CreateStream(stream.GetAddressOf());
+    if (SUCCEEDED(hr)) hr = stream->InitializeFromMemory(static_cast<BYTE*>(const_cast<void*>(data)), DWORD(size));
+
+    ComPtr<IWICBitmapDecoder> decoder;
+    if (SUCCEEDED(hr)) hr = factory->CreateDecoderFromStream(stream.Get(), nullptr, WICDecodeMetadataCacheOnDemand, decoder.GetAddressOf());
+
+    ComPtr<IWICBitmapFrameDecode> frame;
+    if (SUCCEEDED(hr)) hr = decoder->GetFrame(0, frame.GetAddressOf());
+
+    UINT width = 0, height = 0;
+    if (SUCCEEDED(hr)) hr = frame->GetSize(&width, &height);
+
+    // どの入力形式でも 32bit RGBA に変換して取り出す
+    ComPtr<IWICFormatConverter> converter;
+    if (SUCCEEDED(hr)) hr = factory->CreateFormatConverter(converter.GetAddressOf());
+    if (SUCCEEDED(hr))
+    {
+        hr = converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppRGBA,
+            WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom);
+    }
+    if (FAILED(hr))
+    {
+        error = "image decode failed";
+        return false;
+    }
+
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(size_t(width) * height * 4);
+    hr = converter->CopyPixels(nullptr, width * 4, UINT(image.pixels.size()), image.pixels.data());
+    if (FAILED(hr))
+    {
+        error = "image decode failed";
+        return false;
+    }
+    return true;
+}
+
+#elif defined(IMAGELOADER_LIBPNG)
+#include <png.h>
+
+// Windows 以外（ヘッドレスのクッカーなど）では libpng で PNG だけを展開する
+bool DecodeImageRGBA8(const void* data, size_t size, ImageData& image, std::string& error)
+{
+    png_image png{};
+    png.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_memory(&png, data, size))
+    {
+        error = std::string("image decode failed: ") + png.message;
+        return false;
+    }
+
+    // どの入力形式でも 32bit RGBA に変換して取り出す
+    png.format = PNG_FORMAT_RGBA;
+    image.width = png.width;
+    image.height = png.height;
+    image.pixels.resize(PNG_IMAGE_SIZE(png));
+    if (!png_image_finish_read(&png, nullptr, image.pixels.data(), 0, nullptr))
+    {
+        error = std::string("image decode failed: ") + png.message;
+        png_image_free(&png);
+        return false;
+    }
+    return true;
+}
+
+#else
+
+bool DecodeImageRGBA8(const void*, size_t, ImageData&, std::string& error)
+{
+    error = "image decoding is not available on this platform";
+    return false;
+}
+
+#endif
@@ -0,0 +1,12 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ImageData.h"
+
+// 展開結果が変わる修正をしたら上げる（派生データキャッシュのキーに含まれる）
+constexpr uint32_t kImageDecoderVersion = 1;
+
+// PNG などの画像ファイルのバイト列を RGBA8 に展開する（Windows では WIC、それ以外では libpng があれば PNG のみ）
+bool DecodeImageRGBA8(const void* data, size_t size, ImageData& image, std::string& error);
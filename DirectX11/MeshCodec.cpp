@@ -0,0 +1,556 @@
+﻿#include "MeshCodec.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include "MeshOptimizer.h"
+#include "VertexPacking.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MESH_CODEC_SSE2 1
+#endif
+
+namespace
+{
+    constexpr uint8_t kIndexCodecVersion = 1;
+    constexpr uint8_t kVertexCodecVersion = 1;
+
+    // ---- インデックス ----
+
+    constexpr uint32_t kEdgeFifoSize = 16;
+    constexpr uint32_t kVertexFifoSize = 16;
+    constexpr uint32_t kEdgeLookup = 15;        // 上位4bit: 0-14 は辺FIFOの位置、15 は共有辺なし
+    constexpr uint32_t kVertexLookup = 14;      // 下位4bit: 0 は次の新頂点、1-14 は頂点FIFOの位置、15 は差分を直接書く
+    constexpr uint8_t kCodeNoEdge = 0xF;
+    constexpr uint8_t kRefNext = 0;
+    constexpr uint8_t kRefExplicit = 0xF;
+
+    // 符号化/展開で共有する状態（両者が同じ順で更新する）
+    struct IndexCodecState
+    {
+        uint32_t edges[kEdgeFifoSize][2] = {};
+        uint32_t vertices[kVertexFifoSize] = {};
+        uint32_t edgeOffset = 0;
+        uint32_t vertexOffset = 0;
+        uint32_t next = 0;      // まだ現れていない頂点のうち最小の番号（と期待する値）
+        uint32_t last = 0;      // 直接書いた最後の頂点（差分の基準）
+
+        // FIFO の i 番目（0 が最新）
+        const uint32_t* Edge(uint32_t i) const { return edges[(edgeOffset - 1 - i) & (kEdgeFifoSize - 1)]; }
+        uint32_t Vertex(uint32_t i) const { return vertices[(vertexOffset - 1 - i) & (kVertexFifoSize - 1)]; }
+
+        void PushEdge(uint32_t a, uint32_t b)
+        {
+            uint32_t* e = edges[edgeOffset & (kEdgeFifoSize - 1)];
+            e[0] = a;
+            e[1] = b;
+            edgeOffset++;
+        }
+
+        void PushVertex(uint32_t v)
+        {
+            vertices[vertexOffset & (kVertexFifoSize - 1)] = v;
+            vertexOffset++;
+        }
+
+        // 三角形 (a, b, c) の辺を、隣の三角形から見た向き（逆向き）で積む
+        void PushTriangleEdges(uint32_t a, uint32_t b, uint32_t c)
+        {
+            PushEdge(b, a);
+            PushEdge(c, b);
+            PushEdge(a, c);
+        }
+    };
+
+    uint32_t ZigZag(int32_t v) { return (uint32_t(v) << 1) ^ uint32_t(v >> 31); }
+    int32_t UnZigZag(uint32_t v) { return int32_t(v >> 1) ^ -int32_t(v & 1); }
+
+    void WriteVarint(std::vector<uint8_t>& out, uint32_t v)
+    {
+        while (v >= 0x80)
+        {
+            out.push_back(uint8_t(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back(uint8_t(v));
+    }
+
+    bool ReadVarint(const uint8_t*& p, const uint8_t* end, uint32_t& v)
+    {
+        v = 0;
+        for (int shift = 0; shift < 35; shift += 7)
+        {
+            if (p == end) return false;
+            uint8_t b = *p++;
+            v |= uint32_t(b & 0x7f) << shift;
+            if (b < 0x80) return true;
+        }
+        return false;
+    }
+
+    // 頂点1つ分の参照を決めて状態を進める（explicit のとき差分を delta に返す）
+    uint8_t EncodeVertexRef(IndexCodecState& state, uint32_t v, uint32_t& delta)
+    {
+        if (v == state.next)
+        {
+            state.next++;
+            state.PushVertex(v);
+            return kRefNext;
+        }
+        for (uint32_t i = 0; i < kVertexLookup; i++)
+        {
+            if (state.Vertex(i) == v) return uint8_t(i + 1);
+        }
+        delta = ZigZag(int32_t(v - state.last));
+        state.last = v;
+        state.PushVertex(v);
+        return kRefExplicit;
+    }
+
+    bool DecodeVertexRef(IndexCodecState& state, uint8_t ref, const uint8_t*& p, const uint8_t* end, uint32_t& v)
+    {
+        if (ref == kRefNext)
+        {
+            v = state.next++;
+            state.PushVertex(v);
+        }
+        else if (ref == kRefExplicit)
+        {
+            uint32_t delta;
+            if (!ReadVarint(p, end, delta)) return false;
+            v = state.last + uint32_t(UnZigZag(delta));
+            state.last = v;
+            state.PushVertex(v);
+        }
+        else
+        {
+            v = state.Vertex(ref - 1u);
+        }
+        return true;
+    }
+
+    // ---- 頂点 ----
+
+    constexpr size_t kVertexBlockMaxSize = 8192;    // 1ブロックの最大バイト数（L1に収まる程度）
+    constexpr size_t kVertexBlockMaxCount = 256;
+    constexpr size_t kGroupSize = 16;
+    const uint8_t kGroupBits[4] = { 0, 2, 4, 8 };
+
+    size_t VertexBlockCount(size_t stride)
+    {
+        // グループ単位で割り切れるよう 16 の倍数にする
+        size_t count = std::min(kVertexBlockMaxCount, kVertexBlockMaxSize / stride);
+        return std::max(kGroupSize, count & ~(kGroupSize - 1));
+    }
+
+    // 1グループ（16バイト）を bits ずつ詰める
+    // 値 i はバイト i % (16 * bits / 8) の (i / (16 * bits / 8)) * bits ビット目から置く
+    // （展開時にバイト単位のマスクとシフトだけで 4〜8 値ずつまとめて取り出せる並び）
+    void PackGroup(const uint8_t* values, uint32_t bits, std::vector<uint8_t>& out)
+    {
+        if (bits == 0) return;
+        if (bits == 8)
+        {
+            out.insert(out.end(), values, values + kGroupSize);
+            return;
+        }
+        const size_t byteCount = kGroupSize * bits / 8;
+        for (size_t i = 0; i < byteCount; i++)
+        {
+            uint8_t b = 0;
+            for (uint32_t shift = 0, j = uint32_t(i); shift < 8; shift += bits, j += uint32_t(byteCount))
+            {
+                b |= uint8_t(values[j] << shift);
+            }
+            out.push_back(b);
+        }
+    }
+
+    const uint8_t* UnpackGroup(const uint8_t* p, uint32_t bits, uint8_t* values)
+    {
+        switch (bits)
+        {
+        case 0:
+            std::memset(values, 0, kGroupSize);
+            return p;
+        case 2:
+        {
+            uint32_t x;
+            std::memcpy(&x, p, sizeof(x));
+            for (uint32_t j = 0; j < 4; j++)
+            {
+                uint32_t v = (x >> (j * 2)) & 0x03030303u;
+                std::memcpy(values + j * 4, &v, sizeof(v));
+            }
+            return p + 4;
+        }
+        case 4:
+        {
+            uint64_t x;
+            std::memcpy(&x, p, sizeof(x));
+            uint64_t lo = x & 0x0F0F0F0F0F0F0F0Full;
+            uint64_t hi = (x >> 4) & 0x0F0F0F0F0F0F0F0Full;
+            std::memcpy(values, &lo, sizeof(lo));
+            std::memcpy(values + 8, &hi, sizeof(hi));
+            return p + 8;
+        }
+        default:
+            std::memcpy(values, p, kGroupSize);
+            return p + kGroupSize;
+        }
+    }
+
+    uint8_t ZigZag8(uint8_t v) { return uint8_t((v << 1) ^ uint8_t(int8_t(v) >> 7)); }
+    uint8_t UnZigZag8(uint8_t v) { return uint8_t((v >> 1) ^ uint8_t(-int8_t(v & 1))); }
+
+    // 列ごとに展開した差分を頂点の並びに戻しながら足し込む（prev は列ごとの直前の値）
+    // columns は列 k の頂点 v が columns[k * columnPitch + v] にある
+    void ReconstructScalar(const uint8_t* columns, size_t columnPitch, size_t firstVertex, size_t vertexCount,
+        size_t firstColumn, size_t columnCount, uint8_t* prev, uint8_t* dst, size_t stride)
+    {
+        for (size_t v = firstVertex; v < firstVertex + vertexCount; v++)
+        {
+            uint8_t* out = dst + v * stride;
+            for (size_t k = firstColumn; k < firstColumn + columnCount; k++)
+            {
+                prev[k] = uint8_t(prev[k] + UnZigZag8(columns[k * columnPitch + v]));
+                out[k] = prev[k];
+            }
+        }
+    }
+
+#ifdef MESH_CODEC_SSE2
+    // 16列 x 16頂点のタイルを転置し、頂点ごとに16バイトずつ足し込んで書き出す
+    // 戻り値は最後の頂点の値（次のタイルの基準）
+    __m128i ReconstructTileSSE2(const uint8_t* columns, size_t columnPitch, __m128i prev, uint8_t* dst, size_t stride)
+    {
+        __m128i x[16], y[16];
+        for (int i = 0; i < 16; i++) x[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(columns + i * columnPitch));
+
+        // 8/16/32/64bit 単位の interleave を4回で転置（結果は添字のビット反転順に並ぶ）
+        for (int i = 0; i < 8; i++) { y[i] = _mm_unpacklo_epi8(x[2 * i], x[2 * i + 1]); y[i + 8] = _mm_unpackhi_epi8(x[2 * i], x[2 * i + 1]); }
+        for (int i = 0; i < 8; i++) { x[i] = _mm_unpacklo_epi16(y[2 * i], y[2 * i + 1]); x[i + 8] = _mm_unpackhi_epi16(y[2 * i], y[2 * i + 1]); }
+        for (int i = 0; i < 8; i++) { y[i] = _mm_unpacklo_epi32(x[2 * i], x[2 * i + 1]); y[i + 8] = _mm_unpackhi_epi32(x[2 * i], x[2 * i + 1]); }
+        for (int i = 0; i < 8; i++) { x[i] = _mm_unpacklo_epi64(y[2 * i], y[2 * i + 1]); x[i + 8] = _mm_unpackhi_epi64(y[2 * i], y[2 * i + 1]); }
+
+        static const int kBitReverse[16] = { 0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15 };
+        const __m128i one = _mm_set1_epi8(1);
+        const __m128i low7 = _mm_set1_epi8(0x7f);
+        for (int v = 0; v < 16; v++)
+        {
+            __m128i z = x[kBitReverse[v]];
+            __m128i delta = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(z, 1), low7),
+                _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(z, one)));
+            prev = _mm_add_epi8(prev, delta);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + v * stride), prev);
+        }
+        return prev;
+    }
+#endif
+}
+
+namespace MeshCodec
+{
+    void EncodeIndexBuffer(const uint32_t* indices, size_t indexCount, std::vector<uint8_t>& out)
+    {
+        out.clear();
+        out.reserve(indexCount + 16);
+        out.push_back(kIndexCodecVersion);
+
+        IndexCodecState state;
+        std::vector<uint32_t> deltas;
+        for (size_t i = 0; i + 2 < indexCount; i += 3)
+        {
+            const uint32_t tri[3] = { indices[i], indices[i + 1], indices[i + 2] };
+
+            // 3通りの回転のどれかで辺FIFOに当たれば、残りの1頂点だけ書けばよい
+            uint32_t edge = kEdgeLookup;
+            uint32_t rotation = 0;
+            for (uint32_t r = 0; r < 3 && edge == kEdgeLookup; r++)
+            {
+                for (uint32_t e = 0; e < kEdgeLookup; e++)
+                {
+                    const uint32_t* fifo = state.Edge(e);
+                    if (fifo[0] == tri[r] && fifo[1] == tri[(r + 1) % 3])
+                    {
+                        edge = e;
+                        rotation = r;
+                        break;
+                    }
+                }
+            }
+
+            if (edge != kEdgeLookup)
+            {
+                const uint32_t a = tri[rotation], b = tri[(rotation + 1) % 3], c = tri[(rotation + 2) % 3];
+                uint32_t delta = 0;
+                uint8_t ref = EncodeVertexRef(state, c, delta);
+                out.push_back(uint8_t(edge << 4 | ref));
+                if (ref == kRefExplicit) WriteVarint(out, delta);
+
+                // (b, a) は今使った辺なので積み直さない
+                state.PushEdge(c, b);
+                state.PushEdge(a, c);
+            }
+            else
+            {
+                uint32_t delta[3] = {};
+                uint8_t ref[3];
+                for (int k = 0; k < 3; k++) ref[k] = EncodeVertexRef(state, tri[k], delta[k]);
+
+                out.push_back(uint8_t(kCodeNoEdge << 4 | ref[0]));
+                out.push_back(uint8_t(ref[1] << 4 | ref[2]));
+                for (int k = 0; k < 3; k++)
+                {
+                    if (ref[k] == kRefExplicit) WriteVarint(out, delta[k]);
+                }
+                state.PushTriangleEdges(tri[0], tri[1], tri[2]);
+            }
+        }
+    }
+
+    bool DecodeIndexBuffer(uint32_t* indices, size_t indexCount, const uint8_t* data, size_t size)
+    {
+        if (indexCount % 3 != 0 || size < 1 || data[0] != kIndexCodecVersion) return false;
+        const uint8_t* p = data + 1;
+        const uint8_t* end = data + size;
+
+        IndexCodecState state;
+        for (size_t i = 0; i < indexCount; i += 3)
+        {
+            if (p == end) return false;
+            const uint8_t code = *p++;
+            const uint32_t edge = code >> 4;
+
+            if (edge != kCodeNoEdge)
+            {
+                const uint32_t* e = state.Edge(edge);
+                const uint32_t a = e[0], b = e[1];
+                uint32_t c;
+                if (!DecodeVertexRef(state, code & 0xF, p, end, c)) return false;
+
+                indices[i] = a;
+                indices[i + 1] = b;
+                indices[i + 2] = c;
+                state.PushEdge(c, b);
+                state.PushEdge(a, c);
+            }
+            else
+            {
+                if (p == end) return false;
+                const uint8_t refs = *p++;
+                uint32_t a, b, c;
+                if (!DecodeVertexRef(state, code & 0xF, p, end, a) ||
+                    !DecodeVertexRef(state, refs >> 4, p, end, b) ||
+                    !DecodeVertexRef(state, refs & 0xF, p, end, c))
+                {
+                    return false;
+                }
+
+                indices[i] = a;
+                indices[i + 1] = b;
+                indices[i + 2] = c;
+                state.PushTriangleEdges(a, b, c);
+            }
+        }
+        return p == end;
+    }
+
+    void EncodeVertexBuffer(const void* vertices, size_t vertexCount, size_t stride, std::vector<uint8_t>& out)
+    {
+        out.clear();
+        out.reserve(vertexCount * stride / 2 + 16);
+        out.push_back(kVertexCodecVersion);
+
+        const uint8_t* src = static_cast<const uint8_t*>(vertices);
+        const size_t blockCount = VertexBlockCount(stride);
+        std::vector<uint8_t> last(stride, 0);       // 前のブロックの最後の頂点（差分の基準）
+        std::vector<uint8_t> column(blockCount);
+
+        for (size_t base = 0; base < vertexCount; base += blockCount)
+        {
+            const size_t count = std::min(blockCount, vertexCount - base);
+            const size_t groupCount = (count + kGroupSize - 1) / kGroupSize;
+
+            for (size_t k = 0; k < stride; k++)
+            {
+                // バイト位置 k の列を取り出して差分をとる（端数は 0 で埋める）
+                uint8_t prev = last[k];
+                for (size_t v = 0; v < count; v++)
+                {
+                    uint8_t value = src[(base + v) * stride + k];
+                    column[v] = ZigZag8(uint8_t(value - prev));
+                    prev = value;
+                }
+                std::fill(column.begin() + count, column.begin() + groupCount * kGroupSize, uint8_t(0));
+                last[k] = prev;
+
+                // グループごとの bit 幅（2bit ずつ4グループ分で1バイト）を先に並べる
+                const size_t headerOffset = out.size();
+                out.resize(out.size() + (groupCount + 3) / 4, 0);
+                for (size_t g = 0; g < groupCount; g++)
+                {
+                    uint8_t maxValue = 0;
+                    for (size_t j = 0; j < kGroupSize; j++) maxValue = std::max(maxValue, column[g * kGroupSize + j]);
+                    uint32_t mode = maxValue == 0 ? 0 : maxValue < 4 ? 1 : maxValue < 16 ? 2 : 3;
+
+                    out[headerOffset + g / 4] |= uint8_t(mode << ((g % 4) * 2));
+                    PackGroup(&column[g * kGroupSize], kGroupBits[mode], out);
+                }
+            }
+        }
+    }
+
+    bool DecodeVertexBuffer(void* vertices, size_t vertexCount, size_t stride, const uint8_t* data, size_t size)
+    {
+        if (stride == 0 || size < 1 || data[0] != kVertexCodecVersion) return false;
+        const uint8_t* p = data + 1;
+        const uint8_t* end = data + size;
+
+        uint8_t* dst = static_cast<uint8_t*>(vertices);
+        const size_t blockCount = VertexBlockCount(stride);
+        std::vector<uint8_t> last(stride, 0);
+        std::vector<uint8_t> columns(blockCount * stride);     // ブロック全体を列ごとに展開してから転置し直す
+
+        for (size_t base = 0; base < vertexCount; base += blockCount)
+        {
+            const size_t count = std::min(blockCount, vertexCount - base);
+            const size_t groupCount = (count + kGroupSize - 1) / kGroupSize;
+            const size_t headerSize = (groupCount + 3) / 4;
+
+            for (size_t k = 0; k < stride; k++)
+            {
+                if (size_t(end - p) < headerSize) return false;
+                const uint8_t* header = p;
+                p += headerSize;
+
+                uint8_t* column = &columns[k * blockCount];
+                for (size_t g = 0; g < groupCount; g++)
+                {
+                    const uint32_t bits = kGroupBits[(header[g / 4] >> ((g % 4) * 2)) & 3];
+                    if (size_t(end - p) < bits * kGroupSize / 8) return false;
+                    p = UnpackGroup(p, bits, column + g * kGroupSize);
+                }
+            }
+
+            uint8_t* blockDst = dst + base * stride;
+            size_t k = 0;
+#ifdef MESH_CODEC_SSE2
+            // 16列ずつ、16頂点単位のタイルで転置する（端数は下のスカラー処理）
+            const size_t tileVertices = count & ~(kGroupSize - 1);
+            for (; k + 16 <= stride; k += 16)
+            {
+                __m128i prev = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&last[k]));
+                for (size_t v = 0; v < tileVertices; v += 16)
+                {
+                    prev = ReconstructTileSSE2(&columns[k * blockCount + v], blockCount, prev, blockDst + v * stride + k, stride);
+                }
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(&last[k]), prev);
+                ReconstructScalar(columns.data(), blockCount, tileVertices, count - tileVertices, k, 16, last.data(), blockDst, stride);
+            }
+#endif
+            ReconstructScalar(columns.data(), blockCount, 0, count, k, stride - k, last.data(), blockDst, stride);
+        }
+        return p == end;
+    }
+
+    BenchmarkResult RunBenchmark(const void* vertices, size_t vertexCount, size_t stride, const uint32_t* indices,
+        size_t indexCount, int iterations)
+    {
+        // body を iterations 回実行して最も速かった回のバイト数 / 秒を返す
+        auto measure = [&](size_t bytes, auto body)
+        {
+            double best = 0.0;
+            for (int i = 0; i < iterations; i++)
+            {
+                auto start = std::chrono::steady_clock::now();
+                body();
+                const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                if (seconds > 0.0) best = std::max(best, double(bytes) / seconds * 1.0e-6);
+            }
+            return best;
+        };
+
+        BenchmarkResult result;
+        std::vector<uint8_t> encoded;
+
+        StreamBenchmark& v = result.vertices;
+        v.rawBytes = vertexCount * stride;
+        std::vector<uint8_t> decodedVertices(v.rawBytes);
+        v.encodeMegabytesPerSecond = measure(v.rawBytes, [&]() { EncodeVertexBuffer(vertices, vertexCount, stride, encoded); });
+        v.encodedBytes = encoded.size();
+        v.decodeMegabytesPerSecond = measure(v.rawBytes, [&]()
+        {
+            v.matches = DecodeVertexBuffer(decodedVertices.data(), vertexCount, stride, encoded.data(), encoded.size()) && v.matches;
+        });
+        v.matches = v.matches && std::memcmp(decodedVertices.data(), vertices, v.rawBytes) == 0;
+
+        StreamBenchmark& ix = result.indices;
+        ix.rawBytes = indexCount * sizeof(uint32_t);
+        std::vector<uint32_t> decodedIndices(indexCount);
+        ix.encodeMegabytesPerSecond = measure(ix.rawBytes, [&]() { EncodeIndexBuffer(indices, indexCount, encoded); });
+        ix.encodedBytes = encoded.size();
+        ix.decodeMegabytesPerSecond = measure(ix.rawBytes, [&]()
+        {
+            ix.matches = DecodeIndexBuffer(decodedIndices.data(), indexCount, encoded.data(), encoded.size()) && ix.matches;
+        });
+        for (size_t t = 0; ix.matches && t + 3 <= indexCount; t += 3)
+        {
+            const uint32_t* a = &indices[t];
+            const uint32_t* b = &decodedIndices[t];
+            bool rotated = false;
+            for (int r = 0; r < 3; r++)
+            {
+                rotated = rotated || (a[0] == b[r] && a[1] == b[(r + 1) % 3] && a[2] == b[(r + 2) % 3]);
+            }
+            ix.matches = rotated;
+        }
+        return result;
+    }
+
+    std::vector<CorpusBenchmarkMesh> RunCorpusBenchmark(int iterations)
+    {
+        struct Sample
+        {
+            std::string name;
+            MeshData mesh;
+        };
+        std::vector<Sample> samples;
+        for (uint32_t rings : { 16u, 48u, 128u, 256u })
+        {
+            const uint32_t segments = rings * 3 / 2;
+            samples.push_back({ "sphere " + std::to_string(rings) + "x" + std::to_string(segments),
+                MeshOptimizer::MakeBenchmarkSphere(rings, segments) });
+        }
+        for (uint32_t cells : { 16u, 64u, 256u, 512u })
+        {
+            samples.push_back({ "grid " + std::to_string(cells) + "x" + std::to_string(cells), MeshOptimizer::MakeBenchmarkGrid(cells) });
+        }
+
+        std::vector<CorpusBenchmarkMesh> results;
+        for (Sample& sample : samples)
+        {
+            MeshOptimizer::WeldVertices(sample.mesh);
+            MeshOptimizer::OptimizeVertexCache(sample.mesh.indices, sample.mesh.vertices.size());
+            for (VertexFormat format : { VertexFormat::Float32, VertexFormat::Packed16 })
+            {
+                // 頂点フェッチの並べ直しは頂点の大きさで結果が変わるので形式ごとに行う
+                MeshData mesh = sample.mesh;
+                const size_t stride = VertexFormatStride(format);
+                MeshOptimizer::OptimizeVertexFetch(mesh, stride);
+                std::vector<uint8_t> packed;
+                VertexPacking::PackVertices(mesh.vertices, format, VertexPacking::ComputeQuantization(mesh.vertices), packed);
+
+                CorpusBenchmarkMesh result;
+                result.name = sample.name;
+                result.format = format;
+                result.vertexCount = mesh.vertices.size();
+                result.triangleCount = mesh.indices.size() / 3;
+                result.result = RunBenchmark(packed.data(), mesh.vertices.size(), stride, mesh.indices.data(), mesh.indices.size(),
+                    iterations);
+                results.push_back(std::move(result));
+            }
+        }
+        return results;
+    }
+}
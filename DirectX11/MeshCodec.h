@@ -0,0 +1,58 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MeshData.h"
+
+// クック済みメッシュの頂点/インデックス列の可逆圧縮（CPUのみ・D3D非依存）
+// 展開はロード時に毎回走るので、圧縮率より展開速度を優先した単純な符号にしている
+namespace MeshCodec
+{
+    // インデックス列（三角形リスト）
+    // 直前の三角形と共有する辺を FIFO で探して、三角形ごとに残り1頂点だけを符号化する
+    // 頂点が初出順に並んでいる（OptimizeVertexFetch が並べ直した）と新しい頂点は「次の番号」になるので特に縮む
+    // 展開結果は三角形の順序と向きを保つが、三角形内の開始頂点は回転していることがある
+    void EncodeIndexBuffer(const uint32_t* indices, size_t indexCount, std::vector<uint8_t>& out);
+    bool DecodeIndexBuffer(uint32_t* indices, size_t indexCount, const uint8_t* data, size_t size);
+
+    // 頂点列（任意の stride）
+    // ブロック単位でバイト位置ごとに並べ替え（転置）、前の頂点との差分をとってから
+    // 16個ずつのグループを 0/2/4/8bit に詰める
+    void EncodeVertexBuffer(const void* vertices, size_t vertexCount, size_t stride, std::vector<uint8_t>& out);
+    bool DecodeVertexBuffer(void* vertices, size_t vertexCount, size_t stride, const uint8_t* data, size_t size);
+
+    // 1つの列を圧縮・展開した結果
+    struct StreamBenchmark
+    {
+        size_t rawBytes = 0;
+        size_t encodedBytes = 0;
+        double encodeMegabytesPerSecond = 0.0;  // 圧縮前のバイト数 / 秒（最も速かった回）
+        double decodeMegabytesPerSecond = 0.0;  // 展開後のバイト数 / 秒（最も速かった回）
+        bool matches = true;                    // 展開結果が元と一致したか（インデックスは三角形内の回転を許す）
+    };
+
+    struct BenchmarkResult
+    {
+        StreamBenchmark vertices;
+        StreamBenchmark indices;
+    };
+
+    // 与えた頂点/インデックス列（クック済みメッシュの中身など）を圧縮・展開して、圧縮率と処理速度を測る
+    BenchmarkResult RunBenchmark(const void* vertices, size_t vertexCount, size_t stride, const uint32_t* indices,
+        size_t indexCount, int iterations = 5);
+
+    // 組み込みの見本メッシュ1つを1つの頂点形式で測った結果
+    struct CorpusBenchmarkMesh
+    {
+        std::string name;
+        VertexFormat format = VertexFormat::Float32;
+        size_t vertexCount = 0;
+        size_t triangleCount = 0;
+        BenchmarkResult result;
+    };
+
+    // 大きさの違う UV 球と格子を、インポートと同じく溶接 -> 頂点キャッシュ -> 頂点フェッチの順に最適化し
+    // Float32 と Packed16 の両方に詰めてから RunBenchmark で測る
+    std::vector<CorpusBenchmarkMesh> RunCorpusBenchmark(int iterations = 5);
+}
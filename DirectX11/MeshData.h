@@ -0,0 +1,158 @@
+﻿#pragma once
+#include <cstdint>
+#include <vector>
+
+// XMFLOAT3 / XMFLOAT2 と同じメモリ配置の軽量ベクトル
+// （インポート処理を DirectXMath / Windows に依存させないため）
+struct Float3 { float x, y, z; };
+struct Float2 { float x, y; };
+struct Float4 { float x, y, z, w; };
+
+// 1頂点に効く関節（最大4つ、ウェイトの合計は 1。使わない枠はウェイト 0）
+// 関節番号はサブメッシュごとの関節の並び（SubMesh::jointOffset からの相対）
+struct SkinWeights
+{
+    uint16_t joints[4];
+    float weights[4];
+};
+static_assert(sizeof(SkinWeights) == 24, "SkinWeights layout changed");
+
+// インポート中に扱う頂点（GPU には VertexPacking で下の形式に変換して渡す）
+struct MeshVertex
+{
+    Float3 pos;
+    Float3 normal;
+    Float2 uv;
+    Float4 tangent;     // xyz = 接線、w = 従法線の向き（bitangent = w * cross(normal, tangent)）
+    SkinWeights skin;   // スキンなしのメッシュではすべて 0
+};
+static_assert(sizeof(MeshVertex) == 72, "MeshVertex layout changed");
+
+// GPU に渡す頂点の形式
+// 法線/接線/従法線はどちらも QTangent（接空間の回転を表す SNORM16 のクォータニオン、w の符号が従法線の向き）1つで持つ
+enum class VertexFormat : uint32_t
+{
+    Float32,    // Float32Vertex（28byte）
+    Packed16,   // PackedVertex（20byte）
+};
+
+// 位置と UV を float のまま持つ頂点（28byte）
+struct Float32Vertex
+{
+    Float3 pos;
+    int16_t qtangent[4];
+    Float2 uv;
+};
+static_assert(sizeof(Float32Vertex) == 28, "Float32Vertex must match the input layout");
+
+// 量子化した頂点（20byte）
+// 位置はメッシュの AABB で正規化した UNORM16、UV は half
+struct PackedVertex
+{
+    uint16_t pos[4];        // xyz のみ使用（w は 0）
+    int16_t qtangent[4];
+    uint16_t uv[2];
+};
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex must match the input layout");
+
+// CPU スキニングの入出力（バインドポーズ / 変形後）。出力はそのまま2本目の頂点ストリームとして GPU に渡す
+struct SkinnedVertex
+{
+    Float3 pos;
+    Float3 normal;
+    Float4 tangent;     // w = 従法線の向き（スキニングでは変えない）
+};
+static_assert(sizeof(SkinnedVertex) == 40, "SkinnedVertex must match the skinned input layout");
+
+// PackedVertex の位置の復元: pos = offset + unorm * scale
+struct VertexQuantization
+{
+    Float3 positionOffset = { 0.0f, 0.0f, 0.0f };
+    Float3 positionScale = { 1.0f, 1.0f, 1.0f };
+};
+
+inline uint32_t VertexFormatStride(VertexFormat format)
+{
+    return format == VertexFormat::Packed16 ? uint32_t(sizeof(PackedVertex)) : uint32_t(sizeof(Float32Vertex));
+}
+
+// 共有の頂点/インデックス配列の中の1メッシュ分の範囲
+// インデックスはサブメッシュ内のローカル番号（描画時に vertexOffset を BaseVertexLocation に渡す）
+struct SubMesh
+{
+    uint32_t indexOffset = 0;
+    uint32_t indexCount = 0;
+    uint32_t vertexOffset = 0;
+    uint32_t vertexCount = 0;
+    uint32_t meshletOffset = 0;     // meshlets の中の範囲（クラスタ分割しないときは 0 個）
+    uint32_t meshletCount = 0;
+    uint32_t lodOffset = 0;         // lods の中の範囲（先頭が上の範囲と同じ LOD0、あとは粗い順）
+    uint32_t lodCount = 0;
+    Float3 boundsCenter = { 0.0f, 0.0f, 0.0f };     // 頂点を囲む球（メッシュ空間、LOD の選択とカリングに使う）
+    float boundsRadius = 0.0f;
+    Float3 boundsMin = { 0.0f, 0.0f, 0.0f };        // 頂点の AABB（メッシュ空間）
+    Float3 boundsMax = { 0.0f, 0.0f, 0.0f };
+    uint32_t jointOffset = 0;       // スキンの関節の範囲（0 個ならスキンなし）
+    uint32_t jointCount = 0;
+    uint32_t skinVertexOffset = 0;  // バインドポーズ/ウェイトの配列の中の位置（vertexCount 個）
+    uint32_t material = 0;          // ModelData::materials の番号（マテリアルが1つもなければ使わない）
+    float uvDensity = 0.0f;         // UV 空間の長さ / メッシュ空間の長さ（テクスチャのミップの見積もりに使う。0 なら不明）
+    VertexQuantization quantization;    // Packed16 の位置の復元（このサブメッシュの頂点の AABB。描画ごとに定数バッファで渡す）
+};
+
+// 簡略化した1段分のインデックスの範囲
+// 頂点はサブメッシュの頂点をそのまま共有し、インデックスだけが LOD ごとに別に並ぶ
+struct MeshLod
+{
+    uint32_t indexOffset = 0;       // インデックス配列の中の位置（MeshData 内の通し番号）
+    uint32_t indexCount = 0;
+    uint32_t meshletOffset = 0;     // この LOD を区切ったクラスタの範囲
+    uint32_t meshletCount = 0;
+    float error = 0.0f;             // LOD0 からの形状の誤差（モデル空間の距離）
+};
+
+// インデックス列の連続した一部分（クラスタ）とカリング用の境界
+// 三角形はサブメッシュの描画順のまま切り分けるので、残ったクラスタはそのまま DrawIndexed で描ける
+struct Meshlet
+{
+    uint32_t indexOffset = 0;       // インデックス配列の中の位置（MeshData 内の通し番号）
+    uint32_t triangleCount = 0;
+    Float3 center = { 0.0f, 0.0f, 0.0f };   // バウンディング球（モデル空間）
+    float radius = 0.0f;
+    Float3 coneApex = { 0.0f, 0.0f, 0.0f }; // 法線コーン: dot(normalize(coneApex - eye), coneAxis) >= coneCutoff なら全面が裏向き
+    Float3 coneAxis = { 0.0f, 0.0f, 1.0f };
+    float coneCutoff = 1.0f;                // 1 以上なら裏向き判定をしない
+};
+
+// インポート済みメッシュ（頂点配列 + 三角形リストのインデックス）
+// 複数メッシュをまとめる場合は submeshes に範囲を持つ
+struct MeshData
+{
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<SubMesh> submeshes;
+    std::vector<Meshlet> meshlets;
+    std::vector<MeshLod> lods;
+};
+
+// インポート時に掛ける最適化パスの設定
+struct MeshImportOptions
+{
+    bool optimizeOverdraw = true;       // オーバードロー削減の並べ替えを行うか
+    float overdrawThreshold = 1.05f;    // 許容する ACMR の悪化率
+    VertexFormat vertexFormat = VertexFormat::Float32;  // 頂点バッファの形式
+    bool buildMeshlets = true;          // カリング用のクラスタに分割するか
+    uint32_t maxMeshletVertices = 64;
+    uint32_t maxMeshletTriangles = 124;
+    uint32_t lodCount = 4;              // 作る LOD の数（LOD0 を含む。1 なら簡略化しない）
+    float lodReduction = 0.5f;          // 1段ごとの三角形数の比
+    float lodNormalWeight = 0.5f;       // 簡略化の誤差に含める法線/UV の差の重み
+    float lodUvWeight = 1.0f;
+    bool importSkins = true;            // FbxSkin のウェイトと関節を読み込むか（false ならバインドポーズの静的メッシュ）
+    bool importAnimations = true;       // FbxAnimStack（テイク）をノードの TRS トラックにベイクして圧縮するか
+    float animationSampleRate = 30.0f;  // ベイクする間隔（1秒あたりのフレーム数）
+    float animationError = 1.0e-3f;     // 圧縮で許す位置の誤差（骨格の大きさに対する比）
+    bool buildAtlases = true;           // UV を繰り返さない小さいテクスチャをアトラスのページにまとめるか
+    uint32_t atlasMaxExtent = 256;      // まとめる画像の長い辺の上限
+    uint32_t atlasPageSize = 2048;      // ページの辺の上限
+};
@@ -0,0 +1,534 @@
+﻿#include "MeshFile.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <type_traits>
+#include <vector>
+#include "Bounds.h"
+#include "FileUtil.h"
+#include "Hash.h"
+#include "MeshCodec.h"
+
+namespace
+{
+    static_assert(std::is_trivially_copyable<SubMesh>::value, "SubMesh must be trivially copyable");
+    static_assert(std::is_trivially_copyable<SceneNode>::value, "SceneNode must be trivially copyable");
+    static_assert(std::is_trivially_copyable<Meshlet>::value, "Meshlet must be trivially copyable");
+    static_assert(std::is_trivially_copyable<MeshLod>::value, "MeshLod must be trivially copyable");
+    static_assert(std::is_trivially_copyable<SkinJoint>::value, "SkinJoint must be trivially copyable");
+    static_assert(std::is_trivially_copyable<AnimationTrack>::value, "AnimationTrack must be trivially copyable");
+    static_assert(std::is_trivially_copyable<Material>::value, "Material must be trivially copyable");
+
+    uint64_t AlignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    uint64_t HeaderChecksum(const MeshFile::Header& header)
+    {
+        MeshFile::Header copy = header;
+        copy.headerChecksum = 0;
+        return Hash64(&copy, sizeof(copy));
+    }
+
+    double ElapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+namespace MeshFile
+{
+    bool Serialize(const ModelData& model, std::vector<uint8_t>& bytes, std::string& error, bool compressStreams)
+    {
+        const MeshData& geometry = model.geometry;
+        if (geometry.vertices.empty() || geometry.indices.empty())
+        {
+            error = "mesh has no geometry";
+            return false;
+        }
+
+        if (model.gpuVertices.size() != geometry.vertices.size() * VertexFormatStride(model.vertexFormat))
+        {
+            error = "GPU vertices out of sync";
+            return false;
+        }
+        if (model.skinWeights.size() != model.skinVertices.size())
+        {
+            error = "skin weights out of sync";
+            return false;
+        }
+
+        Header header{};
+        header.magic = kMagic;
+        header.version = kVersion;
+        header.vertexStride = VertexFormatStride(model.vertexFormat);
+        header.indexSize = sizeof(uint32_t);
+        header.vertexCount = uint32_t(geometry.vertices.size());
+        header.indexCount = uint32_t(geometry.indices.size());
+        header.submeshCount = uint32_t(geometry.submeshes.size());
+        header.nodeCount = uint32_t(model.nodes.size());
+        header.meshletCount = uint32_t(geometry.meshlets.size());
+        header.lodCount = uint32_t(geometry.lods.size());
+        header.jointCount = uint32_t(model.joints.size());
+        header.skinVertexCount = uint32_t(model.skinVertices.size());
+        header.animationCount = uint32_t(model.animations.size());
+        header.vertexFormat = uint32_t(model.vertexFormat);
+        header.flags = compressStreams ? uint32_t(kFlagCompressedStreams) : 0u;
+
+        const Bounds::Aabb bounds = Bounds::ComputeAabb(&geometry.vertices[0].pos, geometry.vertices.size(), sizeof(MeshVertex));
+        header.boundsMin = bounds.min;
+        header.boundsMax = bounds.max;
+
+        // クリップごとの配列を1本ずつのセクションに詰める
+        std::vector<AnimationEntry> animations;
+        std::vector<AnimationTrack> animationTracks;
+        std::vector<uint16_t> animationKeyFrames;
+        std::vector<uint8_t> animationKeyData;
+        for (const AnimationClip& clip : model.animations)
+        {
+            if (clip.nodeCount != model.nodes.size() || clip.tracks.size() != size_t(clip.nodeCount) * kChannelCount)
+            {
+                error = "animation tracks out of sync";
+                return false;
+            }
+            AnimationEntry entry{};
+            std::memcpy(entry.name, clip.name.c_str(), std::min(clip.name.size(), sizeof(entry.name) - 1));
+            entry.sampleRate = clip.sampleRate;
+            entry.frameCount = clip.frameCount;
+            entry.nodeCount = clip.nodeCount;
+            entry.trackOffset = uint32_t(animationTracks.size());
+            entry.trackCount = uint32_t(clip.tracks.size());
+            entry.keyFrameOffset = uint32_t(animationKeyFrames.size());
+            entry.keyFrameCount = uint32_t(clip.keyFrames.size());
+            entry.keyDataOffset = uint32_t(animationKeyData.size());
+            entry.keyDataSize = uint32_t(clip.keyData.size());
+            entry.errorBudget = clip.errorBudget;
+            entry.measuredError = clip.measuredError;
+            animations.push_back(entry);
+            animationTracks.insert(animationTracks.end(), clip.tracks.begin(), clip.tracks.end());
+            animationKeyFrames.insert(animationKeyFrames.end(), clip.keyFrames.begin(), clip.keyFrames.end());
+            animationKeyData.insert(animationKeyData.end(), clip.keyData.begin(), clip.keyData.end());
+        }
+        header.animationTrackCount = uint32_t(animationTracks.size());
+        header.animationKeyFrameCount = uint32_t(animationKeyFrames.size());
+        header.animationKeyDataSize = uint32_t(animationKeyData.size());
+
+        // テクスチャはパスと埋め込みデータを1本のセクションに続けて詰める
+        std::vector<TextureEntry> textures;
+        std::vector<uint8_t> textureData;
+        for (const ModelTexture& texture : model.textures)
+        {
+            TextureEntry entry{};
+            entry.pathOffset = uint32_t(textureData.size());
+            entry.pathSize = uint32_t(texture.path.size());
+            textureData.insert(textureData.end(), texture.path.begin(), texture.path.end());
+            entry.dataOffset = textureData.size();
+            entry.dataSize = texture.embedded.size();
+            textureData.insert(textureData.end(), texture.embedded.begin(), texture.embedded.end());
+            textures.push_back(entry);
+        }
+        header.materialCount = uint32_t(model.materials.size());
+        header.textureCount = uint32_t(textures.size());
+        header.textureDataSize = textureData.size();
+
+        const void* sectionData[kSectionCount] =
+        {
+            geometry.submeshes.data(), model.nodes.data(),
+            model.gpuVertices.data(),
+            geometry.indices.data(), geometry.meshlets.data(), geometry.lods.data(),
+            model.joints.data(), model.skinVertices.data(), model.skinWeights.data(),
+            animations.data(), animationTracks.data(), animationKeyFrames.data(), animationKeyData.data(),
+            model.materials.data(), textures.data(), textureData.data()
+        };
+        uint64_t sectionSize[kSectionCount] =
+        {
+            geometry.submeshes.size() * sizeof(SubMesh),
+            model.nodes.size() * sizeof(SceneNode),
+            geometry.vertices.size() * header.vertexStride,
+            geometry.indices.size() * sizeof(uint32_t),
+            geometry.meshlets.size() * sizeof(Meshlet),
+            geometry.lods.size() * sizeof(MeshLod),
+            model.joints.size() * sizeof(SkinJoint),
+            model.skinVertices.size() * sizeof(SkinnedVertex),
+            model.skinWeights.size() * sizeof(SkinWeights),
+            animations.size() * sizeof(AnimationEntry),
+            animationTracks.size() * sizeof(AnimationTrack),
+            animationKeyFrames.size() * sizeof(uint16_t),
+            animationKeyData.size(),
+            model.materials.size() * sizeof(Material),
+            textures.size() * sizeof(TextureEntry),
+            textureData.size(),
+        };
+
+        std::vector<uint8_t> encodedVertices, encodedIndices;
+        if (compressStreams)
+        {
+            MeshCodec::EncodeVertexBuffer(sectionData[kSectionVertices], geometry.vertices.size(), header.vertexStride, encodedVertices);
+            MeshCodec::EncodeIndexBuffer(geometry.indices.data(), geometry.indices.size(), encodedIndices);
+            sectionData[kSectionVertices] = encodedVertices.data();
+            sectionSize[kSectionVertices] = encodedVertices.size();
+            sectionData[kSectionIndices] = encodedIndices.data();
+            sectionSize[kSectionIndices] = encodedIndices.size();
+        }
+
+        uint64_t offset = AlignUp(sizeof(Header), kSectionAlignment);
+        for (uint32_t i = 0; i < kSectionCount; i++)
+        {
+            header.sections[i].offset = offset;
+            header.sections[i].size = sectionSize[i];
+            header.sections[i].checksum = Hash64(sectionData[i], size_t(sectionSize[i]));
+            offset = AlignUp(offset + sectionSize[i], kSectionAlignment);
+        }
+        header.headerChecksum = HeaderChecksum(header);
+
+        bytes.assign(size_t(offset), 0);
+        std::memcpy(bytes.data(), &header, sizeof(header));
+        for (uint32_t i = 0; i < kSectionCount; i++)
+        {
+            if (sectionSize[i] > 0)
+            {
+                std::memcpy(bytes.data() + header.sections[i].offset, sectionData[i], size_t(sectionSize[i]));
+            }
+        }
+
+        return true;
+    }
+
+    bool Write(const std::string& path, const ModelData& model, std::string& error, bool compressStreams)
+    {
+        std::vector<uint8_t> bytes;
+        if (!Serialize(model, bytes, error, compressStreams)) return false;
+
+        if (!WriteFileAtomic(path, bytes.data(), bytes.size()))
+        {
+            error = "failed to write " + path;
+            return false;
+        }
+        return true;
+    }
+
+    bool RunLoadBenchmark(const std::string& sourcePath, const std::string& meshPath,
+        const std::function<bool(std::string& error)>& loadSource, LoadBenchmarkResult& result, std::string& error,
+        int iterations)
+    {
+        result = LoadBenchmarkResult();
+        MeshFileView view;
+        if (!view.Open(meshPath))
+        {
+            error = meshPath + ": " + view.GetErrorString();
+            return false;
+        }
+        result.vertexCount = view.GetHeader().vertexCount;
+        result.triangleCount = view.GetHeader().indexCount / 3;
+        result.compressed = view.IsCompressed();
+        view.Close();
+
+        auto fileSize = [](const std::string& path)
+        {
+            std::error_code sizeError;
+            const uintmax_t size = std::filesystem::file_size(path, sizeError);
+            return sizeError ? uint64_t(0) : uint64_t(size);
+        };
+        result.sourceBytes = fileSize(sourcePath);
+        result.meshBytes = fileSize(meshPath);
+
+        // 元ファイル: 呼び出し側の読み込み
+        auto loadModel = [&]()
+        {
+            auto start = std::chrono::steady_clock::now();
+            if (!loadSource(error)) return -1.0;
+            return ElapsedMs(start);
+        };
+
+        // .mesh: マップ + 検証（全セクションを読む）+ 展開（D3DApp::LoadCookedModel と同じ）
+        std::vector<uint8_t> vertices;
+        std::vector<uint32_t> indices;
+        auto loadMesh = [&]()
+        {
+            auto start = std::chrono::steady_clock::now();
+            MeshFileView mesh;
+            if (!mesh.Open(meshPath))
+            {
+                error = meshPath + ": " + mesh.GetErrorString();
+                return -1.0;
+            }
+            if (mesh.IsCompressed())
+            {
+                const Header& header = mesh.GetHeader();
+                vertices.resize(size_t(header.vertexCount) * header.vertexStride);
+                indices.resize(header.indexCount);
+                if (!mesh.DecodeVertices(vertices.data()) || !mesh.DecodeIndices(indices.data()))
+                {
+                    error = meshPath + ": stream decode failed";
+                    return -1.0;
+                }
+            }
+            return ElapsedMs(start);
+        };
+
+        // cold は毎回ページキャッシュから追い出してから、warm は1回読んでおいてから測る
+        auto measure = [&](const std::string& path, auto load, bool cold, double& best)
+        {
+            if (!cold && load() < 0.0) return false;
+            for (int i = 0; i < iterations; i++)
+            {
+                if (cold && !DropFileCache(path)) return true;
+                const double ms = load();
+                if (ms < 0.0) return false;
+                best = i == 0 ? ms : std::min(best, ms);
+            }
+            if (cold) result.coldMeasured = true;
+            return true;
+        };
+        if (loadSource)
+        {
+            if (!measure(sourcePath, loadModel, true, result.sourceColdMs) ||
+                !measure(sourcePath, loadModel, false, result.sourceWarmMs))
+            {
+                return false;
+            }
+            result.sourceMeasured = true;
+        }
+        return measure(meshPath, loadMesh, true, result.meshColdMs) &&
+            measure(meshPath, loadMesh, false, result.meshWarmMs);
+    }
+}
+
+bool MeshFileView::Open(const std::string& path, bool verifyChecksums)
+{
+    Close();
+
+    if (!mFile.Open(path)) return Fail("cannot open file");
+    if (mFile.Size() < sizeof(MeshFile::Header)) return Fail("file too small");
+
+    mHeader = reinterpret_cast<const MeshFile::Header*>(mFile.Data());
+    const MeshFile::Header& header = *mHeader;
+    if (header.magic != MeshFile::kMagic) return Fail("bad magic");
+    if (header.version != MeshFile::kVersion) return Fail("unsupported version");
+    if (header.headerChecksum != HeaderChecksum(header)) return Fail("header checksum mismatch");
+    if (header.vertexFormat > uint32_t(VertexFormat::Packed16)) return Fail("unsupported vertex format");
+    if ((header.flags & ~uint32_t(MeshFile::kFlagCompressedStreams)) != 0) return Fail("unsupported flags");
+    if (header.vertexStride != VertexFormatStride(VertexFormat(header.vertexFormat)) || header.indexSize != sizeof(uint32_t))
+    {
+        return Fail("unsupported vertex layout");
+    }
+
+    const uint64_t counts[MeshFile::kSectionCount] =
+    {
+        header.submeshCount, header.nodeCount, header.vertexCount, header.indexCount, header.meshletCount, header.lodCount,
+        header.jointCount, header.skinVertexCount, header.skinVertexCount,
+        header.animationCount, header.animationTrackCount, header.animationKeyFrameCount, header.animationKeyDataSize,
+        header.materialCount, header.textureCount, header.textureDataSize
+    };
+    const uint64_t elementSize[MeshFile::kSectionCount] =
+    {
+        sizeof(SubMesh), sizeof(SceneNode), header.vertexStride, sizeof(uint32_t), sizeof(Meshlet), sizeof(MeshLod),
+        sizeof(SkinJoint), sizeof(SkinnedVertex), sizeof(SkinWeights),
+        sizeof(MeshFile::AnimationEntry), sizeof(AnimationTrack), sizeof(uint16_t), 1,
+        sizeof(Material), sizeof(MeshFile::TextureEntry), 1
+    };
+    for (uint32_t i = 0; i < MeshFile::kSectionCount; i++)
+    {
+        const MeshFile::Section& section = header.sections[i];
+        const bool compressed = IsCompressed() && (i == MeshFile::kSectionVertices || i == MeshFile::kSectionIndices);
+        if (!compressed && section.size != counts[i] * elementSize[i]) return Fail("section size mismatch");
+        if (section.offset % MeshFile::kSectionAlignment != 0) return Fail("section misaligned");
+        if (section.offset > mFile.Size() || section.size > mFile.Size() - section.offset) return Fail("section out of range");
+        if (verifyChecksums && Hash64(mFile.Data() + section.offset, size_t(section.size)) != section.checksum)
+        {
+            return Fail("section checksum mismatch");
+        }
+    }
+
+    // ノード/サブメッシュの参照先が範囲内か
+    const SubMesh* submeshes = GetSubMeshes();
+    for (uint32_t i = 0; i < header.submeshCount; i++)
+    {
+        const SubMesh& s = submeshes[i];
+        if (uint64_t(s.indexOffset) + s.indexCount > header.indexCount ||
+            uint64_t(s.vertexOffset) + s.vertexCount > header.vertexCount ||
+            uint64_t(s.meshletOffset) + s.meshletCount > header.meshletCount ||
+            uint64_t(s.lodOffset) + s.lodCount > header.lodCount ||
+            uint64_t(s.jointOffset) + s.jointCount > header.jointCount ||
+            (s.jointCount > 0 && uint64_t(s.skinVertexOffset) + s.vertexCount > header.skinVertexCount) ||
+            (header.materialCount > 0 && s.material >= header.materialCount))
+        {
+            return Fail("submesh out of range");
+        }
+
+        // スキニングはウェイトの関節番号でパレットを引くので、番号が範囲外なら読み込まない
+        const SkinWeights* weights = GetSkinWeights() + s.skinVertexOffset;
+        for (uint32_t v = 0; s.jointCount > 0 && v < s.vertexCount; v++)
+        {
+            for (uint16_t joint : weights[v].joints)
+            {
+                if (joint >= s.jointCount) return Fail("skin weight out of range");
+            }
+        }
+    }
+    const Meshlet* meshlets = GetMeshlets();
+    for (uint32_t i = 0; i < header.meshletCount; i++)
+    {
+        if (uint64_t(meshlets[i].indexOffset) + uint64_t(meshlets[i].triangleCount) * 3 > header.indexCount)
+        {
+            return Fail("meshlet out of range");
+        }
+    }
+    const MeshLod* lods = GetLods();
+    for (uint32_t i = 0; i < header.lodCount; i++)
+    {
+        if (uint64_t(lods[i].indexOffset) + lods[i].indexCount > header.indexCount ||
+            uint64_t(lods[i].meshletOffset) + lods[i].meshletCount > header.meshletCount)
+        {
+            return Fail("lod out of range");
+        }
+    }
+    const SkinJoint* joints = GetJoints();
+    for (uint32_t i = 0; i < header.jointCount; i++)
+    {
+        if (joints[i].node < -1 || joints[i].node >= int32_t(header.nodeCount)) return Fail("joint out of range");
+    }
+    if (!ValidateAnimations()) return false;
+    const Material* materials = GetMaterials();
+    for (uint32_t i = 0; i < header.materialCount; i++)
+    {
+        for (int32_t texture : materials[i].textures)
+        {
+            if (texture < -1 || texture >= int32_t(header.textureCount)) return Fail("material texture out of range");
+        }
+    }
+    const MeshFile::TextureEntry* textures = Section<MeshFile::TextureEntry>(MeshFile::kSectionTextures);
+    for (uint32_t i = 0; i < header.textureCount; i++)
+    {
+        const MeshFile::TextureEntry& t = textures[i];
+        if (uint64_t(t.pathOffset) + t.pathSize > header.textureDataSize ||
+            t.dataOffset > header.textureDataSize || t.dataSize > header.textureDataSize - t.dataOffset)
+        {
+            return Fail("texture out of range");
+        }
+    }
+    const SceneNode* nodes = GetNodes();
+    for (uint32_t i = 0; i < header.nodeCount; i++)
+    {
+        if (nodes[i].parent >= int32_t(i) || nodes[i].mesh >= int32_t(header.submeshCount))
+        {
+            return Fail("node table corrupt");
+        }
+    }
+    return true;
+}
+
+bool MeshFileView::DecodeVertices(void* vertices) const
+{
+    const MeshFile::Section& section = mHeader->sections[MeshFile::kSectionVertices];
+    const uint8_t* data = mFile.Data() + section.offset;
+    if (!IsCompressed())
+    {
+        std::memcpy(vertices, data, size_t(section.size));
+        return true;
+    }
+    return MeshCodec::DecodeVertexBuffer(vertices, mHeader->vertexCount, mHeader->vertexStride, data, size_t(section.size));
+}
+
+bool MeshFileView::DecodeIndices(uint32_t* indices) const
+{
+    const MeshFile::Section& section = mHeader->sections[MeshFile::kSectionIndices];
+    const uint8_t* data = mFile.Data() + section.offset;
+    if (!IsCompressed())
+    {
+        std::memcpy(indices, data, size_t(section.size));
+        return true;
+    }
+    return MeshCodec::DecodeIndexBuffer(indices, mHeader->indexCount, data, size_t(section.size));
+}
+
+bool MeshFileView::ValidateAnimations()
+{
+    // 展開はトラックの範囲とキーの位置をそのまま信じて読むので、範囲外を指すクリップは読み込まない
+    const MeshFile::Header& header = *mHeader;
+    const MeshFile::AnimationEntry* animations = GetAnimations();
+    const AnimationTrack* tracks = Section<AnimationTrack>(MeshFile::kSectionAnimationTracks);
+    const uint16_t* keyFrames = Section<uint16_t>(MeshFile::kSectionAnimationKeyFrames);
+    for (uint32_t i = 0; i < header.animationCount; i++)
+    {
+        const MeshFile::AnimationEntry& clip = animations[i];
+        if (clip.name[sizeof(clip.name) - 1] != '\0' || !(clip.sampleRate > 0.0f) ||
+            clip.frameCount == 0 || clip.frameCount > 0xffff || clip.nodeCount != header.nodeCount ||
+            uint64_t(clip.trackCount) != uint64_t(clip.nodeCount) * kChannelCount ||
+            uint64_t(clip.trackOffset) + clip.trackCount > header.animationTrackCount ||
+            uint64_t(clip.keyFrameOffset) + clip.keyFrameCount > header.animationKeyFrameCount ||
+            uint64_t(clip.keyDataOffset) + clip.keyDataSize > header.animationKeyDataSize)
+        {
+            return Fail("animation out of range");
+        }
+
+        for (uint32_t t = 0; t < clip.trackCount; t++)
+        {
+            const AnimationTrack& track = tracks[clip.trackOffset + t];
+            const uint32_t components = AnimationSampling::ChannelComponents(t % kChannelCount);
+            const bool validBits = track.bits <= 16 || track.bits == 32;
+            if (!validBits || track.keyCount == 0 || (track.bits == 0 && track.keyCount != 1) ||
+                uint64_t(track.dataOffset) + AnimationSampling::TrackDataSize(track, components) +
+                    AnimationSampling::kKeyDataPadding > clip.keyDataSize)
+            {
+                return Fail("animation track corrupt");
+            }
+            if (track.bits == 0 || track.keyCount == clip.frameCount) continue;
+
+            // 全フレームにキーがないトラックはフレーム番号が昇順で範囲内であること
+            if (uint64_t(track.keyOffset) + track.keyCount > clip.keyFrameCount) return Fail("animation track corrupt");
+            const uint16_t* frames = keyFrames + clip.keyFrameOffset + track.keyOffset;
+            for (uint32_t k = 0; k < track.keyCount; k++)
+            {
+                if (frames[k] >= clip.frameCount || (k > 0 && frames[k] <= frames[k - 1]))
+                {
+                    return Fail("animation key frames corrupt");
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void MeshFileView::GetAnimation(uint32_t index, AnimationClip& clip) const
+{
+    const MeshFile::AnimationEntry& entry = GetAnimations()[index];
+    const AnimationTrack* tracks = Section<AnimationTrack>(MeshFile::kSectionAnimationTracks) + entry.trackOffset;
+    const uint16_t* keyFrames = Section<uint16_t>(MeshFile::kSectionAnimationKeyFrames) + entry.keyFrameOffset;
+    const uint8_t* keyData = Section<uint8_t>(MeshFile::kSectionAnimationKeyData) + entry.keyDataOffset;
+
+    clip.name = entry.name;
+    clip.sampleRate = entry.sampleRate;
+    clip.frameCount = entry.frameCount;
+    clip.nodeCount = entry.nodeCount;
+    clip.tracks.assign(tracks, tracks + entry.trackCount);
+    clip.keyFrames.assign(keyFrames, keyFrames + entry.keyFrameCount);
+    clip.keyData.assign(keyData, keyData + entry.keyDataSize);
+    clip.errorBudget = entry.errorBudget;
+    clip.measuredError = entry.measuredError;
+}
+
+void MeshFileView::GetTexture(uint32_t index, ModelTexture& texture) const
+{
+    const MeshFile::TextureEntry& entry = Section<MeshFile::TextureEntry>(MeshFile::kSectionTextures)[index];
+    const uint8_t* data = Section<uint8_t>(MeshFile::kSectionTextureData);
+    texture.path.assign(reinterpret_cast<const char*>(data + entry.pathOffset), entry.pathSize);
+    texture.embedded.assign(data + entry.dataOffset, data + entry.dataOffset + entry.dataSize);
+}
+
+void MeshFileView::Close()
+{
+    mFile.Close();
+    mHeader = nullptr;
+    mError.clear();
+}
+
+bool MeshFileView::Fail(const char* reason)
+{
+    mFile.Close();
+    mHeader = nullptr;
+    mError = reason;
+    return false;
+}
@@ -0,0 +1,190 @@
+﻿#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "ModelData.h"
+
+// クック済みメッシュ形式（.mesh）
+// ヘッダーの後に各セクションを 64byte 境界で並べる。頂点/インデックスは GPU バッファと同じ並びなので
+// マップしたポインタをそのまま CreateBuffer の初期データに渡せる
+// kFlagCompressedStreams のときは頂点/インデックスを MeshCodec で圧縮して持ち、読み込み時に展開する
+namespace MeshFile
+{
+    constexpr uint32_t kMagic = 0x48534D43;     // "CMSH"
+    constexpr uint32_t kVersion = 13;
+    constexpr uint64_t kSectionAlignment = 64;
+
+    enum Flags : uint32_t
+    {
+        kFlagCompressedStreams = 1 << 0,
+    };
+
+    enum SectionId : uint32_t
+    {
+        kSectionSubMeshes,
+        kSectionNodes,
+        kSectionVertices,
+        kSectionIndices,
+        kSectionMeshlets,
+        kSectionLods,
+        kSectionJoints,
+        kSectionSkinVertices,
+        kSectionSkinWeights,
+        kSectionAnimations,
+        kSectionAnimationTracks,
+        kSectionAnimationKeyFrames,
+        kSectionAnimationKeyData,
+        kSectionMaterials,
+        kSectionTextures,
+        kSectionTextureData,
+        kSectionCount
+    };
+
+    struct Section
+    {
+        uint64_t offset;        // ファイル先頭からのバイト位置
+        uint64_t size;          // ファイル上のサイズ（圧縮時は圧縮後）
+        uint64_t checksum;      // Hash64（ファイル上のバイト列）
+    };
+
+    // アニメーションクリップ1本（トラック/キーの位置はセクション全体の中の範囲。
+    // クリップ内の AnimationTrack::keyOffset / dataOffset はクリップの範囲の先頭からの位置）
+    struct AnimationEntry
+    {
+        char name[64];          // NUL 終端（長い名前は切り詰める）
+        float sampleRate;
+        uint32_t frameCount;
+        uint32_t nodeCount;     // Header::nodeCount と同じ
+        uint32_t trackOffset;
+        uint32_t trackCount;    // nodeCount * kChannelCount
+        uint32_t keyFrameOffset;
+        uint32_t keyFrameCount;
+        uint32_t keyDataOffset;
+        uint32_t keyDataSize;   // バイト数（末尾のパディングを含む）
+        float errorBudget;
+        float measuredError;
+        uint32_t reserved;
+    };
+    static_assert(sizeof(AnimationEntry) == 112, "MeshFile::AnimationEntry layout changed");
+
+    // テクスチャ1枚（パスと埋め込みデータは kSectionTextureData の中の範囲）
+    struct TextureEntry
+    {
+        uint64_t dataOffset;
+        uint64_t dataSize;      // 埋め込みデータのバイト数（0 なら path のファイルから読む）
+        uint32_t pathOffset;
+        uint32_t pathSize;      // NUL 終端を含まない
+    };
+    static_assert(sizeof(TextureEntry) == 24, "MeshFile::TextureEntry layout changed");
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vertexStride;
+        uint32_t indexSize;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t submeshCount;
+        uint32_t nodeCount;
+        uint32_t meshletCount;
+        uint32_t vertexFormat;  // VertexFormat
+        uint32_t flags;         // Flags
+        uint32_t lodCount;
+        uint32_t jointCount;
+        uint32_t skinVertexCount;   // スキン付きサブメッシュの頂点数の合計（バインドポーズ/ウェイトの要素数）
+        uint32_t animationCount;
+        uint32_t animationTrackCount;
+        uint32_t animationKeyFrameCount;
+        uint32_t animationKeyDataSize;  // 全クリップの keyData のバイト数
+        uint32_t materialCount;
+        uint32_t textureCount;
+        uint64_t textureDataSize;       // 全テクスチャのパスと埋め込みデータのバイト数
+        Float3 boundsMin;       // 全頂点の AABB（モデル空間）
+        Float3 boundsMax;
+        Section sections[kSectionCount];
+        uint64_t headerChecksum;    // このフィールドを 0 にしたヘッダーの Hash64
+    };
+    static_assert(sizeof(Header) == 504, "MeshFile::Header layout changed");
+
+    // ModelData をクック済みメッシュのバイト列にする
+    // compressStreams なら頂点/インデックスを圧縮する（ファイルは小さくなるが直接マップはできない）
+    bool Serialize(const ModelData& model, std::vector<uint8_t>& bytes, std::string& error, bool compressStreams = false);
+
+    // ModelData をクック済みメッシュとして書き出す（一時ファイル経由で置き換える）
+    bool Write(const std::string& path, const ModelData& model, std::string& error, bool compressStreams = false);
+
+    struct LoadBenchmarkResult
+    {
+        uint32_t vertexCount = 0;
+        uint32_t triangleCount = 0;
+        bool compressed = false;
+        uint64_t sourceBytes = 0;
+        uint64_t meshBytes = 0;
+        bool sourceMeasured = false;    // 元ファイルの読み込みを測ったか（loadSource が空なら false で、source の値は 0）
+        bool coldMeasured = false;      // ページキャッシュから追い出せた（Linux のみ）か。false なら cold の値は 0
+        // 読み込みから GPU に渡せる状態まで（ミリ秒）。最も速かった回
+        double sourceColdMs = 0.0;      // loadSource（FBX ならインポートと最適化のすべて）
+        double sourceWarmMs = 0.0;
+        double meshColdMs = 0.0;        // .mesh をマップしてチェックサムを検証し、圧縮していれば頂点/インデックスを展開する
+        double meshWarmMs = 0.0;
+    };
+
+    // 同じモデルの元ファイルとクック済み .mesh の読み込み時間を比べる
+    // 元ファイルの読み込み（FBX のインポートは SDK が要る）は呼び出し側が loadSource で渡す。失敗したら false を返して error に理由を書く
+    bool RunLoadBenchmark(const std::string& sourcePath, const std::string& meshPath,
+        const std::function<bool(std::string& error)>& loadSource, LoadBenchmarkResult& result, std::string& error,
+        int iterations = 5);
+}
+
+// クック済みメッシュをメモリマップして参照する。ポインタは Close するまで有効
+class MeshFileView
+{
+public:
+    bool Open(const std::string& path, bool verifyChecksums = true);
+    void Close();
+
+    const MeshFile::Header& GetHeader() const { return *mHeader; }
+    const SubMesh* GetSubMeshes() const { return Section<SubMesh>(MeshFile::kSectionSubMeshes); }
+    const SceneNode* GetNodes() const { return Section<SceneNode>(MeshFile::kSectionNodes); }
+    bool IsCompressed() const { return (mHeader->flags & MeshFile::kFlagCompressedStreams) != 0; }
+
+    // 非圧縮のときのみ有効（マップしたメモリを直接指す）
+    const void* GetVertexData() const { return Section<uint8_t>(MeshFile::kSectionVertices); }
+    const uint32_t* GetIndices() const { return Section<uint32_t>(MeshFile::kSectionIndices); }
+    const Meshlet* GetMeshlets() const { return Section<Meshlet>(MeshFile::kSectionMeshlets); }
+    const MeshLod* GetLods() const { return Section<MeshLod>(MeshFile::kSectionLods); }
+    const SkinJoint* GetJoints() const { return Section<SkinJoint>(MeshFile::kSectionJoints); }
+    const SkinnedVertex* GetSkinVertices() const { return Section<SkinnedVertex>(MeshFile::kSectionSkinVertices); }
+    const SkinWeights* GetSkinWeights() const { return Section<SkinWeights>(MeshFile::kSectionSkinWeights); }
+    const MeshFile::AnimationEntry* GetAnimations() const { return Section<MeshFile::AnimationEntry>(MeshFile::kSectionAnimations); }
+    const Material* GetMaterials() const { return Section<Material>(MeshFile::kSectionMaterials); }
+
+    // index 番目のクリップをコピーして取り出す
+    void GetAnimation(uint32_t index, AnimationClip& clip) const;
+
+    // index 番目のテクスチャのパスと埋め込みデータをコピーして取り出す
+    void GetTexture(uint32_t index, ModelTexture& texture) const;
+
+    // 圧縮の有無によらず展開/コピーする（vertices は vertexCount * vertexStride バイト）
+    bool DecodeVertices(void* vertices) const;
+    bool DecodeIndices(uint32_t* indices) const;
+
+    const std::string& GetErrorString() const { return mError; }
+
+private:
+    template <class T>
+    const T* Section(MeshFile::SectionId id) const
+    {
+        return reinterpret_cast<const T*>(mFile.Data() + mHeader->sections[id].offset);
+    }
+
+    bool ValidateAnimations();
+    bool Fail(const char* reason);
+
+    MappedFile mFile;
+    const MeshFile::Header* mHeader = nullptr;
+    std::string mError;
+};
@@ -0,0 +1,926 @@
+﻿#include "MeshOptimizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <random>
+
+namespace
+{
+    constexpr uint32_t kEmptySlot = 0xffffffffu;
+    constexpr size_t kVertexWords = sizeof(MeshVertex) / sizeof(uint32_t);
+
+    // -0.0 を +0.0 に揃えたビット列を作る（比較・ハッシュ用）
+    void CanonicalizeVertex(const MeshVertex& v, uint32_t (&words)[kVertexWords])
+    {
+        std::memcpy(words, &v, sizeof(MeshVertex));
+        for (uint32_t& w : words)
+        {
+            if (w == 0x80000000u) w = 0;
+        }
+    }
+
+    uint32_t HashVertexWords(const uint32_t (&words)[kVertexWords])
+    {
+        // MurmurHash2 系の混ぜ込み
+        const uint32_t m = 0x5bd1e995u;
+        uint32_t h = 0;
+        for (uint32_t k : words)
+        {
+            k *= m;
+            k ^= k >> 24;
+            k *= m;
+            h = (h * m) ^ k;
+        }
+        h ^= h >> 13;
+        h *= m;
+        h ^= h >> 15;
+        return h;
+    }
+
+    size_t HashTableSize(size_t count)
+    {
+        size_t size = 16;
+        while (size < count + count / 2) size *= 2;
+        return size;
+    }
+
+    // --- Forsyth 法のスコア ---
+    constexpr int kForsythCacheSize = 32;   // 最適化時に想定するLRUキャッシュ
+    constexpr int kForsythValenceMax = 32;
+
+    struct ForsythScoreTable
+    {
+        float cache[kForsythCacheSize];
+        float live[kForsythValenceMax + 1];
+
+        ForsythScoreTable()
+        {
+            const float cacheDecayPower = 1.5f;
+            const float lastTriScore = 0.75f;
+            const float valenceBoostScale = 2.0f;
+            const float valenceBoostPower = 0.5f;
+
+            for (int i = 0; i < kForsythCacheSize; i++)
+            {
+                if (i < 3)
+                {
+                    // 直前の三角形の頂点は、同じ三角形を連続させないよう一律のスコア
+                    cache[i] = lastTriScore;
+                }
+                else
+                {
+                    float s = 1.0f - float(i - 3) / float(kForsythCacheSize - 3);
+                    cache[i] = std::pow(s, cacheDecayPower);
+                }
+            }
+            live[0] = 0.0f;
+            for (int i = 1; i <= kForsythValenceMax; i++)
+            {
+                // 残り三角形が少ない頂点を優先して使い切る
+                live[i] = valenceBoostScale * std::pow(float(i), -valenceBoostPower);
+            }
+        }
+
+        float Score(int cachePos, uint32_t liveTriangles) const
+        {
+            if (liveTriangles == 0) return -1.0f;
+            float score = cachePos >= 0 ? cache[cachePos] : 0.0f;
+            return score + live[std::min<uint32_t>(liveTriangles, kForsythValenceMax)];
+        }
+    };
+
+    // --- オーバードロー解析用の簡易ラスタライザ ---
+    constexpr int kOverdrawViewport = 256;
+
+    struct OverdrawBuffer
+    {
+        float depth[kOverdrawViewport][kOverdrawViewport][2];
+        size_t shaded = 0;
+    };
+
+    float EdgeFunction(float ax, float ay, float bx, float by, float px, float py)
+    {
+        return (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+    }
+
+    // 画面座標(x,y)と深度zの三角形を描く。表向き(面積>0)は side 0、裏向きは奥行きを反転して side 1
+    void RasterizeOverdraw(OverdrawBuffer& buffer,
+        float x0, float y0, float z0, float x1, float y1, float z1, float x2, float y2, float z2)
+    {
+        float area = EdgeFunction(x0, y0, x1, y1, x2, y2);
+        if (area == 0.0f) return;
+
+        int side = area > 0.0f ? 0 : 1;
+        if (side == 1)
+        {
+            // 反対側から見たものとして扱う
+            z0 = 1.0f - z0; z1 = 1.0f - z1; z2 = 1.0f - z2;
+        }
+
+        int minX = std::max(int(std::floor(std::min({ x0, x1, x2 }))), 0);
+        int minY = std::max(int(std::floor(std::min({ y0, y1, y2 }))), 0);
+        int maxX = std::min(int(std::ceil(std::max({ x0, x1, x2 }))), kOverdrawViewport - 1);
+        int maxY = std::min(int(std::ceil(std::max({ y0, y1, y2 }))), kOverdrawViewport - 1);
+
+        float invArea = 1.0f / area;
+        for (int y = minY; y <= maxY; y++)
+        {
+            for (int x = minX; x <= maxX; x++)
+            {
+                float px = float(x) + 0.5f;
+                float py = float(y) + 0.5f;
+                float w0 = EdgeFunction(x1, y1, x2, y2, px, py) * invArea;
+                float w1 = EdgeFunction(x2, y2, x0, y0, px, py) * invArea;
+                float w2 = EdgeFunction(x0, y0, x1, y1, px, py) * invArea;
+                if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) continue;
+
+                float z = w0 * z0 + w1 * z1 + w2 * z2;
+                float& stored = buffer.depth[y][x][side];
+                if (z < stored)
+                {
+                    stored = z;
+                    buffer.shaded++;
+                }
+            }
+        }
+    }
+
+    Float3 Sub(const Float3& a, const Float3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+    Float3 Add(const Float3& a, const Float3& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+    Float3 Scale(const Float3& a, float s) { return { a.x * s, a.y * s, a.z * s }; }
+    float Dot(const Float3& a, const Float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    Float3 Cross(const Float3& a, const Float3& b)
+    {
+        return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    }
+    float Length(const Float3& a) { return std::sqrt(Dot(a, a)); }
+
+    // FIFOキャッシュを模擬する（キーは頂点番号やキャッシュライン番号）
+    class FifoCacheSimulator
+    {
+    public:
+        FifoCacheSimulator(size_t keyCount, uint32_t cacheSize)
+            : mTimestamp(keyCount, 0), mCacheSize(cacheSize), mNow(cacheSize + 1)
+        {
+        }
+
+        void Reset() { mNow += mCacheSize + 1; }
+
+        // ミスしたら true
+        bool Access(size_t key)
+        {
+            if (mNow - mTimestamp[key] > mCacheSize)
+            {
+                mTimestamp[key] = mNow++;
+                return true;
+            }
+            return false;
+        }
+
+        // 三角形1つ分のキャッシュミス数
+        uint32_t AccessTriangle(const uint32_t* tri)
+        {
+            return uint32_t(Access(tri[0])) + uint32_t(Access(tri[1])) + uint32_t(Access(tri[2]));
+        }
+
+    private:
+        std::vector<size_t> mTimestamp;
+        size_t mCacheSize;
+        size_t mNow;
+    };
+
+    // インデックス列の [begin, end) を描画順のままクラスタに区切って mesh.meshlets に足す
+    void AppendMeshlets(MeshData& mesh, size_t begin, size_t end, uint32_t maxVertices, uint32_t maxTriangles,
+        std::vector<uint32_t>& mark, uint32_t& current)
+    {
+        const std::vector<MeshVertex>& vertices = mesh.vertices;
+        const std::vector<uint32_t>& indices = mesh.indices;
+        uint32_t vertexCount = 0;
+        Meshlet meshlet;
+
+        auto finish = [&](size_t endIndex)
+        {
+            meshlet.triangleCount = uint32_t((endIndex - meshlet.indexOffset) / 3);
+            if (meshlet.triangleCount == 0) return;
+
+            const uint32_t* tris = &indices[meshlet.indexOffset];
+
+            // 境界球: AABB の中心からの最大距離
+            Float3 lo = vertices[tris[0]].pos, hi = lo;
+            for (uint32_t i = 0; i < meshlet.triangleCount * 3; i++)
+            {
+                const Float3& p = vertices[tris[i]].pos;
+                lo = { std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z) };
+                hi = { std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z) };
+            }
+            meshlet.center = Scale(Add(lo, hi), 0.5f);
+            meshlet.radius = 0.0f;
+            for (uint32_t i = 0; i < meshlet.triangleCount * 3; i++)
+            {
+                meshlet.radius = std::max(meshlet.radius, Length(Sub(vertices[tris[i]].pos, meshlet.center)));
+            }
+
+            // 法線コーン: 面法線の平均を軸にし、最も外れた面との角度から判定の閾値を決める
+            std::vector<Float3> normals(meshlet.triangleCount);
+            Float3 axis = { 0.0f, 0.0f, 0.0f };
+            for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+            {
+                const Float3& p0 = vertices[tris[t * 3 + 0]].pos;
+                const Float3& p1 = vertices[tris[t * 3 + 1]].pos;
+                const Float3& p2 = vertices[tris[t * 3 + 2]].pos;
+                // 左手系・時計回りが表なので (p1 - p0) x (p2 - p0) が表向きの法線
+                Float3 n = Cross(Sub(p1, p0), Sub(p2, p0));
+                float length = Length(n);
+                normals[t] = length > 0.0f ? Scale(n, 1.0f / length) : Float3{ 0.0f, 0.0f, 0.0f };
+                axis = Add(axis, normals[t]);
+            }
+            float axisLength = Length(axis);
+            meshlet.coneCutoff = 1.0f;
+            if (axisLength > 0.0f)
+            {
+                axis = Scale(axis, 1.0f / axisLength);
+                float minDot = 1.0f;
+                for (const Float3& n : normals) minDot = std::min(minDot, Dot(n, axis));
+
+                // 面の向きがばらつくクラスタ（コーンが半球近くまで開く）は判定しない
+                if (minDot > 0.1f)
+                {
+                    // 頂点をすべて面の裏側に見る位置まで軸に沿って下げた点を円錐の頂点にする
+                    float maxT = 0.0f;
+                    for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+                    {
+                        float dn = Dot(axis, normals[t]);
+                        if (dn <= 0.0f) continue;
+                        float dc = Dot(Sub(meshlet.center, vertices[tris[t * 3]].pos), normals[t]);
+                        maxT = std::max(maxT, dc / dn);
+                    }
+                    meshlet.coneAxis = axis;
+                    meshlet.coneApex = Sub(meshlet.center, Scale(axis, maxT));
+                    meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+                }
+            }
+            mesh.meshlets.push_back(meshlet);
+        };
+
+        meshlet.indexOffset = uint32_t(begin);
+        for (size_t i = begin; i + 2 < end; i += 3)
+        {
+            const uint32_t* tri = &indices[i];
+            uint32_t added = uint32_t(mark[tri[0]] != current) + uint32_t(mark[tri[1]] != current && tri[1] != tri[0])
+                + uint32_t(mark[tri[2]] != current && tri[2] != tri[0] && tri[2] != tri[1]);
+
+            const uint32_t triangles = uint32_t((i - meshlet.indexOffset) / 3);
+            if (vertexCount + added > maxVertices || triangles + 1 > maxTriangles)
+            {
+                finish(i);
+                meshlet = Meshlet();
+                meshlet.indexOffset = uint32_t(i);
+                current++;
+                vertexCount = 0;
+                added = uint32_t(tri[0] != tri[1]) + uint32_t(tri[2] != tri[0] && tri[2] != tri[1]) + 1;
+            }
+
+            mark[tri[0]] = mark[tri[1]] = mark[tri[2]] = current;
+            vertexCount += added;
+        }
+        finish(end);
+        current++;
+    }
+
+    // 角ごとの頂点を持つメッシュの三角形の並びを固定のシードで混ぜる（モデリングツールが書き出す順の代わり）
+    // 頂点を3つ組で入れ替えるので、インデックスは 0, 1, 2, ... のまま
+    void ShuffleTriangles(MeshData& mesh, uint32_t seed)
+    {
+        std::vector<MeshVertex>& vertices = mesh.vertices;
+        std::mt19937 rng(seed);
+        for (size_t i = vertices.size() / 3; i > 1; i--)
+        {
+            const size_t j = std::uniform_int_distribution<size_t>(0, i - 1)(rng);
+            for (size_t k = 0; k < 3; k++) std::swap(vertices[(i - 1) * 3 + k], vertices[j * 3 + k]);
+        }
+    }
+}
+
+namespace MeshOptimizer
+{
+    WeldStats WeldVertices(MeshData& mesh)
+    {
+        std::vector<MeshVertex>& vertices = mesh.vertices;
+        const size_t vertexCount = vertices.size();
+
+        WeldStats stats;
+        stats.inputVertexCount = vertexCount;
+
+        // オープンアドレス法のハッシュテーブル（値は統合後の頂点番号）
+        const size_t tableSize = HashTableSize(vertexCount);
+        const size_t mask = tableSize - 1;
+        std::vector<uint32_t> table(tableSize, kEmptySlot);
+        std::vector<uint32_t> remap(vertexCount);
+
+        // 統合後の頂点は先頭から詰めて書くので、追加の頂点配列は不要
+        uint32_t uniqueCount = 0;
+        uint32_t words[kVertexWords];
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            CanonicalizeVertex(vertices[i], words);
+
+            size_t slot = HashVertexWords(words) & mask;
+            for (;;)
+            {
+                uint32_t index = table[slot];
+                if (index == kEmptySlot)
+                {
+                    table[slot] = uniqueCount;
+                    std::memcpy(&vertices[uniqueCount], words, sizeof(MeshVertex));
+                    remap[i] = uniqueCount++;
+                    break;
+                }
+                if (std::memcmp(&vertices[index], words, sizeof(MeshVertex)) == 0)
+                {
+                    remap[i] = index;
+                    break;
+                }
+                slot = (slot + 1) & mask;
+            }
+        }
+
+        for (uint32_t& index : mesh.indices)
+        {
+            index = remap[index];
+        }
+
+        vertices.resize(uniqueCount);
+        vertices.shrink_to_fit();
+
+        stats.outputVertexCount = uniqueCount;
+        return stats;
+    }
+
+    MeshData MakeBenchmarkGrid(uint32_t gridSize)
+    {
+        MeshData mesh;
+        mesh.vertices.reserve(size_t(gridSize) * gridSize * 6);
+        mesh.indices.reserve(size_t(gridSize) * gridSize * 6);
+        for (uint32_t z = 0; z < gridSize; z++)
+        {
+            for (uint32_t x = 0; x < gridSize; x++)
+            {
+                const uint32_t cell[6][2] = { { x, z }, { x, z + 1 }, { x + 1, z }, { x + 1, z }, { x, z + 1 }, { x + 1, z + 1 } };
+                for (const uint32_t (&c)[2] : cell)
+                {
+                    MeshVertex v{};
+                    v.pos = { float(c[0]), 0.0f, float(c[1]) };
+                    v.normal = { 0.0f, 1.0f, 0.0f };
+                    v.uv = { float(c[0]) / float(gridSize), float(c[1]) / float(gridSize) };
+                    v.tangent = { 1.0f, 0.0f, 0.0f, 1.0f };
+                    mesh.indices.push_back(uint32_t(mesh.vertices.size()));
+                    mesh.vertices.push_back(v);
+                }
+            }
+        }
+        return mesh;
+    }
+
+    MeshData MakeBenchmarkSphere(uint32_t rings, uint32_t segments)
+    {
+        const float pi = 3.14159265f;
+        auto point = [&](uint32_t r, uint32_t s)
+        {
+            const float theta = pi * float(r) / float(rings);
+            const float phi = 2.0f * pi * float(s) / float(segments);
+            MeshVertex v{};
+            v.pos = { std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) };
+            v.normal = v.pos;
+            v.uv = { float(s) / float(segments), float(r) / float(rings) };
+            v.tangent = { -std::sin(phi), 0.0f, std::cos(phi), 1.0f };
+            return v;
+        };
+
+        MeshData mesh;
+        auto corner = [&](uint32_t r, uint32_t s)
+        {
+            mesh.indices.push_back(uint32_t(mesh.vertices.size()));
+            mesh.vertices.push_back(point(r, s));
+        };
+        for (uint32_t r = 0; r < rings; r++)
+        {
+            for (uint32_t s = 0; s < segments; s++)
+            {
+                // 極の帯は1マスに三角形1つ
+                if (r > 0)
+                {
+                    corner(r, s);
+                    corner(r, s + 1);
+                    corner(r + 1, s);
+                }
+                if (r + 1 < rings)
+                {
+                    corner(r + 1, s);
+                    corner(r, s + 1);
+                    corner(r + 1, s + 1);
+                }
+            }
+        }
+        return mesh;
+    }
+
+    WeldBenchmarkResult RunWeldBenchmark(uint32_t gridSize, int iterations)
+    {
+        WeldBenchmarkResult result;
+        result.gridSize = gridSize;
+        if (gridSize == 0 || iterations <= 0) return result;
+
+        const MeshData source = MakeBenchmarkGrid(gridSize);
+        result.cornerCount = source.vertices.size();
+        for (int i = 0; i < iterations; i++)
+        {
+            // 溶接はその場で書き換えるので、毎回ばらした状態から測る（コピーは計測に含めない）
+            MeshData mesh = source;
+            auto start = std::chrono::steady_clock::now();
+            const WeldStats stats = WeldVertices(mesh);
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (i == 0 || ms < result.milliseconds) result.milliseconds = ms;
+            result.vertexCount = stats.outputVertexCount;
+        }
+        if (result.milliseconds > 0.0) result.verticesPerSecond = double(result.cornerCount) / (result.milliseconds * 1.0e-3);
+        return result;
+    }
+
+    VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+    {
+        VertexCacheStats stats;
+        if (indices.empty() || cacheSize == 0) return stats;
+
+        FifoCacheSimulator cache(vertexCount, cacheSize);
+        std::vector<bool> used(vertexCount, false);
+        size_t usedCount = 0;
+
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            stats.transformedVertexCount += cache.AccessTriangle(&indices[i]);
+            for (int k = 0; k < 3; k++)
+            {
+                if (!used[indices[i + k]])
+                {
+                    used[indices[i + k]] = true;
+                    usedCount++;
+                }
+            }
+        }
+
+        stats.acmr = float(stats.transformedVertexCount) / float(indices.size() / 3);
+        stats.atvr = float(stats.transformedVertexCount) / float(usedCount);
+        return stats;
+    }
+
+    void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+    {
+        const size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0) return;
+
+        static const ForsythScoreTable scoreTable;
+        const uint32_t kNone = 0xffffffffu;
+
+        // 頂点 -> 隣接三角形リスト（未出力の三角形を先頭 liveCount 個に保つ）
+        std::vector<uint32_t> liveCount(vertexCount, 0);
+        for (uint32_t index : indices) liveCount[index]++;
+
+        std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; v++)
+        {
+            adjacencyOffset[v + 1] = adjacencyOffset[v] + liveCount[v];
+        }
+        std::vector<uint32_t> adjacency(indices.size());
+        {
+            std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+            for (size_t i = 0; i < indices.size(); i++)
+            {
+                adjacency[fill[indices[i]]++] = uint32_t(i / 3);
+            }
+        }
+
+        std::vector<float> vertexScore(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+        {
+            vertexScore[v] = scoreTable.Score(-1, liveCount[v]);
+        }
+
+        std::vector<float> triangleScore(triangleCount);
+        std::vector<bool> emitted(triangleCount, false);
+        uint32_t currentTriangle = 0;
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            const uint32_t* tri = &indices[t * 3];
+            triangleScore[t] = vertexScore[tri[0]] + vertexScore[tri[1]] + vertexScore[tri[2]];
+            if (triangleScore[t] > triangleScore[currentTriangle]) currentTriangle = uint32_t(t);
+        }
+
+        uint32_t cache[kForsythCacheSize + 3];
+        uint32_t newCache[kForsythCacheSize + 3];
+        int cacheCount = 0;
+
+        std::vector<uint32_t> result(indices.size());
+        size_t inputCursor = 0;
+
+        for (size_t out = 0; out < triangleCount; out++)
+        {
+            if (currentTriangle == kNone)
+            {
+                // キャッシュ内に候補がない場合は入力順で次の未出力三角形から再開
+                while (emitted[inputCursor]) inputCursor++;
+                currentTriangle = uint32_t(inputCursor);
+            }
+
+            const uint32_t a = indices[currentTriangle * 3 + 0];
+            const uint32_t b = indices[currentTriangle * 3 + 1];
+            const uint32_t c = indices[currentTriangle * 3 + 2];
+            result[out * 3 + 0] = a;
+            result[out * 3 + 1] = b;
+            result[out * 3 + 2] = c;
+            emitted[currentTriangle] = true;
+
+            // 出力した三角形の頂点をキャッシュ先頭へ（LRU）
+            int newCount = 0;
+            newCache[newCount++] = a;
+            newCache[newCount++] = b;
+            newCache[newCount++] = c;
+            for (int i = 0; i < cacheCount; i++)
+            {
+                uint32_t v = cache[i];
+                if (v != a && v != b && v != c) newCache[newCount++] = v;
+            }
+
+            // 隣接リストから出力済み三角形を外す
+            for (uint32_t v : { a, b, c })
+            {
+                uint32_t* list = &adjacency[adjacencyOffset[v]];
+                for (uint32_t i = 0; i < liveCount[v]; i++)
+                {
+                    if (list[i] == currentTriangle)
+                    {
+                        list[i] = list[liveCount[v] - 1];
+                        list[liveCount[v] - 1] = currentTriangle;
+                        liveCount[v]--;
+                        break;
+                    }
+                }
+            }
+
+            // キャッシュ内（と押し出された）頂点のスコアを更新し、差分を三角形スコアへ反映
+            for (int i = 0; i < newCount; i++)
+            {
+                uint32_t v = newCache[i];
+                int position = i < kForsythCacheSize ? i : -1;
+
+                float score = scoreTable.Score(position, liveCount[v]);
+                float delta = score - vertexScore[v];
+                vertexScore[v] = score;
+
+                const uint32_t* list = &adjacency[adjacencyOffset[v]];
+                for (uint32_t j = 0; j < liveCount[v]; j++)
+                {
+                    triangleScore[list[j]] += delta;
+                }
+            }
+
+            // 次の三角形はキャッシュ内頂点に接するものから最高スコアを選ぶ
+            currentTriangle = kNone;
+            float bestScore = 0.0f;
+            cacheCount = std::min(newCount, kForsythCacheSize);
+            for (int i = 0; i < cacheCount; i++)
+            {
+                uint32_t v = newCache[i];
+                cache[i] = v;
+
+                const uint32_t* list = &adjacency[adjacencyOffset[v]];
+                for (uint32_t j = 0; j < liveCount[v]; j++)
+                {
+                    uint32_t t = list[j];
+                    if (currentTriangle == kNone || triangleScore[t] > bestScore)
+                    {
+                        currentTriangle = t;
+                        bestScore = triangleScore[t];
+                    }
+                }
+            }
+        }
+
+        indices.swap(result);
+    }
+
+    OverdrawStats AnalyzeOverdraw(const std::vector<uint32_t>& indices, const std::vector<MeshVertex>& vertices)
+    {
+        OverdrawStats stats;
+        if (indices.empty() || vertices.empty()) return stats;
+
+        // バウンディングボックスの最大辺で [0,1] に正規化
+        Float3 minP = vertices[0].pos, maxP = vertices[0].pos;
+        for (const MeshVertex& v : vertices)
+        {
+            minP = { std::min(minP.x, v.pos.x), std::min(minP.y, v.pos.y), std::min(minP.z, v.pos.z) };
+            maxP = { std::max(maxP.x, v.pos.x), std::max(maxP.y, v.pos.y), std::max(maxP.z, v.pos.z) };
+        }
+        float extent = std::max({ maxP.x - minP.x, maxP.y - minP.y, maxP.z - minP.z });
+        float scale = extent > 0.0f ? 1.0f / extent : 0.0f;
+
+        std::vector<Float3> normalized(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++)
+        {
+            normalized[i] = Scale(Sub(vertices[i].pos, minP), scale);
+        }
+
+        std::unique_ptr<OverdrawBuffer> buffer = std::make_unique<OverdrawBuffer>();
+        const float size = float(kOverdrawViewport);
+
+        // X/Y/Z 軸それぞれの正負2方向（表裏）から見る
+        for (int axis = 0; axis < 3; axis++)
+        {
+            OverdrawBuffer& b = *buffer;
+            std::fill(&b.depth[0][0][0], &b.depth[0][0][0] + kOverdrawViewport * kOverdrawViewport * 2, 1.0f + 1e-6f);
+            b.shaded = 0;
+
+            for (size_t i = 0; i + 2 < indices.size(); i += 3)
+            {
+                float sx[3], sy[3], sz[3];
+                for (int k = 0; k < 3; k++)
+                {
+                    const Float3& p = normalized[indices[i + k]];
+                    const float c[3] = { p.x, p.y, p.z };
+                    sx[k] = c[(axis + 1) % 3] * size;
+                    sy[k] = c[(axis + 2) % 3] * size;
+                    sz[k] = c[axis];
+                }
+                RasterizeOverdraw(b, sx[0], sy[0], sz[0], sx[1], sy[1], sz[1], sx[2], sy[2], sz[2]);
+            }
+
+            for (int y = 0; y < kOverdrawViewport; y++)
+            {
+                for (int x = 0; x < kOverdrawViewport; x++)
+                {
+                    for (int side = 0; side < 2; side++)
+                    {
+                        if (b.depth[y][x][side] <= 1.0f) stats.pixelsCovered++;
+                    }
+                }
+            }
+            stats.pixelsShaded += b.shaded;
+        }
+
+        stats.overdraw = stats.pixelsCovered > 0 ? float(stats.pixelsShaded) / float(stats.pixelsCovered) : 0.0f;
+        return stats;
+    }
+
+    void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<MeshVertex>& vertices, float threshold)
+    {
+        const size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0) return;
+
+        const uint32_t kCacheSize = 16;
+        const size_t kMinClusterTriangles = 8;
+
+        // ハード境界：キャッシュが全ミスになる三角形（ストリップの切れ目）
+        std::vector<size_t> hardBoundaries;
+        {
+            FifoCacheSimulator cache(vertices.size(), kCacheSize);
+            for (size_t t = 0; t < triangleCount; t++)
+            {
+                if (cache.AccessTriangle(&indices[t * 3]) == 3 && t > 0) hardBoundaries.push_back(t);
+            }
+            hardBoundaries.push_back(triangleCount);
+        }
+
+        // ソフト境界：クラスタ内で ACMR が threshold 以内に収まる位置でさらに分割
+        std::vector<size_t> clusters;   // 各クラスタの開始三角形
+        {
+            FifoCacheSimulator cache(vertices.size(), kCacheSize);
+            size_t start = 0;
+            for (size_t end : hardBoundaries)
+            {
+                cache.Reset();
+                size_t clusterMisses = 0;
+                for (size_t t = start; t < end; t++) clusterMisses += cache.AccessTriangle(&indices[t * 3]);
+                float clusterAcmr = float(clusterMisses) / float(end - start);
+
+                cache.Reset();
+                size_t subStart = start;
+                size_t misses = 0;
+                clusters.push_back(start);
+                for (size_t t = start; t < end; t++)
+                {
+                    misses += cache.AccessTriangle(&indices[t * 3]);
+                    size_t count = t + 1 - subStart;
+                    if (t + 1 < end && count >= kMinClusterTriangles &&
+                        float(misses) / float(count) <= threshold * clusterAcmr)
+                    {
+                        subStart = t + 1;
+                        misses = 0;
+                        cache.Reset();
+                        clusters.push_back(subStart);
+                    }
+                }
+                start = end;
+            }
+            clusters.push_back(triangleCount);
+        }
+
+        // メッシュ全体の重心
+        Float3 meshCentroid = { 0.0f, 0.0f, 0.0f };
+        float meshArea = 0.0f;
+        std::vector<float> triangleArea(triangleCount);
+        std::vector<Float3> triangleCentroid(triangleCount);
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            const Float3& p0 = vertices[indices[t * 3 + 0]].pos;
+            const Float3& p1 = vertices[indices[t * 3 + 1]].pos;
+            const Float3& p2 = vertices[indices[t * 3 + 2]].pos;
+            triangleArea[t] = Length(Cross(Sub(p1, p0), Sub(p2, p0))) * 0.5f;
+            triangleCentroid[t] = Scale(Add(Add(p0, p1), p2), 1.0f / 3.0f);
+            meshCentroid = Add(meshCentroid, Scale(triangleCentroid[t], triangleArea[t]));
+            meshArea += triangleArea[t];
+        }
+        if (meshArea > 0.0f) meshCentroid = Scale(meshCentroid, 1.0f / meshArea);
+
+        // クラスタごとに「重心からどれだけ外を向いているか」をソートキーにする
+        const size_t clusterCount = clusters.size() - 1;
+        std::vector<float> sortKey(clusterCount);
+        for (size_t c = 0; c < clusterCount; c++)
+        {
+            Float3 centroid = { 0.0f, 0.0f, 0.0f };
+            Float3 normal = { 0.0f, 0.0f, 0.0f };
+            float area = 0.0f;
+            for (size_t t = clusters[c]; t < clusters[c + 1]; t++)
+            {
+                // 巻き順に依存しないよう、面の向きはインポートした頂点法線から取る
+                Float3 n = Add(Add(vertices[indices[t * 3 + 0]].normal, vertices[indices[t * 3 + 1]].normal),
+                    vertices[indices[t * 3 + 2]].normal);
+                normal = Add(normal, Scale(n, triangleArea[t]));
+                centroid = Add(centroid, Scale(triangleCentroid[t], triangleArea[t]));
+                area += triangleArea[t];
+            }
+            if (area > 0.0f) centroid = Scale(centroid, 1.0f / area);
+            float normalLength = Length(normal);
+            sortKey[c] = normalLength > 0.0f ? Dot(Sub(centroid, meshCentroid), normal) / normalLength : 0.0f;
+        }
+
+        std::vector<uint32_t> order(clusterCount);
+        for (size_t c = 0; c < clusterCount; c++) order[c] = uint32_t(c);
+        std::stable_sort(order.begin(), order.end(),
+            [&](uint32_t a, uint32_t b) { return sortKey[a] > sortKey[b]; });
+
+        std::vector<uint32_t> result;
+        result.reserve(indices.size());
+        for (uint32_t c : order)
+        {
+            result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+        }
+        indices.swap(result);
+    }
+
+    VertexFetchStats AnalyzeVertexFetch(const std::vector<uint32_t>& indices, size_t vertexCount, size_t vertexSize)
+    {
+        VertexFetchStats stats;
+        if (indices.empty() || vertexSize == 0) return stats;
+
+        const size_t kCacheLine = 64;
+        const uint32_t kCacheLines = 64;    // 4KB 程度の頂点フェッチキャッシュを想定
+
+        // 変換済み頂点はポストトランスフォームキャッシュから出るので、フェッチするのはミス時のみ
+        FifoCacheSimulator vertexCache(vertexCount, 16);
+        FifoCacheSimulator lineCache((vertexCount * vertexSize + kCacheLine - 1) / kCacheLine, kCacheLines);
+        std::vector<bool> used(vertexCount, false);
+        size_t usedCount = 0;
+
+        for (uint32_t index : indices)
+        {
+            if (!used[index])
+            {
+                used[index] = true;
+                usedCount++;
+            }
+            if (!vertexCache.Access(index)) continue;
+
+            size_t firstLine = index * vertexSize / kCacheLine;
+            size_t lastLine = ((index + 1) * vertexSize - 1) / kCacheLine;
+            for (size_t line = firstLine; line <= lastLine; line++)
+            {
+                if (lineCache.Access(line))
+                {
+                    stats.cacheLineMisses++;
+                    stats.bytesFetched += kCacheLine;
+                }
+            }
+        }
+
+        stats.overfetch = float(stats.bytesFetched) / float(usedCount * vertexSize);
+        return stats;
+    }
+
+    size_t OptimizeVertexFetch(MeshData& mesh, size_t vertexSize)
+    {
+        const uint32_t kUnused = 0xffffffffu;
+        const size_t vertexCount = mesh.vertices.size();
+
+        // 初出順の番号
+        std::vector<uint32_t> firstUse(vertexCount, kUnused);
+        uint32_t usedCount = 0;
+        for (uint32_t index : mesh.indices)
+        {
+            if (firstUse[index] == kUnused) firstUse[index] = usedCount++;
+        }
+
+        // 元の並びのまま未使用頂点だけを詰めた番号
+        std::vector<uint32_t> compacted(vertexCount, kUnused);
+        uint32_t next = 0;
+        for (size_t v = 0; v < vertexCount; v++)
+        {
+            if (firstUse[v] != kUnused) compacted[v] = next++;
+        }
+
+        // 入力がすでに局所性の高い並び（走査順の格子など）だと、初出順のほうがキャッシュラインの読み込みが増えることがある
+        // GPU に渡す頂点の大きさで両方を測り、初出順がはっきり良いときだけ使う
+        std::vector<uint32_t> firstUseIndices(mesh.indices.size()), compactedIndices(mesh.indices.size());
+        for (size_t i = 0; i < mesh.indices.size(); i++)
+        {
+            firstUseIndices[i] = firstUse[mesh.indices[i]];
+            compactedIndices[i] = compacted[mesh.indices[i]];
+        }
+        const bool useFirstUse = AnalyzeVertexFetch(firstUseIndices, usedCount, vertexSize).cacheLineMisses <
+            AnalyzeVertexFetch(compactedIndices, usedCount, vertexSize).cacheLineMisses;
+        const std::vector<uint32_t>& remap = useFirstUse ? firstUse : compacted;
+
+        std::vector<MeshVertex> result(usedCount);
+        for (size_t v = 0; v < vertexCount; v++)
+        {
+            if (remap[v] != kUnused) result[remap[v]] = mesh.vertices[v];
+        }
+        mesh.indices.swap(useFirstUse ? firstUseIndices : compactedIndices);
+        mesh.vertices.swap(result);
+        return mesh.vertices.size();
+    }
+
+    void BuildMeshlets(MeshData& mesh, uint32_t maxVertices, uint32_t maxTriangles)
+    {
+        mesh.meshlets.clear();
+        if (maxVertices < 3 || maxTriangles < 1) return;
+
+        // 今のクラスタに入っている頂点の印（クラスタ番号 + 1。LOD をまたいで番号を続ける）
+        std::vector<uint32_t> mark(mesh.vertices.size(), 0);
+        uint32_t current = 1;
+
+        if (mesh.lods.empty())
+        {
+            AppendMeshlets(mesh, 0, mesh.indices.size() - mesh.indices.size() % 3, maxVertices, maxTriangles, mark, current);
+            return;
+        }
+        for (MeshLod& lod : mesh.lods)
+        {
+            lod.meshletOffset = uint32_t(mesh.meshlets.size());
+            AppendMeshlets(mesh, lod.indexOffset, size_t(lod.indexOffset) + lod.indexCount, maxVertices, maxTriangles, mark, current);
+            lod.meshletCount = uint32_t(mesh.meshlets.size()) - lod.meshletOffset;
+        }
+    }
+
+    std::vector<OptimizeBenchmarkMesh> RunOptimizeBenchmark()
+    {
+        struct Sample
+        {
+            const char* name;
+            MeshData mesh;
+            bool shuffle;
+        };
+        Sample samples[] =
+        {
+            { "grid", MakeBenchmarkGrid(256), false },
+            { "grid shuffled", MakeBenchmarkGrid(256), true },
+            { "sphere", MakeBenchmarkSphere(96, 128), false },
+            { "sphere shuffled", MakeBenchmarkSphere(96, 128), true },
+        };
+
+        const MeshImportOptions options;
+        std::vector<OptimizeBenchmarkMesh> results;
+        for (Sample& sample : samples)
+        {
+            // インポートと同じく角ごとの頂点を溶接するので、頂点の並びは元の三角形の順での初出順になる
+            MeshData& mesh = sample.mesh;
+            if (sample.shuffle) ShuffleTriangles(mesh, 12345);
+            WeldVertices(mesh);
+
+            OptimizeBenchmarkMesh result;
+            result.name = sample.name;
+            result.triangleCount = mesh.indices.size() / 3;
+            result.vertexCount = mesh.vertices.size();
+            result.cacheBefore = AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+            OptimizeVertexCache(mesh.indices, mesh.vertices.size());
+            OptimizeOverdraw(mesh.indices, mesh.vertices, options.overdrawThreshold);
+            result.cacheAfter = AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+            const size_t stride = VertexFormatStride(options.vertexFormat);
+            result.fetchBefore = AnalyzeVertexFetch(mesh.indices, mesh.vertices.size(), stride);
+            OptimizeVertexFetch(mesh, stride);
+            result.fetchAfter = AnalyzeVertexFetch(mesh.indices, mesh.vertices.size(), stride);
+            results.push_back(result);
+        }
+        return results;
+    }
+}
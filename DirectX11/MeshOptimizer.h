@@ -0,0 +1,103 @@
+﻿#pragma once
+#include <cstddef>
+#include "MeshData.h"
+
+// インポート後のメッシュに掛ける最適化パス群（CPUのみ・D3D非依存）
+namespace MeshOptimizer
+{
+    struct WeldStats
+    {
+        size_t inputVertexCount = 0;
+        size_t outputVertexCount = 0;
+    };
+
+    // 位置・法線・UVがビット単位で一致する頂点を1つにまとめ、インデックスを振り直す
+    // （-0.0 と +0.0 は同一視する）。頂点の並びは初出順を保つ
+    WeldStats WeldVertices(MeshData& mesh);
+
+    struct WeldBenchmarkResult
+    {
+        uint32_t gridSize = 0;
+        size_t cornerCount = 0;         // 溶接前の頂点数（三角形の角ごとに1つ）
+        size_t vertexCount = 0;         // 溶接後の頂点数（格子点の数 (gridSize + 1)^2 になるはず）
+        double milliseconds = 0.0;      // 最良の1回
+        double verticesPerSecond = 0.0; // 溶接前の頂点数 / 秒
+    };
+
+    // 角ごとにばらした gridSize x gridSize マスの格子（FBX から読んだ直後と同じ形）を溶接する時間を測る
+    WeldBenchmarkResult RunWeldBenchmark(uint32_t gridSize = 600, int iterations = 5);
+
+    // 頂点後処理キャッシュの効率（ACMR: 三角形あたりの変換頂点数 / ATVR: 頂点あたり）
+    struct VertexCacheStats
+    {
+        size_t transformedVertexCount = 0;
+        float acmr = 0.0f;
+        float atvr = 0.0f;
+    };
+
+    // FIFOキャッシュを模擬して頂点シェーダーの実行回数を数える
+    VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = 16);
+
+    // Forsyth 法で三角形の順序を並べ替え、頂点後処理キャッシュのヒット率を上げる
+    void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+    // オーバードロー（塗られたピクセル数 / 覆われたピクセル数）
+    struct OverdrawStats
+    {
+        size_t pixelsCovered = 0;
+        size_t pixelsShaded = 0;
+        float overdraw = 0.0f;
+    };
+
+    // 軸方向6視点からの正射影でCPUラスタライズし、深度テストを通ったフラグメント数を数える
+    OverdrawStats AnalyzeOverdraw(const std::vector<uint32_t>& indices, const std::vector<MeshVertex>& vertices);
+
+    // キャッシュ最適化済みの三角形列をクラスタに分け、外向きの面が先に描かれるよう並べ替える
+    // threshold はクラスタ分割で許容する ACMR の悪化率（1.05 なら 5% まで）
+    // OptimizeVertexCache の後に呼ぶこと
+    void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<MeshVertex>& vertices, float threshold);
+
+    // 頂点フェッチのメモリ効率（64byteキャッシュラインのFIFOを模擬）
+    struct VertexFetchStats
+    {
+        size_t cacheLineMisses = 0;
+        size_t bytesFetched = 0;
+        float overfetch = 0.0f;     // 読み込んだバイト数 / 使用頂点の総バイト数
+    };
+
+    VertexFetchStats AnalyzeVertexFetch(const std::vector<uint32_t>& indices, size_t vertexCount, size_t vertexSize);
+
+    // インデックスで最初に参照された順に頂点を並べ直す（未使用頂点は削除）
+    // vertexSize（GPU に渡す頂点の大きさ）で AnalyzeVertexFetch を測り、初出順のほうがキャッシュラインのミスが
+    // 少ないときだけ並べ直す。そうでなければ元の並びのまま未使用頂点だけを詰める
+    // 頂点配列とインデックスの両方を書き換え、新しい頂点数を返す
+    size_t OptimizeVertexFetch(MeshData& mesh, size_t vertexSize);
+
+    // 三角形を描画順のまま、頂点数 maxVertices / 三角形数 maxTriangles 以下のクラスタに区切る
+    // 最適化済みの順序は局所性が高いので、順に詰めるだけで空間的にまとまったクラスタになる
+    // mesh.lods があれば LOD ごとに区切って各 LOD のクラスタの範囲を設定する
+    // mesh.meshlets を置き換える（最適化パスの最後に呼ぶこと）
+    void BuildMeshlets(MeshData& mesh, uint32_t maxVertices, uint32_t maxTriangles);
+
+    // ベンチマーク用の見本メッシュ。三角形の角ごとに頂点を持つ形で作る（インデックスは 0, 1, 2, ...。WeldVertices で溶接して使う）
+    // 格子点 (gridSize + 1)^2 個の平面
+    MeshData MakeBenchmarkGrid(uint32_t gridSize);
+    // 半径 1 の UV 球（経度 0 と 1 の継ぎ目は UV が違うので溶接しても別の頂点になる）
+    MeshData MakeBenchmarkSphere(uint32_t rings, uint32_t segments);
+
+    // 見本メッシュ1つに最適化パスを掛けた前後の指標
+    struct OptimizeBenchmarkMesh
+    {
+        const char* name = "";
+        size_t triangleCount = 0;
+        size_t vertexCount = 0;
+        VertexCacheStats cacheBefore;   // 溶接した直後（元の三角形の順のまま）
+        VertexCacheStats cacheAfter;    // 頂点キャッシュとオーバードローの並べ替えの後
+        VertexFetchStats fetchBefore;   // 三角形を並べ替えた後、頂点を並べ直す前（Float32 の頂点）
+        VertexFetchStats fetchAfter;
+    };
+
+    // 組み込みの見本メッシュ（格子と球を、走査順と三角形をシャッフルした順の2通りで）を
+    // インポートと同じ順に最適化して、パスの前後の指標を測る
+    std::vector<OptimizeBenchmarkMesh> RunOptimizeBenchmark();
+}
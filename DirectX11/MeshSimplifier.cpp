@@ -0,0 +1,452 @@
+﻿#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+    constexpr uint32_t kNone = 0xffffffffu;
+
+    // 対称 4x4 行列で表した平面の二次誤差（w は面積の合計）
+    struct Quadric
+    {
+        double a2 = 0, b2 = 0, c2 = 0, d2 = 0;
+        double ab = 0, ac = 0, ad = 0, bc = 0, bd = 0, cd = 0;
+        double w = 0;
+
+        // (a, b, c, d) の平面からの距離の二乗を weight 倍して足す（正規化していない平面なら値の一次式の二乗）
+        void AddPlane(double a, double b, double c, double d, double weight)
+        {
+            a2 += weight * a * a; b2 += weight * b * b; c2 += weight * c * c; d2 += weight * d * d;
+            ab += weight * a * b; ac += weight * a * c; ad += weight * a * d;
+            bc += weight * b * c; bd += weight * b * d; cd += weight * c * d;
+        }
+
+        void Add(const Quadric& q)
+        {
+            a2 += q.a2; b2 += q.b2; c2 += q.c2; d2 += q.d2;
+            ab += q.ab; ac += q.ac; ad += q.ad; bc += q.bc; bd += q.bd; cd += q.cd;
+            w += q.w;
+        }
+
+        double Evaluate(const Float3& p) const
+        {
+            const double x = p.x, y = p.y, z = p.z;
+            return a2 * x * x + b2 * y * y + c2 * z * z + d2
+                + 2.0 * (ab * x * y + ac * x * z + ad * x + bc * y * z + bd * y + cd * z);
+        }
+
+        // 面積で割った二乗距離
+        double Error(const Float3& p) const
+        {
+            return w > 0.0 ? std::fabs(Evaluate(p)) / w : 0.0;
+        }
+    };
+
+    // 法線 xyz と UV の 5 成分
+    constexpr int kAttributeCount = 5;
+
+    void GetAttributes(const MeshVertex& v, float (&out)[kAttributeCount])
+    {
+        out[0] = v.normal.x; out[1] = v.normal.y; out[2] = v.normal.z;
+        out[3] = v.uv.x; out[4] = v.uv.y;
+    }
+
+    // 属性の二次誤差（三角形の上で線形に補間した属性と、寄せ先の頂点の属性の差の二乗）
+    // 各成分を s(p) = g・p + d の一次式として持ち、(s(p) - s)^2 を展開した係数を貯める
+    struct AttributeQuadric
+    {
+        Quadric gradient[kAttributeCount];      // (g・p + d)^2
+        double linear[kAttributeCount][4] = {}; // g・p + d の係数の和
+        double w = 0;
+
+        void Add(const AttributeQuadric& q)
+        {
+            for (int k = 0; k < kAttributeCount; k++)
+            {
+                gradient[k].Add(q.gradient[k]);
+                for (int i = 0; i < 4; i++) linear[k][i] += q.linear[k][i];
+            }
+            w += q.w;
+        }
+
+        // 重み付きの二乗誤差の和（面積で割る）
+        double Error(const Float3& p, const float (&attributes)[kAttributeCount], const float (&weights)[kAttributeCount]) const
+        {
+            if (w <= 0.0) return 0.0;
+            double error = 0.0;
+            for (int k = 0; k < kAttributeCount; k++)
+            {
+                const double s = attributes[k];
+                const double* l = linear[k];
+                double e = gradient[k].Evaluate(p) - 2.0 * s * (l[0] * p.x + l[1] * p.y + l[2] * p.z + l[3]) + s * s * w;
+                error += weights[k] * std::fabs(e);
+            }
+            return error / w;
+        }
+    };
+
+    Float3 Sub(const Float3& a, const Float3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+    float Dot(const Float3& a, const Float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    Float3 Cross(const Float3& a, const Float3& b)
+    {
+        return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    }
+
+    struct Collapse
+    {
+        uint32_t from;      // 位置グループ番号
+        uint32_t to;
+        float cost;         // 並べ替えに使う誤差（属性を含む）
+        float geometric;    // 形状だけの二乗誤差
+    };
+
+    uint64_t EdgeKey(uint32_t a, uint32_t b)
+    {
+        return a < b ? (uint64_t(a) << 32 | b) : (uint64_t(b) << 32 | a);
+    }
+}
+
+namespace MeshSimplifier
+{
+    size_t Simplify(const std::vector<MeshVertex>& vertices, const uint32_t* indices, size_t indexCount,
+        const std::vector<size_t>& targetIndexCounts, const SimplifyOptions& options, std::vector<SimplifiedLevel>& levels)
+    {
+        levels.clear();
+        std::vector<uint32_t> result(indices, indices + indexCount - indexCount % 3);
+        if (result.empty() || targetIndexCounts.empty()) return 0;
+
+        // 位置をメッシュの大きさで [0, 1] に正規化する（誤差と重みをメッシュの大きさに依存させない）
+        Float3 lo = vertices[result[0]].pos, hi = lo;
+        for (uint32_t v : result)
+        {
+            const Float3& p = vertices[v].pos;
+            lo = { std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z) };
+            hi = { std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z) };
+        }
+        const float extent = std::max({ hi.x - lo.x, hi.y - lo.y, hi.z - lo.z });
+        const float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+
+        // 同じ位置の頂点（UV / 法線の継ぎ目で分かれた頂点）を1つの位置グループにまとめる
+        const size_t vertexCount = vertices.size();
+        std::vector<uint32_t> group(vertexCount, kNone);
+        std::vector<Float3> positions;              // グループの正規化済み位置
+        std::vector<std::vector<uint32_t>> wedges;  // グループに属する頂点
+        {
+            struct PositionHash
+            {
+                size_t operator()(const Float3& p) const
+                {
+                    uint32_t w[3];
+                    std::memcpy(w, &p, sizeof(w));
+                    return size_t(w[0] * 73856093u ^ w[1] * 19349663u ^ w[2] * 83492791u);
+                }
+            };
+            struct PositionEqual
+            {
+                bool operator()(const Float3& a, const Float3& b) const { return a.x == b.x && a.y == b.y && a.z == b.z; }
+            };
+            std::unordered_map<Float3, uint32_t, PositionHash, PositionEqual> lookup;
+            for (uint32_t v : result)
+            {
+                if (group[v] != kNone) continue;
+                Float3 p = vertices[v].pos;
+                p = { p.x + 0.0f, p.y + 0.0f, p.z + 0.0f };     // -0.0 を +0.0 に揃える
+                auto inserted = lookup.emplace(p, uint32_t(positions.size()));
+                if (inserted.second)
+                {
+                    positions.push_back({ (p.x - lo.x) * scale, (p.y - lo.y) * scale, (p.z - lo.z) * scale });
+                    wedges.emplace_back();
+                }
+                group[v] = inserted.first->second;
+                wedges[group[v]].push_back(v);
+            }
+        }
+        const size_t groupCount = positions.size();
+
+        // 面積で重み付けした平面の二次誤差（位置グループごと）と属性の二次誤差（頂点ごと）
+        std::vector<Quadric> quadrics(groupCount);
+        std::vector<AttributeQuadric> attributeQuadrics(vertexCount);
+        for (size_t t = 0; t < result.size(); t += 3)
+        {
+            const uint32_t* tri = &result[t];
+            const Float3& p0 = positions[group[tri[0]]];
+            const Float3& p1 = positions[group[tri[1]]];
+            const Float3& p2 = positions[group[tri[2]]];
+            const Float3 e1 = Sub(p1, p0), e2 = Sub(p2, p0);
+            Float3 n = Cross(e1, e2);
+            double length = std::sqrt(double(Dot(n, n)));
+            if (length == 0.0) continue;
+            double a = n.x / length, b = n.y / length, c = n.z / length;
+            double d = -(a * p0.x + b * p0.y + c * p0.z);
+            double area = length * 0.5;
+            for (int k = 0; k < 3; k++)
+            {
+                Quadric& q = quadrics[group[tri[k]]];
+                q.AddPlane(a, b, c, d, area);
+                q.w += area;
+            }
+
+            // 属性の勾配 g: g・e1 = s1 - s0, g・e2 = s2 - s0 を満たす面内のベクトル
+            const double d11 = Dot(e1, e1), d12 = Dot(e1, e2), d22 = Dot(e2, e2);
+            const double det = d11 * d22 - d12 * d12;
+            if (det <= 0.0) continue;
+            float s[3][kAttributeCount];
+            for (int k = 0; k < 3; k++) GetAttributes(vertices[tri[k]], s[k]);
+            AttributeQuadric contribution;
+            contribution.w = area;
+            for (int k = 0; k < kAttributeCount; k++)
+            {
+                const double ds1 = double(s[1][k]) - s[0][k], ds2 = double(s[2][k]) - s[0][k];
+                const double u = (d22 * ds1 - d12 * ds2) / det, v = (d11 * ds2 - d12 * ds1) / det;
+                const double gx = u * e1.x + v * e2.x, gy = u * e1.y + v * e2.y, gz = u * e1.z + v * e2.z;
+                const double gd = s[0][k] - (gx * p0.x + gy * p0.y + gz * p0.z);
+                contribution.gradient[k].AddPlane(gx, gy, gz, gd, area);
+                contribution.linear[k][0] = area * gx;
+                contribution.linear[k][1] = area * gy;
+                contribution.linear[k][2] = area * gz;
+                contribution.linear[k][3] = area * gd;
+            }
+            for (int k = 0; k < 3; k++) attributeQuadrics[tri[k]].Add(contribution);
+        }
+
+        // 開いた縁（1枚の三角形にしか使われない辺）や非多様体の辺に乗る頂点は動かさない
+        std::vector<bool> locked(groupCount, false);
+        {
+            std::unordered_map<uint64_t, uint32_t> edgeUse;
+            edgeUse.reserve(result.size());
+            for (size_t t = 0; t < result.size(); t += 3)
+            {
+                for (int k = 0; k < 3; k++)
+                {
+                    uint32_t a = group[result[t + k]], b = group[result[t + (k + 1) % 3]];
+                    if (a != b) edgeUse[EdgeKey(a, b)]++;
+                }
+            }
+            for (const auto& edge : edgeUse)
+            {
+                if ((edge.second == 1 && options.lockBorder) || edge.second > 2)
+                {
+                    locked[uint32_t(edge.first >> 32)] = true;
+                    locked[uint32_t(edge.first)] = true;
+                }
+            }
+        }
+
+        const float n2 = options.normalWeight * options.normalWeight, uv2 = options.uvWeight * options.uvWeight;
+        const float attributeWeights[kAttributeCount] = { n2, n2, n2, uv2, uv2 };
+        const double maxError2 = options.maxError >= FLT_MAX ? DBL_MAX : double(options.maxError) * options.maxError;
+        double worstError = 0.0;
+
+        std::vector<uint32_t> triangleStart(groupCount + 1), triangleList;
+        std::vector<uint32_t> vertexRemap(vertexCount), partners;
+        std::vector<uint8_t> touched(groupCount);
+        std::vector<Collapse> collapses;
+        std::vector<uint64_t> edges;
+
+        // 目標に届いた段ごとに、その時点のインデックス列と誤差を書き出す
+        size_t level = 0;
+        auto emit = [&]()
+        {
+            levels.push_back({ result, float(std::sqrt(worstError)) / scale });
+        };
+
+        for (;;)
+        {
+            while (level < targetIndexCounts.size() && result.size() <= targetIndexCounts[level])
+            {
+                emit();
+                level++;
+            }
+            if (level == targetIndexCounts.size()) break;
+            const size_t targetIndexCount = targetIndexCounts[level];
+            const size_t triangleCount = result.size() / 3;
+
+            // 位置グループ -> 隣接三角形
+            std::fill(triangleStart.begin(), triangleStart.end(), 0);
+            for (uint32_t v : result) triangleStart[group[v] + 1]++;
+            for (size_t g = 0; g < groupCount; g++) triangleStart[g + 1] += triangleStart[g];
+            triangleList.resize(result.size());
+            {
+                std::vector<uint32_t> fill(triangleStart.begin(), triangleStart.end() - 1);
+                for (size_t i = 0; i < result.size(); i++) triangleList[fill[group[result[i]]]++] = uint32_t(i / 3);
+            }
+
+            // from の各頂点を、to と共有する三角形の中の to 側の頂点に対応させる
+            // 対応が取れない / 継ぎ目が潰れる（2頂点が同じ相手に寄る）縮約はしない
+            auto mapWedges = [&](uint32_t from, uint32_t to, std::vector<uint32_t>& out) -> bool
+            {
+                out.clear();
+                for (uint32_t w : wedges[from])
+                {
+                    uint32_t partner = kNone;
+                    for (uint32_t i = triangleStart[from]; i < triangleStart[from + 1] && partner == kNone; i++)
+                    {
+                        const uint32_t* tri = &result[triangleList[i] * 3];
+                        if (tri[0] != w && tri[1] != w && tri[2] != w) continue;
+                        for (int k = 0; k < 3; k++)
+                        {
+                            if (group[tri[k]] == to) partner = tri[k];
+                        }
+                    }
+                    // 今の三角形で使われていない頂点は対応を問わない
+                    if (partner == kNone)
+                    {
+                        bool used = false;
+                        for (uint32_t i = triangleStart[from]; i < triangleStart[from + 1] && !used; i++)
+                        {
+                            const uint32_t* tri = &result[triangleList[i] * 3];
+                            used = tri[0] == w || tri[1] == w || tri[2] == w;
+                        }
+                        if (used) return false;
+                        continue;
+                    }
+                    out.push_back(w);
+                    out.push_back(partner);
+                }
+                for (size_t i = 1; i < out.size(); i += 2)
+                {
+                    for (size_t j = i + 2; j < out.size(); j += 2)
+                    {
+                        if (out[i] == out[j]) return false;
+                    }
+                }
+                return !out.empty();
+            };
+
+            // 縮約後の誤差: 位置の二次誤差 + 寄せた各頂点の属性の二次誤差
+            auto collapseCost = [&](uint32_t from, uint32_t to, const std::vector<uint32_t>& pairs, double& geometric) -> double
+            {
+                geometric = quadrics[from].Error(positions[to]);
+                double cost = geometric;
+                for (size_t i = 0; i < pairs.size(); i += 2)
+                {
+                    float target[kAttributeCount];
+                    GetAttributes(vertices[pairs[i + 1]], target);
+                    cost += attributeQuadrics[pairs[i]].Error(positions[to], target, attributeWeights);
+                }
+                return cost;
+            };
+
+            // 縮約の候補（辺ごとに誤差の小さい向き）
+            edges.clear();
+            for (size_t t = 0; t < result.size(); t += 3)
+            {
+                for (int k = 0; k < 3; k++)
+                {
+                    uint32_t a = group[result[t + k]], b = group[result[t + (k + 1) % 3]];
+                    if (a != b) edges.push_back(EdgeKey(a, b));
+                }
+            }
+            std::sort(edges.begin(), edges.end());
+            edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+            collapses.clear();
+            for (uint64_t edge : edges)
+            {
+                const uint32_t a = uint32_t(edge >> 32), b = uint32_t(edge);
+                double best = DBL_MAX;
+                Collapse collapse{ kNone, kNone, 0.0f, 0.0f };
+                for (int direction = 0; direction < 2; direction++)
+                {
+                    const uint32_t from = direction == 0 ? a : b;
+                    const uint32_t to = direction == 0 ? b : a;
+                    if (locked[from] || !mapWedges(from, to, partners)) continue;
+                    double geometric;
+                    double cost = collapseCost(from, to, partners, geometric);
+                    if (cost < best && geometric <= maxError2)
+                    {
+                        best = cost;
+                        collapse = { from, to, float(cost), float(geometric) };
+                    }
+                }
+                if (collapse.from != kNone) collapses.push_back(collapse);
+            }
+            if (collapses.empty()) break;
+            std::sort(collapses.begin(), collapses.end(),
+                [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+            // 安い順に、1パスで同じ頂点を2回動かさないように縮約する
+            for (size_t v = 0; v < vertexCount; v++) vertexRemap[v] = uint32_t(v);
+            std::fill(touched.begin(), touched.end(), uint8_t(0));
+            const size_t targetTriangles = targetIndexCount / 3;
+            size_t removed = 0;
+            bool any = false;
+            for (const Collapse& c : collapses)
+            {
+                if (triangleCount - removed <= targetTriangles) break;
+                if (touched[c.from] || touched[c.to]) continue;
+
+                // 裏返る三角形ができる縮約はしない
+                bool flips = false;
+                size_t degenerate = 0;
+                for (uint32_t i = triangleStart[c.from]; i < triangleStart[c.from + 1] && !flips; i++)
+                {
+                    const uint32_t* tri = &result[triangleList[i] * 3];
+                    uint32_t g[3] = { group[tri[0]], group[tri[1]], group[tri[2]] };
+                    if (g[0] == c.to || g[1] == c.to || g[2] == c.to)
+                    {
+                        degenerate++;
+                        continue;
+                    }
+                    Float3 p[3], q[3];
+                    for (int k = 0; k < 3; k++)
+                    {
+                        p[k] = positions[g[k]];
+                        q[k] = g[k] == c.from ? positions[c.to] : p[k];
+                    }
+                    Float3 before = Cross(Sub(p[1], p[0]), Sub(p[2], p[0]));
+                    Float3 after = Cross(Sub(q[1], q[0]), Sub(q[2], q[0]));
+                    // 向きが大きく変わる（75度以上）三角形も、縁に立った細い三角形になりやすいので避ける
+                    flips = Dot(before, after) <= 0.25f * std::sqrt(Dot(before, before) * Dot(after, after));
+                }
+                if (flips) continue;
+
+                mapWedges(c.from, c.to, partners);
+                for (size_t i = 0; i < partners.size(); i += 2)
+                {
+                    vertexRemap[partners[i]] = partners[i + 1];
+                    attributeQuadrics[partners[i + 1]].Add(attributeQuadrics[partners[i]]);
+                }
+                quadrics[c.to].Add(quadrics[c.from]);
+
+                // from の周りの三角形は形が変わるので、同じパスでその頂点を動かさない（裏返りの判定が崩れる）
+                for (uint32_t i = triangleStart[c.from]; i < triangleStart[c.from + 1]; i++)
+                {
+                    const uint32_t* tri = &result[triangleList[i] * 3];
+                    touched[group[tri[0]]] = touched[group[tri[1]]] = touched[group[tri[2]]] = 1;
+                }
+                worstError = std::max(worstError, double(c.geometric));
+                removed += degenerate;
+                any = true;
+            }
+            if (!any) break;
+
+            // 縮約を反映し、潰れた三角形を取り除く
+            size_t write = 0;
+            for (size_t t = 0; t < result.size(); t += 3)
+            {
+                uint32_t a = vertexRemap[result[t]], b = vertexRemap[result[t + 1]], c = vertexRemap[result[t + 2]];
+                if (group[a] == group[b] || group[b] == group[c] || group[c] == group[a]) continue;
+                result[write++] = a;
+                result[write++] = b;
+                result[write++] = c;
+            }
+            result.resize(write);
+            for (size_t g = 0; g < groupCount; g++)
+            {
+                // 寄せた先以外には属さなくなった頂点をグループから外す
+                if (touched[g]) wedges[g].erase(std::remove_if(wedges[g].begin(), wedges[g].end(),
+                    [&](uint32_t w) { return vertexRemap[w] != w; }), wedges[g].end());
+            }
+        }
+
+        // 縮約できる辺がなくなって届かなかった段は、それまでより減っていれば最後の状態を1段として出す
+        if (level < targetIndexCounts.size() && (levels.empty() || result.size() < levels.back().indices.size()))
+        {
+            emit();
+        }
+        return levels.size();
+    }
+}
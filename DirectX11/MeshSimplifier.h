@@ -0,0 +1,31 @@
+﻿#pragma once
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MeshData.h"
+
+// 二次誤差（QEM）による辺の縮約でメッシュを簡略化する（CPUのみ・D3D非依存）
+// 頂点は移動も追加もせず既存の頂点に寄せるので、元の頂点バッファを全 LOD で共有できる
+namespace MeshSimplifier
+{
+    struct SimplifyOptions
+    {
+        float normalWeight = 0.5f;      // 法線の差を誤差にどれだけ含めるか（位置はメッシュの大きさを 1 とした単位）
+        float uvWeight = 1.0f;          // UV の差の重み
+        float maxError = FLT_MAX;       // 許容する誤差（メッシュの大きさに対する比）
+        bool lockBorder = true;         // 開いた縁の頂点を動かさない（隣のメッシュとの継ぎ目に隙間を作らない）
+    };
+
+    struct SimplifiedLevel
+    {
+        std::vector<uint32_t> indices;
+        float error = 0.0f;             // モデル空間での形状の誤差（距離）。それまでに縮約した辺の誤差の最大値
+    };
+
+    // indices（三角形リスト）を targetIndexCounts（降順）のそれぞれ以下まで簡略化した段を levels に書き、段数を返す
+    // 1回の簡略化の途中経過を順に取り出すので、二次誤差はどの段も元のメッシュに対して測ったものになる
+    // 誤差が maxError を超える、または縮約できる辺がなくなった時点で止まる（段数が目標の数より少なくなる）
+    size_t Simplify(const std::vector<MeshVertex>& vertices, const uint32_t* indices, size_t indexCount,
+        const std::vector<size_t>& targetIndexCounts, const SimplifyOptions& options, std::vector<SimplifiedLevel>& levels);
+}
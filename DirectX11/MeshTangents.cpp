@@ -0,0 +1,176 @@
+﻿#include "MeshTangents.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "ThreadPool.h"
+
+namespace
+{
+    constexpr size_t kParallelChunk = 16 * 1024;
+
+    // 三角形のコーナーの寄与の種類
+    enum CornerOrientation : uint8_t
+    {
+        kOrientationNegative,   // UV が裏返っている（tangent.w = -1）
+        kOrientationPositive,
+        kOrientationDegenerate, // UV の面積が 0
+    };
+
+    Float3 Sub(const Float3& a, const Float3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+    Float3 Add(const Float3& a, const Float3& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+    Float3 Scale(const Float3& a, float s) { return { a.x * s, a.y * s, a.z * s }; }
+    float Dot(const Float3& a, const Float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    float Length(const Float3& a) { return std::sqrt(Dot(a, a)); }
+
+    Float3 Normalize(const Float3& a)
+    {
+        float length = Length(a);
+        return length > 0.0f ? Scale(a, 1.0f / length) : Float3{ 0.0f, 0.0f, 0.0f };
+    }
+
+    // v を法線 n の接平面に射影して正規化する
+    Float3 ProjectToPlane(const Float3& v, const Float3& n)
+    {
+        return Normalize(Sub(v, Scale(n, Dot(n, v))));
+    }
+
+    // 寄与のない頂点用: 法線に最も直交する軸を射影した接線
+    Float3 FallbackTangent(const Float3& n)
+    {
+        const float ax = std::fabs(n.x), ay = std::fabs(n.y), az = std::fabs(n.z);
+        Float3 axis = ax <= ay && ax <= az ? Float3{ 1.0f, 0.0f, 0.0f }
+            : ay <= az ? Float3{ 0.0f, 1.0f, 0.0f } : Float3{ 0.0f, 0.0f, 1.0f };
+        Float3 t = ProjectToPlane(axis, n);
+        return Length(t) > 0.0f ? t : Float3{ 1.0f, 0.0f, 0.0f };
+    }
+}
+
+namespace MeshTangents
+{
+    TangentStats GenerateTangents(MeshData& mesh, ThreadPool* pool)
+    {
+        TangentStats stats;
+        std::vector<MeshVertex>& vertices = mesh.vertices;
+        std::vector<uint32_t>& indices = mesh.indices;
+        const size_t cornerCount = indices.size() - indices.size() % 3;
+        const size_t triangleCount = cornerCount / 3;
+
+        // 三角形ごと（pool があれば並列）: 接平面に射影した dP/du をコーナーの角で重み付けしたもの
+        std::vector<Float3> cornerTangent(cornerCount);
+        std::vector<uint8_t> cornerOrientation(cornerCount);
+        auto orientTriangles = [&](size_t begin, size_t end)
+        {
+            for (size_t t = begin; t < end; t++)
+            {
+                const uint32_t* tri = &indices[t * 3];
+                const MeshVertex& v0 = vertices[tri[0]];
+                const MeshVertex& v1 = vertices[tri[1]];
+                const MeshVertex& v2 = vertices[tri[2]];
+
+                const Float3 d1 = Sub(v1.pos, v0.pos), d2 = Sub(v2.pos, v0.pos);
+                const float s1 = v1.uv.x - v0.uv.x, t1 = v1.uv.y - v0.uv.y;
+                const float s2 = v2.uv.x - v0.uv.x, t2 = v2.uv.y - v0.uv.y;
+                const float signedArea = s1 * t2 - t1 * s2;
+
+                // UV の行列の逆を行列式で割らずに掛け、向きだけ符号で直す
+                Float3 os = Sub(Scale(d1, t2), Scale(d2, t1));
+                const bool positive = signedArea > 0.0f;
+                const bool degenerate = signedArea == 0.0f || Length(os) == 0.0f;
+                if (!positive) os = Scale(os, -1.0f);
+
+                for (int k = 0; k < 3; k++)
+                {
+                    const size_t c = t * 3 + k;
+                    cornerOrientation[c] = degenerate ? kOrientationDegenerate : positive ? kOrientationPositive : kOrientationNegative;
+                    cornerTangent[c] = { 0.0f, 0.0f, 0.0f };
+                    if (degenerate) continue;
+
+                    // コーナーの角（法線の接平面上で測る）
+                    const MeshVertex& v = vertices[tri[k]];
+                    const Float3& n = v.normal;
+                    const Float3 e1 = ProjectToPlane(Sub(vertices[tri[(k + 1) % 3]].pos, v.pos), n);
+                    const Float3 e2 = ProjectToPlane(Sub(vertices[tri[(k + 2) % 3]].pos, v.pos), n);
+                    const float angle = std::acos(std::min(std::max(Dot(e1, e2), -1.0f), 1.0f));
+                    cornerTangent[c] = Scale(ProjectToPlane(os, n), angle);
+                }
+            }
+        };
+        if (pool) pool->ParallelFor(triangleCount, kParallelChunk, orientTriangles);
+        else orientTriangles(size_t(0), triangleCount);
+        for (uint8_t orientation : cornerOrientation)
+        {
+            stats.degenerateTriangles += orientation == kOrientationDegenerate;
+        }
+        stats.degenerateTriangles /= 3;
+
+        // 頂点 -> コーナーの対応
+        const size_t vertexCount = vertices.size();
+        std::vector<uint32_t> cornerStart(vertexCount + 1, 0), cornerList(cornerCount);
+        for (size_t c = 0; c < cornerCount; c++) cornerStart[indices[c] + 1]++;
+        for (size_t v = 0; v < vertexCount; v++) cornerStart[v + 1] += cornerStart[v];
+        {
+            std::vector<uint32_t> fill(cornerStart.begin(), cornerStart.end() - 1);
+            for (size_t c = 0; c < cornerCount; c++) cornerList[fill[indices[c]]++] = uint32_t(c);
+        }
+
+        // 頂点ごと（pool があれば並列）: 向きごとに合計し、多い方の向きをその頂点の接線にする
+        // 少ない方の向きの接線は複製する頂点のために取っておく
+        std::vector<Float4> splitTangent(vertexCount, Float4{ 0.0f, 0.0f, 0.0f, 0.0f });    // w = 0 なら複製しない
+        auto resolveVertices = [&](size_t begin, size_t end)
+        {
+            for (size_t v = begin; v < end; v++)
+            {
+                Float3 sum[2] = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } };
+                uint32_t count[2] = { 0, 0 };
+                for (uint32_t i = cornerStart[v]; i < cornerStart[v + 1]; i++)
+                {
+                    const uint32_t c = cornerList[i];
+                    const uint8_t orientation = cornerOrientation[c];
+                    if (orientation == kOrientationDegenerate) continue;
+                    sum[orientation] = Add(sum[orientation], cornerTangent[c]);
+                    count[orientation]++;
+                }
+
+                MeshVertex& vertex = vertices[v];
+                const int primary = count[kOrientationPositive] >= count[kOrientationNegative] ? kOrientationPositive : kOrientationNegative;
+                Float3 tangent = ProjectToPlane(sum[primary], vertex.normal);
+                if (Length(tangent) == 0.0f) tangent = FallbackTangent(vertex.normal);
+                vertex.tangent = { tangent.x, tangent.y, tangent.z, primary == kOrientationPositive ? 1.0f : -1.0f };
+
+                const int secondary = 1 - primary;
+                if (count[secondary] > 0)
+                {
+                    Float3 other = ProjectToPlane(sum[secondary], vertex.normal);
+                    if (Length(other) == 0.0f) other = FallbackTangent(vertex.normal);
+                    splitTangent[v] = { other.x, other.y, other.z, secondary == kOrientationPositive ? 1.0f : -1.0f };
+                }
+            }
+        };
+        if (pool) pool->ParallelFor(vertexCount, kParallelChunk, resolveVertices);
+        else resolveVertices(size_t(0), vertexCount);
+
+        // 逆向きの三角形が混ざった頂点を複製し、その三角形のコーナーを付け替える（順序を決めるため直列）
+        for (size_t v = 0; v < vertexCount; v++)
+        {
+            bool contributed = false;
+            for (uint32_t i = cornerStart[v]; i < cornerStart[v + 1] && !contributed; i++)
+            {
+                contributed = cornerOrientation[cornerList[i]] != kOrientationDegenerate;
+            }
+            stats.fallbackVertices += !contributed;
+
+            if (splitTangent[v].w == 0.0f) continue;
+            const uint8_t secondary = splitTangent[v].w > 0.0f ? kOrientationPositive : kOrientationNegative;
+            const uint32_t copy = uint32_t(vertices.size());
+            MeshVertex vertex = vertices[v];
+            vertex.tangent = splitTangent[v];
+            vertices.push_back(vertex);
+            for (uint32_t i = cornerStart[v]; i < cornerStart[v + 1]; i++)
+            {
+                if (cornerOrientation[cornerList[i]] == secondary) indices[cornerList[i]] = copy;
+            }
+            stats.splitVertices++;
+        }
+        return stats;
+    }
+}
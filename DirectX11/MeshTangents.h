@@ -0,0 +1,24 @@
+﻿#pragma once
+#include <cstddef>
+#include "MeshData.h"
+
+class ThreadPool;
+
+// 法線マップ用の接線の生成（CPUのみ・D3D非依存）
+// MikkTSpace 風: 三角形ごとの dP/du を頂点法線の接平面に射影し、角で重み付けして平均する規約は同じだが、
+// 参照実装とビット単位では一致しない（溶接済みの頂点ごとにまとめ、縮退した三角形の扱いも簡略化している）
+// 従法線の向き（tangent.w）は UV の向きで決まり、向きの違う三角形どうしでは頂点を共有しない
+// 従法線は tangent.w * cross(normal, tangent) = +dP/dv。UV は取り込み時に v を反転した後のもの（DirectX 形式の法線マップ）
+namespace MeshTangents
+{
+    struct TangentStats
+    {
+        size_t splitVertices = 0;           // UV の向きが混ざっていたため複製した頂点
+        size_t degenerateTriangles = 0;     // UV の面積が 0 で接線に寄与しない三角形
+        size_t fallbackVertices = 0;        // 寄与がなく法線から適当な接線を作った頂点
+    };
+
+    // 溶接済みのメッシュの全頂点に tangent を書く（頂点が増えることがある）
+    // pool があれば三角形ごと・頂点ごとの処理を並列に行う
+    TangentStats GenerateTangents(MeshData& mesh, ThreadPool* pool = nullptr);
+}
@@ -0,0 +1,527 @@
+﻿#include "MipGenerator.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <string_view>
+#include "Hash.h"
+#include "ThreadPool.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define MIP_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    // 1スレッドに渡す最小の画素数（これより少ない段は行の帯に分けない）
+    constexpr size_t kParallelPixels = 16384;
+
+    constexpr double kPi = 3.14159265358979323846;
+
+    // sRGB 8bit -> 線形
+    const float* SrgbToLinearTable()
+    {
+        static const std::vector<float> table = []()
+        {
+            std::vector<float> t(256);
+            for (int i = 0; i < 256; i++)
+            {
+                const double c = i / 255.0;
+                t[i] = float(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+            }
+            return t;
+        }();
+        return table.data();
+    }
+
+    // 線形 [0, 1] を 65535 段に量子化した値 -> sRGB 8bit
+    // 8bit の暗い側の1段（線形で約 0.0003）よりも十分細かいので、式で求めた値と丸めが変わるのは境目のごく近くだけ
+    constexpr int kLinearSteps = 65535;
+    const uint8_t* LinearToSrgbTable()
+    {
+        static const std::vector<uint8_t> table = []()
+        {
+            std::vector<uint8_t> t(kLinearSteps + 1);
+            for (int i = 0; i <= kLinearSteps; i++)
+            {
+                const double l = double(i) / kLinearSteps;
+                const double s = l <= 0.0031308 ? l * 12.92 : 1.055 * std::pow(l, 1.0 / 2.4) - 0.055;
+                t[i] = uint8_t(std::lround(std::min(std::max(s, 0.0), 1.0) * 255.0));
+            }
+            return t;
+        }();
+        return table.data();
+    }
+
+    // --- フィルタ（x は出力画素単位の距離） ---
+
+    double Sinc(double x)
+    {
+        if (std::fabs(x) < 1.0e-6) return 1.0;
+        x *= kPi;
+        return std::sin(x) / x;
+    }
+
+    // 第1種変形ベッセル関数 I0（級数展開）
+    double BesselI0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+        const double q = x * x * 0.25;
+        for (int k = 1; k < 64 && term > sum * 1.0e-12; k++)
+        {
+            term *= q / (double(k) * k);
+            sum += term;
+        }
+        return sum;
+    }
+
+    double FilterRadius(MipGenerator::Filter filter)
+    {
+        return filter == MipGenerator::Filter::Box ? 0.5 : 3.0;
+    }
+
+    double EvaluateFilter(MipGenerator::Filter filter, double x)
+    {
+        const double radius = FilterRadius(filter);
+        if (std::fabs(x) >= radius) return 0.0;
+        if (filter == MipGenerator::Filter::Lanczos) return Sinc(x) * Sinc(x / radius);
+
+        constexpr double kAlpha = 4.0;
+        const double t = x / radius;
+        return Sinc(x) * BesselI0(kAlpha * std::sqrt(1.0 - t * t)) / BesselI0(kAlpha);
+    }
+
+    // 1軸分の縮小の重み（出力画素ごとに count 個。足りない分は重み 0）
+    struct Taps
+    {
+        uint32_t count = 0;
+        std::vector<int32_t> indices;   // [出力画素 * count + k] 読む元の画素（端の処理済み）
+        std::vector<float> weights;     // 合計 1
+    };
+
+    Taps BuildTaps(uint32_t sourceSize, uint32_t targetSize, const MipGenerator::Options& options)
+    {
+        // 出力画素 d は元の画素単位で [d * scale, (d + 1) * scale) を覆う
+        const double scale = double(sourceSize) / targetSize;
+        const double radius = FilterRadius(options.filter) * scale;
+
+        Taps taps;
+        taps.count = uint32_t(std::ceil(radius * 2.0)) + 1;
+        taps.indices.resize(size_t(targetSize) * taps.count);
+        taps.weights.resize(size_t(targetSize) * taps.count);
+        std::vector<double> weights(taps.count);
+        for (uint32_t d = 0; d < targetSize; d++)
+        {
+            const double center = (d + 0.5) * scale;
+            const int32_t first = int32_t(std::floor(center - radius));
+            double sum = 0.0;
+            for (uint32_t k = 0; k < taps.count; k++)
+            {
+                const int32_t i = first + int32_t(k);
+                if (options.filter == MipGenerator::Filter::Box)
+                {
+                    // 元の画素 [i, i + 1) と覆う範囲の重なり
+                    weights[k] = std::max(0.0, std::min(i + 1.0, center + radius) - std::max(double(i), center - radius));
+                }
+                else
+                {
+                    weights[k] = EvaluateFilter(options.filter, (i + 0.5 - center) / scale);
+                }
+                sum += weights[k];
+
+                int32_t index = i;
+                if (options.wrap)
+                {
+                    index %= int32_t(sourceSize);
+                    if (index < 0) index += int32_t(sourceSize);
+                }
+                else
+                {
+                    index = std::min(std::max(index, 0), int32_t(sourceSize) - 1);
+                }
+                taps.indices[size_t(d) * taps.count + k] = index;
+            }
+            for (uint32_t k = 0; k < taps.count; k++)
+            {
+                taps.weights[size_t(d) * taps.count + k] = float(weights[k] / sum);
+            }
+        }
+        return taps;
+    }
+
+    // 8bit の1行 -> 線形の float RGBA
+    void DecodeRow(const uint8_t* pixels, uint32_t width, bool srgb, float* out)
+    {
+        const float* toLinear = SrgbToLinearTable();
+        for (size_t i = 0; i < size_t(width) * 4; i += 4)
+        {
+            for (size_t c = 0; c < 3; c++)
+            {
+                out[i + c] = srgb ? toLinear[pixels[i + c]] : pixels[i + c] * (1.0f / 255.0f);
+            }
+            out[i + 3] = pixels[i + 3] * (1.0f / 255.0f);
+        }
+    }
+
+    // --- スカラー版 ---
+
+    // 横方向: 1行を width 画素に縮小する
+    void FilterRowScalar(const float* row, const Taps& taps, uint32_t width, float* out)
+    {
+        for (uint32_t x = 0; x < width; x++)
+        {
+            const int32_t* indices = &taps.indices[size_t(x) * taps.count];
+            const float* weights = &taps.weights[size_t(x) * taps.count];
+            float sum[4] = {};
+            for (uint32_t k = 0; k < taps.count; k++)
+            {
+                const float* p = row + size_t(indices[k]) * 4;
+                for (int c = 0; c < 4; c++) sum[c] += weights[k] * p[c];
+            }
+            std::copy(sum, sum + 4, out + size_t(x) * 4);
+        }
+    }
+
+    // 縦方向: count 行を重みで混ぜて1行にする
+    void FilterColumnsScalar(const float* const* rows, const float* weights, uint32_t count, size_t floatCount, float* out)
+    {
+        for (size_t i = 0; i < floatCount; i++)
+        {
+            float sum = 0.0f;
+            for (uint32_t k = 0; k < count; k++) sum += weights[k] * rows[k][i];
+            out[i] = sum;
+        }
+    }
+
+    void EncodeRowScalar(const float* row, uint32_t width, bool srgb, uint8_t* out)
+    {
+        const uint8_t* toSrgb = LinearToSrgbTable();
+        for (size_t i = 0; i < size_t(width) * 4; i += 4)
+        {
+            for (size_t c = 0; c < 4; c++)
+            {
+                const float v = std::min(std::max(row[i + c], 0.0f), 1.0f);
+                out[i + c] = srgb && c < 3 ? toSrgb[int(v * float(kLinearSteps) + 0.5f)] : uint8_t(int(v * 255.0f + 0.5f));
+            }
+        }
+    }
+
+#if MIP_SSE
+    // --- SSE 版（1画素 = 1レジスタ。縦方向は行の4要素ずつ） ---
+
+    void FilterRowSse(const float* row, const Taps& taps, uint32_t width, float* out)
+    {
+        for (uint32_t x = 0; x < width; x++)
+        {
+            const int32_t* indices = &taps.indices[size_t(x) * taps.count];
+            const float* weights = &taps.weights[size_t(x) * taps.count];
+            __m128 sum = _mm_setzero_ps();
+            for (uint32_t k = 0; k < taps.count; k++)
+            {
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(row + size_t(indices[k]) * 4)));
+            }
+            _mm_storeu_ps(out + size_t(x) * 4, sum);
+        }
+    }
+
+    // floatCount は4の倍数（RGBA の行）。16要素ずつ4本の和を並べて、行の読み込みを待つ間も加算を進める
+    void FilterColumnsSse(const float* const* rows, const float* weights, uint32_t count, size_t floatCount, float* out)
+    {
+        size_t i = 0;
+        for (; i + 16 <= floatCount; i += 16)
+        {
+            __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps(), s2 = _mm_setzero_ps(), s3 = _mm_setzero_ps();
+            for (uint32_t k = 0; k < count; k++)
+            {
+                const __m128 w = _mm_set1_ps(weights[k]);
+                const float* r = rows[k] + i;
+                s0 = _mm_add_ps(s0, _mm_mul_ps(w, _mm_loadu_ps(r)));
+                s1 = _mm_add_ps(s1, _mm_mul_ps(w, _mm_loadu_ps(r + 4)));
+                s2 = _mm_add_ps(s2, _mm_mul_ps(w, _mm_loadu_ps(r + 8)));
+                s3 = _mm_add_ps(s3, _mm_mul_ps(w, _mm_loadu_ps(r + 12)));
+            }
+            _mm_storeu_ps(out + i, s0);
+            _mm_storeu_ps(out + i + 4, s1);
+            _mm_storeu_ps(out + i + 8, s2);
+            _mm_storeu_ps(out + i + 12, s3);
+        }
+        for (; i < floatCount; i += 4)
+        {
+            __m128 sum = _mm_setzero_ps();
+            for (uint32_t k = 0; k < count; k++)
+            {
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(rows[k] + i)));
+            }
+            _mm_storeu_ps(out + i, sum);
+        }
+    }
+
+    // [0, 1] に収めて整数化までを SIMD で行い、sRGB の RGB だけ表を引く
+    void EncodeRowSse(const float* row, uint32_t width, bool srgb, uint8_t* out)
+    {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+        if (!srgb)
+        {
+            const __m128 scale = _mm_set1_ps(255.0f);
+            uint32_t x = 0;
+            for (; x + 4 <= width; x += 4)
+            {
+                __m128i v[4];
+                for (int p = 0; p < 4; p++)
+                {
+                    const __m128 c = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(row + size_t(x + p) * 4), zero), one);
+                    v[p] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(c, scale), half));
+                }
+                const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3]));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + size_t(x) * 4), packed);
+            }
+            if (x < width) EncodeRowScalar(row + size_t(x) * 4, width - x, false, out + size_t(x) * 4);
+            return;
+        }
+
+        const uint8_t* toSrgb = LinearToSrgbTable();
+        const __m128 scale = _mm_setr_ps(float(kLinearSteps), float(kLinearSteps), float(kLinearSteps), 255.0f);
+        for (uint32_t x = 0; x < width; x++)
+        {
+            const __m128 c = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(row + size_t(x) * 4), zero), one);
+            alignas(16) int32_t v[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(v), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(c, scale), half)));
+            uint8_t* o = out + size_t(x) * 4;
+            o[0] = toSrgb[v[0]];
+            o[1] = toSrgb[v[1]];
+            o[2] = toSrgb[v[2]];
+            o[3] = uint8_t(v[3]);
+        }
+    }
+#endif
+
+    struct Kernel
+    {
+        void (*filterRow)(const float*, const Taps&, uint32_t, float*);
+        void (*filterColumns)(const float* const*, const float*, uint32_t, size_t, float*);
+        void (*encodeRow)(const float*, uint32_t, bool, uint8_t*);
+        const char* name;
+    };
+
+    const Kernel& ScalarKernel()
+    {
+        static const Kernel kernel{ FilterRowScalar, FilterColumnsScalar, EncodeRowScalar, "scalar" };
+        return kernel;
+    }
+
+    const Kernel& SelectKernel()
+    {
+#if MIP_SSE
+        static const Kernel kernel{ FilterRowSse, FilterColumnsSse, EncodeRowSse, "SSE2" };
+        return kernel;
+#else
+        return ScalarKernel();
+#endif
+    }
+
+    void Generate(const ImageData& image, const MipGenerator::Options& options, std::vector<ImageData>& levels,
+        ThreadPool* pool, const Kernel& kernel)
+    {
+        levels.clear();
+        if (image.width == 0 || image.height == 0) return;
+        const uint32_t levelCount = MipLevelCount(image.width, image.height);
+        levels.reserve(levelCount);
+        levels.push_back(image);
+
+        // 行の帯に分けて処理する（小さな段は分けない）
+        auto forEachRow = [&](uint32_t rowCount, uint32_t width, auto func)
+        {
+            const size_t minRows = std::max<size_t>(1, kParallelPixels / width);
+            if (pool) pool->ParallelFor(rowCount, minRows, func);
+            else func(size_t(0), size_t(rowCount));
+        };
+
+        // 前の段の線形の値（1段目は元の 8bit から行ごとに直す）
+        std::vector<float> source, target, horizontal;
+        for (uint32_t level = 1; level < levelCount; level++)
+        {
+            const uint32_t sourceWidth = MipExtent(image.width, level - 1);
+            const uint32_t sourceHeight = MipExtent(image.height, level - 1);
+            const uint32_t width = MipExtent(image.width, level);
+            const uint32_t height = MipExtent(image.height, level);
+            const Taps columns = BuildTaps(sourceWidth, width, options);
+            const Taps rows = BuildTaps(sourceHeight, height, options);
+
+            // 横に縮める（元の段の全行）
+            horizontal.resize(size_t(sourceHeight) * width * 4);
+            forEachRow(sourceHeight, sourceWidth, [&](size_t begin, size_t end)
+            {
+                std::vector<float> decoded;
+                for (size_t y = begin; y < end; y++)
+                {
+                    const float* row;
+                    if (level == 1)
+                    {
+                        decoded.resize(size_t(sourceWidth) * 4);
+                        DecodeRow(image.pixels.data() + y * sourceWidth * 4, sourceWidth, options.srgb, decoded.data());
+                        row = decoded.data();
+                    }
+                    else
+                    {
+                        row = source.data() + y * sourceWidth * 4;
+                    }
+                    kernel.filterRow(row, columns, width, horizontal.data() + y * width * 4);
+                }
+            });
+
+            // 縦に縮め、8bit に戻す（線形の値は次の段の入力に残す）
+            ImageData& out = levels.emplace_back();
+            out.width = width;
+            out.height = height;
+            out.pixels.resize(size_t(width) * height * 4);
+            target.resize(size_t(width) * height * 4);
+            forEachRow(height, width, [&](size_t begin, size_t end)
+            {
+                std::vector<const float*> taps(rows.count);
+                for (size_t y = begin; y < end; y++)
+                {
+                    for (uint32_t k = 0; k < rows.count; k++)
+                    {
+                        taps[k] = horizontal.data() + size_t(rows.indices[y * rows.count + k]) * width * 4;
+                    }
+                    float* row = target.data() + y * width * 4;
+                    kernel.filterColumns(taps.data(), &rows.weights[y * rows.count], rows.count, size_t(width) * 4, row);
+                    kernel.encodeRow(row, width, options.srgb, out.pixels.data() + y * width * 4);
+                }
+            });
+            source.swap(target);
+        }
+    }
+
+    // 縞と格子と雑音を重ねた画像（折り返しが出やすい高い周波数を含める）
+    ImageData MakeBenchmarkImage(uint32_t width, uint32_t height)
+    {
+        std::mt19937 rng(12345);
+        std::uniform_int_distribution<int> noise(-24, 24);
+        ImageData image;
+        image.width = width;
+        image.height = height;
+        image.pixels.resize(size_t(width) * height * 4);
+        for (uint32_t y = 0; y < height; y++)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                uint8_t* p = &image.pixels[(size_t(y) * width + x) * 4];
+                const int stripes = ((x / 3 + y / 5) & 1) ? 200 : 40;
+                const int checker = (((x >> 4) ^ (y >> 4)) & 1) ? 220 : 30;
+                p[0] = uint8_t(std::clamp(stripes + noise(rng), 0, 255));
+                p[1] = uint8_t(std::clamp(checker + noise(rng), 0, 255));
+                p[2] = uint8_t(std::clamp(int(x * 255 / width) + noise(rng), 0, 255));
+                p[3] = uint8_t(std::clamp(int(y * 255 / height) + noise(rng), 0, 255));
+            }
+        }
+        return image;
+    }
+
+    // body を iterations 回実行し、最も速かった1回の処理速度（メガピクセル/秒）を返す
+    template <class Body>
+    double MeasureThroughput(size_t pixelCount, int iterations, Body body)
+    {
+        double best = 0.0;
+        for (int i = 0; i < iterations; i++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            body();
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (seconds > 0.0) best = std::max(best, double(pixelCount) * 1.0e-6 / seconds);
+        }
+        return best;
+    }
+}
+
+namespace MipGenerator
+{
+    uint64_t HashOptions(const Options& options)
+    {
+        Hasher hasher;
+        hasher.AddValue(options.filter);
+        hasher.AddValue(options.srgb);
+        hasher.AddValue(options.wrap);
+        return hasher.Get();
+    }
+
+    void GenerateMips(const ImageData& image, const Options& options, std::vector<ImageData>& levels, ThreadPool* pool)
+    {
+        Generate(image, options, levels, pool, SelectKernel());
+    }
+
+    void GenerateMipsReference(const ImageData& image, const Options& options, std::vector<ImageData>& levels)
+    {
+        Generate(image, options, levels, nullptr, ScalarKernel());
+    }
+
+    const char* GetKernelName()
+    {
+        return SelectKernel().name;
+    }
+
+    const char* GetFilterName(Filter filter)
+    {
+        switch (filter)
+        {
+        case Filter::Box: return "box";
+        case Filter::Kaiser: return "kaiser";
+        case Filter::Lanczos: return "lanczos";
+        }
+        return "unknown";
+    }
+
+    bool ParseFilter(const char* name, Filter& filter)
+    {
+        for (Filter candidate : { Filter::Box, Filter::Kaiser, Filter::Lanczos })
+        {
+            if (std::string_view(name) == GetFilterName(candidate))
+            {
+                filter = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    BenchmarkResult RunBenchmark(ThreadPool& pool, uint32_t width, uint32_t height, int iterations)
+    {
+        BenchmarkResult result;
+        result.kernel = GetKernelName();
+        result.width = width;
+        result.height = height;
+        result.threadCount = pool.GetThreadCount();
+        if (width == 0 || height == 0 || iterations <= 0) return result;
+
+        const ImageData image = MakeBenchmarkImage(width, height);
+        const size_t pixelCount = size_t(width) * height;
+        std::vector<ImageData> reference, simd, parallel;
+        for (Filter filter : { Filter::Box, Filter::Kaiser, Filter::Lanczos })
+        {
+            Options options;
+            options.filter = filter;
+            const size_t f = size_t(filter);
+            result.referenceMegapixelsPerSecond[f] = MeasureThroughput(pixelCount, iterations,
+                [&]() { GenerateMipsReference(image, options, reference); });
+            result.simdMegapixelsPerSecond[f] = MeasureThroughput(pixelCount, iterations,
+                [&]() { GenerateMips(image, options, simd, nullptr); });
+            result.parallelMegapixelsPerSecond[f] = MeasureThroughput(pixelCount, iterations,
+                [&]() { GenerateMips(image, options, parallel, &pool); });
+
+            for (size_t level = 0; level < reference.size(); level++)
+            {
+                for (size_t i = 0; i < reference[level].pixels.size(); i++)
+                {
+                    const int a = reference[level].pixels[i];
+                    result.maxDifference = std::max({ result.maxDifference,
+                        std::abs(a - int(simd[level].pixels[i])), std::abs(a - int(parallel[level].pixels[i])) });
+                }
+            }
+        }
+        return result;
+    }
+}
@@ -0,0 +1,64 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ImageData.h"
+
+class ThreadPool;
+
+// RGBA8 画像のミップチェーンを CPU で作る（D3D非依存）
+// 1段ずつ前の段から縦横に分けて縮小する。sRGB の画像は線形空間に直して混ぜ、アルファは常に線形のまま扱う
+namespace MipGenerator
+{
+    // 生成結果が変わる修正をしたら上げる（派生データキャッシュ / クッカーの依存関係のキーに含まれる）
+    constexpr uint32_t kVersion = 1;
+
+    enum class Filter : uint32_t
+    {
+        Box,        // 出力1画素が覆う範囲の平均（速いが折り返しが残る）
+        Kaiser,     // カイザー窓付き sinc（半径3画素、alpha = 4）
+        Lanczos,    // Lanczos3
+    };
+
+    struct Options
+    {
+        Filter filter = Filter::Kaiser;
+        bool srgb = true;       // RGB を sRGB として線形空間で混ぜる（法線マップなど値そのものが意味を持つ画像は false）
+        bool wrap = true;       // 端の外側を反対側から読む（サンプラーが WRAP なので既定は繰り返し。false なら端の画素を延ばす）
+    };
+
+    // キャッシュのキーに混ぜる設定のハッシュ（kVersion は含まない）
+    uint64_t HashOptions(const Options& options);
+
+    // levels[0] に元の画像、以降に 1x1 までの各段を入れる
+    // 各辺は前の段の半分（切り捨て、最小 1）。2のべき乗でない大きさは出力1画素が覆う範囲に合わせて重みを作る
+    // pool があれば各段を行の帯に分けて並列に処理する
+    void GenerateMips(const ImageData& image, const Options& options, std::vector<ImageData>& levels, ThreadPool* pool = nullptr);
+
+    // スカラー版・1スレッド（SIMD 版の検証用の基準。SIMD 版と同じ順序で計算する）
+    void GenerateMipsReference(const ImageData& image, const Options& options, std::vector<ImageData>& levels);
+
+    // GenerateMips が使う命令セット（"SSE2" / "scalar"）
+    const char* GetKernelName();
+
+    const char* GetFilterName(Filter filter);
+
+    // "box" / "kaiser" / "lanczos"（知らない名前なら false）
+    bool ParseFilter(const char* name, Filter& filter);
+
+    struct BenchmarkResult
+    {
+        const char* kernel = "";
+        uint32_t width = 0;
+        uint32_t height = 0;
+        size_t threadCount = 0;
+        // フィルタごと（Filter の順）の処理速度。元の画像の画素数 / 全段を作る時間（メガピクセル/秒）
+        double referenceMegapixelsPerSecond[3] = {};    // スカラー版、1スレッド
+        double simdMegapixelsPerSecond[3] = {};         // SIMD 版、1スレッド
+        double parallelMegapixelsPerSecond[3] = {};     // SIMD 版をスレッドプールで実行
+        int maxDifference = 0;                          // SIMD 版とスカラー版の画素値の差の最大（8bit の段数）
+    };
+
+    // 乱数で作った画像で各版の処理速度を測り、SIMD 版の結果をスカラー版と比べる
+    BenchmarkResult RunBenchmark(ThreadPool& pool, uint32_t width = 1920, uint32_t height = 1080, int iterations = 5);
+}
@@ -0,0 +1,79 @@
+﻿#pragma once
+#include <string>
+#include <vector>
+#include "AnimationClip.h"
+#include "MeshData.h"
+
+// シーン階層の1ノード（親は必ず自分より前に並ぶので、先頭から1回なめればワールド行列が求まる）
+struct SceneNode
+{
+    int32_t parent = -1;                            // 親ノード番号（ルート直下は -1）
+    Float3 translation = { 0.0f, 0.0f, 0.0f };     // ローカル TRS
+    Float4 rotation = { 0.0f, 0.0f, 0.0f, 1.0f };   // クォータニオン (x, y, z, w)
+    Float3 scale = { 1.0f, 1.0f, 1.0f };
+    int32_t mesh = -1;                              // geometry.submeshes の番号（メッシュなしは -1）
+};
+
+// マテリアルが参照するテクスチャの用途（Material::textures の添字）
+enum MaterialTextureSlot : uint32_t
+{
+    kTextureDiffuse,
+    kTextureNormal,
+    kTextureSpecular,
+    kTextureEmissive,
+    kTextureSlotCount
+};
+
+// FbxSurfaceLambert / FbxSurfacePhong から取り出した描画用の値
+// 値とテクスチャがすべて同じマテリアルはインポート時に1つにまとめる（SubMesh::material で参照）
+struct Material
+{
+    Float4 diffuse = { 1.0f, 1.0f, 1.0f, 1.0f };   // Diffuse * DiffuseFactor（a = 1 - TransparencyFactor）
+    Float3 specular = { 1.0f, 1.0f, 1.0f };         // Specular * SpecularFactor（Lambert は 0）
+    float specularPower = 64.0f;                    // Shininess
+    Float3 emissive = { 0.0f, 0.0f, 0.0f };         // Emissive * EmissiveFactor
+    int32_t textures[kTextureSlotCount] = { -1, -1, -1, -1 };  // ModelData::textures の番号（なしは -1）
+    // テクスチャごとの UV の変換（uv * xy + zw）。アトラスにまとめた画像はページの中の範囲を指す
+    Float4 uvScaleOffset[kTextureSlotCount] = {
+        { 1.0f, 1.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 0.0f, 0.0f } };
+};
+static_assert(sizeof(Material) == 124, "Material layout changed");
+
+// マテリアルが参照する画像（同じファイル / 同じ内容の埋め込みデータは1つにまとめる）
+struct ModelTexture
+{
+    std::string path;               // 見つかったファイル（埋め込みなら FBX に記録された元のパス）
+    std::vector<uint8_t> embedded;  // FBX に埋め込まれていた画像ファイルのバイト列（空なら path から読む）
+};
+
+// スキンの1関節
+// 変形後の位置 = バインドポーズの位置 * inverseBind * 関節ノードのモデル空間での行列
+struct SkinJoint
+{
+    int32_t node = -1;              // 関節のノード番号（-1 ならモデルの原点）
+    float inverseBind[4][4];        // バインドポーズのメッシュ空間 -> 関節空間（行ベクトル形式、XMFLOAT4X4 と同じ並び）
+};
+
+// シーン全体のインポート結果
+// 全メッシュの頂点/インデックスは geometry に詰めて持ち、ノードはサブメッシュを番号で参照する
+struct ModelData
+{
+    MeshData geometry;
+    std::vector<SceneNode> nodes;
+    std::vector<std::string> nodeNames;         // nodes と同じ並び（描画では使わないので別配列）
+    std::vector<Material> materials;
+    std::vector<std::string> materialNames;     // materials と同じ並び（まとめたものは最初の名前）
+    std::vector<ModelTexture> textures;
+
+    // GPU に渡す頂点（vertexFormat の形式で geometry.vertices と同じ並び）
+    VertexFormat vertexFormat = VertexFormat::Float32;
+    std::vector<uint8_t> gpuVertices;       // Packed16 の位置はサブメッシュごとの SubMesh::quantization で復元する
+
+    // スキン付きサブメッシュの CPU スキニングの入力（SubMesh::skinVertexOffset から vertexCount 個ずつ）
+    std::vector<SkinJoint> joints;              // SubMesh::jointOffset から jointCount 個ずつ
+    std::vector<SkinnedVertex> skinVertices;    // バインドポーズ（メッシュ空間）
+    std::vector<SkinWeights> skinWeights;
+
+    // テイクごとの圧縮済みアニメーション（トラックは nodes と同じ並び）
+    std::vector<AnimationClip> animations;
+};
@@ -0,0 +1,760 @@
+﻿#include "ModelImporter.h"
+#include <fbxsdk.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <unordered_map>
+#include "Bounds.h"
+#include "FbxAnimationBaker.h"
+#include "FbxMeshExtractor.h"
+#include "Hash.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshTangents.h"
+#include "TextureAtlas.h"
+#include "TextureStreaming.h"
+#include "ThreadPool.h"
+
+namespace
+{
+    // 前回の Lap からの経過時間を返すストップウォッチ
+    class StageClock
+    {
+    public:
+        double Lap()
+        {
+            auto now = std::chrono::steady_clock::now();
+            double ms = std::chrono::duration<double, std::milli>(now - mLast).count();
+            mLast = now;
+            return ms;
+        }
+
+    private:
+        std::chrono::steady_clock::time_point mLast = std::chrono::steady_clock::now();
+    };
+
+    // FbxManager の生成/破棄は SDK 内の共有の登録情報に触れるので、スレッドごとに持つ場合も同時には行わない
+    // （生成後のインポートはマネージャーごとに独立しているので並列に走らせてよい）
+    std::mutex gManagerMutex;
+
+    // LOD0（最適化済みのインデックス列）を簡略化した段をインデックス配列の後ろに足し、mesh.lods に範囲を書く
+    void BuildLods(MeshData& mesh, const MeshImportOptions& options)
+    {
+        const size_t lod0Count = mesh.indices.size();
+        mesh.lods.assign(1, MeshLod());
+        mesh.lods[0].indexCount = uint32_t(lod0Count);
+        if (options.lodCount <= 1 || options.lodReduction <= 0.0f || options.lodReduction >= 1.0f) return;
+
+        std::vector<size_t> targets;
+        size_t target = lod0Count;
+        for (uint32_t i = 1; i < options.lodCount; i++)
+        {
+            target = size_t(double(target) * options.lodReduction) / 3 * 3;
+            if (target < 3) break;
+            targets.push_back(target);
+        }
+
+        MeshSimplifier::SimplifyOptions simplify;
+        simplify.normalWeight = options.lodNormalWeight;
+        simplify.uvWeight = options.lodUvWeight;
+        std::vector<MeshSimplifier::SimplifiedLevel> levels;
+        MeshSimplifier::Simplify(mesh.vertices, mesh.indices.data(), lod0Count, targets, simplify, levels);
+
+        for (MeshSimplifier::SimplifiedLevel& level : levels)
+        {
+            // 縁を固定しているなどで前の段からほとんど減らなかった段は使わない
+            const MeshLod& previous = mesh.lods.back();
+            if (level.indices.empty() || double(level.indices.size()) > previous.indexCount * 0.9) break;
+
+            MeshOptimizer::OptimizeVertexCache(level.indices, mesh.vertices.size());
+            MeshLod lod;
+            lod.indexOffset = uint32_t(mesh.indices.size());
+            lod.indexCount = uint32_t(level.indices.size());
+            lod.error = std::max(level.error, previous.error);
+            mesh.indices.insert(mesh.indices.end(), level.indices.begin(), level.indices.end());
+            mesh.lods.push_back(lod);
+        }
+    }
+
+    // 溶接 → 頂点キャッシュ → オーバードロー → 頂点フェッチ の順に最適化する
+    void OptimizeGeometry(MeshData& mesh, const MeshImportOptions& options, MeshImportStats& stats,
+        ImportReport& report, StageClock& clock, ThreadPool* pool)
+    {
+        std::vector<MeshVertex>& vertices = mesh.vertices;
+        std::vector<uint32_t>& indices = mesh.indices;
+
+        // 同一頂点を統合して本物のインデックスバッファにする
+        MeshOptimizer::WeldStats weld = MeshOptimizer::WeldVertices(mesh);
+        stats.cornerCount = weld.inputVertexCount;
+        report.AddStageTime("weld", clock.Lap());
+
+        // 溶接した頂点ごとに接線を求める（UV の向きが混ざる頂点は複製される）
+        MeshTangents::TangentStats tangents = MeshTangents::GenerateTangents(mesh, pool);
+        stats.tangentSplitVertices = tangents.splitVertices;
+        stats.tangentFallbackVertices = tangents.fallbackVertices;
+        report.AddStageTime("tangents", clock.Lap());
+
+        // 頂点後処理キャッシュに合わせて三角形を並べ替え
+        MeshOptimizer::VertexCacheStats cacheBefore = MeshOptimizer::AnalyzeVertexCache(indices, vertices.size());
+        MeshOptimizer::OptimizeVertexCache(indices, vertices.size());
+        MeshOptimizer::VertexCacheStats cacheAfter = MeshOptimizer::AnalyzeVertexCache(indices, vertices.size());
+        report.AddStageTime("vertex cache", clock.Lap());
+
+        // 外向きの面から描くよう並べ替えてピクセルシェーダーの無駄な実行を減らす
+        if (options.optimizeOverdraw)
+        {
+            stats.overdrawBefore = MeshOptimizer::AnalyzeOverdraw(indices, vertices).overdraw;
+            MeshOptimizer::OptimizeOverdraw(indices, vertices, options.overdrawThreshold);
+            stats.overdrawAfter = MeshOptimizer::AnalyzeOverdraw(indices, vertices).overdraw;
+            cacheAfter = MeshOptimizer::AnalyzeVertexCache(indices, vertices.size());
+            report.AddStageTime("overdraw", clock.Lap());
+        }
+        stats.acmrBefore = cacheBefore.acmr;
+        stats.acmrAfter = cacheAfter.acmr;
+        stats.atvrBefore = cacheBefore.atvr;
+        stats.atvrAfter = cacheAfter.atvr;
+
+        // 頂点フェッチがメモリを前から順に読むよう頂点を並べ直す
+        const size_t stride = VertexFormatStride(options.vertexFormat);
+        const MeshOptimizer::VertexFetchStats fetchBefore = MeshOptimizer::AnalyzeVertexFetch(indices, vertices.size(), stride);
+        MeshOptimizer::OptimizeVertexFetch(mesh, stride);
+        const MeshOptimizer::VertexFetchStats fetchAfter = MeshOptimizer::AnalyzeVertexFetch(indices, vertices.size(), stride);
+        stats.fetchMissesBefore = fetchBefore.cacheLineMisses;
+        stats.fetchMissesAfter = fetchAfter.cacheLineMisses;
+        stats.overfetchBefore = fetchBefore.overfetch;
+        stats.overfetchAfter = fetchAfter.overfetch;
+        report.AddStageTime("vertex fetch", clock.Lap());
+
+        // LOD0 の並びが決まったあとで簡略化した段を作る（頂点は LOD0 のものを共有する）
+        BuildLods(mesh, options);
+        for (const MeshLod& lod : mesh.lods) stats.lods.push_back({ lod.indexCount / 3, lod.error });
+        report.AddStageTime("lod", clock.Lap());
+
+        // 描画順が決まったあとでカリング用のクラスタに区切る（LOD ごと）
+        if (options.buildMeshlets)
+        {
+            MeshOptimizer::BuildMeshlets(mesh, options.maxMeshletVertices, options.maxMeshletTriangles);
+            stats.meshletCount = mesh.lods[0].meshletCount;
+            report.AddStageTime("meshlets", clock.Lap());
+        }
+
+        stats.vertexCount = vertices.size();
+        stats.triangleCount = mesh.lods[0].indexCount / 3;
+    }
+
+    // サブメッシュごとの誤差をモデル全体の最大にまとめる（上限も最大をとる）
+    void MergePackingStats(VertexPacking::PackingStats& total, const VertexPacking::PackingStats& stats)
+    {
+        auto merge = [](VertexPacking::PackingError& a, const VertexPacking::PackingError& b)
+        {
+            a.position = std::max(a.position, b.position);
+            a.normalDegrees = std::max(a.normalDegrees, b.normalDegrees);
+            a.tangentDegrees = std::max(a.tangentDegrees, b.tangentDegrees);
+            a.uv = std::max(a.uv, b.uv);
+        };
+        merge(total.measured, stats.measured);
+        merge(total.bound, stats.bound);
+    }
+
+    // FbxFileTexture のパスを FBX のあるフォルダからの相対パス → 記録された絶対パス → ファイル名だけ、の順に探す
+    // どれも見つからなければ最初の候補を返す（後からファイルが置かれたときに変更として検出できるように）
+    std::string ResolveTexturePath(const FbxFileTexture* texture, const std::filesystem::path& directory)
+    {
+        namespace fs = std::filesystem;
+        const fs::path absolute = fs::u8path(texture->GetFileName());
+        const fs::path relative = fs::u8path(texture->GetRelativeFileName());
+
+        std::vector<fs::path> candidates;
+        if (!relative.empty()) candidates.push_back(directory / relative);
+        if (!absolute.empty()) candidates.push_back(absolute);
+        if (absolute.has_filename()) candidates.push_back(directory / absolute.filename());
+        if (candidates.empty()) return std::string();
+
+        std::error_code ec;
+        for (const fs::path& candidate : candidates)
+        {
+            if (fs::is_regular_file(candidate, ec)) return candidate.lexically_normal().u8string();
+        }
+        return candidates[0].lexically_normal().u8string();
+    }
+
+    // FBX に埋め込まれた画像ファイル（元のパス -> 中身）。読み込み中にコールバックで受け取り、ディスクには展開しない
+    using EmbeddedMedia = std::unordered_map<std::string, std::vector<uint8_t>>;
+
+    FbxCallback::State ReadEmbeddedFile(void* userData, FbxClassId, const char* fileName, const void* buffer, size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(buffer);
+        (*static_cast<EmbeddedMedia*>(userData))[fileName].assign(bytes, bytes + size);
+        return FbxCallback::eHandled;
+    }
+
+    // マテリアルとテクスチャの表（値とテクスチャが同じマテリアル、同じファイル/同じ内容のテクスチャは1つにまとめる）
+    class MaterialTable
+    {
+    public:
+        MaterialTable(ModelData& model, const std::string& fbxPath, const EmbeddedMedia& embedded, MaterialImportStats& stats)
+            : mModel(model), mDirectory(std::filesystem::path(fbxPath).parent_path()), mEmbedded(embedded), mStats(stats)
+        {
+        }
+
+        // material が nullptr ならマテリアルなしのメッシュ用の既定値
+        uint32_t Add(FbxSurfaceMaterial* material)
+        {
+            auto found = mSourceIds.find(material);
+            if (found != mSourceIds.end()) return found->second;
+
+            Material converted;
+            std::string name = "default";
+            if (material)
+            {
+                converted = Convert(material);
+                name = material->GetName();
+                mStats.sourceMaterials++;
+            }
+
+            // 値の比較はバイト列で行う（Material は 4byte のフィールドだけでパディングがない）
+            const uint64_t hash = Hash64(&converted, sizeof(converted));
+            uint32_t index = uint32_t(mModel.materials.size());
+            for (uint32_t candidate : mByHash[hash])
+            {
+                if (std::memcmp(&mModel.materials[candidate], &converted, sizeof(Material)) == 0) index = candidate;
+            }
+            if (index == mModel.materials.size())
+            {
+                mModel.materials.push_back(converted);
+                mModel.materialNames.push_back(name);
+                mByHash[hash].push_back(index);
+            }
+            mSourceIds[material] = index;
+            return index;
+        }
+
+    private:
+        Material Convert(FbxSurfaceMaterial* material)
+        {
+            auto readColor = [&](const char* colorName, const char* factorName, const Float3& fallback)
+            {
+                const FbxProperty color = material->FindProperty(colorName);
+                if (!color.IsValid()) return fallback;
+                const FbxDouble3 value = color.Get<FbxDouble3>();
+                const FbxProperty factor = material->FindProperty(factorName);
+                const double scale = factor.IsValid() ? factor.Get<FbxDouble>() : 1.0;
+                return Float3{ float(value[0] * scale), float(value[1] * scale), float(value[2] * scale) };
+            };
+
+            Material result;
+            const Float3 diffuse = readColor(FbxSurfaceMaterial::sDiffuse, FbxSurfaceMaterial::sDiffuseFactor, { 1.0f, 1.0f, 1.0f });
+            const FbxProperty transparency = material->FindProperty(FbxSurfaceMaterial::sTransparencyFactor);
+            const float alpha = transparency.IsValid() ? 1.0f - float(transparency.Get<FbxDouble>()) : 1.0f;
+            result.diffuse = { diffuse.x, diffuse.y, diffuse.z, std::min(std::max(alpha, 0.0f), 1.0f) };
+            result.emissive = readColor(FbxSurfaceMaterial::sEmissive, FbxSurfaceMaterial::sEmissiveFactor, { 0.0f, 0.0f, 0.0f });
+
+            // 鏡面反射は Phong のみ（Lambert は鏡面なし）
+            if (material->Is<FbxSurfacePhong>())
+            {
+                result.specular = readColor(FbxSurfaceMaterial::sSpecular, FbxSurfaceMaterial::sSpecularFactor, { 1.0f, 1.0f, 1.0f });
+                const FbxProperty shininess = material->FindProperty(FbxSurfaceMaterial::sShininess);
+                if (shininess.IsValid()) result.specularPower = float(shininess.Get<FbxDouble>());
+            }
+            else if (material->Is<FbxSurfaceLambert>())
+            {
+                result.specular = { 0.0f, 0.0f, 0.0f };
+            }
+
+            result.textures[kTextureDiffuse] = AddTexture(material->FindProperty(FbxSurfaceMaterial::sDiffuse));
+            result.textures[kTextureNormal] = AddTexture(material->FindProperty(FbxSurfaceMaterial::sNormalMap));
+            if (result.textures[kTextureNormal] < 0)
+            {
+                result.textures[kTextureNormal] = AddTexture(material->FindProperty(FbxSurfaceMaterial::sBump));
+            }
+            result.textures[kTextureSpecular] = AddTexture(material->FindProperty(FbxSurfaceMaterial::sSpecular));
+            result.textures[kTextureEmissive] = AddTexture(material->FindProperty(FbxSurfaceMaterial::sEmissive));
+            return result;
+        }
+
+        // プロパティにつながった最初の画像（レイヤードテクスチャなら一番下の層）
+        int32_t AddTexture(const FbxProperty& property)
+        {
+            if (!property.IsValid()) return -1;
+            const FbxFileTexture* texture = property.GetSrcObject<FbxFileTexture>(0);
+            if (!texture)
+            {
+                if (const FbxLayeredTexture* layered = property.GetSrcObject<FbxLayeredTexture>(0))
+                {
+                    texture = layered->GetSrcObject<FbxFileTexture>(0);
+                }
+            }
+            if (!texture) return -1;
+            mStats.textureReferences++;
+
+            // 埋め込みデータは内容で、外部ファイルは見つかったパスでまとめる
+            ModelTexture entry;
+            std::string key;
+            if (const std::vector<uint8_t>* data = FindEmbedded(texture))
+            {
+                entry.path = texture->GetFileName();
+                entry.embedded = *data;
+                key = "embedded:" + std::to_string(Hash64(data->data(), data->size()));
+            }
+            else
+            {
+                entry.path = ResolveTexturePath(texture, mDirectory);
+                if (entry.path.empty()) return -1;
+                key = "file:" + entry.path;
+            }
+
+            auto found = mTextureIds.find(key);
+            if (found != mTextureIds.end()) return found->second;
+            const int32_t index = int32_t(mModel.textures.size());
+            if (!entry.embedded.empty()) mStats.embeddedTextures++;
+            mModel.textures.push_back(std::move(entry));
+            mTextureIds[key] = index;
+            return index;
+        }
+
+        // コールバックに渡される元のパスと FbxFileTexture のパスは書き方が違うことがあるので、最後はファイル名で引く
+        const std::vector<uint8_t>* FindEmbedded(const FbxFileTexture* texture) const
+        {
+            if (mEmbedded.empty()) return nullptr;
+            auto found = mEmbedded.find(texture->GetFileName());
+            if (found != mEmbedded.end()) return &found->second;
+            const std::filesystem::path filename = std::filesystem::u8path(texture->GetFileName()).filename();
+            if (filename.empty()) return nullptr;
+            for (const auto& media : mEmbedded)
+            {
+                if (std::filesystem::u8path(media.first).filename() == filename) return &media.second;
+            }
+            return nullptr;
+        }
+
+        ModelData& mModel;
+        std::filesystem::path mDirectory;
+        const EmbeddedMedia& mEmbedded;
+        MaterialImportStats& mStats;
+        std::unordered_map<FbxSurfaceMaterial*, uint32_t> mSourceIds;
+        std::unordered_map<uint64_t, std::vector<uint32_t>> mByHash;
+        std::unordered_map<std::string, int32_t> mTextureIds;
+    };
+}
+
+void ImportReport::AddStageTime(const char* stage, double milliseconds)
+{
+    for (ImportStageTiming& timing : stages)
+    {
+        if (timing.stage == stage)
+        {
+            timing.milliseconds += milliseconds;
+            return;
+        }
+    }
+    stages.push_back({ stage, milliseconds });
+}
+
+uint64_t ModelImporter::ComputeCacheKey(const void* sourceData, size_t sourceSize, const MeshImportOptions& options)
+{
+    Hasher hasher(Hash64(sourceData, sourceSize));
+    hasher.AddValue(kVersion);
+    hasher.AddValue(TextureAtlas::kVersion);
+    hasher.AddValue(HashOptions(options));
+    return hasher.Get();
+}
+
+uint64_t ModelImporter::HashOptions(const MeshImportOptions& options)
+{
+    // パディングを含めないようフィールドごとに混ぜる
+    Hasher hasher;
+    hasher.AddValue(options.optimizeOverdraw);
+    hasher.AddValue(options.overdrawThreshold);
+    hasher.AddValue(options.vertexFormat);
+    hasher.AddValue(options.buildMeshlets);
+    hasher.AddValue(options.maxMeshletVertices);
+    hasher.AddValue(options.maxMeshletTriangles);
+    hasher.AddValue(options.lodCount);
+    hasher.AddValue(options.lodReduction);
+    hasher.AddValue(options.lodNormalWeight);
+    hasher.AddValue(options.lodUvWeight);
+    hasher.AddValue(options.importSkins);
+    hasher.AddValue(options.importAnimations);
+    hasher.AddValue(options.animationSampleRate);
+    hasher.AddValue(options.animationError);
+    hasher.AddValue(options.buildAtlases);
+    hasher.AddValue(options.atlasMaxExtent);
+    hasher.AddValue(options.atlasPageSize);
+    return hasher.Get();
+}
+
+uint64_t ModelImporter::HashTextureFiles(const std::vector<std::string>& paths)
+{
+    Hasher hasher;
+    for (const std::string& path : paths)
+    {
+        hasher.Add(path.data(), path.size());
+        std::error_code error;
+        const std::filesystem::path file = std::filesystem::u8path(path);
+        const uint64_t size = std::filesystem::file_size(file, error);
+        hasher.AddValue(error ? UINT64_MAX : size);
+        const auto time = std::filesystem::last_write_time(file, error);
+        hasher.AddValue(error ? int64_t(0) : int64_t(time.time_since_epoch().count()));
+    }
+    return hasher.Get();
+}
+
+ModelImporter::ModelImporter(ThreadPool* pool)
+    : mPool(pool)
+{
+    // FBXマネージャ生成
+    std::lock_guard<std::mutex> lock(gManagerMutex);
+    mManager = FbxManager::Create();
+    FbxIOSettings* ios = FbxIOSettings::Create(mManager, IOSROOT);
+    mManager->SetIOSettings(ios);
+}
+
+ModelImporter::~ModelImporter()
+{
+    std::lock_guard<std::mutex> lock(gManagerMutex);
+    if (mManager) mManager->Destroy();
+}
+
+bool ModelImporter::Import(const std::string& path, const MeshImportOptions& options, ModelData& model, ImportReport& report)
+{
+    StageClock clock;
+    mError.clear();
+
+    // インポーター生成
+    FbxImporter* importer = FbxImporter::Create(mManager, "");
+    if (!importer->Initialize(path.c_str(), -1, mManager->GetIOSettings()))
+    {
+        mError = importer->GetStatus().GetErrorString();
+        importer->Destroy();
+        return false;
+    }
+
+    // 埋め込みメディアは .fbm フォルダに展開させず、メモリで受け取る
+    EmbeddedMedia embedded;
+    FbxEmbeddedFileCallback* embeddedCallback = FbxEmbeddedFileCallback::Create(mManager, "");
+    embeddedCallback->RegisterReadFunction(ReadEmbeddedFile, &embedded);
+    importer->SetEmbeddedFileReadCallback(embeddedCallback);
+
+    // シーン生成・読み込み
+    FbxScene* scene = FbxScene::Create(mManager, "scene");
+    importer->Import(scene);
+    importer->Destroy();
+    embeddedCallback->Destroy();
+    report.AddStageTime("import", clock.Lap());
+
+    // 三角形化
+    FbxGeometryConverter converter(mManager);
+    converter.Triangulate(scene, true);
+    report.AddStageTime("triangulate", clock.Lap());
+
+    FbxNode* root = scene->GetRootNode();
+    if (!root)
+    {
+        mError = "FBX scene has no root node";
+        scene->Destroy();
+        return false;
+    }
+
+    // 階層を深さ優先でたどり、親が子より前に並ぶフラットな表にする
+    struct PendingNode
+    {
+        FbxNode* node;
+        int32_t parent;
+    };
+    std::vector<PendingNode> stack;
+    for (int i = root->GetChildCount() - 1; i >= 0; i--)
+    {
+        stack.push_back({ root->GetChild(i), -1 });
+    }
+
+    // 同じ FbxMesh を同じマテリアルで使うノードは同じサブメッシュを共有する
+    std::unordered_map<FbxMesh*, int32_t> meshIds;
+    MaterialTable materials(model, path, embedded, report.materials);
+
+    // 関節のノードはメッシュより後に現れることがあるので、番号は全ノードを並べてから引く
+    std::unordered_map<FbxNode*, int32_t> nodeIds;
+    std::vector<FbxNode*> jointNodes;   // model.joints と同じ並び
+    std::vector<FbxNode*> fbxNodes;     // model.nodes と同じ並び（アニメーションのベイク用）
+
+    while (!stack.empty())
+    {
+        PendingNode pending = stack.back();
+        stack.pop_back();
+        FbxNode* node = pending.node;
+
+        SceneNode sceneNode;
+        sceneNode.parent = pending.parent;
+
+        FbxAMatrix& local = node->EvaluateLocalTransform();
+        FbxVector4 t = local.GetT();
+        FbxQuaternion q = local.GetQ();
+        FbxVector4 s = local.GetS();
+        sceneNode.translation = { (float)t[0], (float)t[1], (float)t[2] };
+        sceneNode.rotation = { (float)q[0], (float)q[1], (float)q[2], (float)q[3] };
+        sceneNode.scale = { (float)s[0], (float)s[1], (float)s[2] };
+
+        if (FbxMesh* fbxMesh = node->GetMesh())
+        {
+            // ノードの最初のマテリアルをサブメッシュ全体に使う（ポリゴンごとの割り当ては分けない）
+            const uint32_t material = materials.Add(node->GetMaterialCount() > 0 ? node->GetMaterial(0) : nullptr);
+
+            // ジオメトリック変換を持つノードは頂点に焼き込むので共有しない
+            FbxAMatrix geometric(
+                node->GetGeometricTranslation(FbxNode::eSourcePivot),
+                node->GetGeometricRotation(FbxNode::eSourcePivot),
+                node->GetGeometricScaling(FbxNode::eSourcePivot));
+            bool shareable = geometric.IsIdentity();
+
+            auto found = shareable ? meshIds.find(fbxMesh) : meshIds.end();
+            if (found != meshIds.end() && model.geometry.submeshes[found->second].material == material)
+            {
+                sceneNode.mesh = found->second;
+            }
+            else
+            {
+                report.AddStageTime("hierarchy", clock.Lap());
+                MeshData mesh;
+                std::vector<FbxSkinJoint> joints;
+                bool imported = ImportMesh(node, fbxMesh, shareable ? nullptr : &geometric, options, mesh, joints, report);
+                clock.Lap();    // ImportMesh の中で計測済み
+                if (imported)
+                {
+                    // 共有の頂点/インデックス配列へ詰める（サブメッシュ自身の範囲は LOD0）
+                    const MeshLod& lod0 = mesh.lods[0];
+                    SubMesh submesh;
+                    submesh.indexOffset = uint32_t(model.geometry.indices.size());
+                    submesh.indexCount = lod0.indexCount;
+                    submesh.vertexOffset = uint32_t(model.geometry.vertices.size());
+                    submesh.vertexCount = uint32_t(mesh.vertices.size());
+                    submesh.meshletOffset = uint32_t(model.geometry.meshlets.size());
+                    submesh.meshletCount = lod0.meshletCount;
+                    submesh.lodOffset = uint32_t(model.geometry.lods.size());
+                    submesh.lodCount = uint32_t(mesh.lods.size());
+                    submesh.jointOffset = uint32_t(model.joints.size());
+                    submesh.jointCount = uint32_t(joints.size());
+                    submesh.material = material;
+                    Bounds::ComputeSubMeshBounds(mesh.vertices.data(), mesh.vertices.size(), submesh);
+                    submesh.uvDensity = TextureStreaming::ComputeUvDensity(mesh.vertices.data(),
+                        mesh.indices.data() + lod0.indexOffset, lod0.indexCount);
+                    for (const FbxSkinJoint& joint : joints)
+                    {
+                        SkinJoint skinJoint;
+                        std::copy(&joint.inverseBind[0][0], &joint.inverseBind[0][0] + 16, &skinJoint.inverseBind[0][0]);
+                        model.joints.push_back(skinJoint);
+                        jointNodes.push_back(joint.node);
+                    }
+                    model.geometry.vertices.insert(model.geometry.vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+                    model.geometry.indices.insert(model.geometry.indices.end(), mesh.indices.begin(), mesh.indices.end());
+                    for (Meshlet meshlet : mesh.meshlets)
+                    {
+                        meshlet.indexOffset += submesh.indexOffset;
+                        model.geometry.meshlets.push_back(meshlet);
+                    }
+                    for (MeshLod lod : mesh.lods)
+                    {
+                        lod.indexOffset += submesh.indexOffset;
+                        lod.meshletOffset += submesh.meshletOffset;
+                        model.geometry.lods.push_back(lod);
+                    }
+
+                    sceneNode.mesh = int32_t(model.geometry.submeshes.size());
+                    model.geometry.submeshes.push_back(submesh);
+                    if (shareable) meshIds.emplace(fbxMesh, sceneNode.mesh);
+                    report.AddStageTime("pack", clock.Lap());
+                }
+            }
+        }
+
+        int32_t index = int32_t(model.nodes.size());
+        nodeIds[node] = index;
+        fbxNodes.push_back(node);
+        model.nodes.push_back(sceneNode);
+        model.nodeNames.push_back(node->GetName());
+
+        for (int i = node->GetChildCount() - 1; i >= 0; i--)
+        {
+            stack.push_back({ node->GetChild(i), index });
+        }
+    }
+    report.AddStageTime("hierarchy", clock.Lap());
+
+    // マテリアルが参照する外部のテクスチャファイル（クッカーの依存関係に使う）
+    for (const ModelTexture& texture : model.textures)
+    {
+        if (texture.embedded.empty()) report.textureFiles.push_back(texture.path);
+    }
+
+    // テイクはシーンを破棄する前にノードのローカル TRS へベイクしておく
+    std::vector<AnimationCompression::RawClip> rawClips;
+    if (options.importAnimations)
+    {
+        FbxAnimationBaker::BakeTakes(scene, fbxNodes, options.animationSampleRate, rawClips);
+        report.AddStageTime("animation bake", clock.Lap());
+    }
+
+    scene->Destroy();
+
+    if (model.geometry.submeshes.empty())
+    {
+        mError = "FBX scene has no mesh";
+        return false;
+    }
+
+    // スキン付きサブメッシュのバインドポーズとウェイトを CPU スキニング用の配列に移す
+    for (size_t i = 0; i < model.joints.size(); i++)
+    {
+        auto found = nodeIds.find(jointNodes[i]);
+        model.joints[i].node = found != nodeIds.end() ? found->second : -1;
+    }
+    for (SubMesh& submesh : model.geometry.submeshes)
+    {
+        if (submesh.jointCount == 0) continue;
+        submesh.skinVertexOffset = uint32_t(model.skinVertices.size());
+        for (uint32_t v = 0; v < submesh.vertexCount; v++)
+        {
+            const MeshVertex& vertex = model.geometry.vertices[submesh.vertexOffset + v];
+            model.skinVertices.push_back({ vertex.pos, vertex.normal, vertex.tangent });
+            model.skinWeights.push_back(vertex.skin);
+        }
+    }
+    report.AddStageTime("skin", clock.Lap());
+
+    // 誤差の予算を階層に沿って配るため、ノードの親子関係を渡して圧縮する
+    if (!rawClips.empty())
+    {
+        std::vector<int32_t> parents(model.nodes.size());
+        for (size_t i = 0; i < model.nodes.size(); i++) parents[i] = model.nodes[i].parent;
+
+        AnimationCompression::CompressOptions compress;
+        compress.errorRatio = options.animationError;
+        for (const AnimationCompression::RawClip& raw : rawClips)
+        {
+            AnimationClip clip;
+            AnimationImportStats stats;
+            stats.name = raw.name;
+            stats.frameCount = raw.frameCount;
+            stats.compression = AnimationCompression::Compress(raw, parents, compress, clip, mPool);
+            stats.errorBudget = clip.errorBudget;
+            stats.measuredError = clip.measuredError;
+            report.animations.push_back(stats);
+            model.animations.push_back(std::move(clip));
+        }
+        rawClips.clear();
+        report.AddStageTime("animation compress", clock.Lap());
+    }
+
+    // 小さいテクスチャをページにまとめ、マテリアルには UV の変換を持たせる（頂点の UV はそのまま）
+    if (options.buildAtlases)
+    {
+        TextureAtlas::Options atlas;
+        atlas.maxExtent = options.atlasMaxExtent;
+        atlas.pageSize = options.atlasPageSize;
+        TextureAtlas::AtlasModelTextures(model, atlas, report.materials.atlas);
+        report.AddStageTime("atlas", clock.Lap());
+    }
+
+    // GPU の頂点形式に変換し、復元したときの誤差を測っておく
+    // Packed16 の位置はサブメッシュごとに自身の AABB で量子化する（描画ごとに復元の定数を切り替える）
+    model.vertexFormat = options.vertexFormat;
+    const std::vector<MeshVertex>& vertices = model.geometry.vertices;
+    const size_t stride = VertexFormatStride(model.vertexFormat);
+    model.gpuVertices.resize(vertices.size() * stride);
+    report.packing = VertexPacking::PackingStats();
+    for (SubMesh& submesh : model.geometry.submeshes)
+    {
+        const MeshVertex* first = vertices.data() + submesh.vertexOffset;
+        uint8_t* packed = model.gpuVertices.data() + size_t(submesh.vertexOffset) * stride;
+        if (options.vertexFormat == VertexFormat::Packed16)
+        {
+            submesh.quantization = VertexPacking::ComputeQuantization(first, submesh.vertexCount);
+        }
+        VertexPacking::PackVertices(first, submesh.vertexCount, model.vertexFormat, submesh.quantization, packed);
+        const VertexPacking::PackingStats stats = VertexPacking::MeasureError(first, submesh.vertexCount, packed,
+            model.vertexFormat, submesh.quantization);
+        MergePackingStats(report.packing, stats);
+
+        // 量子化で頂点が動く分だけ境界球と LOD の誤差を広げておく
+        const float positionError = stats.measured.position;
+        if (positionError > 0.0f)
+        {
+            submesh.boundsRadius += positionError;
+            submesh.boundsMin = { submesh.boundsMin.x - positionError, submesh.boundsMin.y - positionError, submesh.boundsMin.z - positionError };
+            submesh.boundsMax = { submesh.boundsMax.x + positionError, submesh.boundsMax.y + positionError, submesh.boundsMax.z + positionError };
+            for (uint32_t l = 0; l < submesh.lodCount; l++)
+            {
+                MeshLod& lod = model.geometry.lods[submesh.lodOffset + l];
+                if (lod.error > 0.0f) lod.error += positionError;
+                for (uint32_t m = 0; m < lod.meshletCount; m++)
+                {
+                    model.geometry.meshlets[lod.meshletOffset + m].radius += positionError;
+                }
+            }
+        }
+    }
+    report.AddStageTime("quantize", clock.Lap());
+    return true;
+}
+
+bool ModelImporter::BenchmarkExtraction(const std::string& path, int iterations, FbxMeshExtractor::BenchmarkResult& result,
+    double& importMs, double& triangulateMs)
+{
+    StageClock clock;
+    mError.clear();
+
+    FbxImporter* importer = FbxImporter::Create(mManager, "");
+    if (!importer->Initialize(path.c_str(), -1, mManager->GetIOSettings()))
+    {
+        mError = importer->GetStatus().GetErrorString();
+        importer->Destroy();
+        return false;
+    }
+    FbxScene* scene = FbxScene::Create(mManager, "scene");
+    importer->Import(scene);
+    importer->Destroy();
+    importMs = clock.Lap();
+
+    FbxGeometryConverter converter(mManager);
+    converter.Triangulate(scene, true);
+    triangulateMs = clock.Lap();
+
+    result = FbxMeshExtractor::RunBenchmark(scene, mPool, iterations);
+    scene->Destroy();
+    return true;
+}
+
+bool ModelImporter::ImportMesh(FbxNode* node, FbxMesh* fbxMesh, const FbxAMatrix* geometric,
+    const MeshImportOptions& options, MeshData& mesh, std::vector<FbxSkinJoint>& joints, ImportReport& report)
+{
+    StageClock clock;
+
+    // 頂点データ格納（属性を列ごとに一括で読み出してから頂点を組み立てる）
+    FbxMeshColumns columns;
+    if (!FbxMeshExtractor::ExtractColumns(fbxMesh, columns, mPool)) return false;
+    if (options.importSkins)
+    {
+        FbxMeshExtractor::ExtractSkin(fbxMesh, node, columns);
+    }
+
+    if (geometric)
+    {
+        FbxMeshExtractor::TransformColumns(columns, *geometric);
+    }
+    report.AddStageTime("extract", clock.Lap());
+
+    FbxMeshExtractor::AssembleVertices(columns, mesh, mPool);
+    joints = std::move(columns.joints);
+    MeshImportStats stats;
+    stats.invalidAttributeCorners = columns.invalidCorners;
+    stats.unsupportedAttributeLayers = columns.unsupportedLayers;
+    columns = FbxMeshColumns();
+    report.AddStageTime("assemble", clock.Lap());
+
+    stats.name = node->GetName();
+    stats.skinJoints = joints.size();
+    OptimizeGeometry(mesh, options, stats, report, clock, mPool);
+    report.meshes.push_back(stats);
+    return true;
+}
@@ -0,0 +1,124 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "AnimationCompression.h"
+#include "FbxMeshExtractor.h"
+#include "ModelData.h"
+#include "TextureAtlas.h"
+#include "VertexPacking.h"
+
+namespace fbxsdk { class FbxManager; class FbxNode; class FbxMesh; class FbxAMatrix; }
+class ThreadPool;
+// 1メッシュ分の最適化の結果
+struct MeshImportStats
+{
+    std::string name;
+    size_t cornerCount = 0;         // 溶接前の頂点数（三角形のコーナー数）
+    size_t vertexCount = 0;         // 最終的な頂点数
+    size_t tangentSplitVertices = 0;    // UV の向きの違いで複製した頂点
+    size_t tangentFallbackVertices = 0; // UV から接線が決まらなかった頂点
+    size_t invalidAttributeCorners = 0; // 法線/UV の参照が範囲外で既定値にしたコーナー（両方の合計）
+    size_t unsupportedAttributeLayers = 0;  // マッピングが未対応（eByEdge など）で読まなかった法線/UV のレイヤー
+    size_t triangleCount = 0;
+    float acmrBefore = 0.0f, acmrAfter = 0.0f;
+    float atvrBefore = 0.0f, atvrAfter = 0.0f;
+    float overdrawBefore = 0.0f, overdrawAfter = 0.0f;
+    size_t fetchMissesBefore = 0, fetchMissesAfter = 0;
+    float overfetchBefore = 0.0f, overfetchAfter = 0.0f;   // 読み込んだバイト数 / 使用頂点の総バイト数
+    size_t meshletCount = 0;
+    size_t skinJoints = 0;          // スキンの関節数（0 ならスキンなし）
+
+    struct Lod
+    {
+        size_t triangleCount;
+        float error;
+    };
+    std::vector<Lod> lods;          // LOD0 を含む
+};
+
+// 1テイク分のベイクと圧縮の結果
+struct AnimationImportStats
+{
+    std::string name;
+    uint32_t frameCount = 0;
+    AnimationCompression::CompressStats compression;
+    float errorBudget = 0.0f;       // 許した位置の誤差（モデル空間の距離）
+    float measuredError = 0.0f;     // 圧縮後に全フレームで測った誤差
+};
+
+// マテリアル/テクスチャの表を作った結果（まとめた後の数は ModelData の配列の長さ）
+struct MaterialImportStats
+{
+    size_t sourceMaterials = 0;     // ノードから参照された FBX のマテリアルの数
+    size_t textureReferences = 0;   // マテリアルからテクスチャへの参照の数（まとめる前）
+    size_t embeddedTextures = 0;    // FBX に埋め込まれていたテクスチャの数（まとめた後）
+    TextureAtlas::ModelStats atlas; // 小さいテクスチャをアトラスにまとめた結果
+};
+
+struct ImportStageTiming
+{
+    std::string stage;
+    double milliseconds = 0.0;
+};
+
+// インポートの計測結果（段階ごとの時間は全メッシュ分を合算）
+struct ImportReport
+{
+    std::vector<ImportStageTiming> stages;
+    std::vector<MeshImportStats> meshes;
+    std::vector<AnimationImportStats> animations;
+    VertexPacking::PackingStats packing;    // GPU の頂点形式に変換したときの誤差
+    MaterialImportStats materials;
+    std::vector<std::string> textureFiles;  // マテリアルが参照する外部のテクスチャファイル（見つからないものも含む）
+
+    void AddStageTime(const char* stage, double milliseconds);
+};
+
+// FBXファイルを読み込み、シーン階層と全メッシュを ModelData にまとめる（D3D非依存）
+// 1つのインスタンスは1スレッドから使う。並列に読むときはスレッドごとに作る（BatchImporter）
+class ModelImporter
+{
+public:
+    // 出力が変わる修正をしたら上げる（派生データキャッシュのキーに含まれる）
+    static constexpr uint32_t kVersion = 11;
+
+    // 元ファイルの内容・インポーターのバージョン・オプションから派生データのキーを作る
+    static uint64_t ComputeCacheKey(const void* sourceData, size_t sourceSize, const MeshImportOptions& options);
+
+    // 出力に影響するオプションだけのハッシュ（バージョンを含まない）
+    static uint64_t HashOptions(const MeshImportOptions& options);
+
+    // 外部のテクスチャファイル（ImportReport::textureFiles）のパス・大きさ・更新日時のハッシュ
+    // アトラスのページはこれらの画像から作るので、元ファイルのキーだけでは画像の変更に気づけない
+    // キャッシュしたメッシュを使う前に、記録しておいた値と比べる（見つからないファイルも状態として混ぜる）
+    static uint64_t HashTextureFiles(const std::vector<std::string>& paths);
+
+    // pool があれば接線・属性の読み出し・アニメーションの圧縮をメッシュ内で並列に行う（nullptr なら直列）
+    // pool は複数のインポーターで共有してよい（BatchImporter は全ワーカーで1つを使う）
+    explicit ModelImporter(ThreadPool* pool = nullptr);
+    ~ModelImporter();
+    ModelImporter(const ModelImporter&) = delete;
+    ModelImporter& operator=(const ModelImporter&) = delete;
+
+    bool Import(const std::string& path, const MeshImportOptions& options, ModelData& model, ImportReport& report);
+
+    // path を読み込んで三角形化し、全メッシュで頂点属性の読み出し方を比べる（FbxMeshExtractor::RunBenchmark）
+    // importMs / triangulateMs には1回分の読み込みと三角形化の時間を返す
+    bool BenchmarkExtraction(const std::string& path, int iterations, FbxMeshExtractor::BenchmarkResult& result,
+        double& importMs, double& triangulateMs);
+
+    // 失敗時の理由
+    const std::string& GetErrorString() const { return mError; }
+
+private:
+    // geometric はノードのジオメトリック変換（単位行列なら nullptr）
+    // スキン付きなら joints に関節を返す（頂点の SkinWeights はこの並びを参照する）
+    bool ImportMesh(fbxsdk::FbxNode* node, fbxsdk::FbxMesh* fbxMesh, const fbxsdk::FbxAMatrix* geometric,
+        const MeshImportOptions& options, MeshData& mesh, std::vector<FbxSkinJoint>& joints, ImportReport& report);
+
+    fbxsdk::FbxManager* mManager = nullptr;
+    ThreadPool* mPool = nullptr;
+    std::string mError;
+};
@@ -0,0 +1,428 @@
+﻿#include "Skinning.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "ThreadPool.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define SKINNING_X64 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define SKINNING_TARGET_AVX2
+#else
+#define SKINNING_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+namespace
+{
+    // 1スレッドに渡す最小の頂点数（これより少ない区間は分けない）
+    constexpr size_t kParallelChunk = 4096;
+
+    using SkinFunction = void (*)(const SkinnedVertex*, const SkinWeights*, size_t, const Skinning::SkinMatrix*, SkinnedVertex*);
+
+    // --- スカラー版 ---
+
+    Float3 TransformPoint(const Float3& p, const float (&m)[4][4])
+    {
+        return
+        {
+            p.x * m[0][0] + p.y * m[1][0] + p.z * m[2][0] + m[3][0],
+            p.x * m[0][1] + p.y * m[1][1] + p.z * m[2][1] + m[3][1],
+            p.x * m[0][2] + p.y * m[1][2] + p.z * m[2][2] + m[3][2],
+        };
+    }
+
+    // 法線/接線は混ぜた行列の 3x3 部分で回して正規化する（関節の非一様スケールは考慮しない）
+    Float3 TransformDirection(const Float3& v, const float (&m)[4][4])
+    {
+        Float3 r =
+        {
+            v.x * m[0][0] + v.y * m[1][0] + v.z * m[2][0],
+            v.x * m[0][1] + v.y * m[1][1] + v.z * m[2][1],
+            v.x * m[0][2] + v.y * m[1][2] + v.z * m[2][2],
+        };
+        const float length = std::sqrt((r.x * r.x + r.y * r.y) + r.z * r.z);
+        if (length <= 0.0f) return { 0.0f, 0.0f, 0.0f };
+        return { r.x / length, r.y / length, r.z / length };
+    }
+
+#if SKINNING_X64
+    // --- SSE 版（1頂点ずつ） ---
+    // 行列は4行をそれぞれ __m128 で混ぜ、位置は p.x * r0 + p.y * r1 + p.z * r2 + r3 で変換する
+    // 読み書きは SkinnedVertex の中で 16byte ずつ行う（pos の4要素目は normal.x に重なるが、書く順で上書きされる）
+
+    __m128 NormalizeDirection(__m128 v, __m128 xyzMask)
+    {
+        v = _mm_and_ps(v, xyzMask);
+        __m128 sq = _mm_mul_ps(v, v);
+        __m128 sum = _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 3, 0, 1)));
+        sum = _mm_add_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 0, 3, 2)));
+        const __m128 length = _mm_sqrt_ps(sum);
+        return _mm_and_ps(_mm_div_ps(v, length), _mm_cmpgt_ps(length, _mm_setzero_ps()));
+    }
+
+    void SkinVerticesSse(const SkinnedVertex* bindPose, const SkinWeights* weights, size_t count,
+        const Skinning::SkinMatrix* palette, SkinnedVertex* out)
+    {
+        const __m128 xyzMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+        for (size_t i = 0; i < count; i++)
+        {
+            const SkinWeights& w = weights[i];
+            const __m128 weight4 = _mm_loadu_ps(w.weights);
+
+            const Skinning::SkinMatrix& m0 = palette[w.joints[0]];
+            __m128 s = _mm_shuffle_ps(weight4, weight4, _MM_SHUFFLE(0, 0, 0, 0));
+            __m128 r0 = _mm_mul_ps(_mm_load_ps(m0.m[0]), s);
+            __m128 r1 = _mm_mul_ps(_mm_load_ps(m0.m[1]), s);
+            __m128 r2 = _mm_mul_ps(_mm_load_ps(m0.m[2]), s);
+            __m128 r3 = _mm_mul_ps(_mm_load_ps(m0.m[3]), s);
+            for (int k = 1; k < 4; k++)
+            {
+                const Skinning::SkinMatrix& m = palette[w.joints[k]];
+                s = _mm_set1_ps(w.weights[k]);
+                r0 = _mm_add_ps(r0, _mm_mul_ps(_mm_load_ps(m.m[0]), s));
+                r1 = _mm_add_ps(r1, _mm_mul_ps(_mm_load_ps(m.m[1]), s));
+                r2 = _mm_add_ps(r2, _mm_mul_ps(_mm_load_ps(m.m[2]), s));
+                r3 = _mm_add_ps(r3, _mm_mul_ps(_mm_load_ps(m.m[3]), s));
+            }
+
+            const SkinnedVertex& v = bindPose[i];
+            const __m128 p = _mm_loadu_ps(&v.pos.x);
+            const __m128 n = _mm_loadu_ps(&v.normal.x);
+            const __m128 t = _mm_loadu_ps(&v.tangent.x);
+
+            __m128 po = _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(0, 0, 0, 0)), r0);
+            po = _mm_add_ps(po, _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1)), r1));
+            po = _mm_add_ps(po, _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 2, 2)), r2));
+            po = _mm_add_ps(po, r3);
+
+            __m128 no = _mm_mul_ps(_mm_shuffle_ps(n, n, _MM_SHUFFLE(0, 0, 0, 0)), r0);
+            no = _mm_add_ps(no, _mm_mul_ps(_mm_shuffle_ps(n, n, _MM_SHUFFLE(1, 1, 1, 1)), r1));
+            no = _mm_add_ps(no, _mm_mul_ps(_mm_shuffle_ps(n, n, _MM_SHUFFLE(2, 2, 2, 2)), r2));
+            no = NormalizeDirection(no, xyzMask);
+
+            __m128 to = _mm_mul_ps(_mm_shuffle_ps(t, t, _MM_SHUFFLE(0, 0, 0, 0)), r0);
+            to = _mm_add_ps(to, _mm_mul_ps(_mm_shuffle_ps(t, t, _MM_SHUFFLE(1, 1, 1, 1)), r1));
+            to = _mm_add_ps(to, _mm_mul_ps(_mm_shuffle_ps(t, t, _MM_SHUFFLE(2, 2, 2, 2)), r2));
+            to = _mm_or_ps(NormalizeDirection(to, xyzMask), _mm_andnot_ps(xyzMask, t));
+
+            SkinnedVertex& o = out[i];
+            _mm_storeu_ps(&o.pos.x, po);
+            _mm_storeu_ps(&o.normal.x, no);
+            _mm_storeu_ps(&o.tangent.x, to);
+        }
+    }
+
+    // --- AVX2 版（2頂点ずつ。下位 128bit が1頂点目、上位が2頂点目） ---
+
+    SKINNING_TARGET_AVX2 inline __m256 Combine(__m128 lo, __m128 hi)
+    {
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+    }
+
+    SKINNING_TARGET_AVX2 inline __m256 NormalizeDirection2(__m256 v, __m256 xyzMask)
+    {
+        v = _mm256_and_ps(v, xyzMask);
+        __m256 sq = _mm256_mul_ps(v, v);
+        __m256 sum = _mm256_add_ps(sq, _mm256_permute_ps(sq, _MM_SHUFFLE(2, 3, 0, 1)));
+        sum = _mm256_add_ps(sum, _mm256_permute_ps(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+        const __m256 length = _mm256_sqrt_ps(sum);
+        return _mm256_and_ps(_mm256_div_ps(v, length), _mm256_cmp_ps(length, _mm256_setzero_ps(), _CMP_GT_OQ));
+    }
+
+    // v の x, y, z をレーンごとに広げて r0..r2 に掛けた和
+    SKINNING_TARGET_AVX2 inline __m256 TransformDirection2(__m256 v, __m256 r0, __m256 r1, __m256 r2)
+    {
+        __m256 o = _mm256_mul_ps(_mm256_permute_ps(v, _MM_SHUFFLE(0, 0, 0, 0)), r0);
+        o = _mm256_fmadd_ps(_mm256_permute_ps(v, _MM_SHUFFLE(1, 1, 1, 1)), r1, o);
+        return _mm256_fmadd_ps(_mm256_permute_ps(v, _MM_SHUFFLE(2, 2, 2, 2)), r2, o);
+    }
+
+    SKINNING_TARGET_AVX2 void SkinVerticesAvx2(const SkinnedVertex* bindPose, const SkinWeights* weights, size_t count,
+        const Skinning::SkinMatrix* palette, SkinnedVertex* out)
+    {
+        const __m256 xyzMask = _mm256_castsi256_ps(_mm256_set_epi32(0, -1, -1, -1, 0, -1, -1, -1));
+        size_t i = 0;
+        for (; i + 2 <= count; i += 2)
+        {
+            const SkinWeights& wa = weights[i];
+            const SkinWeights& wb = weights[i + 1];
+            const __m256 weight8 = Combine(_mm_loadu_ps(wa.weights), _mm_loadu_ps(wb.weights));
+
+            __m256 r0, r1, r2, r3;
+            {
+                const Skinning::SkinMatrix& ma = palette[wa.joints[0]];
+                const Skinning::SkinMatrix& mb = palette[wb.joints[0]];
+                const __m256 s = _mm256_permute_ps(weight8, _MM_SHUFFLE(0, 0, 0, 0));
+                r0 = _mm256_mul_ps(Combine(_mm_load_ps(ma.m[0]), _mm_load_ps(mb.m[0])), s);
+                r1 = _mm256_mul_ps(Combine(_mm_load_ps(ma.m[1]), _mm_load_ps(mb.m[1])), s);
+                r2 = _mm256_mul_ps(Combine(_mm_load_ps(ma.m[2]), _mm_load_ps(mb.m[2])), s);
+                r3 = _mm256_mul_ps(Combine(_mm_load_ps(ma.m[3]), _mm_load_ps(mb.m[3])), s);
+            }
+#define SKINNING_BLEND_JOINT(k, shuffle) \
+            { \
+                const Skinning::SkinMatrix& ma = palette[wa.joints[k]]; \
+                const Skinning::SkinMatrix& mb = palette[wb.joints[k]]; \
+                const __m256 s = _mm256_permute_ps(weight8, shuffle); \
+                r0 = _mm256_fmadd_ps(Combine(_mm_load_ps(ma.m[0]), _mm_load_ps(mb.m[0])), s, r0); \
+                r1 = _mm256_fmadd_ps(Combine(_mm_load_ps(ma.m[1]), _mm_load_ps(mb.m[1])), s, r1); \
+                r2 = _mm256_fmadd_ps(Combine(_mm_load_ps(ma.m[2]), _mm_load_ps(mb.m[2])), s, r2); \
+                r3 = _mm256_fmadd_ps(Combine(_mm_load_ps(ma.m[3]), _mm_load_ps(mb.m[3])), s, r3); \
+            }
+            SKINNING_BLEND_JOINT(1, _MM_SHUFFLE(1, 1, 1, 1))
+            SKINNING_BLEND_JOINT(2, _MM_SHUFFLE(2, 2, 2, 2))
+            SKINNING_BLEND_JOINT(3, _MM_SHUFFLE(3, 3, 3, 3))
+#undef SKINNING_BLEND_JOINT
+
+            const SkinnedVertex& va = bindPose[i];
+            const SkinnedVertex& vb = bindPose[i + 1];
+            const __m256 p = Combine(_mm_loadu_ps(&va.pos.x), _mm_loadu_ps(&vb.pos.x));
+            const __m256 n = Combine(_mm_loadu_ps(&va.normal.x), _mm_loadu_ps(&vb.normal.x));
+            const __m256 t = Combine(_mm_loadu_ps(&va.tangent.x), _mm_loadu_ps(&vb.tangent.x));
+
+            const __m256 po = _mm256_add_ps(TransformDirection2(p, r0, r1, r2), r3);
+            const __m256 no = NormalizeDirection2(TransformDirection2(n, r0, r1, r2), xyzMask);
+            const __m256 to = _mm256_or_ps(NormalizeDirection2(TransformDirection2(t, r0, r1, r2), xyzMask),
+                _mm256_andnot_ps(xyzMask, t));
+
+            // 頂点ごとに pos -> normal -> tangent の順で書く（16byte の書き込みが次の要素に重なるため）
+            SkinnedVertex& oa = out[i];
+            SkinnedVertex& ob = out[i + 1];
+            _mm_storeu_ps(&oa.pos.x, _mm256_castps256_ps128(po));
+            _mm_storeu_ps(&oa.normal.x, _mm256_castps256_ps128(no));
+            _mm_storeu_ps(&oa.tangent.x, _mm256_castps256_ps128(to));
+            _mm_storeu_ps(&ob.pos.x, _mm256_extractf128_ps(po, 1));
+            _mm_storeu_ps(&ob.normal.x, _mm256_extractf128_ps(no, 1));
+            _mm_storeu_ps(&ob.tangent.x, _mm256_extractf128_ps(to, 1));
+        }
+
+        if (i < count)
+        {
+            SkinVerticesSse(bindPose + i, weights + i, count - i, palette, out + i);
+        }
+    }
+
+    // CPU と OS が AVX2 / FMA（YMM レジスタの保存）に対応しているか
+    bool CpuSupportsAvx2()
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7) return false;
+        __cpuid(info, 1);
+        const bool fma = (info[2] & (1 << 12)) != 0;
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        if (!fma || !osxsave || !avx || (_xgetbv(0) & 6) != 6) return false;
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+    }
+#endif
+
+    struct Kernel
+    {
+        SkinFunction function;
+        const char* name;
+    };
+
+    const Kernel& SelectKernel()
+    {
+        static const Kernel kernel = []()
+        {
+#if SKINNING_X64
+            if (CpuSupportsAvx2()) return Kernel{ SkinVerticesAvx2, "AVX2" };
+            return Kernel{ SkinVerticesSse, "SSE2" };
+#else
+            return Kernel{ Skinning::SkinVerticesReference, "scalar" };
+#endif
+        }();
+        return kernel;
+    }
+
+    // 関節数 jointCount の範囲でランダムなウェイト（1〜4本、合計 1）を作る
+    void MakeBenchmarkMesh(size_t vertexCount, uint32_t jointCount, std::vector<SkinnedVertex>& vertices,
+        std::vector<SkinWeights>& weights, std::vector<Skinning::SkinMatrix>& palette)
+    {
+        std::mt19937 rng(12345);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        std::uniform_int_distribution<uint32_t> joint(0, jointCount - 1);
+        auto direction = [&]()
+        {
+            Float3 d = { unit(rng), unit(rng), unit(rng) + 2.0f };
+            const float length = std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z);
+            return Float3{ d.x / length, d.y / length, d.z / length };
+        };
+
+        vertices.resize(vertexCount);
+        weights.resize(vertexCount);
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            SkinnedVertex& v = vertices[i];
+            v.pos = { unit(rng), unit(rng), unit(rng) };
+            v.normal = direction();
+            const Float3 t = direction();
+            v.tangent = { t.x, t.y, t.z, (i & 1) ? 1.0f : -1.0f };
+
+            SkinWeights& w = weights[i];
+            const int influences = 1 + int(i % 4);
+            float sum = 0.0f;
+            for (int k = 0; k < 4; k++)
+            {
+                w.joints[k] = k < influences ? uint16_t(joint(rng)) : 0;
+                w.weights[k] = k < influences ? unit(rng) + 1.5f : 0.0f;
+                sum += w.weights[k];
+            }
+            for (float& weight : w.weights) weight /= sum;
+        }
+
+        // 関節ごとに回転 + 平行移動（w 列は 0, 0, 0, 1）
+        palette.resize(jointCount);
+        for (Skinning::SkinMatrix& m : palette)
+        {
+            const Float3 axis = direction();
+            const float angle = unit(rng) * 3.14159265f;
+            const float c = std::cos(angle), s = std::sin(angle), ic = 1.0f - c;
+            const float x = axis.x, y = axis.y, z = axis.z;
+            const float rows[4][4] =
+            {
+                { c + x * x * ic,     x * y * ic + z * s, x * z * ic - y * s, 0.0f },
+                { y * x * ic - z * s, c + y * y * ic,     y * z * ic + x * s, 0.0f },
+                { z * x * ic + y * s, z * y * ic - x * s, c + z * z * ic,     0.0f },
+                { unit(rng),          unit(rng),          unit(rng),          1.0f },
+            };
+            std::copy(&rows[0][0], &rows[0][0] + 16, &m.m[0][0]);
+        }
+    }
+
+    // body を iterations 回実行し、最も速かった1回の処理速度（頂点/秒）を返す
+    template <class Body>
+    double MeasureThroughput(size_t vertexCount, int iterations, Body body)
+    {
+        double best = 0.0;
+        for (int i = 0; i < iterations; i++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            body();
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (seconds > 0.0) best = std::max(best, double(vertexCount) / seconds);
+        }
+        return best;
+    }
+
+    float Distance(const Float3& a, const Float3& b)
+    {
+        const float dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+        return std::sqrt(dx * dx + dy * dy + dz * dz);
+    }
+}
+
+namespace Skinning
+{
+    void SkinVerticesReference(const SkinnedVertex* bindPose, const SkinWeights* weights, size_t count,
+        const SkinMatrix* palette, SkinnedVertex* out)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            // 4つの関節行列をウェイトで混ぜてから変換する（SIMD 版と同じ順序）
+            const SkinWeights& w = weights[i];
+            float m[4][4];
+            for (int r = 0; r < 4; r++)
+            {
+                for (int c = 0; c < 4; c++)
+                {
+                    m[r][c] = palette[w.joints[0]].m[r][c] * w.weights[0];
+                }
+            }
+            for (int k = 1; k < 4; k++)
+            {
+                const SkinMatrix& joint = palette[w.joints[k]];
+                for (int r = 0; r < 4; r++)
+                {
+                    for (int c = 0; c < 4; c++)
+                    {
+                        m[r][c] += joint.m[r][c] * w.weights[k];
+                    }
+                }
+            }
+
+            const SkinnedVertex& v = bindPose[i];
+            SkinnedVertex& o = out[i];
+            o.pos = TransformPoint(v.pos, m);
+            o.normal = TransformDirection(v.normal, m);
+            const Float3 tangent = TransformDirection(Float3{ v.tangent.x, v.tangent.y, v.tangent.z }, m);
+            o.tangent = { tangent.x, tangent.y, tangent.z, v.tangent.w };
+        }
+    }
+
+    void SkinVertices(const SkinnedVertex* bindPose, const SkinWeights* weights, size_t count,
+        const SkinMatrix* palette, SkinnedVertex* out)
+    {
+        SelectKernel().function(bindPose, weights, count, palette, out);
+    }
+
+    void SkinVerticesParallel(ThreadPool& pool, const SkinnedVertex* bindPose, const SkinWeights* weights, size_t count,
+        const SkinMatrix* palette, SkinnedVertex* out)
+    {
+        const SkinFunction function = SelectKernel().function;
+        pool.ParallelFor(count, kParallelChunk, [&](size_t begin, size_t end)
+        {
+            function(bindPose + begin, weights + begin, end - begin, palette, out + begin);
+        });
+    }
+
+    const char* GetKernelName()
+    {
+        return SelectKernel().name;
+    }
+
+    BenchmarkResult RunBenchmark(ThreadPool& pool, size_t vertexCount, uint32_t jointCount, int iterations)
+    {
+        BenchmarkResult result;
+        result.kernel = GetKernelName();
+        result.vertexCount = vertexCount;
+        result.jointCount = jointCount;
+        result.threadCount = pool.GetThreadCount();
+        if (vertexCount == 0 || jointCount == 0 || iterations <= 0) return result;
+
+        std::vector<SkinnedVertex> bindPose;
+        std::vector<SkinWeights> weights;
+        std::vector<SkinMatrix> palette;
+        MakeBenchmarkMesh(vertexCount, jointCount, bindPose, weights, palette);
+
+        std::vector<SkinnedVertex> reference(vertexCount), simd(vertexCount), parallel(vertexCount);
+        result.referenceVerticesPerSecond = MeasureThroughput(vertexCount, iterations, [&]()
+        {
+            SkinVerticesReference(bindPose.data(), weights.data(), vertexCount, palette.data(), reference.data());
+        });
+        result.simdVerticesPerSecond = MeasureThroughput(vertexCount, iterations, [&]()
+        {
+            SkinVertices(bindPose.data(), weights.data(), vertexCount, palette.data(), simd.data());
+        });
+        result.parallelVerticesPerSecondPerCore = MeasureThroughput(vertexCount, iterations, [&]()
+        {
+            SkinVerticesParallel(pool, bindPose.data(), weights.data(), vertexCount, palette.data(), parallel.data());
+        }) / double(result.threadCount);
+
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            const Float3 referenceTangent = { reference[i].tangent.x, reference[i].tangent.y, reference[i].tangent.z };
+            for (const SkinnedVertex* v : { &simd[i], &parallel[i] })
+            {
+                result.maxPositionError = std::max(result.maxPositionError, Distance(v->pos, reference[i].pos));
+                result.maxNormalError = std::max(result.maxNormalError, Distance(v->normal, reference[i].normal));
+                result.maxNormalError = std::max(result.maxNormalError,
+                    Distance(Float3{ v->tangent.x, v->tangent.y, v->tangent.z }, referenceTangent));
+                if (v->tangent.w != reference[i].tangent.w) result.maxNormalError = std::max(result.maxNormalError, 2.0f);
+            }
+        }
+        return result;
+    }
+}
@@ -0,0 +1,51 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "MeshData.h"
+
+class ThreadPool;
+
+// CPU の線形ブレンドスキニング（D3D非依存）
+// 頂点ごとに最大4つの関節行列をウェイトで混ぜ、位置・法線・接線を変換する
+namespace Skinning
+{
+    // パレットの1行列（行ベクトル形式 p' = p * M。w 列は使わない）
+    // = SkinJoint::inverseBind * 関節ノードの行列。16byte 境界に置いて行ごとに SIMD で読む
+    struct alignas(16) SkinMatrix
+    {
+        float m[4][4];
+    };
+
+    // スカラー版（SIMD 版の検証用の基準。SIMD 版と同じ順序で計算する）
+    // palette はサブメッシュの関節の並び（SkinWeights::joints の番号で引く）
+    void SkinVerticesReference(const SkinnedVertex* bindPose, const SkinWeights* weights, size_t count,
+        const SkinMatrix* palette, SkinnedVertex* out);
+
+    // SIMD 版（AVX2 + FMA が使える CPU では2頂点ずつ、それ以外は SSE で1頂点ずつ）
+    // out は書き込み専用（D3D の動的バッファをマップしたメモリを直接渡してよい）
+    void SkinVertices(const SkinnedVertex* bindPose, const SkinWeights* weights, size_t count,
+        const SkinMatrix* palette, SkinnedVertex* out);
+
+    // SkinVertices を区間に分けてスレッドプールで処理する
+    void SkinVerticesParallel(ThreadPool& pool, const SkinnedVertex* bindPose, const SkinWeights* weights, size_t count,
+        const SkinMatrix* palette, SkinnedVertex* out);
+
+    // SkinVertices が使う命令セット（"AVX2" / "SSE2" / "scalar"）
+    const char* GetKernelName();
+
+    struct BenchmarkResult
+    {
+        const char* kernel = "";
+        size_t vertexCount = 0;
+        uint32_t jointCount = 0;
+        size_t threadCount = 0;
+        double referenceVerticesPerSecond = 0.0;    // スカラー版、1スレッド
+        double simdVerticesPerSecond = 0.0;         // SIMD 版、1スレッド
+        double parallelVerticesPerSecondPerCore = 0.0;  // SIMD 版をスレッドプールで実行したときのスレッドあたり
+        float maxPositionError = 0.0f;              // SIMD 版とスカラー版の差の最大（距離）
+        float maxNormalError = 0.0f;                // 法線/接線の差の最大（ベクトルの差の長さ）
+    };
+
+    // 乱数で作ったメッシュとパレットで各版の処理速度を測り、SIMD 版の結果をスカラー版と比べる
+    BenchmarkResult RunBenchmark(ThreadPool& pool, size_t vertexCount = 200000, uint32_t jointCount = 64, int iterations = 20);
+}
@@ -0,0 +1,599 @@
+﻿#include "TextureAtlas.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include "FileUtil.h"
+#include "ImageLoader.h"
+#include "TextureFile.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <objbase.h>
+#endif
+
+namespace
+{
+    constexpr float kUvEpsilon = 1.0e-3f;
+
+    double ElapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    uint32_t AlignUp(uint32_t value, uint32_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // 最後の段でも 1 画素以上残るよう、段数ぶん割り切れる大きさに丸めた余白
+    uint32_t GutterSize(const TextureAtlas::Options& options)
+    {
+        const uint32_t step = 1u << (std::max<uint32_t>(options.mipCount, 1) - 1);
+        return AlignUp(std::max(options.gutter, step), step);
+    }
+
+    // 画像を置くセルの大きさ（CellAlignment の倍数）
+    uint32_t CellSize(uint32_t size, const TextureAtlas::Options& options)
+    {
+        return AlignUp(size + 2 * GutterSize(options), TextureAtlas::CellAlignment(options));
+    }
+
+    struct FreeRect
+    {
+        uint32_t x, y, width, height;
+    };
+
+    class SkylinePacker
+    {
+    public:
+        SkylinePacker(uint32_t width, uint32_t height) : mWidth(width), mHeight(height)
+        {
+            mNodes.push_back({ 0, 0, width });
+        }
+
+        bool Insert(uint32_t width, uint32_t height, uint32_t& x, uint32_t& y)
+        {
+            // 上端が最も低くなる（同じなら左の）節から置く
+            size_t best = SIZE_MAX;
+            uint32_t bestTop = UINT32_MAX, bestY = 0;
+            for (size_t i = 0; i < mNodes.size(); i++)
+            {
+                uint32_t top;
+                if (!Fit(i, width, height, top)) continue;
+                if (top + height < bestTop)
+                {
+                    best = i;
+                    bestY = top;
+                    bestTop = top + height;
+                }
+            }
+            if (best == SIZE_MAX) return false;
+            x = mNodes[best].x;
+            y = bestY;
+
+            // 新しい節を入れ、その下に隠れた節を削って、同じ高さの隣どうしをつなぐ
+            mNodes.insert(mNodes.begin() + best, { x, y + height, width });
+            for (size_t i = best + 1; i < mNodes.size();)
+            {
+                Node& node = mNodes[i];
+                const uint32_t right = x + width;
+                if (node.x >= right) break;
+                const uint32_t shrink = std::min(right - node.x, node.width);
+                node.x += shrink;
+                node.width -= shrink;
+                if (node.width == 0)
+                {
+                    mNodes.erase(mNodes.begin() + i);
+                    continue;
+                }
+                break;
+            }
+            for (size_t i = 0; i + 1 < mNodes.size();)
+            {
+                if (mNodes[i].y == mNodes[i + 1].y)
+                {
+                    mNodes[i].width += mNodes[i + 1].width;
+                    mNodes.erase(mNodes.begin() + i + 1);
+                    continue;
+                }
+                i++;
+            }
+            return true;
+        }
+
+    private:
+        struct Node
+        {
+            uint32_t x, y, width;
+        };
+
+        // index の節の左端に置いたときの下端（幅にかかる節の最も高いところ）
+        bool Fit(size_t index, uint32_t width, uint32_t height, uint32_t& top) const
+        {
+            if (mNodes[index].x + width > mWidth) return false;
+            top = 0;
+            uint32_t remaining = width;
+            for (size_t i = index; remaining > 0; i++)
+            {
+                top = std::max(top, mNodes[i].y);
+                if (top + height > mHeight) return false;
+                remaining -= std::min(remaining, mNodes[i].width);
+            }
+            return true;
+        }
+
+        uint32_t mWidth, mHeight;
+        std::vector<Node> mNodes;
+    };
+
+    class MaxRectsPacker
+    {
+    public:
+        MaxRectsPacker(uint32_t width, uint32_t height)
+        {
+            mFree.push_back({ 0, 0, width, height });
+        }
+
+        bool Insert(uint32_t width, uint32_t height, uint32_t& x, uint32_t& y)
+        {
+            // 短い辺の余りが最も小さい（同じなら長い辺の余りが小さい）空き領域の左上に置く
+            size_t best = SIZE_MAX;
+            uint32_t bestShort = UINT32_MAX, bestLong = UINT32_MAX;
+            for (size_t i = 0; i < mFree.size(); i++)
+            {
+                const FreeRect& free = mFree[i];
+                if (free.width < width || free.height < height) continue;
+                const uint32_t dx = free.width - width, dy = free.height - height;
+                const uint32_t shortSide = std::min(dx, dy), longSide = std::max(dx, dy);
+                if (shortSide < bestShort || (shortSide == bestShort && longSide < bestLong))
+                {
+                    best = i;
+                    bestShort = shortSide;
+                    bestLong = longSide;
+                }
+            }
+            if (best == SIZE_MAX) return false;
+            x = mFree[best].x;
+            y = mFree[best].y;
+
+            // 置いた範囲と重なる空き領域を、重ならない残りの極大な長方形（最大4つ）に分ける
+            const FreeRect placed = { x, y, width, height };
+            const size_t count = mFree.size();
+            for (size_t i = 0; i < count; i++)
+            {
+                const FreeRect free = mFree[i];
+                if (placed.x >= free.x + free.width || placed.x + placed.width <= free.x ||
+                    placed.y >= free.y + free.height || placed.y + placed.height <= free.y)
+                {
+                    continue;
+                }
+                if (placed.x > free.x) mFree.push_back({ free.x, free.y, placed.x - free.x, free.height });
+                if (placed.x + placed.width < free.x + free.width)
+                {
+                    mFree.push_back({ placed.x + placed.width, free.y, free.x + free.width - placed.x - placed.width, free.height });
+                }
+                if (placed.y > free.y) mFree.push_back({ free.x, free.y, free.width, placed.y - free.y });
+                if (placed.y + placed.height < free.y + free.height)
+                {
+                    mFree.push_back({ free.x, placed.y + placed.height, free.width, free.y + free.height - placed.y - placed.height });
+                }
+                mFree[i].width = 0;
+            }
+            Prune();
+            return true;
+        }
+
+    private:
+        static bool Contains(const FreeRect& outer, const FreeRect& inner)
+        {
+            return inner.x >= outer.x && inner.y >= outer.y &&
+                inner.x + inner.width <= outer.x + outer.width && inner.y + inner.height <= outer.y + outer.height;
+        }
+
+        // 分けた後の空でない領域から、他の領域に含まれるものを取り除く（同じものは1つ残す）
+        void Prune()
+        {
+            mFree.erase(std::remove_if(mFree.begin(), mFree.end(), [](const FreeRect& r) { return r.width == 0; }), mFree.end());
+            for (size_t i = 0; i < mFree.size(); i++)
+            {
+                for (size_t j = i + 1; j < mFree.size();)
+                {
+                    if (Contains(mFree[i], mFree[j]))
+                    {
+                        mFree.erase(mFree.begin() + j);
+                        continue;
+                    }
+                    if (Contains(mFree[j], mFree[i]))
+                    {
+                        mFree.erase(mFree.begin() + i);
+                        i--;
+                        break;
+                    }
+                    j++;
+                }
+            }
+        }
+
+        std::vector<FreeRect> mFree;
+    };
+
+    template <class PackerType>
+    void PackPages(std::vector<TextureAtlas::PackRect>& rects, const std::vector<uint32_t>& order, uint32_t pageSize,
+        std::vector<TextureAtlas::PageExtent>& pages)
+    {
+        std::vector<uint32_t> remaining = order;
+        while (!remaining.empty())
+        {
+            PackerType packer(pageSize, pageSize);
+            TextureAtlas::PageExtent extent;
+            const uint32_t page = uint32_t(pages.size());
+            std::vector<uint32_t> next;
+            for (uint32_t i : remaining)
+            {
+                TextureAtlas::PackRect& rect = rects[i];
+                if (!packer.Insert(rect.width, rect.height, rect.x, rect.y))
+                {
+                    next.push_back(i);
+                    continue;
+                }
+                rect.page = page;
+                extent.width = std::max(extent.width, rect.x + rect.width);
+                extent.height = std::max(extent.height, rect.y + rect.height);
+            }
+            pages.push_back(extent);
+            remaining.swap(next);
+        }
+    }
+
+    // セルを左上 (cellX, cellY) に置いた画像の level 段目を、余りを折り返した画素で埋めてページにコピーする
+    void CopyCell(const ImageData& image, uint32_t cellX, uint32_t cellY, uint32_t cellWidth, uint32_t cellHeight,
+        uint32_t gutter, uint32_t level, ImageData& page)
+    {
+        const uint32_t x0 = cellX >> level, y0 = cellY >> level;
+        const uint32_t width = cellWidth >> level, height = cellHeight >> level;
+        const uint32_t pad = gutter >> level;
+        for (uint32_t y = 0; y < height; y++)
+        {
+            const uint32_t sy = (y + image.height - pad % image.height) % image.height;
+            const uint8_t* src = image.pixels.data() + size_t(sy) * image.width * 4;
+            uint8_t* dst = page.pixels.data() + (size_t(y0 + y) * page.width + x0) * 4;
+            for (uint32_t x = 0; x < width; x++)
+            {
+                const uint32_t sx = (x + image.width - pad % image.width) % image.width;
+                std::copy_n(src + size_t(sx) * 4, 4, dst + size_t(x) * 4);
+            }
+        }
+    }
+
+    bool ReadTexture(const ModelTexture& texture, std::vector<uint8_t>& bytes)
+    {
+        if (!texture.embedded.empty())
+        {
+            bytes = texture.embedded;
+            return true;
+        }
+        return ReadFileBytes(std::filesystem::u8path(texture.path), bytes);
+    }
+}
+
+namespace TextureAtlas
+{
+    uint32_t CellAlignment(const Options& options)
+    {
+        return 4u << (std::max<uint32_t>(options.mipCount, 1) - 1);
+    }
+
+    bool CanPack(uint32_t width, uint32_t height, const Options& options)
+    {
+        const uint32_t step = std::max(4u, 1u << (std::max<uint32_t>(options.mipCount, 1) - 1));
+        if (width == 0 || height == 0 || std::max(width, height) > options.maxExtent) return false;
+        if (width % step != 0 || height % step != 0) return false;
+        return CellSize(width, options) <= options.pageSize && CellSize(height, options) <= options.pageSize;
+    }
+
+    const char* GetPackerName(Packer packer)
+    {
+        switch (packer)
+        {
+        case Packer::Skyline: return "skyline";
+        case Packer::MaxRects: return "maxrects";
+        }
+        return "unknown";
+    }
+
+    void Pack(std::vector<PackRect>& rects, uint32_t pageSize, Packer packer, std::vector<PageExtent>& pages)
+    {
+        pages.clear();
+        std::vector<uint32_t> order;
+        for (uint32_t i = 0; i < rects.size(); i++)
+        {
+            PackRect& rect = rects[i];
+            rect.page = kNoPage;
+            rect.x = rect.y = 0;
+            if (rect.width > 0 && rect.height > 0 && rect.width <= pageSize && rect.height <= pageSize) order.push_back(i);
+        }
+        // 長い辺、短い辺の大きい順（同じなら元の順）
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+        {
+            const PackRect& ra = rects[a];
+            const PackRect& rb = rects[b];
+            const uint32_t longA = std::max(ra.width, ra.height), longB = std::max(rb.width, rb.height);
+            if (longA != longB) return longA > longB;
+            return std::min(ra.width, ra.height) > std::min(rb.width, rb.height);
+        });
+
+        if (packer == Packer::Skyline)
+        {
+            PackPages<SkylinePacker>(rects, order, pageSize, pages);
+        }
+        else
+        {
+            PackPages<MaxRectsPacker>(rects, order, pageSize, pages);
+        }
+    }
+
+    void Build(const std::vector<const ImageData*>& images, bool srgb, const Options& options, std::vector<Page>& pages,
+        std::vector<uint32_t>& pageOf, std::vector<Float4>& uvScaleOffset, BuildStats& stats)
+    {
+        stats = BuildStats();
+        pages.clear();
+        pageOf.assign(images.size(), kNoPage);
+        uvScaleOffset.assign(images.size(), Float4{ 1.0f, 1.0f, 0.0f, 0.0f });
+        if (images.empty()) return;
+
+        // セルはすべて CellAlignment の倍数なので、その単位で詰める
+        auto start = std::chrono::steady_clock::now();
+        const uint32_t alignment = CellAlignment(options);
+        const uint32_t gutter = GutterSize(options);
+        const uint32_t mipCount = std::max<uint32_t>(options.mipCount, 1);
+        std::vector<PackRect> rects(images.size());
+        for (size_t i = 0; i < images.size(); i++)
+        {
+            rects[i].width = CellSize(images[i]->width, options) / alignment;
+            rects[i].height = CellSize(images[i]->height, options) / alignment;
+        }
+        std::vector<PageExtent> extents;
+        Pack(rects, options.pageSize / alignment, options.packer, extents);
+        stats.packMs = ElapsedMs(start);
+
+        start = std::chrono::steady_clock::now();
+        pages.resize(extents.size());
+        for (size_t p = 0; p < extents.size(); p++)
+        {
+            const uint32_t width = extents[p].width * alignment, height = extents[p].height * alignment;
+            pages[p].levels.resize(mipCount);
+            for (uint32_t level = 0; level < mipCount; level++)
+            {
+                ImageData& image = pages[p].levels[level];
+                image.width = MipExtent(width, level);
+                image.height = MipExtent(height, level);
+                image.pixels.assign(ImageSize(PixelFormat::RGBA8, image.width, image.height), 0);
+            }
+            stats.pageTexels += uint64_t(width) * height;
+        }
+
+        // 画像ごとに単独のときと同じ（WRAP の）ミップを作ってから各段をセルに写すので、隣の画像とは混ざらない
+        MipGenerator::Options mipOptions;
+        mipOptions.filter = options.filter;
+        mipOptions.srgb = srgb;
+        mipOptions.wrap = true;
+        std::vector<ImageData> levels;
+        for (size_t i = 0; i < images.size(); i++)
+        {
+            const PackRect& rect = rects[i];
+            if (rect.page == kNoPage) continue;
+            const ImageData& image = *images[i];
+            MipGenerator::GenerateMips(image, mipOptions, levels);
+            Page& page = pages[rect.page];
+            const uint32_t cellX = rect.x * alignment, cellY = rect.y * alignment;
+            for (uint32_t level = 0; level < mipCount; level++)
+            {
+                CopyCell(levels[level], cellX, cellY, rect.width * alignment, rect.height * alignment, gutter, level, page.levels[level]);
+            }
+
+            const float pageWidth = float(page.levels[0].width), pageHeight = float(page.levels[0].height);
+            pageOf[i] = rect.page;
+            uvScaleOffset[i] = { image.width / pageWidth, image.height / pageHeight,
+                (cellX + gutter) / pageWidth, (cellY + gutter) / pageHeight };
+            stats.imageCount++;
+            stats.imageTexels += uint64_t(image.width) * image.height;
+        }
+        stats.pageCount = pages.size();
+        stats.buildMs = ElapsedMs(start);
+    }
+
+    bool AtlasModelTextures(ModelData& model, const Options& options, ModelStats& stats)
+    {
+        stats = ModelStats();
+        const size_t textureCount = model.textures.size();
+        if (textureCount < 2) return true;
+
+        // UV が [0, 1] からはみ出す（繰り返す）サブメッシュのあるマテリアル
+        std::vector<bool> repeats(model.materials.size(), false);
+        for (const SubMesh& submesh : model.geometry.submeshes)
+        {
+            if (submesh.material >= model.materials.size() || repeats[submesh.material]) continue;
+            for (uint32_t v = 0; v < submesh.vertexCount; v++)
+            {
+                const Float2 uv = model.geometry.vertices[submesh.vertexOffset + v].uv;
+                if (uv.x < -kUvEpsilon || uv.x > 1.0f + kUvEpsilon || uv.y < -kUvEpsilon || uv.y > 1.0f + kUvEpsilon)
+                {
+                    repeats[submesh.material] = true;
+                    break;
+                }
+            }
+        }
+
+        // 参照するマテリアルがすべて繰り返さない画像だけが候補。法線マップとして参照されるものは線形のページへ
+        std::vector<uint8_t> referenced(textureCount, 0), eligible(textureCount, 1), linear(textureCount, 0);
+        for (size_t m = 0; m < model.materials.size(); m++)
+        {
+            for (uint32_t slot = 0; slot < kTextureSlotCount; slot++)
+            {
+                const int32_t t = model.materials[m].textures[slot];
+                if (t < 0 || size_t(t) >= textureCount) continue;
+                referenced[t] = 1;
+                if (repeats[m]) eligible[t] = 0;
+                if (slot == kTextureNormal) linear[t] = 1;
+            }
+        }
+
+#ifdef _WIN32
+        // WIC は呼び出しスレッドで COM が初期化されている必要がある
+        const HRESULT com = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+#endif
+        std::vector<ImageData> decoded(textureCount);
+        std::vector<uint32_t> groups[2];    // [0] sRGB、[1] 線形
+        for (size_t t = 0; t < textureCount; t++)
+        {
+            if (!referenced[t] || !eligible[t]) continue;
+            std::vector<uint8_t> bytes;
+            std::string error;
+            if (!ReadTexture(model.textures[t], bytes) || !DecodeImageRGBA8(bytes.data(), bytes.size(), decoded[t], error)) continue;
+            if (!CanPack(decoded[t].width, decoded[t].height, options))
+            {
+                decoded[t] = ImageData();
+                continue;
+            }
+            groups[linear[t]].push_back(uint32_t(t));
+            stats.candidates++;
+        }
+#ifdef _WIN32
+        if (SUCCEEDED(com)) CoUninitialize();
+#endif
+
+        // 1枚しかない組はまとめても結ぶ回数が減らない
+        std::vector<int32_t> remap(textureCount, -1);
+        std::vector<Float4> transform(textureCount, Float4{ 1.0f, 1.0f, 0.0f, 0.0f });
+        std::vector<ModelTexture> pageTextures;
+        for (int g = 0; g < 2; g++)
+        {
+            if (groups[g].size() < 2) continue;
+            std::vector<const ImageData*> images;
+            for (uint32_t t : groups[g]) images.push_back(&decoded[t]);
+
+            std::vector<Page> pages;
+            std::vector<uint32_t> pageOf;
+            std::vector<Float4> uvScaleOffset;
+            BuildStats build;
+            Build(images, g == 0, options, pages, pageOf, uvScaleOffset, build);
+            stats.build.imageCount += build.imageCount;
+            stats.build.imageTexels += build.imageTexels;
+            stats.build.packMs += build.packMs;
+            stats.build.buildMs += build.buildMs;
+
+            // ページはクック済みテクスチャとして埋め込む（表の後ろに足すので、元の番号は後で詰め直す）
+            std::vector<int32_t> pageIndex(pages.size(), -1);
+            for (size_t p = 0; p < pages.size(); p++)
+            {
+                ModelTexture texture;
+                texture.path = std::string("atlas/") + (g == 0 ? "srgb" : "linear") + "/" + std::to_string(p);
+                std::string error;
+                if (!TextureFile::Serialize(pages[p].levels, uint32_t(pages[p].levels.size()), g == 0 ? uint32_t(TextureFile::kFlagSrgb) : 0u,
+                    texture.embedded, error))
+                {
+                    continue;
+                }
+                pageIndex[p] = int32_t(textureCount + pageTextures.size());
+                pageTextures.push_back(std::move(texture));
+                stats.build.pageCount++;
+                stats.build.pageTexels += uint64_t(pages[p].levels[0].width) * pages[p].levels[0].height;
+            }
+            for (size_t i = 0; i < groups[g].size(); i++)
+            {
+                if (pageOf[i] == kNoPage || pageIndex[pageOf[i]] < 0) continue;
+                remap[groups[g][i]] = pageIndex[pageOf[i]];
+                transform[groups[g][i]] = uvScaleOffset[i];
+            }
+        }
+        if (pageTextures.empty()) return true;
+
+        // まとめた画像を表から外し、残りとページを詰めて並べ直す
+        std::vector<int32_t> finalIndex(textureCount + pageTextures.size(), -1);
+        std::vector<ModelTexture> textures;
+        for (size_t t = 0; t < textureCount; t++)
+        {
+            if (remap[t] >= 0) continue;
+            finalIndex[t] = int32_t(textures.size());
+            textures.push_back(std::move(model.textures[t]));
+        }
+        for (size_t p = 0; p < pageTextures.size(); p++)
+        {
+            finalIndex[textureCount + p] = int32_t(textures.size());
+            textures.push_back(std::move(pageTextures[p]));
+        }
+        for (Material& material : model.materials)
+        {
+            for (uint32_t slot = 0; slot < kTextureSlotCount; slot++)
+            {
+                const int32_t t = material.textures[slot];
+                if (t < 0 || size_t(t) >= textureCount) continue;
+                if (remap[t] >= 0)
+                {
+                    material.uvScaleOffset[slot] = transform[t];
+                    material.textures[slot] = finalIndex[remap[t]];
+                }
+                else
+                {
+                    material.textures[slot] = finalIndex[t];
+                }
+            }
+        }
+        model.textures = std::move(textures);
+        return true;
+    }
+
+    BenchmarkResult RunBenchmark(const Options& options, size_t rectCount, int iterations)
+    {
+        BenchmarkResult result;
+        result.rectCount = rectCount;
+        result.pageSize = options.pageSize;
+
+        // 辺の長さは 16 から maxExtent までの 2 のべき乗が多く、ときどき 4 の倍数の半端な大きさと細長いものが混ざる
+        const uint32_t alignment = CellAlignment(options);
+        const uint32_t step = std::max(4u, 1u << (std::max<uint32_t>(options.mipCount, 1) - 1));
+        uint32_t state = 12345;
+        auto next = [&]()
+        {
+            state = state * 1664525u + 1013904223u;
+            return state >> 8;
+        };
+        auto randomExtent = [&]()
+        {
+            uint32_t size = 16u << (next() % 5);
+            if (next() % 4 == 0) size = AlignUp(size * 3 / 4, step);
+            return std::min(std::max(size, step), options.maxExtent / step * step);
+        };
+        std::vector<PackRect> source(rectCount);
+        uint64_t imageArea = 0, cellArea = 0;
+        for (PackRect& rect : source)
+        {
+            const uint32_t width = randomExtent();
+            const uint32_t height = next() % 3 == 0 ? randomExtent() : width;
+            rect.width = CellSize(width, options) / alignment;
+            rect.height = CellSize(height, options) / alignment;
+            imageArea += uint64_t(width) * height;
+            cellArea += uint64_t(rect.width) * rect.height * alignment * alignment;
+        }
+
+        for (Packer packer : { Packer::Skyline, Packer::MaxRects })
+        {
+            const size_t p = size_t(packer);
+            std::vector<PageExtent> pages;
+            for (int i = 0; i < iterations; i++)
+            {
+                std::vector<PackRect> rects = source;
+                auto start = std::chrono::steady_clock::now();
+                Pack(rects, options.pageSize / alignment, packer, pages);
+                const double ms = ElapsedMs(start);
+                result.packMs[p] = i == 0 ? ms : std::min(result.packMs[p], ms);
+            }
+            uint64_t pageArea = 0;
+            for (const PageExtent& page : pages) pageArea += uint64_t(page.width) * page.height * alignment * alignment;
+            result.pageCount[p] = pages.size();
+            result.occupancy[p] = pageArea > 0 ? double(cellArea) / pageArea : 0.0;
+            result.imageOccupancy[p] = pageArea > 0 ? double(imageArea) / pageArea : 0.0;
+        }
+        return result;
+    }
+}
@@ -0,0 +1,106 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ImageData.h"
+#include "MipGenerator.h"
+#include "ModelData.h"
+
+// 小さいテクスチャを大きなページにまとめるクック段階（D3D非依存）
+// 各画像はミップの各段でブロック境界にそろうセルに置き、セルの余りは反対側の端から折り返した画素で埋める
+// （サンプラーが WRAP なので、元の画像を単独で引いたときと端の混ざり方が同じになる）
+// マテリアルは UV の拡大/平行移動（Material::uvScaleOffset）でページの中の自分の範囲を引く
+namespace TextureAtlas
+{
+    // 生成結果が変わる修正をしたら上げる
+    constexpr uint32_t kVersion = 1;
+    constexpr uint32_t kNoPage = UINT32_MAX;
+
+    enum class Packer : uint32_t
+    {
+        Skyline,    // 上端の輪郭だけを持ち、最も低い（同じなら左の）位置に置く。速いが輪郭の下にできた隙間は使わない
+        MaxRects,   // 空き領域の極大な長方形をすべて持ち、短い辺の余りが最も小さい場所に置く（Best Short Side Fit）
+    };
+
+    struct Options
+    {
+        Packer packer = Packer::MaxRects;
+        uint32_t pageSize = 2048;   // ページの辺の上限（最後に使った範囲まで縮める）
+        uint32_t maxExtent = 256;   // 長い辺がこれ以下の画像だけをまとめる
+        uint32_t gutter = 4;        // 画像の周りに最低限足す画素（mipCount - 1 段目でも 1 画素以上残るように丸める）
+        uint32_t mipCount = 3;      // ページに作るミップの段数。セルはこの段まで 4x4 ブロックの境界にそろう
+        MipGenerator::Filter filter = MipGenerator::Filter::Kaiser;
+    };
+
+    // セルの位置と大きさの単位（最後の段で 4 画素）
+    uint32_t CellAlignment(const Options& options);
+
+    // まとめられる大きさか（長い辺が maxExtent 以下で、各辺が最後の段まで割り切れ、BC のブロックにそろう）
+    bool CanPack(uint32_t width, uint32_t height, const Options& options);
+
+    const char* GetPackerName(Packer packer);
+
+    // 詰める長方形（width/height を渡すと page/x/y が決まる。pageSize に入らなければ kNoPage のまま）
+    struct PackRect
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t page = kNoPage;
+        uint32_t x = 0;
+        uint32_t y = 0;
+    };
+
+    struct PageExtent
+    {
+        uint32_t width = 0;         // そのページで使った範囲
+        uint32_t height = 0;
+    };
+
+    // 大きい順に並べてから1ページずつ詰め、入らなかったものを次のページに回す
+    void Pack(std::vector<PackRect>& rects, uint32_t pageSize, Packer packer, std::vector<PageExtent>& pages);
+
+    struct Page
+    {
+        std::vector<ImageData> levels;  // RGBA8 の mipCount 段（TextureFile::Serialize にそのまま渡せる）
+    };
+
+    struct BuildStats
+    {
+        size_t imageCount = 0;
+        size_t pageCount = 0;
+        uint64_t imageTexels = 0;   // まとめた画像の先頭の段の画素数の合計
+        uint64_t pageTexels = 0;    // ページの先頭の段の画素数の合計
+        double packMs = 0.0;
+        double buildMs = 0.0;       // 各画像のミップ生成とページへのコピー
+    };
+
+    // images（RGBA8、すべて CanPack を満たすこと）をページにまとめる
+    // pageOf[i] と uvScaleOffset[i] に images[i] の載ったページと、元の UV をページの UV に移す値（uv * xy + zw）を返す
+    void Build(const std::vector<const ImageData*>& images, bool srgb, const Options& options, std::vector<Page>& pages,
+        std::vector<uint32_t>& pageOf, std::vector<Float4>& uvScaleOffset, BuildStats& stats);
+
+    // インポート済みのモデルの小さいテクスチャをページにまとめ、マテリアルの参照と UV の変換を書き換える
+    // まとめるのは、参照するマテリアルのサブメッシュの UV がすべて [0, 1] に収まる（繰り返さない）画像だけ
+    // 法線マップとして参照される画像は sRGB の画像とは別のページにする。ページはクック済みテクスチャ（.texture）として埋め込む
+    // まとめなかった画像はそのまま残り、参照されなくなった画像は表から外す
+    struct ModelStats
+    {
+        size_t candidates = 0;      // 大きさと UV の範囲の条件を満たした画像
+        BuildStats build;
+    };
+    bool AtlasModelTextures(ModelData& model, const Options& options, ModelStats& stats);
+
+    struct BenchmarkResult
+    {
+        size_t rectCount = 0;
+        uint32_t pageSize = 0;
+        // Packer の順
+        size_t pageCount[2] = {};
+        double occupancy[2] = {};   // セルの面積の合計 / 使ったページの面積（詰め方だけの効率）
+        double imageOccupancy[2] = {};  // 画像の面積の合計 / 使ったページの面積（セルの余りも含めた効率）
+        double packMs[2] = {};      // 最も速かった回
+    };
+
+    // 乱数で作った小さい画像の大きさの組を各 Packer で詰め、効率と時間を測る
+    BenchmarkResult RunBenchmark(const Options& options, size_t rectCount = 1000, int iterations = 5);
+}
@@ -0,0 +1,267 @@
+﻿#include "TextureFile.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include "FileUtil.h"
+#include "Hash.h"
+#include "ImageLoader.h"
+
+namespace
+{
+    uint64_t AlignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    uint64_t HeaderChecksum(const uint8_t* bytes)
+    {
+        TextureFile::Header header;
+        std::memcpy(&header, bytes, sizeof(header));
+        header.headerChecksum = 0;
+        Hasher hasher(Hash64(&header, sizeof(header)));
+        hasher.Add(bytes + sizeof(header), size_t(header.subresourceCount) * sizeof(TextureFile::Subresource));
+        return hasher.Get();
+    }
+
+    // マップしたピクセルのページを1つずつ読む（ドライバーが初期データを読み出すのと同じだけページフォルトを起こす）
+    uint64_t TouchPages(const TextureFileView& view)
+    {
+        uint64_t sum = 0;
+        const TextureFile::Header& header = view.GetHeader();
+        for (uint32_t i = 0; i < header.subresourceCount; i++)
+        {
+            const uint8_t* pixels = view.GetPixels(i);
+            const uint32_t size = view.GetSubresources()[i].slicePitch;
+            for (uint32_t offset = 0; offset < size; offset += 4096) sum += pixels[offset];
+            sum += pixels[size - 1];
+        }
+        return sum;
+    }
+
+    double ElapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+namespace TextureFile
+{
+    bool Serialize(const std::vector<ImageData>& subresources, uint32_t mipCount, uint32_t flags, std::vector<uint8_t>& bytes,
+        std::string& error)
+    {
+        if (subresources.empty() || mipCount == 0 || subresources.size() % mipCount != 0)
+        {
+            error = "subresource count is not a multiple of the mip count";
+            return false;
+        }
+        const ImageData& top = subresources[0];
+        if (top.width == 0 || top.height == 0 || mipCount > MipLevelCount(top.width, top.height))
+        {
+            error = "invalid texture size";
+            return false;
+        }
+
+        Header header{};
+        header.magic = kMagic;
+        header.version = kVersion;
+        header.width = top.width;
+        header.height = top.height;
+        header.mipCount = mipCount;
+        header.arraySize = uint32_t(subresources.size() / mipCount);
+        header.format = top.format;
+        header.flags = flags;
+        header.subresourceCount = uint32_t(subresources.size());
+
+        std::vector<Subresource> table(subresources.size());
+        uint64_t offset = AlignUp(sizeof(Header) + table.size() * sizeof(Subresource), kSubresourceAlignment);
+        for (size_t i = 0; i < subresources.size(); i++)
+        {
+            const ImageData& image = subresources[i];
+            const uint32_t mip = uint32_t(i % mipCount);
+            const uint32_t width = MipExtent(top.width, mip), height = MipExtent(top.height, mip);
+            if (image.format != top.format || image.width != width || image.height != height ||
+                image.pixels.size() != ImageSize(image.format, width, height))
+            {
+                error = "subresource size or format mismatch";
+                return false;
+            }
+            table[i].offset = offset;
+            table[i].rowPitch = uint32_t(RowPitch(image.format, width));
+            table[i].slicePitch = uint32_t(image.pixels.size());
+            offset = AlignUp(offset + image.pixels.size(), kSubresourceAlignment);
+        }
+        header.fileSize = offset;
+
+        bytes.assign(size_t(offset), 0);
+        std::memcpy(bytes.data(), &header, sizeof(header));
+        std::memcpy(bytes.data() + sizeof(header), table.data(), table.size() * sizeof(Subresource));
+        for (size_t i = 0; i < subresources.size(); i++)
+        {
+            std::memcpy(bytes.data() + table[i].offset, subresources[i].pixels.data(), subresources[i].pixels.size());
+        }
+        header.headerChecksum = HeaderChecksum(bytes.data());
+        std::memcpy(bytes.data(), &header, sizeof(header));
+        return true;
+    }
+
+    bool Write(const std::string& path, const std::vector<ImageData>& subresources, uint32_t mipCount, uint32_t flags,
+        std::string& error)
+    {
+        std::vector<uint8_t> bytes;
+        if (!Serialize(subresources, mipCount, flags, bytes, error)) return false;
+
+        if (!WriteFileAtomic(path, bytes.data(), bytes.size()))
+        {
+            error = "failed to write " + path;
+            return false;
+        }
+        return true;
+    }
+
+    bool Validate(const uint8_t* bytes, size_t size, std::string& error)
+    {
+        auto fail = [&](const char* reason)
+        {
+            error = reason;
+            return false;
+        };
+
+        if (size < sizeof(Header)) return fail("file too small");
+        Header header;
+        std::memcpy(&header, bytes, sizeof(header));
+        if (header.magic != kMagic) return fail("bad magic");
+        if (header.version != kVersion) return fail("unsupported version");
+        if (header.format > PixelFormat::BC7) return fail("unsupported pixel format");
+        if ((header.flags & ~uint32_t(kFlagSrgb)) != 0) return fail("unsupported flags");
+        if (header.width == 0 || header.height == 0 || header.mipCount == 0 || header.arraySize == 0 ||
+            header.mipCount > MipLevelCount(header.width, header.height))
+        {
+            return fail("invalid texture size");
+        }
+        if (uint64_t(header.mipCount) * header.arraySize != header.subresourceCount) return fail("subresource count mismatch");
+        if (header.fileSize != size) return fail("file size mismatch");
+        const uint64_t tableEnd = sizeof(Header) + uint64_t(header.subresourceCount) * sizeof(Subresource);
+        if (tableEnd > size) return fail("subresource table out of range");
+        if (header.headerChecksum != HeaderChecksum(bytes)) return fail("header checksum mismatch");
+
+        const Subresource* table = reinterpret_cast<const Subresource*>(bytes + sizeof(Header));
+        for (uint32_t i = 0; i < header.subresourceCount; i++)
+        {
+            const uint32_t mip = i % header.mipCount;
+            const uint32_t width = MipExtent(header.width, mip), height = MipExtent(header.height, mip);
+            const Subresource& subresource = table[i];
+            if (subresource.rowPitch != RowPitch(header.format, width) ||
+                subresource.slicePitch != ImageSize(header.format, width, height))
+            {
+                return fail("subresource pitch mismatch");
+            }
+            if (subresource.offset % kSubresourceAlignment != 0) return fail("subresource misaligned");
+            if (subresource.offset < tableEnd || subresource.offset > size || subresource.slicePitch > size - subresource.offset)
+            {
+                return fail("subresource out of range");
+            }
+        }
+        return true;
+    }
+
+    bool RunLoadBenchmark(const std::string& imagePath, const std::string& texturePath, LoadBenchmarkResult& result,
+        std::string& error, int iterations)
+    {
+        result = LoadBenchmarkResult();
+        TextureFileView view;
+        if (!view.Open(texturePath))
+        {
+            error = texturePath + ": " + view.GetErrorString();
+            return false;
+        }
+        const Header& header = view.GetHeader();
+        result.width = header.width;
+        result.height = header.height;
+        result.mipCount = header.mipCount;
+        result.format = header.format;
+        view.Close();
+
+        std::vector<unsigned char> source;
+        if (!ReadFileBytes(imagePath, source))
+        {
+            error = "cannot read " + imagePath;
+            return false;
+        }
+        result.imageBytes = source.size();
+
+        // 元画像: 読み込み + 展開
+        auto loadImage = [&]()
+        {
+            auto start = std::chrono::steady_clock::now();
+            std::vector<unsigned char> bytes;
+            ImageData image;
+            std::string decodeError;
+            if (!ReadFileBytes(imagePath, bytes) || !DecodeImageRGBA8(bytes.data(), bytes.size(), image, decodeError))
+            {
+                error = "cannot decode " + imagePath + ": " + decodeError;
+                return -1.0;
+            }
+            return ElapsedMs(start);
+        };
+
+        // .texture: マップ + 検証 + ページを触る
+        volatile uint64_t sink = 0;
+        auto loadTexture = [&]()
+        {
+            auto start = std::chrono::steady_clock::now();
+            TextureFileView texture;
+            if (!texture.Open(texturePath))
+            {
+                error = texturePath + ": " + texture.GetErrorString();
+                return -1.0;
+            }
+            sink = sink + TouchPages(texture);
+            result.textureBytes = texture.GetHeader().fileSize;
+            return ElapsedMs(start);
+        };
+
+        // cold は毎回ページキャッシュから追い出してから、warm は1回読んでおいてから測る
+        auto measure = [&](const std::string& path, auto load, bool cold, double& best)
+        {
+            if (!cold && load() < 0.0) return false;
+            for (int i = 0; i < iterations; i++)
+            {
+                if (cold && !DropFileCache(path)) return true;
+                const double ms = load();
+                if (ms < 0.0) return false;
+                best = i == 0 ? ms : std::min(best, ms);
+            }
+            if (cold) result.coldMeasured = true;
+            return true;
+        };
+        return measure(imagePath, loadImage, true, result.imageColdMs) &&
+            measure(imagePath, loadImage, false, result.imageWarmMs) &&
+            measure(texturePath, loadTexture, true, result.textureColdMs) &&
+            measure(texturePath, loadTexture, false, result.textureWarmMs);
+    }
+}
+
+bool TextureFileView::Open(const std::string& path)
+{
+    Close();
+
+    if (!mFile.Open(path))
+    {
+        mError = "cannot open file";
+        return false;
+    }
+    if (!TextureFile::Validate(mFile.Data(), mFile.Size(), mError))
+    {
+        mFile.Close();
+        return false;
+    }
+    mHeader = reinterpret_cast<const TextureFile::Header*>(mFile.Data());
+    return true;
+}
+
+void TextureFileView::Close()
+{
+    mFile.Close();
+    mHeader = nullptr;
+    mError.clear();
+}
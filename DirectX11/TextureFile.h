@@ -0,0 +1,104 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ImageData.h"
+#include "MappedFile.h"
+
+// クック済みテクスチャ形式（.texture）
+// ヘッダーとサブリソースの表の後に、各サブリソース（ミップ段 x 配列要素）のピクセルを 64byte 境界で並べる
+// ピクセルは GPU のテクスチャと同じ並び（RGBA8 または BC）なので、マップしたポインタと表の行ピッチを
+// そのまま D3D11_SUBRESOURCE_DATA に渡せる
+namespace TextureFile
+{
+    constexpr uint32_t kMagic = 0x58455443;     // "CTEX"
+    constexpr uint32_t kVersion = 1;
+    constexpr uint64_t kSubresourceAlignment = 64;
+
+    enum Flags : uint32_t
+    {
+        kFlagSrgb = 1 << 0,     // RGB が sRGB（ミップは線形空間で縮小した）
+    };
+
+    // サブリソースは D3D11 の番号順（mip + arraySlice * mipCount）に並ぶ
+    struct Subresource
+    {
+        uint64_t offset;        // ファイル先頭からのバイト位置
+        uint32_t rowPitch;      // 1行（BC ならブロック1行）のバイト数
+        uint32_t slicePitch;    // この段全体のバイト数
+    };
+    static_assert(sizeof(Subresource) == 16, "TextureFile::Subresource layout changed");
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t width;
+        uint32_t height;
+        uint32_t mipCount;      // 各辺は MipExtent
+        uint32_t arraySize;
+        PixelFormat format;
+        uint32_t flags;         // Flags
+        uint32_t subresourceCount;  // mipCount * arraySize（表はヘッダーの直後）
+        uint32_t reserved;
+        uint64_t fileSize;
+        uint64_t headerChecksum;    // このフィールドを 0 にしたヘッダーと表の Hash64
+    };
+    static_assert(sizeof(Header) == 56, "TextureFile::Header layout changed");
+
+    // subresources は配列要素ごとに mipCount 段ずつ（MipGenerator::GenerateMips の結果か、それを BlockCompression で圧縮したもの）
+    // 全サブリソースが同じ形式で、配列要素どうしは同じ大きさであること
+    bool Serialize(const std::vector<ImageData>& subresources, uint32_t mipCount, uint32_t flags, std::vector<uint8_t>& bytes,
+        std::string& error);
+
+    // 一時ファイル経由で置き換える
+    bool Write(const std::string& path, const std::vector<ImageData>& subresources, uint32_t mipCount, uint32_t flags,
+        std::string& error);
+
+    // ピクセルを読まずに（ヘッダーと表だけで）検証する。ピクセルは全体を触ることになるのでチェックサムを持たない
+    bool Validate(const uint8_t* bytes, size_t size, std::string& error);
+
+    struct LoadBenchmarkResult
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t mipCount = 0;
+        PixelFormat format = PixelFormat::RGBA8;
+        uint64_t imageBytes = 0;
+        uint64_t textureBytes = 0;
+        bool coldMeasured = false;      // ページキャッシュから追い出せた（Linux のみ）か。false なら cold の値は 0
+        // 読み込みから GPU に渡せる状態まで（ミリ秒）。最も速かった回
+        double imageColdMs = 0.0;       // 画像を読んで RGBA8 に展開する（先頭の段のみ。ミップ生成と圧縮は含まない）
+        double imageWarmMs = 0.0;
+        double textureColdMs = 0.0;     // .texture をマップして検証し、全サブリソースのページを触る（ドライバーの読み出しの代わり）
+        double textureWarmMs = 0.0;
+    };
+
+    // 同じ画像の元ファイル（PNG など）とクック済み .texture の読み込み時間を比べる
+    bool RunLoadBenchmark(const std::string& imagePath, const std::string& texturePath, LoadBenchmarkResult& result,
+        std::string& error, int iterations = 5);
+}
+
+// クック済みテクスチャをメモリマップして参照する。ポインタは Close するまで有効
+class TextureFileView
+{
+public:
+    bool Open(const std::string& path);
+    void Close();
+
+    // ファイル全体（D3DApp::CreateTexture にそのまま渡せる）
+    const uint8_t* GetData() const { return mFile.Data(); }
+    const TextureFile::Header& GetHeader() const { return *mHeader; }
+    const TextureFile::Subresource* GetSubresources() const { return reinterpret_cast<const TextureFile::Subresource*>(mHeader + 1); }
+
+    // index 番目（mip + arraySlice * mipCount）のサブリソースのピクセル（マップしたメモリを直接指す）
+    const uint8_t* GetPixels(uint32_t index) const { return mFile.Data() + GetSubresources()[index].offset; }
+
+    const std::string& GetErrorString() const { return mError; }
+
+private:
+    MappedFile mFile;
+    const TextureFile::Header* mHeader = nullptr;
+    std::string mError;
+};
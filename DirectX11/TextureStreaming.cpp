@@ -0,0 +1,226 @@
+﻿#include "TextureStreaming.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+    constexpr float kNotRequested = FLT_MAX;
+
+    float TriangleArea(float ax, float ay, float az, float bx, float by, float bz)
+    {
+        const float cx = ay * bz - az * by;
+        const float cy = az * bx - ax * bz;
+        const float cz = ax * by - ay * bx;
+        return 0.5f * std::sqrt(cx * cx + cy * cy + cz * cz);
+    }
+}
+
+namespace TextureStreaming
+{
+    float ComputeUvDensity(const MeshVertex* vertices, const uint32_t* indices, size_t indexCount)
+    {
+        double uvArea = 0.0, meshArea = 0.0;
+        for (size_t i = 0; i + 2 < indexCount; i += 3)
+        {
+            const MeshVertex& a = vertices[indices[i]];
+            const MeshVertex& b = vertices[indices[i + 1]];
+            const MeshVertex& c = vertices[indices[i + 2]];
+            meshArea += TriangleArea(b.pos.x - a.pos.x, b.pos.y - a.pos.y, b.pos.z - a.pos.z,
+                c.pos.x - a.pos.x, c.pos.y - a.pos.y, c.pos.z - a.pos.z);
+            uvArea += TriangleArea(b.uv.x - a.uv.x, b.uv.y - a.uv.y, 0.0f, c.uv.x - a.uv.x, c.uv.y - a.uv.y, 0.0f);
+        }
+        if (meshArea <= 0.0 || uvArea <= 0.0) return 0.0f;
+        return float(std::sqrt(uvArea / meshArea));
+    }
+
+    float RequiredMip(float texelsPerUnit, float distance, float pixelsPerUnit)
+    {
+        // 視点が境界球の中にある、または密度が分からないときは最も細かい段
+        if (distance <= 0.0f || texelsPerUnit <= 0.0f || pixelsPerUnit <= 0.0f) return 0.0f;
+        const float texelsPerPixel = texelsPerUnit * distance / pixelsPerUnit;
+        return texelsPerPixel > 1.0f ? std::log2(texelsPerPixel) : 0.0f;
+    }
+
+    uint32_t Streamer::Register(uint32_t width, uint32_t height, uint32_t mipCount, PixelFormat format, uint32_t arraySize)
+    {
+        Texture texture;
+        mipCount = std::max<uint32_t>(mipCount, 1);
+        texture.bytesFrom.assign(mipCount + 1, 0);
+        for (uint32_t mip = mipCount; mip-- > 0;)
+        {
+            texture.bytesFrom[mip] = texture.bytesFrom[mip + 1] +
+                ImageSize(format, MipExtent(width, mip), MipExtent(height, mip)) * arraySize;
+        }
+
+        // ミップの末尾は長い辺が tailExtent 以下になる最初の段から（その段がなければ最も小さい段だけ）
+        texture.tailMip = mipCount - 1;
+        while (texture.tailMip > 0 &&
+            std::max(MipExtent(width, texture.tailMip - 1), MipExtent(height, texture.tailMip - 1)) <= mSettings.tailExtent)
+        {
+            texture.tailMip--;
+        }
+        // D3D11 は先頭の段の幅/高さが4の倍数でない BC テクスチャを作れないので、作り直すときの先頭になれる段までに留める
+        while (IsBlockCompressed(format) && texture.tailMip > 0 &&
+            (MipExtent(width, texture.tailMip) % 4 != 0 || MipExtent(height, texture.tailMip) % 4 != 0))
+        {
+            texture.tailMip--;
+        }
+        texture.residentMip = texture.tailMip;
+        texture.wantedMip = texture.tailMip;
+        texture.requestedMip = kNotRequested;
+
+        mStats.textureCount++;
+        mStats.residentBytes += texture.bytesFrom[texture.tailMip];
+        mStats.tailBytes += texture.bytesFrom[texture.tailMip];
+        mTextures.push_back(std::move(texture));
+        return uint32_t(mTextures.size() - 1);
+    }
+
+    void Streamer::Clear()
+    {
+        mTextures.clear();
+        mFrame = 0;
+        mStats = Stats();
+    }
+
+    void Streamer::Request(uint32_t texture, float mip)
+    {
+        if (texture >= mTextures.size()) return;
+        Texture& t = mTextures[texture];
+        t.requestedMip = std::min(t.requestedMip, std::max(mip, 0.0f));
+    }
+
+    uint64_t Streamer::SurplusBytes(const Texture& texture) const
+    {
+        return texture.residentMip < texture.wantedMip ? texture.bytesFrom[texture.residentMip] - texture.bytesFrom[texture.wantedMip] : 0;
+    }
+
+    // keep 以外のテクスチャの、要求より細かく常駐している段を追い出して bytesNeeded を空ける（空けたバイト数を返す）
+    // 長く要求されていないものから、同じなら余分の大きいものから追い出す
+    uint64_t Streamer::Evict(uint64_t bytesNeeded, uint32_t keep)
+    {
+        std::vector<uint32_t> victims;
+        for (uint32_t i = 0; i < mTextures.size(); i++)
+        {
+            if (i != keep && SurplusBytes(mTextures[i]) > 0) victims.push_back(i);
+        }
+        std::sort(victims.begin(), victims.end(), [&](uint32_t a, uint32_t b)
+        {
+            const Texture& ta = mTextures[a];
+            const Texture& tb = mTextures[b];
+            if (ta.lastRequestFrame != tb.lastRequestFrame) return ta.lastRequestFrame < tb.lastRequestFrame;
+            return SurplusBytes(ta) > SurplusBytes(tb);
+        });
+
+        uint64_t freed = 0;
+        for (uint32_t i : victims)
+        {
+            if (freed >= bytesNeeded) break;
+            Texture& t = mTextures[i];
+            // 1段ずつ粗くし、足りたところで止める
+            while (freed < bytesNeeded && t.residentMip < t.wantedMip)
+            {
+                const uint64_t bytes = t.bytesFrom[t.residentMip] - t.bytesFrom[t.residentMip + 1];
+                t.residentMip++;
+                freed += bytes;
+                mStats.evictedBytes += bytes;
+            }
+            t.changed = true;
+            mStats.evictions++;
+        }
+        mStats.residentBytes -= freed;
+        return freed;
+    }
+
+    void Streamer::Update(std::vector<Change>& changes)
+    {
+        changes.clear();
+        mFrame++;
+
+        // 今のフレームの要求から各テクスチャに必要な段を決める（要求がなければミップの末尾だけでよい）
+        uint64_t requestedBytes = 0;
+        std::vector<uint32_t> loads;
+        for (uint32_t i = 0; i < mTextures.size(); i++)
+        {
+            Texture& t = mTextures[i];
+            t.updateStartMip = t.residentMip;
+            if (t.requestedMip != kNotRequested)
+            {
+                const float mip = std::max(t.requestedMip + mSettings.mipBias, 0.0f);
+                t.wantedMip = std::min(uint32_t(mip), t.tailMip);
+                t.lastRequestFrame = mFrame;
+            }
+            else
+            {
+                t.wantedMip = t.tailMip;
+            }
+            t.requestedMip = kNotRequested;
+            requestedBytes += t.bytesFrom[t.wantedMip];
+            if (t.wantedMip < t.residentMip) loads.push_back(i);
+        }
+        mStats.requestedBytes = requestedBytes;
+
+        // 予算が下がったときなどは、読み込みの前に余分な段を追い出して予算に収める
+        if (mStats.residentBytes > mSettings.budgetBytes) Evict(mStats.residentBytes - mSettings.budgetBytes, UINT32_MAX);
+
+        // ぼやけている段数の多い順に読む（同じなら番号順）
+        std::stable_sort(loads.begin(), loads.end(), [&](uint32_t a, uint32_t b)
+        {
+            return mTextures[a].residentMip - mTextures[a].wantedMip > mTextures[b].residentMip - mTextures[b].wantedMip;
+        });
+
+        uint64_t uploaded = 0;
+        for (uint32_t i : loads)
+        {
+            Texture& t = mTextures[i];
+            if (uploaded > 0 && uploaded >= mSettings.uploadBytesPerFrame)
+            {
+                mStats.deferredLoads++;
+                continue;
+            }
+
+            // 予算に収まらなければ他の余分な段を追い出し、それでも足りなければ粗い段で妥協する
+            uint32_t target = t.wantedMip;
+            const uint64_t extra = t.bytesFrom[target] - t.bytesFrom[t.residentMip];
+            if (mStats.residentBytes + extra > mSettings.budgetBytes)
+            {
+                Evict(mStats.residentBytes + extra - mSettings.budgetBytes, i);
+            }
+            while (target < t.residentMip &&
+                mStats.residentBytes + (t.bytesFrom[target] - t.bytesFrom[t.residentMip]) > mSettings.budgetBytes)
+            {
+                target++;
+            }
+            if (target < t.wantedMip || target == t.residentMip) mStats.deferredLoads++;
+            if (target == t.residentMip) continue;
+
+            const uint64_t bytes = t.bytesFrom[target] - t.bytesFrom[t.residentMip];
+            t.residentMip = target;
+            t.changed = true;
+            uploaded += bytes;
+            mStats.residentBytes += bytes;
+            mStats.loadedBytes += bytes;
+            mStats.loads++;
+        }
+
+        for (uint32_t i = 0; i < mTextures.size(); i++)
+        {
+            Texture& t = mTextures[i];
+            if (!t.changed) continue;
+            t.changed = false;
+            if (t.residentMip != t.updateStartMip) changes.push_back({ i, t.residentMip, t.updateStartMip });
+        }
+    }
+
+    void Streamer::Revert(const Change& change)
+    {
+        Texture& t = mTextures[change.texture];
+        if (t.residentMip != change.firstMip || change.firstMip == change.previousMip) return;
+
+        // 読み込みを戻すなら常駐量が減り、追い出しを戻すなら古いテクスチャが残っているので増える
+        mStats.residentBytes = mStats.residentBytes - t.bytesFrom[t.residentMip] + t.bytesFrom[change.previousMip];
+        t.residentMip = change.previousMip;
+        mStats.reverts++;
+    }
+}
@@ -0,0 +1,106 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ImageData.h"
+#include "MeshData.h"
+
+// ミップ段単位のテクスチャストリーミング（D3D非依存）
+// 登録時はミップの末尾（小さい段）だけを常駐させ、描画のたびに求めた必要な段まで細かいミップを読み込む
+// 常駐量は予算で抑え、足りなければしばらく使われていないテクスチャの余分な段から追い出す
+// 実際の読み込み/解放（テクスチャの作り直し）は Update が返す変更を見て呼び出し側が行う
+namespace TextureStreaming
+{
+    // UV 空間の長さ / メッシュ空間の長さ（三角形の面積の合計どうしの比の平方根）
+    // indices は vertices の中の番号。面積が 0 なら 0（密度不明）
+    float ComputeUvDensity(const MeshVertex* vertices, const uint32_t* indices, size_t indexCount);
+
+    // 画面上の1ピクセルに入るテクセル数から、必要な最も細かいミップ段を求める（小数、0 以上）
+    // texelsPerUnit: メッシュ空間の長さ1あたりのテクセル数（テクスチャの辺のテクセル数 * uvDensity）
+    // distance: 視点から境界球までのメッシュ空間の距離、pixelsPerUnit: 距離1で長さ1が画面上で何ピクセルか
+    // 拡大率はメッシュ空間の距離と長さの比で打ち消し合うので、LOD の選択と同じくモデル空間で測ればよい
+    float RequiredMip(float texelsPerUnit, float distance, float pixelsPerUnit);
+
+    class Streamer
+    {
+    public:
+        struct Settings
+        {
+            uint64_t budgetBytes = 256ull << 20;        // 常駐させる段の合計の上限（ミップの末尾は上限を超えても常駐させる）
+            uint32_t tailExtent = 64;                   // 長い辺がこれ以下の段をミップの末尾として登録時に読み、追い出さない
+            uint64_t uploadBytesPerFrame = 16ull << 20; // 1フレームに読み込む量の上限（1件目は超えても読む）
+            float mipBias = 0.0f;                       // 要求された段に足す（正なら粗い側に寄せて常駐量を減らす）
+        };
+
+        // テクスチャの常駐する最も細かい段が previousMip から firstMip になった（呼び出し側はその段から下でテクスチャを作り直す）
+        struct Change
+        {
+            uint32_t texture;
+            uint32_t firstMip;
+            uint32_t previousMip;
+        };
+
+        struct Stats
+        {
+            size_t textureCount = 0;
+            uint64_t residentBytes = 0;     // 今常駐している段の合計
+            uint64_t requestedBytes = 0;    // 直近のフレームで要求された段をすべて常駐させたときの合計
+            uint64_t tailBytes = 0;         // ミップの末尾だけの合計（常駐量の下限）
+            size_t loads = 0;               // 以下は Update の累計
+            size_t evictions = 0;
+            uint64_t loadedBytes = 0;
+            uint64_t evictedBytes = 0;
+            size_t deferredLoads = 0;       // 予算か1フレームの上限で見送った読み込み
+            size_t reverts = 0;             // 呼び出し側が反映できずに Revert した変更
+        };
+
+        Streamer() = default;
+        explicit Streamer(const Settings& settings) : mSettings(settings) {}
+
+        const Settings& GetSettings() const { return mSettings; }
+        void SetSettings(const Settings& settings) { mSettings = settings; }
+
+        // テクスチャを登録して番号を返す。常駐するのはミップの末尾（GetTailMip から下）だけ
+        // BC 形式の末尾は幅/高さが4の倍数の段から始まる（細かい段の方へずらす）
+        uint32_t Register(uint32_t width, uint32_t height, uint32_t mipCount, PixelFormat format, uint32_t arraySize = 1);
+        void Clear();
+
+        size_t GetTextureCount() const { return mTextures.size(); }
+        uint32_t GetTailMip(uint32_t texture) const { return mTextures[texture].tailMip; }
+        uint32_t GetResidentMip(uint32_t texture) const { return mTextures[texture].residentMip; }
+
+        // このフレームで texture の mip 段（小数）が必要。複数回呼ばれたら最も細かいものを使う
+        void Request(uint32_t texture, float mip);
+
+        // フレームの終わりに1回呼ぶ。要求と予算から常駐する段を決め直し、変わったテクスチャを changes に入れる
+        // 読み込みはぼやけている段数の多い順、追い出しは要求されてからの時間が長い順
+        void Update(std::vector<Change>& changes);
+
+        // Update が返した変更を反映できなかった（テクスチャを作り直せなかった）ときに呼ぶ
+        // 常駐する段を previousMip に戻し、常駐量をその分補正する（要求が続けば次の Update で読み込み直す）
+        void Revert(const Change& change);
+
+        const Stats& GetStats() const { return mStats; }
+
+    private:
+        struct Texture
+        {
+            std::vector<uint64_t> bytesFrom;    // [mip] その段から末尾までの合計バイト数
+            uint32_t tailMip = 0;
+            uint32_t residentMip = 0;
+            uint32_t updateStartMip = 0;        // Update を始めたときの residentMip（Change::previousMip）
+            uint32_t wantedMip = 0;
+            float requestedMip = 0.0f;          // このフレームで要求された最も細かい段（要求がなければ大きな値）
+            uint64_t lastRequestFrame = 0;
+            bool changed = false;
+        };
+
+        uint64_t SurplusBytes(const Texture& texture) const;
+        uint64_t Evict(uint64_t bytesNeeded, uint32_t keep);
+
+        Settings mSettings;
+        std::vector<Texture> mTextures;
+        uint64_t mFrame = 0;
+        Stats mStats;
+    };
+}
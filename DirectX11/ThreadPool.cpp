@@ -0,0 +1,66 @@
+﻿#include "ThreadPool.h"
+
+bool ThreadPool::Batch::RunOne()
+{
+    const size_t chunk = next.fetch_add(1);
+    if (chunk >= chunkCount) return false;
+
+    const size_t begin = chunk * chunkSize;
+    func(begin, std::min(count, begin + chunkSize));
+
+    // 最後の区間を終えたスレッドが待っている呼び出し元を起こす
+    if (done.fetch_add(1) + 1 == chunkCount)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.notify_all();
+    }
+    return true;
+}
+
+ThreadPool::ThreadPool(size_t workerCount)
+{
+    if (workerCount == 0)
+    {
+        workerCount = std::max<size_t>(1, std::thread::hardware_concurrency()) - 1;
+    }
+    mWorkers.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; i++)
+    {
+        mWorkers.emplace_back([this]() { WorkerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mWake.notify_all();
+    for (std::thread& worker : mWorkers) worker.join();
+}
+
+void ThreadPool::Enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTasks.push_back(std::move(task));
+    }
+    mWake.notify_one();
+}
+
+void ThreadPool::WorkerLoop()
+{
+    for (;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWake.wait(lock, [this]() { return mStopping || !mTasks.empty(); });
+            if (mStopping && mTasks.empty()) return;
+            task = std::move(mTasks.front());
+            mTasks.pop_front();
+        }
+        task();
+    }
+}
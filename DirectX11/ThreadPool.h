@@ -0,0 +1,88 @@
+﻿#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 常駐ワーカースレッドのプール
+// 重い処理は pool を引数に取り（nullptr なら直列）、呼ぶたびにスレッドを作らない。同時に複数のスレッドから呼んでもよい
+class ThreadPool
+{
+public:
+    // workerCount が 0 なら（論理コア数 - 1）個。呼び出しスレッドも処理に加わる
+    explicit ThreadPool(size_t workerCount = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // 呼び出しスレッドを含めた並列数
+    size_t GetThreadCount() const { return mWorkers.size() + 1; }
+
+    // [0, count) を区間に分けてワーカーと呼び出しスレッドで処理し、全区間が終わるまで待つ
+    // func(begin, end) は区間ごとに1回呼ばれる。区間はスレッド数より細かく切って負荷の偏りを均す
+    template <class Func>
+    void ParallelFor(size_t count, size_t minChunk, Func func);
+
+private:
+    // 区間の配布状態。遅れて起きたワーカーが呼び出し元の戻った後に触っても安全なよう共有で持つ
+    struct Batch
+    {
+        std::atomic<size_t> next{ 0 };
+        std::atomic<size_t> done{ 0 };
+        size_t chunkCount = 0;
+        size_t chunkSize = 0;
+        size_t count = 0;
+        std::function<void(size_t, size_t)> func;
+        std::mutex mutex;
+        std::condition_variable finished;
+
+        // 区間を1つ取って処理する（残っていなければ false）
+        bool RunOne();
+    };
+
+    void Enqueue(std::function<void()> task);
+    void WorkerLoop();
+
+    std::vector<std::thread> mWorkers;
+    std::deque<std::function<void()>> mTasks;
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    bool mStopping = false;
+};
+
+template <class Func>
+void ThreadPool::ParallelFor(size_t count, size_t minChunk, Func func)
+{
+    if (count == 0) return;
+
+    const size_t threadCount = GetThreadCount();
+    const size_t maxChunks = (count + minChunk - 1) / std::max<size_t>(minChunk, 1);
+    const size_t chunkCount = std::min(maxChunks, threadCount * 4);
+    if (threadCount <= 1 || chunkCount <= 1)
+    {
+        func(size_t(0), count);
+        return;
+    }
+
+    auto batch = std::make_shared<Batch>();
+    batch->chunkSize = (count + chunkCount - 1) / chunkCount;
+    batch->chunkCount = (count + batch->chunkSize - 1) / batch->chunkSize;
+    batch->count = count;
+    batch->func = [&func](size_t begin, size_t end) { func(begin, end); };
+
+    const size_t helpers = std::min(mWorkers.size(), batch->chunkCount - 1);
+    for (size_t i = 0; i < helpers; i++)
+    {
+        Enqueue([batch]() { while (batch->RunOne()) {} });
+    }
+    while (batch->RunOne()) {}
+
+    std::unique_lock<std::mutex> lock(batch->mutex);
+    batch->finished.wait(lock, [&]() { return batch->done.load() == batch->chunkCount; });
+}
@@ -0,0 +1,352 @@
+﻿#include "VertexPacking.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include "Bounds.h"
+
+namespace
+{
+    constexpr float kUnorm16Max = 65535.0f;
+    constexpr float kSnorm16Max = 32767.0f;
+
+    // QTangent（SNORM16 のクォータニオン）で復元した法線/接線の角度誤差の上限[度]
+    // （成分ごとに半ステップずれたときの回転角 2 * asin(sqrt(4) * 0.5 / 32767) = 0.0035 度に余裕を持たせたもの）
+    constexpr float kQTangentErrorDegrees = 0.01f;
+
+    // D3D の SNORM 変換規則（-32768 は -1 に丸められる）
+    float SnormToFloat(int16_t value)
+    {
+        return std::max(float(value) / kSnorm16Max, -1.0f);
+    }
+
+    int16_t FloatToSnorm(float value)
+    {
+        return int16_t(std::lround(std::min(std::max(value, -1.0f), 1.0f) * kSnorm16Max));
+    }
+
+    uint16_t FloatToUnorm(float value)
+    {
+        return uint16_t(std::lround(std::min(std::max(value, 0.0f), 1.0f) * kUnorm16Max));
+    }
+
+    float Dot(const Float3& a, const Float3& b)
+    {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+
+    float Length(const Float3& a)
+    {
+        return std::sqrt(Dot(a, a));
+    }
+
+    Float3 Cross(const Float3& a, const Float3& b)
+    {
+        return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    }
+
+    Float3 Normalize(const Float3& a)
+    {
+        float length = Length(a);
+        return length > 0.0f ? Float3{ a.x / length, a.y / length, a.z / length } : Float3{ 0.0f, 0.0f, 0.0f };
+    }
+
+    // 2ベクトルのなす角[度]。小さな角は acos(dot) では float の精度が足りないので atan2 で求める
+    float AngleDegrees(const Float3& a, const Float3& b)
+    {
+        return std::atan2(Length(Cross(a, b)), Dot(a, b)) * (180.0f / 3.14159265f);
+    }
+
+    // 正規直交な列 (x, y, z) の回転行列 -> クォータニオン (x, y, z, w)
+    Float4 QuaternionFromBasis(const Float3& x, const Float3& y, const Float3& z)
+    {
+        const float trace = x.x + y.y + z.z;
+        Float4 q;
+        if (trace > 0.0f)
+        {
+            float s = std::sqrt(trace + 1.0f) * 2.0f;
+            q = { (y.z - z.y) / s, (z.x - x.z) / s, (x.y - y.x) / s, 0.25f * s };
+        }
+        else if (x.x > y.y && x.x > z.z)
+        {
+            float s = std::sqrt(1.0f + x.x - y.y - z.z) * 2.0f;
+            q = { 0.25f * s, (y.x + x.y) / s, (z.x + x.z) / s, (y.z - z.y) / s };
+        }
+        else if (y.y > z.z)
+        {
+            float s = std::sqrt(1.0f + y.y - x.x - z.z) * 2.0f;
+            q = { (y.x + x.y) / s, 0.25f * s, (z.y + y.z) / s, (z.x - x.z) / s };
+        }
+        else
+        {
+            float s = std::sqrt(1.0f + z.z - x.x - y.y) * 2.0f;
+            q = { (z.x + x.z) / s, (z.y + y.z) / s, 0.25f * s, (x.y - y.x) / s };
+        }
+        float length = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+        return { q.x / length, q.y / length, q.z / length, q.w / length };
+    }
+
+    // 位置の量子化の逆数（厚みのない軸は 0 に詰める。復元すると offset そのもの）
+    Float3 InverseScale(const VertexQuantization& quantization)
+    {
+        const Float3& scale = quantization.positionScale;
+        return
+        {
+            scale.x > 0.0f ? 1.0f / scale.x : 0.0f,
+            scale.y > 0.0f ? 1.0f / scale.y : 0.0f,
+            scale.z > 0.0f ? 1.0f / scale.z : 0.0f,
+        };
+    }
+}
+
+namespace VertexPacking
+{
+    VertexQuantization ComputeQuantization(const std::vector<MeshVertex>& vertices)
+    {
+        return ComputeQuantization(vertices.data(), vertices.size());
+    }
+
+    VertexQuantization ComputeQuantization(const MeshVertex* vertices, size_t count)
+    {
+        VertexQuantization quantization;
+        if (count == 0) return quantization;
+
+        const Bounds::Aabb bounds = Bounds::ComputeAabb(&vertices[0].pos, count, sizeof(MeshVertex));
+        quantization.positionOffset = bounds.min;
+        quantization.positionScale = { bounds.max.x - bounds.min.x, bounds.max.y - bounds.min.y, bounds.max.z - bounds.min.z };
+        return quantization;
+    }
+
+    void EncodeQTangent(const Float3& normal, const Float4& tangent, int16_t out[4])
+    {
+        // 法線を z、接線を x とする回転（y = cross(z, x)）。従法線の向きは w の符号で持つ
+        Float3 n = Normalize(normal);
+        if (Length(n) == 0.0f) n = { 0.0f, 0.0f, 1.0f };
+        const Float3 raw = { tangent.x, tangent.y, tangent.z };
+        const float along = Dot(n, raw);
+        Float3 t = Normalize(Float3{ raw.x - n.x * along, raw.y - n.y * along, raw.z - n.z * along });
+        if (Length(t) == 0.0f)
+        {
+            t = Normalize(Cross(std::fabs(n.x) < 0.9f ? Float3{ 1.0f, 0.0f, 0.0f } : Float3{ 0.0f, 1.0f, 0.0f }, n));
+        }
+        Float4 q = QuaternionFromBasis(t, Cross(n, t), n);
+
+        // q と -q は同じ回転なので w >= 0 にそろえ、w が 0 に丸まって符号が消えないよう最小値を持たせる
+        if (q.w < 0.0f) q = { -q.x, -q.y, -q.z, -q.w };
+        const float bias = 1.0f / kSnorm16Max;
+        if (q.w < bias)
+        {
+            const float rescale = std::sqrt(1.0f - bias * bias) / std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z);
+            q = { q.x * rescale, q.y * rescale, q.z * rescale, bias };
+        }
+        if (tangent.w < 0.0f) q = { -q.x, -q.y, -q.z, -q.w };
+
+        out[0] = FloatToSnorm(q.x);
+        out[1] = FloatToSnorm(q.y);
+        out[2] = FloatToSnorm(q.z);
+        out[3] = FloatToSnorm(q.w);
+    }
+
+    void DecodeQTangent(const int16_t in[4], Float3& normal, Float4& tangent)
+    {
+        Float4 q = { SnormToFloat(in[0]), SnormToFloat(in[1]), SnormToFloat(in[2]), SnormToFloat(in[3]) };
+        const float length = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+        q = { q.x / length, q.y / length, q.z / length, q.w / length };
+
+        // shaders.hlsl の DecodeQTangent と同じ計算（回転行列の x 列と z 列）
+        tangent =
+        {
+            1.0f - 2.0f * (q.y * q.y + q.z * q.z),
+            2.0f * (q.x * q.y + q.w * q.z),
+            2.0f * (q.x * q.z - q.w * q.y),
+            q.w < 0.0f ? -1.0f : 1.0f,
+        };
+        normal =
+        {
+            2.0f * (q.x * q.z + q.w * q.y),
+            2.0f * (q.y * q.z - q.w * q.x),
+            1.0f - 2.0f * (q.x * q.x + q.y * q.y),
+        };
+    }
+
+    void PackVertices(const std::vector<MeshVertex>& vertices, VertexFormat format, const VertexQuantization& quantization,
+        std::vector<uint8_t>& out)
+    {
+        out.resize(vertices.size() * VertexFormatStride(format));
+        PackVertices(vertices.data(), vertices.size(), format, quantization, out.data());
+    }
+
+    void PackVertices(const MeshVertex* vertices, size_t count, VertexFormat format, const VertexQuantization& quantization,
+        uint8_t* out)
+    {
+        const size_t stride = VertexFormatStride(format);
+        const Float3& offset = quantization.positionOffset;
+        const Float3 invScale = InverseScale(quantization);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const MeshVertex& v = vertices[i];
+            if (format == VertexFormat::Packed16)
+            {
+                PackedVertex p;
+                p.pos[0] = FloatToUnorm((v.pos.x - offset.x) * invScale.x);
+                p.pos[1] = FloatToUnorm((v.pos.y - offset.y) * invScale.y);
+                p.pos[2] = FloatToUnorm((v.pos.z - offset.z) * invScale.z);
+                p.pos[3] = 0;
+                EncodeQTangent(v.normal, v.tangent, p.qtangent);
+                p.uv[0] = FloatToHalf(v.uv.x);
+                p.uv[1] = FloatToHalf(v.uv.y);
+                std::memcpy(&out[i * stride], &p, sizeof(p));
+            }
+            else
+            {
+                Float32Vertex f;
+                f.pos = v.pos;
+                EncodeQTangent(v.normal, v.tangent, f.qtangent);
+                f.uv = v.uv;
+                std::memcpy(&out[i * stride], &f, sizeof(f));
+            }
+        }
+    }
+
+    MeshVertex UnpackVertex(const void* vertex, VertexFormat format, const VertexQuantization& quantization)
+    {
+        MeshVertex v;
+        if (format == VertexFormat::Packed16)
+        {
+            PackedVertex p;
+            std::memcpy(&p, vertex, sizeof(p));
+            const Float3& offset = quantization.positionOffset;
+            const Float3& scale = quantization.positionScale;
+            v.pos =
+            {
+                offset.x + float(p.pos[0]) / kUnorm16Max * scale.x,
+                offset.y + float(p.pos[1]) / kUnorm16Max * scale.y,
+                offset.z + float(p.pos[2]) / kUnorm16Max * scale.z,
+            };
+            DecodeQTangent(p.qtangent, v.normal, v.tangent);
+            v.uv = { HalfToFloat(p.uv[0]), HalfToFloat(p.uv[1]) };
+        }
+        else
+        {
+            Float32Vertex f;
+            std::memcpy(&f, vertex, sizeof(f));
+            v.pos = f.pos;
+            DecodeQTangent(f.qtangent, v.normal, v.tangent);
+            v.uv = f.uv;
+        }
+        return v;
+    }
+
+    PackingStats MeasureError(const std::vector<MeshVertex>& vertices, const std::vector<uint8_t>& packed,
+        VertexFormat format, const VertexQuantization& quantization)
+    {
+        const size_t count = std::min(vertices.size(), packed.size() / VertexFormatStride(format));
+        return MeasureError(vertices.data(), count, packed.data(), format, quantization);
+    }
+
+    PackingStats MeasureError(const MeshVertex* vertices, size_t count, const uint8_t* packed, VertexFormat format,
+        const VertexQuantization& quantization)
+    {
+        PackingStats stats;
+        const size_t stride = VertexFormatStride(format);
+
+        float maxCoordinate = 0.0f;
+        float maxUv = 0.0f;
+        for (size_t i = 0; i < count; i++)
+        {
+            const MeshVertex& a = vertices[i];
+            const MeshVertex b = UnpackVertex(&packed[i * stride], format, quantization);
+
+            Float3 d = { a.pos.x - b.pos.x, a.pos.y - b.pos.y, a.pos.z - b.pos.z };
+            stats.measured.position = std::max(stats.measured.position, Length(d));
+            maxCoordinate = std::max({ maxCoordinate, std::fabs(a.pos.x), std::fabs(a.pos.y), std::fabs(a.pos.z) });
+
+            // 法線のない頂点（長さ 0）は比べない。接線は法線に直交させた向きと比べる
+            const Float3 n = Normalize(a.normal);
+            if (Length(n) > 0.0f)
+            {
+                stats.measured.normalDegrees = std::max(stats.measured.normalDegrees, AngleDegrees(n, b.normal));
+
+                const Float3 t = { a.tangent.x, a.tangent.y, a.tangent.z };
+                const Float3 tn = Normalize(Float3{ t.x - n.x * Dot(n, t), t.y - n.y * Dot(n, t), t.z - n.z * Dot(n, t) });
+                const Float3 tb = { b.tangent.x, b.tangent.y, b.tangent.z };
+                if (Length(tn) > 0.0f)
+                {
+                    float degrees = AngleDegrees(tn, tb);
+                    if ((a.tangent.w < 0.0f) != (b.tangent.w < 0.0f)) degrees = 180.0f;     // 従法線の向きが反転
+                    stats.measured.tangentDegrees = std::max(stats.measured.tangentDegrees, degrees);
+                }
+            }
+
+            stats.measured.uv = std::max({ stats.measured.uv, std::fabs(a.uv.x - b.uv.x), std::fabs(a.uv.y - b.uv.y) });
+            maxUv = std::max({ maxUv, std::fabs(a.uv.x), std::fabs(a.uv.y) });
+        }
+
+        stats.bound.normalDegrees = kQTangentErrorDegrees;
+        stats.bound.tangentDegrees = kQTangentErrorDegrees;
+        if (format == VertexFormat::Packed16)
+        {
+            // 位置: 各軸 半ステップ + 復元計算の float 丸め
+            stats.bound.position = 0.5f / kUnorm16Max * Length(quantization.positionScale) + 4.0f * FLT_EPSILON * maxCoordinate;
+            // UV: half の相対誤差 2^-11（非正規化数の範囲では絶対誤差 2^-25）
+            stats.bound.uv = std::max(maxUv * (1.0f / 2048.0f), 1.0f / 33554432.0f);
+        }
+        return stats;
+    }
+
+    uint16_t FloatToHalf(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        const uint16_t sign = uint16_t((bits >> 16) & 0x8000);
+        const uint32_t magnitude = bits & 0x7fffffff;
+
+        if (magnitude >= 0x7f800000)    // Inf / NaN
+        {
+            return uint16_t(sign | 0x7c00 | (magnitude > 0x7f800000 ? 0x200 : 0));
+        }
+        if (magnitude >= 0x477ff000)    // 65520 以上は Inf に丸まる
+        {
+            return uint16_t(sign | 0x7c00);
+        }
+        if (magnitude < 0x38800000)     // half の非正規化数（2^-14 未満）
+        {
+            float f;
+            std::memcpy(&f, &magnitude, sizeof(f));
+            return uint16_t(sign | uint16_t(std::nearbyint(f * 16777216.0f)));
+        }
+
+        // 指数のバイアスを 127 -> 15 に付け替え、仮数を 23 -> 10bit に最近接偶数丸め
+        uint32_t h = magnitude - 0x38000000;
+        h = (h + 0xfff + ((h >> 13) & 1)) >> 13;
+        return uint16_t(sign | h);
+    }
+
+    float HalfToFloat(uint16_t value)
+    {
+        const uint32_t sign = uint32_t(value & 0x8000) << 16;
+        const uint32_t exponent = (value >> 10) & 0x1f;
+        const uint32_t mantissa = value & 0x3ff;
+
+        uint32_t bits;
+        if (exponent == 0)
+        {
+            float f = float(mantissa) * (1.0f / 16777216.0f);
+            std::memcpy(&bits, &f, sizeof(bits));
+            bits |= sign;
+        }
+        else if (exponent == 31)
+        {
+            bits = sign | 0x7f800000 | (mantissa << 13);
+        }
+        else
+        {
+            bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+        }
+
+        float result;
+        std::memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+}
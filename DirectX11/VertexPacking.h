@@ -0,0 +1,53 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MeshData.h"
+
+// MeshVertex と GPU 頂点（Float32Vertex / PackedVertex）の相互変換（CPUのみ・D3D非依存）
+// 復元はシェーダー（VSMain）と同じ式で行う
+namespace VertexPacking
+{
+    // 量子化で失われる精度（位置はモデル空間の距離、法線/接線は角度[度]、UV は座標の差）
+    struct PackingError
+    {
+        float position = 0.0f;
+        float normalDegrees = 0.0f;
+        float tangentDegrees = 0.0f;
+        float uv = 0.0f;
+    };
+
+    struct PackingStats
+    {
+        PackingError measured;      // 全頂点を復元して測った最大誤差
+        PackingError bound;         // 形式から決まる誤差の上限（measured がこれを超えたら変換の不具合）
+    };
+
+    // 法線と接線（w = 従法線の向き）<-> QTangent
+    void EncodeQTangent(const Float3& normal, const Float4& tangent, int16_t out[4]);
+    void DecodeQTangent(const int16_t in[4], Float3& normal, Float4& tangent);
+
+    // 全頂点を囲む AABB を UNORM16 の [0, 1] に対応させる
+    // インポートはサブメッシュの範囲ごとに求める（SubMesh::quantization。離れた小物が大きな AABB の粗い刻みにならない）
+    VertexQuantization ComputeQuantization(const std::vector<MeshVertex>& vertices);
+    VertexQuantization ComputeQuantization(const MeshVertex* vertices, size_t count);
+
+    // 全頂点を format の頂点バッファのバイト列にする（quantization は Packed16 のときのみ使う）
+    // 範囲版は out に count * VertexFormatStride(format) バイト書く
+    void PackVertices(const std::vector<MeshVertex>& vertices, VertexFormat format, const VertexQuantization& quantization,
+        std::vector<uint8_t>& out);
+    void PackVertices(const MeshVertex* vertices, size_t count, VertexFormat format, const VertexQuantization& quantization,
+        uint8_t* out);
+
+    MeshVertex UnpackVertex(const void* vertex, VertexFormat format, const VertexQuantization& quantization);
+
+    // packed を復元して元の頂点と比べる
+    PackingStats MeasureError(const std::vector<MeshVertex>& vertices, const std::vector<uint8_t>& packed,
+        VertexFormat format, const VertexQuantization& quantization);
+    PackingStats MeasureError(const MeshVertex* vertices, size_t count, const uint8_t* packed, VertexFormat format,
+        const VertexQuantization& quantization);
+
+    // IEEE 754 binary16 との変換（最近接偶数丸め）
+    uint16_t FloatToHalf(float value);
+    float HalfToFloat(uint16_t value);
+}
@@ -15,26 +15,64 @@ cbuffer ConstantBuffer : register(b0)
     float specPower;        // ʂ̉s(32, 64, 128Ȃ)
     float4 materialColor;   // AxhZF
     uint useTexture;        // 1: eNX`gp / 0: gp
-    float3 _pad;            // 16byte킹
+    uint useNormalMap;      // 1: @}bvgp / 0: gp
+    float2 _pad;            // 16byte킹
+
+    // ʎq_̈ʒu̕iPACKED_VERTEX ̂Ƃ̂ݎgpj
+    float3 posOffset;
+    float _pad1;
+    float3 posScale;
+    float _pad2;
+
+    // }eA̋ʔːFƎȔF
+    float3 specularColor;
+    float _pad3;
+    float3 emissiveColor;
+    float _pad4;
+
+    // gUFeNX`Ɩ@}bv UV ̕ϊiuv * xy + zwBAgX̃y[W͈̒̔́j
+    float4 diffuseUvScaleOffset;
+    float4 normalUvScaleOffset;
 }
 
 // eNX`ƃTv[
 Texture2D tex0 : register(t0);
+Texture2D normalMap : register(t1);     // ڋԂ̖@}bviuseNormalMap ̂Ƃ̂݁j
 SamplerState samp0 : register(s0);
 
 // _\́íj
 struct VSIn
 {
-    float3 pos : POSITION;
+#if SKINNED_VERTEX
+    float3 pos : POSITION;      // CPU ŃXLjOς݁ifԁAXbg1j
     float3 normal : NORMAL;
-    float2 uv : TEXCOORD;
+    float4 tangent : TANGENT;   // w = ]@̌
+#elif PACKED_VERTEX
+    float4 pos : POSITION;      // AABB ŐKʒu (UNORM16)
+    float4 qtangent : QTANGENT; // ڋԂ̉] (SNORM16)Bw ̕]@̌
+#else
+    float3 pos : POSITION;
+    float4 qtangent : QTANGENT;
+#endif
+    float2 uv : TEXCOORD;       // XLtłXbg0 ̌̒_ǂ
 };
 
+// QTangent -> @ƐڐiVertexPacking.cpp  DecodeQTangent ƓvZj
+// ]s z 񂪖@Ax 񂪐ڐA]@ handedness * cross(normal, tangent)
+void DecodeQTangent(float4 q, out float3 normal, out float3 tangent, out float handedness)
+{
+    handedness = q.w < 0.0 ? -1.0 : 1.0;
+    q = normalize(q);
+    tangent = float3(1.0 - 2.0 * (q.y * q.y + q.z * q.z), 2.0 * (q.x * q.y + q.w * q.z), 2.0 * (q.x * q.z - q.w * q.y));
+    normal = float3(2.0 * (q.x * q.z + q.w * q.y), 2.0 * (q.y * q.z - q.w * q.x), 1.0 - 2.0 * (q.x * q.x + q.y * q.y));
+}
+
 // _\́iój
 struct VSOut
 {
     float4 pos : SV_POSITION;
     float3 nW : NORMAL;         // [hԖ@
+    float4 tW : TANGENT;        // [hԐڐiw = ]@̌j
     float2 uv : TEXCOORD;
     float3 posW : TEXCOORD1;    // [hʒu
 };
@@ -43,9 +81,25 @@ struct VSOut
 VSOut VSMain(VSIn i)
 {
     VSOut o;
+
+    float3 normal, tangent;
+    float handedness;
+#if SKINNED_VERTEX
+    float3 pos = i.pos;
+    normal = i.normal;
+    tangent = i.tangent.xyz;
+    handedness = i.tangent.w;
+#else
+#if PACKED_VERTEX
+    float3 pos = posOffset + i.pos.xyz * posScale;
+#else
+    float3 pos = i.pos;
+#endif
+    DecodeQTangent(i.qtangent, normal, tangent, handedness);
+#endif
     
     // f@-> [h
-    float4 wpos = mul(float4(i.pos, 1.0), world);
+    float4 wpos = mul(float4(pos, 1.0), world);
     o.posW = wpos.xyz;
     
     // [h -> r[
@@ -53,8 +107,9 @@ VSOut VSMain(VSIn i)
     // r[ -> vWFNV
     o.pos = mul(vpos, proj);
     
-    // @[hԂ֕ϊ
-    o.nW = mul(i.normal, (float3x3) transpose(world));
+    // @Ɛڐ[hԂ֕ϊisŉ񂵂ĐڋԂۂj
+    o.nW = mul(normal, (float3x3) transpose(world));
+    o.tW = float4(mul(tangent, (float3x3) transpose(world)), handedness);
     
     o.uv = i.uv;
     
@@ -66,6 +121,17 @@ float4 PSMain(VSOut i) : SV_TARGET
 {
     // K
     float3 N = normalize(i.nW);
+    if (useNormalMap != 0)
+    {
+        // ڋԂ̖@[hԂցBMikkTSpace ŃxCN@}bvƈv悤A
+        // Ԃ@/ڐ𐳋KɎgA]@̓sNZƂɊOςō
+        float3 B = i.tW.w * cross(i.nW, i.tW.xyz);
+        // @}bv BC5iRG ̂݁jɈk邱Ƃ̂ŁAz ͒Pʒ蒼
+        float3 t;
+        t.xy = normalMap.Sample(samp0, i.uv * normalUvScaleOffset.xy + normalUvScaleOffset.zw).xy * 2.0 - 1.0;
+        t.z = sqrt(saturate(1.0 - dot(t.xy, t.xy)));
+        N = normalize(t.x * i.tW.xyz + t.y * B + t.z * i.nW);
+    }
     float3 L = normalize(-lightDir);
     float V = normalize(camPos - i.posW);
     float3 H = normalize(L + V);
@@ -81,16 +147,16 @@ float4 PSMain(VSOut i) : SV_TARGET
     float4 albedo = materialColor;
     if (useTexture != 0)
     {
-        float4 texColor = tex0.Sample(samp0, i.uv);
+        float4 texColor = tex0.Sample(samp0, i.uv * diffuseUvScaleOffset.xy + diffuseUvScaleOffset.zw);
         albedo *= texColor;
     }
     
     //  + gU + 
     float3 ambient = ambientColor.rgb * albedo.rgb;
     float3 diffuse = lightIntensity * diff * lightColor.rgb * albedo.rgb;
-    float3 specular = lightIntensity * spec * lightColor.rgb; // xȂ̃Vvdl
+    float3 specular = lightIntensity * spec * lightColor.rgb * specularColor; // xȂ̃Vvdl
 
-    float3 color = ambient + diffuse + specular;
+    float3 color = ambient + diffuse + specular + emissiveColor;
 
     return float4(color, albedo.a);
 }
@@ -0,0 +1,78 @@
+﻿#include <algorithm>
+#include <cmath>
+#include "BlockCompression.h"
+#include "TestHarness.h"
+#include "ThreadPool.h"
+
+namespace
+{
+    // 滑らかなグラデーションに、硬い縁の模様と弱い固定の乱数を重ねた RGBA8 画像
+    ImageData MakeTestImage(uint32_t width, uint32_t height)
+    {
+        ImageData image;
+        image.width = width;
+        image.height = height;
+        image.pixels.resize(size_t(width) * height * 4);
+        uint32_t state = 2024;
+        for (uint32_t y = 0; y < height; y++)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                state = state * 1664525u + 1013904223u;
+                const int noise = int(state >> 29) - 4;
+                const float fx = float(x) / width, fy = float(y) / height;
+                const bool stripe = ((x / 8) + (y / 8)) % 2 == 0;
+                int rgba[4] =
+                {
+                    int(255.0f * fx),
+                    int(127.5f + 127.5f * std::sin(fy * 6.2831853f)),
+                    stripe ? 200 : 40,
+                    int(255.0f * (0.5f + 0.5f * std::cos((fx + fy) * 9.0f))),
+                };
+                uint8_t* p = &image.pixels[(size_t(y) * width + x) * 4];
+                for (int c = 0; c < 4; c++) p[c] = uint8_t(std::min(255, std::max(0, rgba[c] + noise)));
+            }
+        }
+        return image;
+    }
+}
+
+TEST_SUITE(BlockCompressionQuality)
+{
+    ThreadPool pool(3);
+    const PixelFormat formats[] = { PixelFormat::BC1, PixelFormat::BC3, PixelFormat::BC5, PixelFormat::BC7 };
+    const BlockCompression::Quality qualities[] = { BlockCompression::Quality::Fast, BlockCompression::Quality::Normal, BlockCompression::Quality::High };
+    // 端のブロックを埋める処理も通るよう、4の倍数でない大きさも使う
+    const ImageData images[] = { MakeTestImage(64, 64), MakeTestImage(30, 18) };
+    // PSNR の下限 [dB]（画像ごと、BC1 / BC3 / BC5 / BC7 の順。実測から 1dB ほど下げた値）
+    // 小さい画像は1ブロックあたりの模様の変化が大きいので低い。BC7 はモード 6 だけなので 4 チャンネルの相関に弱い
+    const double floors[2][4] = { { 36.0, 36.5, 47.0, 35.0 }, { 31.0, 31.0, 40.0, 27.5 } };
+
+    for (size_t i = 0; i < 2; i++)
+    {
+        const ImageData& image = images[i];
+        for (size_t f = 0; f < 4; f++)
+        {
+            double fastPsnr = 0.0;
+            for (BlockCompression::Quality quality : qualities)
+            {
+                ImageData compressed, reference, decoded;
+                BlockCompression::CompressImage(image, formats[f], quality, compressed, &pool);
+                BlockCompression::CompressImageReference(image, formats[f], quality, reference);
+                TEST_CHECK(compressed.format == formats[f]);
+                TEST_CHECK(compressed.pixels.size() == ImageSize(formats[f], image.width, image.height));
+                // SIMD 版 / 並列版の出力はスカラー版とバイト単位で一致する
+                TEST_CHECK(compressed.pixels == reference.pixels);
+
+                BlockCompression::DecompressImage(compressed, decoded);
+                TEST_CHECK(decoded.width == image.width && decoded.height == image.height);
+                const double psnr = BlockCompression::ComputePsnr(image, decoded, formats[f]);
+                TEST_CHECK(psnr >= floors[i][f]);
+                TEST_CHECK(psnr < 99.0);
+                // 品質を上げても悪くならない
+                if (quality == BlockCompression::Quality::Fast) fastPsnr = psnr;
+                TEST_CHECK(psnr >= fastPsnr);
+            }
+        }
+    }
+}
@@ -0,0 +1,127 @@
+﻿#include <cmath>
+#include "ClusterCulling.h"
+#include "MeshOptimizer.h"
+#include "TestHarness.h"
+#include "TestMeshes.h"
+
+namespace
+{
+    // どのクラスタも視錐台の外に出ない（距離に関係なく内側になる）平面
+    ClusterCulling::Frustum Everything()
+    {
+        ClusterCulling::Frustum frustum;
+        for (Float4& plane : frustum.planes) plane = { 0.0f, 0.0f, 0.0f, 1.0f };
+        return frustum;
+    }
+
+    // インポートと同じ順（頂点キャッシュ -> 頂点フェッチ -> クラスタ分割）で最適化する
+    MeshData Clustered(MeshData mesh)
+    {
+        MeshOptimizer::OptimizeVertexCache(mesh.indices, mesh.vertices.size());
+        MeshOptimizer::OptimizeVertexFetch(mesh, VertexFormatStride(VertexFormat::Float32));
+        MeshOptimizer::BuildMeshlets(mesh, 64, 124);
+        return mesh;
+    }
+
+    // 三角形が eye から裏向き（表の面の裏側に eye がある）か。左手系・時計回りが表
+    bool BackFacing(const MeshData& mesh, size_t triangle, const Float3& eye)
+    {
+        const Float3& p0 = mesh.vertices[mesh.indices[triangle * 3 + 0]].pos;
+        const Float3& p1 = mesh.vertices[mesh.indices[triangle * 3 + 1]].pos;
+        const Float3& p2 = mesh.vertices[mesh.indices[triangle * 3 + 2]].pos;
+        const Float3 e1 = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+        const Float3 e2 = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+        const Float3 n = { e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x };
+        return n.x * (eye.x - p0.x) + n.y * (eye.y - p0.y) + n.z * (eye.z - p0.z) <= 0.0f;
+    }
+
+    struct ConeResult
+    {
+        size_t clusters = 0;
+        size_t culled = 0;
+        size_t allBackFacing = 0;       // すべての三角形が裏向きのクラスタ
+        size_t culledBackFacing = 0;    // そのうち裏向き判定で落とされたもの
+        size_t far = 0;                 // 球の中心から見て eye と反対側に深く入ったクラスタ（球のときだけ意味がある）
+        size_t farCulled = 0;
+        bool conservative = true;       // 表向きの三角形を含むクラスタを落とさなかったか
+        bool rangesConsistent = true;   // 範囲が残ったクラスタのインデックスとちょうど一致するか
+    };
+
+    ConeResult CullFrom(const MeshData& mesh, const Float3& eye)
+    {
+        ConeResult result;
+        std::vector<ClusterCulling::DrawRange> ranges;
+        ClusterCulling::CullStats stats;
+        ClusterCulling::CullMeshlets(mesh.meshlets.data(), mesh.meshlets.size(), Everything(), eye, ranges, stats);
+        result.clusters = stats.clusters;
+        result.culled = stats.backfaceCulled;
+
+        std::vector<bool> drawn(mesh.indices.size() / 3, false);
+        size_t drawnTriangles = 0;
+        for (const ClusterCulling::DrawRange& range : ranges)
+        {
+            for (uint32_t t = range.indexOffset / 3; t < (range.indexOffset + range.indexCount) / 3; t++)
+            {
+                result.rangesConsistent = result.rangesConsistent && !drawn[t];
+                drawn[t] = true;
+                drawnTriangles++;
+            }
+        }
+        result.rangesConsistent = result.rangesConsistent && drawnTriangles == stats.trianglesDrawn && stats.frustumCulled == 0;
+
+        for (const Meshlet& m : mesh.meshlets)
+        {
+            bool back = true;
+            for (uint32_t t = 0; t < m.triangleCount; t++) back = back && BackFacing(mesh, m.indexOffset / 3 + t, eye);
+            const bool culled = !drawn[m.indexOffset / 3];
+            result.conservative = result.conservative && (!culled || back);
+            result.allBackFacing += back ? 1 : 0;
+            result.culledBackFacing += back && culled ? 1 : 0;
+
+            const float eyeLength = std::sqrt(eye.x * eye.x + eye.y * eye.y + eye.z * eye.z);
+            bool far = eyeLength > 0.0f;
+            for (uint32_t i = 0; i < m.triangleCount * 3 && far; i++)
+            {
+                const Float3& p = mesh.vertices[mesh.indices[m.indexOffset + i]].pos;
+                far = (p.x * eye.x + p.y * eye.y + p.z * eye.z) / eyeLength < -0.3f;
+            }
+            result.far += far ? 1 : 0;
+            result.farCulled += far && culled ? 1 : 0;
+        }
+        return result;
+    }
+}
+
+TEST_SUITE(ConeCulling)
+{
+    const MeshData sphere = Clustered(TestMeshes::MakeSphere(64, 96));
+    TEST_CHECK(sphere.meshlets.size() > 20);
+
+    // 閉じた球の内側からは全面が裏を向くので、法線コーンを持つクラスタはすべて落ちる
+    size_t withCone = 0;
+    for (const Meshlet& m : sphere.meshlets) withCone += m.coneCutoff < 1.0f ? 1 : 0;
+    const ConeResult inside = CullFrom(sphere, { 0.0f, 0.0f, 0.0f });
+    TEST_CHECK(withCone * 10 >= sphere.meshlets.size() * 9);
+    TEST_CHECK(inside.culled == withCone);
+    TEST_CHECK(inside.conservative && inside.rangesConsistent);
+
+    // 外から見ると表向きの三角形を含むクラスタは残り、全面が裏向きのクラスタは大半が落ちる
+    // 視線の反対側に深く入った（全頂点が中心から eye と逆向きに 0.3 以上離れた）クラスタはすべて落ちる
+    const Float3 eyes[] = { { 0.0f, 0.0f, 10.0f }, { 0.0f, 0.0f, -10.0f }, { 10.0f, 0.0f, 0.0f }, { 0.0f, 10.0f, 0.0f }, { 0.0f, 0.0f, 1.5f } };
+    for (const Float3& eye : eyes)
+    {
+        const ConeResult outside = CullFrom(sphere, eye);
+        TEST_CHECK(outside.conservative && outside.rangesConsistent);
+        TEST_CHECK(outside.culled > 0);
+        TEST_CHECK(outside.culledBackFacing * 3 >= outside.allBackFacing * 2);
+        TEST_CHECK(outside.farCulled == outside.far && outside.far > 0);
+    }
+
+    // 開いた格子（表は +y）: 下からはすべて落ち、上からは何も落ちない
+    const MeshData grid = Clustered(TestMeshes::MakeGrid(48));
+    const ConeResult below = CullFrom(grid, { 0.5f, -5.0f, 0.5f });
+    TEST_CHECK(below.conservative && below.rangesConsistent);
+    TEST_CHECK(below.culled == grid.meshlets.size());
+    const ConeResult above = CullFrom(grid, { 0.5f, 5.0f, 0.5f });
+    TEST_CHECK(above.culled == 0 && above.rangesConsistent);
+}
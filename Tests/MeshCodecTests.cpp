@@ -0,0 +1,124 @@
+﻿#include <cstring>
+#include "MeshCodec.h"
+#include "MeshOptimizer.h"
+#include "TestHarness.h"
+#include "TestMeshes.h"
+#include "VertexPacking.h"
+
+namespace
+{
+    // 三角形の順序と向きが同じか（三角形内の開始頂点の回転だけは許す）
+    bool SameTriangles(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b)
+    {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); i += 3)
+        {
+            bool match = false;
+            for (int r = 0; r < 3 && !match; r++)
+            {
+                match = a[i] == b[i + r] && a[i + 1] == b[i + (r + 1) % 3] && a[i + 2] == b[i + (r + 2) % 3];
+            }
+            if (!match) return false;
+        }
+        return true;
+    }
+
+    void CheckIndexRoundTrip(const std::vector<uint32_t>& indices)
+    {
+        std::vector<uint8_t> encoded;
+        MeshCodec::EncodeIndexBuffer(indices.data(), indices.size(), encoded);
+        std::vector<uint32_t> decoded(indices.size());
+        TEST_CHECK(MeshCodec::DecodeIndexBuffer(decoded.data(), decoded.size(), encoded.data(), encoded.size()));
+        TEST_CHECK(SameTriangles(indices, decoded));
+
+        // 展開結果をもう一度符号化すると同じバイト列になり、展開すると同じインデックス列に戻る
+        std::vector<uint8_t> reencoded;
+        MeshCodec::EncodeIndexBuffer(decoded.data(), decoded.size(), reencoded);
+        TEST_CHECK(reencoded == encoded);
+        std::vector<uint32_t> again(decoded.size());
+        TEST_CHECK(MeshCodec::DecodeIndexBuffer(again.data(), again.size(), reencoded.data(), reencoded.size()));
+        TEST_CHECK(again == decoded);
+
+        // 途中で切れたデータは失敗する
+        if (encoded.size() > 1)
+        {
+            TEST_CHECK(!MeshCodec::DecodeIndexBuffer(decoded.data(), decoded.size(), encoded.data(), encoded.size() - 1));
+        }
+    }
+
+    void CheckVertexRoundTrip(const void* vertices, size_t vertexCount, size_t stride)
+    {
+        std::vector<uint8_t> encoded;
+        MeshCodec::EncodeVertexBuffer(vertices, vertexCount, stride, encoded);
+        std::vector<uint8_t> decoded(vertexCount * stride, 0xcd);
+        TEST_CHECK(MeshCodec::DecodeVertexBuffer(decoded.data(), vertexCount, stride, encoded.data(), encoded.size()));
+        TEST_CHECK(vertexCount == 0 || std::memcmp(decoded.data(), vertices, decoded.size()) == 0);
+
+        std::vector<uint8_t> reencoded;
+        MeshCodec::EncodeVertexBuffer(decoded.data(), vertexCount, stride, reencoded);
+        TEST_CHECK(reencoded == encoded);
+
+        if (vertexCount > 0)
+        {
+            TEST_CHECK(!MeshCodec::DecodeVertexBuffer(decoded.data(), vertexCount, stride, encoded.data(), encoded.size() - 1));
+        }
+    }
+}
+
+TEST_SUITE(IndexCodec)
+{
+    // インポート直後の順序、頂点キャッシュ/フェッチ最適化後の順序、バラバラの順序
+    MeshData mesh = TestMeshes::MakeSphere(24, 32);
+    CheckIndexRoundTrip(mesh.indices);
+    MeshOptimizer::OptimizeVertexCache(mesh.indices, mesh.vertices.size());
+    MeshOptimizer::OptimizeVertexFetch(mesh, VertexFormatStride(VertexFormat::Float32));
+    CheckIndexRoundTrip(mesh.indices);
+
+    // 最適化済みの列は 1 インデックスあたり 1 バイトを十分下回る
+    std::vector<uint8_t> encoded;
+    MeshCodec::EncodeIndexBuffer(mesh.indices.data(), mesh.indices.size(), encoded);
+    TEST_CHECK(encoded.size() < mesh.indices.size());
+
+    TestMeshes::ShuffleTriangles(mesh.indices, 3);
+    CheckIndexRoundTrip(mesh.indices);
+    CheckIndexRoundTrip(TestMeshes::MakeGrid(20).indices);
+
+    // 縮退した三角形と大きな番号の飛び
+    CheckIndexRoundTrip({ 0, 0, 0, 5, 5, 1, 100000, 2, 70000, 0xfffffffe, 1, 3 });
+    CheckIndexRoundTrip({});
+}
+
+TEST_SUITE(VertexCodec)
+{
+    MeshData mesh = TestMeshes::MakeSphere(24, 32);
+    MeshOptimizer::OptimizeVertexCache(mesh.indices, mesh.vertices.size());
+    MeshOptimizer::OptimizeVertexFetch(mesh, VertexFormatStride(VertexFormat::Float32));
+
+    // MeshVertex そのままと、GPU に渡す2つの形式
+    CheckVertexRoundTrip(mesh.vertices.data(), mesh.vertices.size(), sizeof(MeshVertex));
+    const VertexQuantization quantization = VertexPacking::ComputeQuantization(mesh.vertices);
+    for (VertexFormat format : { VertexFormat::Float32, VertexFormat::Packed16 })
+    {
+        std::vector<uint8_t> packed;
+        VertexPacking::PackVertices(mesh.vertices, format, quantization, packed);
+        CheckVertexRoundTrip(packed.data(), mesh.vertices.size(), VertexFormatStride(format));
+    }
+
+    // 乱数のバイト列（差分が大きく 8bit のグループになる）を、ブロックやグループの端数が出る頂点数と stride で
+    std::vector<uint8_t> noise(70000);
+    uint32_t state = 12345;
+    for (uint8_t& b : noise)
+    {
+        state = state * 1664525u + 1013904223u;
+        b = uint8_t(state >> 24);
+    }
+    const size_t strides[] = { 1, 3, 4, 17, 28, 72 };
+    const size_t counts[] = { 0, 1, 15, 16, 17, 257, 900 };
+    for (size_t stride : strides)
+    {
+        for (size_t count : counts)
+        {
+            if (count * stride <= noise.size()) CheckVertexRoundTrip(noise.data(), count, stride);
+        }
+    }
+}
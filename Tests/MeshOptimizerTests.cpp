@@ -0,0 +1,218 @@
+﻿#include <algorithm>
+#include <array>
+#include <cstring>
+#include "MeshOptimizer.h"
+#include "TestHarness.h"
+#include "TestMeshes.h"
+
+namespace
+{
+    using Triangle = std::array<uint32_t, 3>;
+
+    // 向きを保ったまま最小の番号が先頭に来るよう回した三角形の一覧（並べ替えの前後の比較用）
+    std::vector<Triangle> CanonicalTriangles(const std::vector<uint32_t>& indices)
+    {
+        std::vector<Triangle> triangles;
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            Triangle t = { indices[i], indices[i + 1], indices[i + 2] };
+            while (t[0] > t[1] || t[0] > t[2]) t = { t[1], t[2], t[0] };
+            triangles.push_back(t);
+        }
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    }
+
+    // インデックスが初めて現れるときは必ず今までの最大 + 1（頂点が初出順に並んでいる）
+    bool IsFirstUseOrder(const std::vector<uint32_t>& indices)
+    {
+        uint32_t next = 0;
+        for (uint32_t index : indices)
+        {
+            if (index == next) next++;
+            else if (index > next) return false;
+        }
+        return true;
+    }
+
+    // 中心を共有する大きさの違う球を、内側から順に（オーバードローが最も多くなる順で）1つのメッシュにまとめる
+    MeshData MakeNestedSpheres(uint32_t count)
+    {
+        MeshData nested;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const MeshData sphere = TestMeshes::MakeSphere(24, 32);
+            const float radius = float(i + 1) / float(count);
+            const uint32_t base = uint32_t(nested.vertices.size());
+            for (MeshVertex v : sphere.vertices)
+            {
+                v.pos = { v.pos.x * radius, v.pos.y * radius, v.pos.z * radius };
+                nested.vertices.push_back(v);
+            }
+            for (uint32_t index : sphere.indices) nested.indices.push_back(base + index);
+        }
+        return nested;
+    }
+
+    // ビット単位で比べる（WeldVertices と同じく -0.0 と +0.0 は同じとみなす）
+    bool SameVertex(const MeshVertex& a, const MeshVertex& b)
+    {
+        uint32_t wa[sizeof(MeshVertex) / 4], wb[sizeof(MeshVertex) / 4];
+        std::memcpy(wa, &a, sizeof(MeshVertex));
+        std::memcpy(wb, &b, sizeof(MeshVertex));
+        for (size_t i = 0; i < sizeof(MeshVertex) / 4; i++)
+        {
+            if ((wa[i] == 0x80000000u ? 0u : wa[i]) != (wb[i] == 0x80000000u ? 0u : wb[i])) return false;
+        }
+        return true;
+    }
+}
+
+TEST_SUITE(WeldVertices)
+{
+    const MeshData source = TestMeshes::MakeSphere(12, 16);
+    MeshData mesh = TestMeshes::Unweld(source);
+    const MeshData unwelded = mesh;
+    const MeshOptimizer::WeldStats stats = MeshOptimizer::WeldVertices(mesh);
+
+    // 元の球で使われている頂点の数までまとまり、各コーナーの頂点の値は変わらない
+    std::vector<uint32_t> used(source.indices);
+    std::sort(used.begin(), used.end());
+    used.erase(std::unique(used.begin(), used.end()), used.end());
+    TEST_CHECK(stats.inputVertexCount == unwelded.vertices.size());
+    TEST_CHECK(stats.outputVertexCount == used.size());
+    TEST_CHECK(mesh.vertices.size() == used.size());
+    TEST_CHECK(mesh.indices.size() == unwelded.indices.size());
+    for (size_t i = 0; i < mesh.indices.size(); i++)
+    {
+        TEST_CHECK(SameVertex(mesh.vertices[mesh.indices[i]], unwelded.vertices[unwelded.indices[i]]));
+    }
+
+    // -0.0 と +0.0 だけが違う頂点は1つになる
+    MeshData zeros;
+    MeshVertex a = {};
+    MeshVertex b = {};
+    b.pos.x = -0.0f;
+    MeshVertex c = {};
+    c.pos.y = 1.0f;
+    zeros.vertices = { a, b, c };
+    zeros.indices = { 0, 1, 2 };
+    MeshOptimizer::WeldVertices(zeros);
+    TEST_CHECK(zeros.vertices.size() == 2);
+    TEST_CHECK(zeros.indices[0] == zeros.indices[1]);
+}
+
+TEST_SUITE(OptimizeVertexCache)
+{
+    MeshData mesh = TestMeshes::MakeSphere(32, 48);
+    TestMeshes::ShuffleTriangles(mesh.indices, 1);
+    const std::vector<Triangle> before = CanonicalTriangles(mesh.indices);
+    const MeshOptimizer::VertexCacheStats shuffled = MeshOptimizer::AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+    MeshOptimizer::OptimizeVertexCache(mesh.indices, mesh.vertices.size());
+    const MeshOptimizer::VertexCacheStats optimized = MeshOptimizer::AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+    // 同じ三角形（向きも同じ）を並べ替えただけで、ACMR / ATVR は上がらない
+    TEST_CHECK(CanonicalTriangles(mesh.indices) == before);
+    TEST_CHECK(optimized.acmr <= shuffled.acmr);
+    TEST_CHECK(optimized.atvr <= shuffled.atvr);
+    // 格子状のメッシュなら Forsyth 法で 1 頂点/三角形を十分下回る
+    TEST_CHECK(optimized.acmr < 0.8f);
+
+    // 最適化済みの列にもう一度掛けても悪くならない
+    MeshOptimizer::OptimizeVertexCache(mesh.indices, mesh.vertices.size());
+    TEST_CHECK(MeshOptimizer::AnalyzeVertexCache(mesh.indices, mesh.vertices.size()).acmr <= optimized.acmr + 1.0e-6f);
+}
+
+TEST_SUITE(OptimizeOverdraw)
+{
+    // インポートと同じく頂点キャッシュの最適化の後に掛ける
+    MeshData mesh = MakeNestedSpheres(3);
+    TestMeshes::ShuffleTriangles(mesh.indices, 4);
+    MeshOptimizer::OptimizeVertexCache(mesh.indices, mesh.vertices.size());
+    const std::vector<Triangle> triangles = CanonicalTriangles(mesh.indices);
+
+    MeshImportOptions options;
+    const MeshOptimizer::OverdrawStats before = MeshOptimizer::AnalyzeOverdraw(mesh.indices, mesh.vertices);
+    const MeshOptimizer::VertexCacheStats cacheBefore = MeshOptimizer::AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+    MeshOptimizer::OptimizeOverdraw(mesh.indices, mesh.vertices, options.overdrawThreshold);
+    const MeshOptimizer::OverdrawStats after = MeshOptimizer::AnalyzeOverdraw(mesh.indices, mesh.vertices);
+    const MeshOptimizer::VertexCacheStats cacheAfter = MeshOptimizer::AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+    // 同じ三角形を並べ替えただけなので覆う範囲は同じで、オーバードローは減る
+    TEST_CHECK(CanonicalTriangles(mesh.indices) == triangles);
+    TEST_CHECK(after.pixelsCovered == before.pixelsCovered);
+    TEST_CHECK(before.overdraw > 1.0f);
+    TEST_CHECK(after.overdraw < before.overdraw);
+    // ACMR の悪化は overdrawThreshold の範囲に収まる
+    TEST_CHECK(cacheAfter.acmr <= cacheBefore.acmr * options.overdrawThreshold);
+}
+
+TEST_SUITE(OptimizeVertexFetch)
+{
+    const size_t gpuStride = VertexFormatStride(VertexFormat::Float32);
+
+    MeshData mesh = TestMeshes::MakeSphere(16, 24);
+    TestMeshes::ShuffleTriangles(mesh.indices, 2);
+    // 使われない頂点を1つ足しておく（削除される）
+    MeshVertex unused = {};
+    unused.pos = { 5.0f, 5.0f, 5.0f };
+    mesh.vertices.push_back(unused);
+    const MeshData original = mesh;
+
+    const size_t count = MeshOptimizer::OptimizeVertexFetch(mesh, gpuStride);
+    std::vector<uint32_t> used(original.indices);
+    std::sort(used.begin(), used.end());
+    used.erase(std::unique(used.begin(), used.end()), used.end());
+    TEST_CHECK(count == used.size());
+    TEST_CHECK(mesh.vertices.size() == count);
+
+    // 新しい番号 -> 元の番号の対応が使われた頂点の並べ替え（重複も欠けもない）で、各コーナーの頂点の値は同じ
+    std::vector<uint32_t> remap(count, UINT32_MAX);
+    bool consistent = true;
+    for (size_t i = 0; i < mesh.indices.size(); i++)
+    {
+        const uint32_t to = mesh.indices[i], from = original.indices[i];
+        if (to >= count) { consistent = false; break; }
+        if (remap[to] == UINT32_MAX) remap[to] = from;
+        consistent = consistent && remap[to] == from && SameVertex(mesh.vertices[to], original.vertices[from]);
+    }
+    TEST_CHECK(consistent);
+    std::vector<uint32_t> sorted(remap);
+    std::sort(sorted.begin(), sorted.end());
+    TEST_CHECK(sorted == used);
+
+    // 並びは初出順か、元の並びのまま詰めたもののどちらか
+    TEST_CHECK(IsFirstUseOrder(mesh.indices) || remap == used);
+
+    // 走査順の格子（すでに局所性が高い）は、頂点キャッシュの最適化の後でも GPU の頂点の大きさで読み込みが増えない
+    for (VertexFormat format : { VertexFormat::Float32, VertexFormat::Packed16 })
+    {
+        const size_t stride = VertexFormatStride(format);
+        MeshData grid = TestMeshes::MakeGrid(96);
+        MeshOptimizer::OptimizeVertexCache(grid.indices, grid.vertices.size());
+        const MeshOptimizer::VertexFetchStats gridBefore = MeshOptimizer::AnalyzeVertexFetch(grid.indices, grid.vertices.size(), stride);
+        MeshOptimizer::OptimizeVertexFetch(grid, stride);
+        const MeshOptimizer::VertexFetchStats gridAfter = MeshOptimizer::AnalyzeVertexFetch(grid.indices, grid.vertices.size(), stride);
+        TEST_CHECK(gridAfter.cacheLineMisses <= gridBefore.cacheLineMisses);
+        TEST_CHECK(gridAfter.overfetch <= gridBefore.overfetch);
+    }
+
+    // インポートと同じ流れ（元の三角形の順は任意 -> 溶接 -> 頂点キャッシュの最適化）の後に並べ直すと
+    // キャッシュラインの読み込みははっきり減る（溶接で決まった頂点の並びは三角形の新しい順とばらばらなので、初出順が選ばれる）
+    MeshData imported = TestMeshes::MakeSphere(32, 48);
+    TestMeshes::ShuffleTriangles(imported.indices, 3);
+    imported = TestMeshes::Unweld(imported);
+    MeshOptimizer::WeldVertices(imported);
+    MeshOptimizer::OptimizeVertexCache(imported.indices, imported.vertices.size());
+    for (size_t stride : { gpuStride, sizeof(MeshVertex) })
+    {
+        MeshData reordered = imported;
+        const MeshOptimizer::VertexFetchStats fetchBefore = MeshOptimizer::AnalyzeVertexFetch(reordered.indices, reordered.vertices.size(), stride);
+        MeshOptimizer::OptimizeVertexFetch(reordered, stride);
+        const MeshOptimizer::VertexFetchStats fetchAfter = MeshOptimizer::AnalyzeVertexFetch(reordered.indices, reordered.vertices.size(), stride);
+        TEST_CHECK(fetchAfter.overfetch < fetchBefore.overfetch);
+        TEST_CHECK(fetchAfter.cacheLineMisses < fetchBefore.cacheLineMisses);
+        TEST_CHECK(IsFirstUseOrder(reordered.indices));
+    }
+}
@@ -0,0 +1,140 @@
+﻿#include <algorithm>
+#include <map>
+#include <utility>
+#include "MeshSimplifier.h"
+#include "TestHarness.h"
+#include "TestMeshes.h"
+
+namespace
+{
+    bool ValidTriangles(const std::vector<uint32_t>& indices, size_t vertexCount)
+    {
+        if (indices.size() % 3 != 0) return false;
+        for (uint32_t index : indices)
+        {
+            if (index >= vertexCount) return false;
+        }
+        return true;
+    }
+
+    // 1つの三角形にしか使われない辺（開いた縁）
+    std::vector<std::pair<uint32_t, uint32_t>> OpenEdges(const std::vector<uint32_t>& indices)
+    {
+        std::map<std::pair<uint32_t, uint32_t>, int> count;
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                const uint32_t a = indices[i + k], b = indices[i + (k + 1) % 3];
+                count[{ std::min(a, b), std::max(a, b) }]++;
+            }
+        }
+        std::vector<std::pair<uint32_t, uint32_t>> edges;
+        for (const auto& [edge, n] : count)
+        {
+            if (n == 1) edges.push_back(edge);
+        }
+        return edges;
+    }
+}
+
+TEST_SUITE(SimplifyLevels)
+{
+    const MeshData sphere = TestMeshes::MakeSphere(32, 48);
+    const size_t indexCount = sphere.indices.size();
+    const std::vector<size_t> targets = { indexCount / 2, indexCount / 4, indexCount / 10 };
+
+    std::vector<MeshSimplifier::SimplifiedLevel> levels;
+    MeshSimplifier::SimplifyOptions options;
+    const size_t count = MeshSimplifier::Simplify(sphere.vertices, sphere.indices.data(), indexCount, targets, options, levels);
+
+    // 誤差の上限なしなら全段に届き、各段は目標のインデックス数以下で、誤差は段ごとに減らない
+    TEST_CHECK(count == targets.size());
+    TEST_CHECK(levels.size() >= count);
+    float previousError = 0.0f;
+    size_t previousCount = indexCount;
+    for (size_t i = 0; i < count && i < levels.size(); i++)
+    {
+        const MeshSimplifier::SimplifiedLevel& level = levels[i];
+        TEST_CHECK(ValidTriangles(level.indices, sphere.vertices.size()));
+        TEST_CHECK(level.indices.size() <= targets[i]);
+        TEST_CHECK(!level.indices.empty());
+        TEST_CHECK(level.indices.size() <= previousCount);
+        TEST_CHECK(level.error >= previousError);
+        previousError = level.error;
+        previousCount = level.indices.size();
+    }
+    TEST_CHECK(count == 0 || levels[count - 1].error > 0.0f);
+
+    // 誤差の上限（大きさは AABB の最も長い辺で 2）を付けると縮約できる辺が尽きて止まる
+    // 届かなかった段は最後の状態が1段として出るので、それ以外の段は目標を満たし、どの段も誤差は上限を超えない
+    const float sphereSize = 2.0f;
+    MeshSimplifier::SimplifyOptions strict = options;
+    strict.maxError = 0.001f;
+    std::vector<MeshSimplifier::SimplifiedLevel> limited;
+    const size_t limitedCount = MeshSimplifier::Simplify(sphere.vertices, sphere.indices.data(), indexCount, targets, strict, limited);
+    TEST_CHECK(limitedCount >= 1 && limitedCount <= targets.size());
+    previousError = 0.0f;
+    for (size_t i = 0; i < limitedCount && i < limited.size(); i++)
+    {
+        TEST_CHECK(limited[i].error <= strict.maxError * sphereSize * 1.0001f);
+        TEST_CHECK(limited[i].error >= previousError);
+        TEST_CHECK(i + 1 == limitedCount || limited[i].indices.size() <= targets[i]);
+        previousError = limited[i].error;
+    }
+    if (!limited.empty())
+    {
+        TEST_CHECK(limited.back().indices.size() > targets[limitedCount - 1]);
+        TEST_CHECK(limited.back().indices.size() < indexCount);
+    }
+}
+
+TEST_SUITE(SimplifyLockBorder)
+{
+    const uint32_t cells = 24;
+    const MeshData grid = TestMeshes::MakeGrid(cells);
+    const std::vector<std::pair<uint32_t, uint32_t>> border = OpenEdges(grid.indices);
+    std::vector<bool> isBorder(grid.vertices.size(), false);
+    for (const auto& [a, b] : border)
+    {
+        isBorder[a] = true;
+        isBorder[b] = true;
+    }
+    const size_t borderVertices = size_t(std::count(isBorder.begin(), isBorder.end(), true));
+    TEST_CHECK(borderVertices == cells * 4);
+
+    const std::vector<size_t> targets = { grid.indices.size() / 3, grid.indices.size() / 10 };
+    for (bool lockBorder : { true, false })
+    {
+        MeshSimplifier::SimplifyOptions options;
+        options.lockBorder = lockBorder;
+        std::vector<MeshSimplifier::SimplifiedLevel> levels;
+        const size_t count = MeshSimplifier::Simplify(grid.vertices, grid.indices.data(), grid.indices.size(), targets, options, levels);
+        TEST_CHECK(count >= 1);
+
+        for (size_t i = 0; i < count && i < levels.size(); i++)
+        {
+            const std::vector<uint32_t>& indices = levels[i].indices;
+            TEST_CHECK(ValidTriangles(indices, grid.vertices.size()));
+            std::vector<bool> used(grid.vertices.size(), false);
+            for (uint32_t index : indices) used[index] = true;
+            size_t borderKept = 0;
+            for (size_t v = 0; v < grid.vertices.size(); v++) borderKept += isBorder[v] && used[v] ? 1 : 0;
+
+            // 縁を固定すると縁の頂点はすべて残り、開いた辺は縁の頂点どうしを結ぶ（縁は元の位置のまま）
+            // 固定しないと強く簡略化した段では縁の頂点も縮約される
+            if (lockBorder)
+            {
+                TEST_CHECK(borderKept == borderVertices);
+                bool onBorder = true;
+                for (const auto& [a, b] : OpenEdges(indices)) onBorder = onBorder && isBorder[a] && isBorder[b];
+                TEST_CHECK(onBorder);
+                TEST_CHECK(OpenEdges(indices).size() == border.size());
+            }
+            else if (i + 1 == count)
+            {
+                TEST_CHECK(borderKept < borderVertices);
+            }
+        }
+    }
+}
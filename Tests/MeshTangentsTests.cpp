@@ -0,0 +1,173 @@
+﻿#include <cmath>
+#include <cstring>
+#include "MeshTangents.h"
+#include "TestHarness.h"
+#include "TestMeshes.h"
+#include "ThreadPool.h"
+
+namespace
+{
+    constexpr float kTolerance = 1.0e-5f;
+
+    bool Near(const Float3& a, const Float3& b)
+    {
+        return std::fabs(a.x - b.x) <= kTolerance && std::fabs(a.y - b.y) <= kTolerance && std::fabs(a.z - b.z) <= kTolerance;
+    }
+
+    Float3 TangentOf(const MeshVertex& v)
+    {
+        return { v.tangent.x, v.tangent.y, v.tangent.z };
+    }
+
+    // シェーダー（PSMain）と同じ従法線: tangent.w * cross(normal, tangent)
+    Float3 Bitangent(const MeshVertex& v)
+    {
+        const Float3& n = v.normal;
+        const Float3 t = TangentOf(v);
+        const Float3 c = { n.y * t.z - n.z * t.y, n.z * t.x - n.x * t.z, n.x * t.y - n.y * t.x };
+        return { c.x * v.tangent.w, c.y * v.tangent.w, c.z * v.tangent.w };
+    }
+
+    MeshVertex Corner(float x, float y, float u, float v)
+    {
+        MeshVertex vertex{};
+        vertex.pos = { x, y, 0.0f };
+        vertex.normal = { 0.0f, 0.0f, 1.0f };
+        vertex.uv = { u, v };
+        return vertex;
+    }
+
+    // xy 平面上の 1x1 の四角形（法線 +z、cross(p1 - p0, p2 - p0) が法線の向き）
+    // uv(x, y) で各頂点の UV を決める
+    template <class Uv>
+    MeshData MakeQuad(Uv uv)
+    {
+        MeshData mesh;
+        const float corners[4][2] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } };
+        for (const float (&c)[2] : corners)
+        {
+            const Float2 t = uv(c[0], c[1]);
+            mesh.vertices.push_back(Corner(c[0], c[1], t.x, t.y));
+        }
+        mesh.indices = { 0, 1, 2, 0, 2, 3 };
+        return mesh;
+    }
+
+    // すべての頂点が同じ接線と従法線の向きを持つか
+    bool AllTangents(const MeshData& mesh, const Float3& tangent, float w)
+    {
+        bool same = true;
+        for (const MeshVertex& v : mesh.vertices) same = same && Near(TangentOf(v), tangent) && v.tangent.w == w;
+        return same;
+    }
+
+    bool AllBitangents(const MeshData& mesh, const Float3& bitangent)
+    {
+        bool same = true;
+        for (const MeshVertex& v : mesh.vertices) same = same && Near(Bitangent(v), bitangent);
+        return same;
+    }
+}
+
+TEST_SUITE(Tangents)
+{
+    // 接線は +dP/du、従法線（w * cross(N, T)）は +dP/dv
+    MeshData plain = MakeQuad([](float x, float y) { return Float2{ x, y }; });
+    MeshTangents::TangentStats stats = MeshTangents::GenerateTangents(plain);
+    TEST_CHECK(stats.splitVertices == 0 && stats.degenerateTriangles == 0 && stats.fallbackVertices == 0);
+    TEST_CHECK(AllTangents(plain, { 1.0f, 0.0f, 0.0f }, 1.0f));
+    TEST_CHECK(AllBitangents(plain, { 0.0f, 1.0f, 0.0f }));
+
+    // u を鏡映すると接線が反転し、w も反転して従法線は +dP/dv のまま
+    MeshData mirrored = MakeQuad([](float x, float y) { return Float2{ 1.0f - x, y }; });
+    MeshTangents::GenerateTangents(mirrored);
+    TEST_CHECK(AllTangents(mirrored, { -1.0f, 0.0f, 0.0f }, -1.0f));
+    TEST_CHECK(AllBitangents(mirrored, { 0.0f, 1.0f, 0.0f }));
+
+    // 左右対称の UV（左半分 u = x、右半分 u = 2 - x）: 継ぎ目の2頂点は UV が同じなので溶接で共有されているが、
+    // 両側で w が違うので複製され、どの三角形の角も自身の側の接線を持つ
+    {
+        MeshData strip;
+        for (int x = 0; x <= 2; x++)
+        {
+            const float u = x <= 1 ? float(x) : 2.0f - float(x);
+            strip.vertices.push_back(Corner(float(x), 0.0f, u, 0.0f));
+            strip.vertices.push_back(Corner(float(x), 1.0f, u, 1.0f));
+        }
+        // 頂点 2 * x が下、2 * x + 1 が上
+        strip.indices = { 0, 2, 3, 0, 3, 1, 2, 4, 5, 2, 5, 3 };
+        stats = MeshTangents::GenerateTangents(strip);
+        TEST_CHECK(stats.splitVertices == 2);
+        TEST_CHECK(strip.vertices.size() == 8);
+        bool sides = true, bitangents = true;
+        for (size_t c = 0; c < strip.indices.size(); c++)
+        {
+            const MeshVertex& v = strip.vertices[strip.indices[c]];
+            const bool left = c < 6;
+            sides = sides && Near(TangentOf(v), { left ? 1.0f : -1.0f, 0.0f, 0.0f }) && v.tangent.w == (left ? 1.0f : -1.0f);
+            bitangents = bitangents && Near(Bitangent(v), { 0.0f, 1.0f, 0.0f });
+        }
+        TEST_CHECK(sides);
+        TEST_CHECK(bitangents);
+        // 複製は継ぎ目の頂点 2, 3 の順に末尾に足され、位置と UV は元と同じ
+        for (uint32_t v : { 2u, 3u })
+        {
+            const MeshVertex& source = strip.vertices[v];
+            const MeshVertex& copy = strip.vertices[v + 4];
+            TEST_CHECK(Near(copy.pos, source.pos) && copy.uv.x == source.uv.x && copy.uv.y == source.uv.y);
+        }
+    }
+
+    // UV の面積が 0 の三角形は寄与しない。共有する頂点は他の三角形の接線を使い、
+    // 寄与がまったくない頂点は法線に直交する単位長の接線になる
+    {
+        MeshData mesh = MakeQuad([](float x, float y) { return Float2{ x, y }; });
+        mesh.vertices.pop_back();
+        mesh.indices = { 0, 1, 2 };
+        const uint32_t base = uint32_t(mesh.vertices.size());
+        mesh.vertices.push_back(Corner(2.0f, 0.0f, 0.5f, 0.5f));
+        mesh.vertices.push_back(Corner(3.0f, 0.0f, 0.5f, 0.5f));
+        mesh.vertices.push_back(Corner(3.0f, 1.0f, 0.5f, 0.5f));
+        // 2つ目の縮退は頂点 0, 2 と共有する（UV (0, 0), (1, 1), (0.5, 0.5) が一直線に並ぶ）
+        mesh.indices.insert(mesh.indices.end(), { base, base + 1, base + 2, 0, 2, base + 2 });
+        stats = MeshTangents::GenerateTangents(mesh);
+        TEST_CHECK(stats.degenerateTriangles == 2);
+        TEST_CHECK(stats.fallbackVertices == 3);
+        TEST_CHECK(stats.splitVertices == 0);
+        for (uint32_t v = 0; v < 3; v++) TEST_CHECK(Near(TangentOf(mesh.vertices[v]), { 1.0f, 0.0f, 0.0f }));
+        bool fallback = true;
+        for (uint32_t v = base; v < base + 3; v++)
+        {
+            const MeshVertex& vertex = mesh.vertices[v];
+            const Float3 t = TangentOf(vertex);
+            const float length = std::sqrt(t.x * t.x + t.y * t.y + t.z * t.z);
+            const float along = t.x * vertex.normal.x + t.y * vertex.normal.y + t.z * vertex.normal.z;
+            fallback = fallback && std::fabs(length - 1.0f) <= kTolerance && std::fabs(along) <= kTolerance &&
+                std::fabs(vertex.tangent.w) == 1.0f;
+        }
+        TEST_CHECK(fallback);
+    }
+
+    // FBX の UV は v が上向きで、取り込み時に v' = 1 - v に反転する（D3D のテクスチャ座標）
+    // 接線は反転後の UV から作るので、接線は同じで w が反転し、従法線は +dP/dv' = FBX の -dP/dv を向く
+    // つまり法線マップの緑はテクスチャの下向き（DirectX 形式）として読まれる
+    MeshData flipped = MakeQuad([](float x, float y) { return Float2{ x, 1.0f - y }; });
+    MeshTangents::GenerateTangents(flipped);
+    TEST_CHECK(AllTangents(flipped, { 1.0f, 0.0f, 0.0f }, -1.0f));
+    TEST_CHECK(AllBitangents(flipped, { 0.0f, -1.0f, 0.0f }));
+
+    // pool に分けても直列と同じ結果になる（三角形も頂点も並列の区間に分かれる大きさ）
+    {
+        MeshData serial = TestMeshes::MakeGrid(192);
+        MeshData parallel = serial;
+        ThreadPool pool(3);
+        const MeshTangents::TangentStats serialStats = MeshTangents::GenerateTangents(serial);
+        const MeshTangents::TangentStats parallelStats = MeshTangents::GenerateTangents(parallel, &pool);
+        TEST_CHECK(serialStats.splitVertices == parallelStats.splitVertices);
+        TEST_CHECK(serialStats.degenerateTriangles == parallelStats.degenerateTriangles);
+        TEST_CHECK(serialStats.fallbackVertices == parallelStats.fallbackVertices);
+        TEST_CHECK(serial.indices == parallel.indices);
+        TEST_CHECK(serial.vertices.size() == parallel.vertices.size() &&
+            std::memcmp(serial.vertices.data(), parallel.vertices.data(), serial.vertices.size() * sizeof(MeshVertex)) == 0);
+    }
+}
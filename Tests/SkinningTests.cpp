@@ -0,0 +1,196 @@
+﻿#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "Skinning.h"
+#include "TestHarness.h"
+#include "ThreadPool.h"
+
+namespace
+{
+    // SIMD 版とスカラー版の差の許容値（FMA と加算順の違いの分だけ）
+    constexpr float kTolerance = 1.0e-5f;
+
+    struct SkinnedMesh
+    {
+        std::vector<SkinnedVertex> bindPose;
+        std::vector<SkinWeights> weights;
+        std::vector<Skinning::SkinMatrix> palette;
+    };
+
+    Float3 Normalized(Float3 v)
+    {
+        const float length = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+        return { v.x / length, v.y / length, v.z / length };
+    }
+
+    // 1〜4本のウェイト（合計 1）を持つ乱数の頂点と、回転 + 平行移動の関節行列
+    SkinnedMesh MakeSkinnedMesh(size_t vertexCount, uint32_t jointCount, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        std::uniform_int_distribution<uint32_t> joint(0, jointCount - 1);
+        auto direction = [&]() { return Normalized({ unit(rng), unit(rng), unit(rng) + 2.0f }); };
+
+        SkinnedMesh mesh;
+        mesh.bindPose.resize(vertexCount);
+        mesh.weights.resize(vertexCount);
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            SkinnedVertex& v = mesh.bindPose[i];
+            v.pos = { unit(rng), unit(rng), unit(rng) };
+            v.normal = direction();
+            const Float3 t = direction();
+            v.tangent = { t.x, t.y, t.z, (i % 3 == 0) ? -1.0f : 1.0f };
+
+            SkinWeights& w = mesh.weights[i];
+            const size_t influences = 1 + i % 4;
+            float sum = 0.0f;
+            for (size_t k = 0; k < 4; k++)
+            {
+                w.joints[k] = k < influences ? uint16_t(joint(rng)) : 0;
+                w.weights[k] = k < influences ? unit(rng) + 1.5f : 0.0f;
+                sum += w.weights[k];
+            }
+            for (float& weight : w.weights) weight /= sum;
+        }
+
+        mesh.palette.resize(jointCount);
+        for (Skinning::SkinMatrix& m : mesh.palette)
+        {
+            const Float3 a = direction();
+            const float angle = unit(rng) * 3.14159265f;
+            const float c = std::cos(angle), s = std::sin(angle), ic = 1.0f - c;
+            const float rows[4][4] =
+            {
+                { c + a.x * a.x * ic,       a.x * a.y * ic + a.z * s, a.x * a.z * ic - a.y * s, 0.0f },
+                { a.y * a.x * ic - a.z * s, c + a.y * a.y * ic,       a.y * a.z * ic + a.x * s, 0.0f },
+                { a.z * a.x * ic + a.y * s, a.z * a.y * ic - a.x * s, c + a.z * a.z * ic,       0.0f },
+                { unit(rng),                unit(rng),                unit(rng),                1.0f },
+            };
+            std::memcpy(m.m, rows, sizeof(rows));
+        }
+        return mesh;
+    }
+
+    float Distance(const Float3& a, const Float3& b)
+    {
+        const float dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+        return std::sqrt(dx * dx + dy * dy + dz * dz);
+    }
+
+    // 先頭 count 頂点が基準と許容値内で一致し、その先（count 以降）に書き込んでいないか
+    bool MatchesReference(const std::vector<SkinnedVertex>& out, const std::vector<SkinnedVertex>& reference, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            const SkinnedVertex& a = out[i];
+            const SkinnedVertex& b = reference[i];
+            if (Distance(a.pos, b.pos) > kTolerance) return false;
+            if (Distance(a.normal, b.normal) > kTolerance) return false;
+            if (Distance({ a.tangent.x, a.tangent.y, a.tangent.z }, { b.tangent.x, b.tangent.y, b.tangent.z }) > kTolerance) return false;
+            if (a.tangent.w != b.tangent.w) return false;
+        }
+        for (size_t i = count; i < out.size(); i++)
+        {
+            if (out[i].pos.x != 123.0f || out[i].tangent.w != 123.0f) return false;
+        }
+        return true;
+    }
+
+    // 書き込まれなかった頂点が分かる値で埋めた出力（末尾に1頂点の余白を取る）
+    std::vector<SkinnedVertex> MakeOutput(size_t count)
+    {
+        SkinnedVertex fill;
+        fill.pos = { 123.0f, 123.0f, 123.0f };
+        fill.normal = { 123.0f, 123.0f, 123.0f };
+        fill.tangent = { 123.0f, 123.0f, 123.0f, 123.0f };
+        return std::vector<SkinnedVertex>(count + 1, fill);
+    }
+}
+
+TEST_SUITE(Skinning)
+{
+    ThreadPool pool(3);
+
+    // 単位行列のパレットではバインドポーズがそのまま出る（スカラー版の基準の確認）
+    {
+        const SkinnedMesh mesh = MakeSkinnedMesh(64, 4, 1);
+        std::vector<Skinning::SkinMatrix> identity(4);
+        for (Skinning::SkinMatrix& m : identity)
+        {
+            for (int r = 0; r < 4; r++) for (int c = 0; c < 4; c++) m.m[r][c] = r == c ? 1.0f : 0.0f;
+        }
+        std::vector<SkinnedVertex> out(mesh.bindPose.size());
+        Skinning::SkinVerticesReference(mesh.bindPose.data(), mesh.weights.data(), out.size(), identity.data(), out.data());
+        bool same = true;
+        for (size_t i = 0; i < out.size(); i++)
+        {
+            const SkinnedVertex& a = out[i];
+            const SkinnedVertex& b = mesh.bindPose[i];
+            same = same && Distance(a.pos, b.pos) <= kTolerance && Distance(a.normal, b.normal) <= kTolerance &&
+                Distance({ a.tangent.x, a.tangent.y, a.tangent.z }, { b.tangent.x, b.tangent.y, b.tangent.z }) <= kTolerance &&
+                a.tangent.w == b.tangent.w;
+        }
+        TEST_CHECK(same);
+    }
+
+    // 奇数を含むどの頂点数でも（AVX2 版の2頂点ずつの残り、並列版の区間の端）基準と一致し、範囲の外に書かない
+    const SkinnedMesh mesh = MakeSkinnedMesh(3 * 4096 + 7, 64, 2);
+    std::vector<SkinnedVertex> reference(mesh.bindPose.size());
+    Skinning::SkinVerticesReference(mesh.bindPose.data(), mesh.weights.data(), reference.size(), mesh.palette.data(), reference.data());
+    for (size_t count : { size_t(0), size_t(1), size_t(2), size_t(3), size_t(5), size_t(64), size_t(4097), mesh.bindPose.size() })
+    {
+        std::vector<SkinnedVertex> simd = MakeOutput(count);
+        Skinning::SkinVertices(mesh.bindPose.data(), mesh.weights.data(), count, mesh.palette.data(), simd.data());
+        TEST_CHECK(MatchesReference(simd, reference, count));
+
+        std::vector<SkinnedVertex> parallel = MakeOutput(count);
+        Skinning::SkinVerticesParallel(pool, mesh.bindPose.data(), mesh.weights.data(), count, mesh.palette.data(), parallel.data());
+        TEST_CHECK(MatchesReference(parallel, reference, count));
+    }
+
+    // 途中から始めても（16byte 境界にない入出力）同じ結果になる
+    {
+        const size_t offset = 1, count = 33;
+        std::vector<SkinnedVertex> simd = MakeOutput(count);
+        Skinning::SkinVertices(mesh.bindPose.data() + offset, mesh.weights.data() + offset, count, mesh.palette.data(), simd.data());
+        const std::vector<SkinnedVertex> shifted(reference.begin() + offset, reference.begin() + offset + count);
+        TEST_CHECK(MatchesReference(simd, shifted, count));
+    }
+
+    // ウェイトがすべて 0 の頂点は原点に潰れ、法線と接線は 0（NaN にならない）。従法線の向きは残る
+    {
+        SkinnedMesh zero = MakeSkinnedMesh(7, 8, 3);
+        for (size_t i = 0; i < zero.weights.size(); i += 2)
+        {
+            for (int k = 0; k < 4; k++) zero.weights[i].weights[k] = 0.0f;
+        }
+        std::vector<SkinnedVertex> expected(zero.bindPose.size());
+        Skinning::SkinVerticesReference(zero.bindPose.data(), zero.weights.data(), expected.size(), zero.palette.data(), expected.data());
+        bool collapsed = true;
+        for (size_t i = 0; i < expected.size(); i += 2)
+        {
+            const SkinnedVertex& v = expected[i];
+            collapsed = collapsed && v.pos.x == 0.0f && v.pos.y == 0.0f && v.pos.z == 0.0f &&
+                v.normal.x == 0.0f && v.normal.y == 0.0f && v.normal.z == 0.0f &&
+                v.tangent.x == 0.0f && v.tangent.y == 0.0f && v.tangent.z == 0.0f &&
+                v.tangent.w == zero.bindPose[i].tangent.w;
+        }
+        TEST_CHECK(collapsed);
+
+        std::vector<SkinnedVertex> simd = MakeOutput(zero.bindPose.size());
+        Skinning::SkinVertices(zero.bindPose.data(), zero.weights.data(), zero.bindPose.size(), zero.palette.data(), simd.data());
+        TEST_CHECK(MatchesReference(simd, expected, zero.bindPose.size()));
+
+        std::vector<SkinnedVertex> parallel = MakeOutput(zero.bindPose.size());
+        Skinning::SkinVerticesParallel(pool, zero.bindPose.data(), zero.weights.data(), zero.bindPose.size(), zero.palette.data(),
+            parallel.data());
+        TEST_CHECK(MatchesReference(parallel, expected, zero.bindPose.size()));
+    }
+
+    // ベンチマークの比較（SIMD 版と並列版をスカラー版と比べた最大誤差）も許容値に収まる
+    const Skinning::BenchmarkResult bench = Skinning::RunBenchmark(pool, 10001, 32, 1);
+    TEST_CHECK(bench.maxPositionError <= kTolerance);
+    TEST_CHECK(bench.maxNormalError <= kTolerance);
+}
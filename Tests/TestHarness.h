@@ -0,0 +1,32 @@
+﻿#pragma once
+#include <cstdio>
+#include <vector>
+
+// ヘッドレスのエンジンテスト（D3D / FBX SDK なし）
+// スイートは TEST_SUITE で定義すると自動で登録され、ctest にはスイートごとに1件として登録する
+namespace Tests
+{
+    struct Suite
+    {
+        const char* name;
+        void (*run)();
+    };
+
+    std::vector<Suite>& GetSuites();
+
+    // 失敗を数えて場所を表示する（スイートは最後まで続ける）
+    void ReportFailure(const char* expression, const char* file, int line);
+
+    struct Registrar
+    {
+        Registrar(const char* name, void (*run)()) { GetSuites().push_back({ name, run }); }
+    };
+}
+
+#define TEST_CHECK(expression) \
+    do { if (!(expression)) ::Tests::ReportFailure(#expression, __FILE__, __LINE__); } while (0)
+
+#define TEST_SUITE(name) \
+    static void name##Suite(); \
+    static ::Tests::Registrar name##Registrar(#name, name##Suite); \
+    static void name##Suite()
@@ -0,0 +1,42 @@
+﻿#include <cstring>
+#include "TestHarness.h"
+
+namespace
+{
+    int gFailures = 0;
+}
+
+namespace Tests
+{
+    std::vector<Suite>& GetSuites()
+    {
+        static std::vector<Suite> suites;
+        return suites;
+    }
+
+    void ReportFailure(const char* expression, const char* file, int line)
+    {
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+        gFailures++;
+    }
+}
+
+// 引数なしなら全スイート、あればその名前のスイートだけを実行する
+int main(int argc, char** argv)
+{
+    bool found = false;
+    for (const Tests::Suite& suite : Tests::GetSuites())
+    {
+        if (argc > 1 && std::strcmp(argv[1], suite.name) != 0) continue;
+        found = true;
+        const int before = gFailures;
+        suite.run();
+        std::printf("%-24s %s\n", suite.name, gFailures == before ? "passed" : "FAILED");
+    }
+    if (!found)
+    {
+        std::fprintf(stderr, "unknown test suite: %s\n", argc > 1 ? argv[1] : "(none)");
+        return 2;
+    }
+    return gFailures == 0 ? 0 : 1;
+}
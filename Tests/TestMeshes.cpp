@@ -0,0 +1,100 @@
+﻿#include "TestMeshes.h"
+#include <cmath>
+#include <utility>
+
+namespace TestMeshes
+{
+    MeshData MakeSphere(uint32_t rings, uint32_t segments)
+    {
+        const float pi = 3.14159265358979f;
+        MeshData mesh;
+        for (uint32_t r = 0; r <= rings; r++)
+        {
+            const float theta = pi * r / rings;
+            for (uint32_t s = 0; s <= segments; s++)
+            {
+                const float phi = 2.0f * pi * s / segments;
+                const Float3 n = { std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) };
+                MeshVertex v = {};
+                v.pos = n;
+                v.normal = n;
+                v.uv = { float(s) / segments, float(r) / rings };
+                v.tangent = { -std::sin(phi), 0.0f, std::cos(phi), 1.0f };
+                mesh.vertices.push_back(v);
+            }
+        }
+        const uint32_t stride = segments + 1;
+        for (uint32_t r = 0; r < rings; r++)
+        {
+            for (uint32_t s = 0; s < segments; s++)
+            {
+                const uint32_t a = r * stride + s, b = a + 1, c = a + stride, d = c + 1;
+                if (r > 0) mesh.indices.insert(mesh.indices.end(), { a, b, c });
+                if (r + 1 < rings) mesh.indices.insert(mesh.indices.end(), { b, d, c });
+            }
+        }
+        SubMesh submesh;
+        submesh.indexCount = uint32_t(mesh.indices.size());
+        submesh.vertexCount = uint32_t(mesh.vertices.size());
+        mesh.submeshes.push_back(submesh);
+        return mesh;
+    }
+
+    MeshData MakeGrid(uint32_t cells)
+    {
+        MeshData mesh;
+        for (uint32_t z = 0; z <= cells; z++)
+        {
+            for (uint32_t x = 0; x <= cells; x++)
+            {
+                MeshVertex v = {};
+                const float fx = float(x) / cells, fz = float(z) / cells;
+                v.pos = { fx, 0.02f * std::sin(fx * 7.0f) * std::cos(fz * 5.0f), fz };
+                v.normal = { 0.0f, 1.0f, 0.0f };
+                v.uv = { fx, fz };
+                v.tangent = { 1.0f, 0.0f, 0.0f, 1.0f };
+                mesh.vertices.push_back(v);
+            }
+        }
+        const uint32_t stride = cells + 1;
+        for (uint32_t z = 0; z < cells; z++)
+        {
+            for (uint32_t x = 0; x < cells; x++)
+            {
+                const uint32_t a = z * stride + x, b = a + 1, c = a + stride, d = c + 1;
+                mesh.indices.insert(mesh.indices.end(), { a, c, b, b, c, d });
+            }
+        }
+        SubMesh submesh;
+        submesh.indexCount = uint32_t(mesh.indices.size());
+        submesh.vertexCount = uint32_t(mesh.vertices.size());
+        mesh.submeshes.push_back(submesh);
+        return mesh;
+    }
+
+    MeshData Unweld(const MeshData& mesh)
+    {
+        MeshData result;
+        for (uint32_t index : mesh.indices)
+        {
+            result.indices.push_back(uint32_t(result.vertices.size()));
+            result.vertices.push_back(mesh.vertices[index]);
+        }
+        SubMesh submesh;
+        submesh.indexCount = uint32_t(result.indices.size());
+        submesh.vertexCount = uint32_t(result.vertices.size());
+        result.submeshes.push_back(submesh);
+        return result;
+    }
+
+    void ShuffleTriangles(std::vector<uint32_t>& indices, uint32_t seed)
+    {
+        const size_t triangles = indices.size() / 3;
+        for (size_t i = triangles; i > 1; i--)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            const size_t j = (seed >> 8) % i;
+            for (int k = 0; k < 3; k++) std::swap(indices[(i - 1) * 3 + k], indices[j * 3 + k]);
+        }
+    }
+}
@@ -0,0 +1,19 @@
+﻿#pragma once
+#include <cstdint>
+#include "MeshData.h"
+
+// テスト用の固定のメッシュ（乱数の種も固定なので毎回同じものができる）
+namespace TestMeshes
+{
+    // 閉じた UV 球（経度の継ぎ目と極は UV の違う頂点に分かれる）。接線は経度方向
+    MeshData MakeSphere(uint32_t rings, uint32_t segments);
+
+    // 開いた格子（xz 平面上の cells x cells マス、高さに少し凹凸がある）
+    MeshData MakeGrid(uint32_t cells);
+
+    // 三角形のコーナーごとに頂点を複製してインデックスを 0, 1, 2, ... にする（インポート直後の形）
+    MeshData Unweld(const MeshData& mesh);
+
+    // 三角形の順番を固定の乱数で入れ替える（頂点キャッシュの効率が悪い入力を作る）
+    void ShuffleTriangles(std::vector<uint32_t>& indices, uint32_t seed);
+}
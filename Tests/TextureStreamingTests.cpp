@@ -0,0 +1,99 @@
+﻿#include <algorithm>
+#include "TestHarness.h"
+#include "TextureStreaming.h"
+
+namespace
+{
+    using TextureStreaming::Streamer;
+
+    constexpr uint32_t kExtent = 1024;
+    constexpr uint32_t kMipCount = 11;
+
+    // 1024x1024 の BC1 テクスチャの mip 段から末尾までのバイト数
+    uint64_t BytesFrom(uint32_t mip)
+    {
+        uint64_t bytes = 0;
+        for (uint32_t m = mip; m < kMipCount; m++)
+        {
+            const uint32_t extent = std::max(kExtent >> m, 1u);
+            bytes += ImageSize(PixelFormat::BC1, extent, extent);
+        }
+        return bytes;
+    }
+
+    // 常駐量の統計が、各テクスチャの常駐する段から数えた合計と一致するか
+    bool ResidentBytesConsistent(const Streamer& streamer)
+    {
+        uint64_t bytes = 0;
+        for (uint32_t i = 0; i < streamer.GetTextureCount(); i++) bytes += BytesFrom(streamer.GetResidentMip(i));
+        return bytes == streamer.GetStats().residentBytes;
+    }
+
+    const Streamer::Change* FindChange(const std::vector<Streamer::Change>& changes, uint32_t texture)
+    {
+        for (const Streamer::Change& change : changes)
+        {
+            if (change.texture == texture) return &change;
+        }
+        return nullptr;
+    }
+}
+
+TEST_SUITE(StreamerRevert)
+{
+    // 1枚を細かい段まで読むと予算いっぱいになる設定
+    Streamer streamer;
+    const uint32_t a = streamer.Register(kExtent, kExtent, kMipCount, PixelFormat::BC1);
+    const uint32_t b = streamer.Register(kExtent, kExtent, kMipCount, PixelFormat::BC1);
+    const uint32_t tail = streamer.GetTailMip(a);
+    Streamer::Settings settings = streamer.GetSettings();
+    settings.budgetBytes = BytesFrom(0) + BytesFrom(tail);
+    settings.uploadBytesPerFrame = UINT64_MAX;
+    streamer.SetSettings(settings);
+    TEST_CHECK(tail > 0 && ResidentBytesConsistent(streamer));
+
+    // 読み込みを反映できなければ前の段に戻り、次のフレームで読み直す
+    std::vector<Streamer::Change> changes;
+    streamer.Request(a, 0.0f);
+    streamer.Update(changes);
+    TEST_CHECK(changes.size() == 1 && changes[0].texture == a && changes[0].firstMip == 0 && changes[0].previousMip == tail);
+    TEST_CHECK(ResidentBytesConsistent(streamer));
+    if (!changes.empty()) streamer.Revert(changes[0]);
+    TEST_CHECK(streamer.GetResidentMip(a) == tail);
+    TEST_CHECK(ResidentBytesConsistent(streamer));
+    TEST_CHECK(streamer.GetStats().reverts == 1);
+
+    streamer.Request(a, 0.0f);
+    streamer.Update(changes);
+    TEST_CHECK(changes.size() == 1 && streamer.GetResidentMip(a) == 0);
+    TEST_CHECK(ResidentBytesConsistent(streamer));
+
+    // b を読むために a を追い出す。追い出しを反映できなければ a の細かい段は残ったものとして数える
+    streamer.Request(b, 0.0f);
+    streamer.Update(changes);
+    const Streamer::Change* evicted = FindChange(changes, a);
+    const Streamer::Change* loaded = FindChange(changes, b);
+    TEST_CHECK(evicted && evicted->previousMip == 0 && evicted->firstMip > 0);
+    TEST_CHECK(loaded && loaded->firstMip == 0);
+    TEST_CHECK(ResidentBytesConsistent(streamer));
+    if (evicted) streamer.Revert(*evicted);
+    TEST_CHECK(streamer.GetResidentMip(a) == 0);
+    TEST_CHECK(ResidentBytesConsistent(streamer));
+
+    // 予算を超えた分は次の Update で追い出し直す
+    streamer.Request(b, 0.0f);
+    streamer.Update(changes);
+    TEST_CHECK(streamer.GetStats().residentBytes <= settings.budgetBytes);
+    TEST_CHECK(streamer.GetResidentMip(b) == 0 && streamer.GetResidentMip(a) > 0);
+    TEST_CHECK(ResidentBytesConsistent(streamer));
+
+    // 反映済みの変更をもう一度戻しても（段が変わっていれば）何もしない
+    const size_t reverts = streamer.GetStats().reverts;
+    if (loaded)
+    {
+        Streamer::Change stale = *loaded;
+        stale.firstMip = tail;
+        streamer.Revert(stale);
+    }
+    TEST_CHECK(streamer.GetStats().reverts == reverts && ResidentBytesConsistent(streamer));
+}
@@ -0,0 +1,199 @@
+﻿#include <cmath>
+#include <cstring>
+#include "TestHarness.h"
+#include "TestMeshes.h"
+#include "VertexPacking.h"
+
+namespace
+{
+    Float3 Normalize(const Float3& v)
+    {
+        const float length = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+        return { v.x / length, v.y / length, v.z / length };
+    }
+
+    float AngleDegrees(const Float3& a, const Float3& b)
+    {
+        const Float3 na = Normalize(a), nb = Normalize(b);
+        const float d = na.x * nb.x + na.y * nb.y + na.z * nb.z;
+        return std::acos(std::fmax(-1.0f, std::fmin(1.0f, d))) * 57.2957795f;
+    }
+
+    // 符号化して戻した法線と（法線に直交させた）接線の角度の誤差と、従法線の向きを調べる
+    void CheckQTangent(const Float3& normal, const Float4& tangent, float maxDegrees)
+    {
+        int16_t q[4];
+        VertexPacking::EncodeQTangent(normal, tangent, q);
+        Float3 n;
+        Float4 t;
+        VertexPacking::DecodeQTangent(q, n, t);
+
+        const Float3 nn = Normalize(normal);
+        const float along = nn.x * tangent.x + nn.y * tangent.y + nn.z * tangent.z;
+        const Float3 tn = { tangent.x - nn.x * along, tangent.y - nn.y * along, tangent.z - nn.z * along };
+        TEST_CHECK(AngleDegrees(nn, n) <= maxDegrees);
+        TEST_CHECK(AngleDegrees(tn, { t.x, t.y, t.z }) <= maxDegrees);
+        TEST_CHECK(t.w == (tangent.w < 0.0f ? -1.0f : 1.0f));
+        // 復元した接線は法線に直交する
+        TEST_CHECK(std::fabs(n.x * t.x + n.y * t.y + n.z * t.z) < 1.0e-3f);
+    }
+
+    uint32_t FloatBits(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+}
+
+TEST_SUITE(QTangent)
+{
+    // 球の上に散らばった法線と、それに直交する接線（従法線の向きは両方）
+    for (int i = 0; i < 200; i++)
+    {
+        const float z = 1.0f - 2.0f * (float(i) + 0.5f) / 200.0f;
+        const float r = std::sqrt(1.0f - z * z);
+        const float phi = float(i) * 2.39996323f;
+        const Float3 n = { r * std::cos(phi), r * std::sin(phi), z };
+        const Float3 helper = std::fabs(n.z) < 0.9f ? Float3{ 0.0f, 0.0f, 1.0f } : Float3{ 1.0f, 0.0f, 0.0f };
+        const Float3 t = Normalize({ helper.y * n.z - helper.z * n.y, helper.z * n.x - helper.x * n.z, helper.x * n.y - helper.y * n.x });
+        CheckQTangent(n, { t.x, t.y, t.z, 1.0f }, 0.05f);
+        CheckQTangent(n, { t.x, t.y, t.z, -1.0f }, 0.05f);
+    }
+
+    // 回転の w が 0 付近になる基底（180 度回転）でも従法線の向きが消えない
+    const Float3 flipped[] = { { 0.0f, 0.0f, -1.0f }, { 0.0f, 0.0f, -1.0f }, { 0.0f, -1.0f, 0.0f } };
+    const Float4 flippedTangents[] = { { 1.0f, 0.0f, 0.0f, 1.0f }, { -1.0f, 0.0f, 0.0f, 1.0f }, { -1.0f, 0.0f, 0.0f, 1.0f } };
+    for (int i = 0; i < 3; i++)
+    {
+        Float4 t = flippedTangents[i];
+        CheckQTangent(flipped[i], t, 0.05f);
+        t.w = -1.0f;
+        CheckQTangent(flipped[i], t, 0.05f);
+    }
+
+    // 法線とほぼ平行な接線（直交成分がわずか）でも法線は保たれ、接線は直交成分の向きになる
+    CheckQTangent({ 0.0f, 1.0f, 0.0f }, { 1.0e-3f, 1.0f, 0.0f, -1.0f }, 0.05f);
+    CheckQTangent({ 0.3f, 0.4f, 0.866f }, { 0.3f, 0.4f + 1.0e-3f, 0.866f, 1.0f }, 0.1f);
+
+    // 法線と平行な接線は任意の直交する向きで補う
+    int16_t q[4];
+    Float3 n;
+    Float4 t;
+    VertexPacking::EncodeQTangent({ 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, 2.0f, -1.0f }, q);
+    VertexPacking::DecodeQTangent(q, n, t);
+    TEST_CHECK(AngleDegrees({ 0.0f, 0.0f, 1.0f }, n) <= 0.05f);
+    TEST_CHECK(std::fabs(n.x * t.x + n.y * t.y + n.z * t.z) < 1.0e-3f);
+    TEST_CHECK(t.w == -1.0f);
+}
+
+TEST_SUITE(HalfFloat)
+{
+    using VertexPacking::FloatToHalf;
+    using VertexPacking::HalfToFloat;
+
+    // 非正規化数（最小は 2^-24）と、その半分ちょうどの偶数丸め
+    TEST_CHECK(FloatToHalf(std::ldexp(1.0f, -24)) == 0x0001);
+    TEST_CHECK(FloatToHalf(std::ldexp(1.0f, -25)) == 0x0000);
+    TEST_CHECK(FloatToHalf(std::ldexp(3.0f, -25)) == 0x0002);
+    TEST_CHECK(FloatToHalf(-std::ldexp(1.0f, -24)) == 0x8001);
+    TEST_CHECK(FloatToHalf(std::ldexp(1023.0f, -24)) == 0x03ff);
+    TEST_CHECK(FloatToHalf(std::ldexp(1.0f, -14)) == 0x0400);
+    TEST_CHECK(HalfToFloat(0x0001) == std::ldexp(1.0f, -24));
+    TEST_CHECK(HalfToFloat(0x83ff) == -std::ldexp(1023.0f, -24));
+    TEST_CHECK(FloatBits(HalfToFloat(0x8000)) == 0x80000000u);
+
+    // 正規化数の偶数丸め（1 と次の値のちょうど中間は 1 に、その次の中間は切り上げ）
+    TEST_CHECK(FloatToHalf(1.0f) == 0x3c00);
+    TEST_CHECK(FloatToHalf(1.0f + std::ldexp(1.0f, -11)) == 0x3c00);
+    TEST_CHECK(FloatToHalf(1.0f + std::ldexp(3.0f, -11)) == 0x3c02);
+    TEST_CHECK(FloatToHalf(1.0f + std::ldexp(1.0f, -11) + std::ldexp(1.0f, -20)) == 0x3c01);
+
+    // 最大値と Inf への丸め
+    TEST_CHECK(FloatToHalf(65504.0f) == 0x7bff);
+    TEST_CHECK(FloatToHalf(65519.0f) == 0x7bff);
+    TEST_CHECK(FloatToHalf(65520.0f) == 0x7c00);
+    TEST_CHECK(FloatToHalf(INFINITY) == 0x7c00);
+    TEST_CHECK(FloatToHalf(-INFINITY) == 0xfc00);
+    TEST_CHECK(HalfToFloat(0x7c00) == INFINITY);
+    TEST_CHECK(HalfToFloat(0xfc00) == -INFINITY);
+
+    // NaN は NaN のまま
+    const uint16_t nan = FloatToHalf(NAN);
+    TEST_CHECK((nan & 0x7c00) == 0x7c00 && (nan & 0x03ff) != 0);
+    TEST_CHECK(std::isnan(HalfToFloat(nan)));
+    TEST_CHECK(std::isnan(HalfToFloat(0x7e00)));
+
+    // NaN 以外のすべての half は float を経由しても同じビットに戻る
+    bool roundTrip = true;
+    for (uint32_t h = 0; h < 0x10000; h++)
+    {
+        if ((h & 0x7c00) == 0x7c00 && (h & 0x03ff) != 0) continue;
+        roundTrip = roundTrip && FloatToHalf(HalfToFloat(uint16_t(h))) == h;
+    }
+    TEST_CHECK(roundTrip);
+}
+
+TEST_SUITE(PackingErrorBound)
+{
+    // 従法線の向きが混ざった球を、大きめの座標に置いて両方の形式で詰める
+    MeshData mesh = TestMeshes::MakeSphere(24, 32);
+    for (size_t i = 0; i < mesh.vertices.size(); i++)
+    {
+        MeshVertex& v = mesh.vertices[i];
+        v.pos = { v.pos.x * 40.0f + 100.0f, v.pos.y * 40.0f - 20.0f, v.pos.z * 40.0f };
+        v.uv = { v.uv.x * 3.0f, v.uv.y * 3.0f };
+        if (i % 3 == 0) v.tangent.w = -1.0f;
+    }
+
+    const VertexQuantization quantization = VertexPacking::ComputeQuantization(mesh.vertices);
+    for (VertexFormat format : { VertexFormat::Float32, VertexFormat::Packed16 })
+    {
+        std::vector<uint8_t> packed;
+        VertexPacking::PackVertices(mesh.vertices, format, quantization, packed);
+        TEST_CHECK(packed.size() == mesh.vertices.size() * VertexFormatStride(format));
+
+        const VertexPacking::PackingStats stats = VertexPacking::MeasureError(mesh.vertices, packed, format, quantization);
+        TEST_CHECK(stats.measured.position <= stats.bound.position);
+        TEST_CHECK(stats.measured.normalDegrees <= stats.bound.normalDegrees);
+        TEST_CHECK(stats.measured.tangentDegrees <= stats.bound.tangentDegrees);
+        TEST_CHECK(stats.measured.uv <= stats.bound.uv);
+        // 従法線の向きはすべて保たれる（反転していれば 180 度になる）
+        TEST_CHECK(stats.measured.tangentDegrees < 90.0f);
+    }
+
+    // 半径 0.5 の小物と、そこから離れた 400 単位四方の地面を1つの頂点配列に並べる
+    // インポートと同じくサブメッシュの範囲ごとに量子化すると、小物は全体の AABB の刻みより細かく復元される
+    MeshData prop = TestMeshes::MakeSphere(16, 24);
+    for (MeshVertex& v : prop.vertices) v.pos = { v.pos.x * 0.5f, v.pos.y * 0.5f + 1.0f, v.pos.z * 0.5f };
+    MeshData ground = TestMeshes::MakeGrid(32);
+    for (MeshVertex& v : ground.vertices) v.pos = { v.pos.x * 400.0f + 300.0f, 0.0f, v.pos.z * 400.0f - 200.0f };
+    std::vector<MeshVertex> scene(prop.vertices);
+    scene.insert(scene.end(), ground.vertices.begin(), ground.vertices.end());
+
+    const size_t stride = VertexFormatStride(VertexFormat::Packed16);
+    const VertexQuantization wide = VertexPacking::ComputeQuantization(scene);
+    std::vector<uint8_t> packedWide;
+    VertexPacking::PackVertices(scene, VertexFormat::Packed16, wide, packedWide);
+    const VertexPacking::PackingStats propWide = VertexPacking::MeasureError(scene.data(), prop.vertices.size(), packedWide.data(),
+        VertexFormat::Packed16, wide);
+
+    std::vector<uint8_t> packed(scene.size() * stride);
+    const VertexQuantization propQuantization = VertexPacking::ComputeQuantization(scene.data(), prop.vertices.size());
+    const VertexQuantization groundQuantization = VertexPacking::ComputeQuantization(scene.data() + prop.vertices.size(),
+        ground.vertices.size());
+    VertexPacking::PackVertices(scene.data(), prop.vertices.size(), VertexFormat::Packed16, propQuantization, packed.data());
+    VertexPacking::PackVertices(scene.data() + prop.vertices.size(), ground.vertices.size(), VertexFormat::Packed16,
+        groundQuantization, packed.data() + prop.vertices.size() * stride);
+    const VertexPacking::PackingStats propOwn = VertexPacking::MeasureError(scene.data(), prop.vertices.size(), packed.data(),
+        VertexFormat::Packed16, propQuantization);
+    const VertexPacking::PackingStats groundOwn = VertexPacking::MeasureError(scene.data() + prop.vertices.size(),
+        ground.vertices.size(), packed.data() + prop.vertices.size() * stride, VertexFormat::Packed16, groundQuantization);
+    const VertexPacking::PackingStats groundWide = VertexPacking::MeasureError(scene.data() + prop.vertices.size(),
+        ground.vertices.size(), packedWide.data() + prop.vertices.size() * stride, VertexFormat::Packed16, wide);
+
+    TEST_CHECK(propOwn.measured.position <= propOwn.bound.position);
+    TEST_CHECK(groundOwn.measured.position <= groundOwn.bound.position);
+    TEST_CHECK(propOwn.measured.position * 100.0f < propWide.measured.position);
+    TEST_CHECK(groundOwn.measured.position <= groundWide.measured.position);
+}